@@ -46,6 +46,7 @@ versions bear some notice that they have been modified.
 #include <stdarg.h>
 #endif
 #include "posemath.h"
+#include "pminline.h"
 
 //#include "sincos.h"
 
@@ -916,57 +917,49 @@ int pmCartCartCompare(PmCartesian v1, PmCartesian v2)
 
 int pmCartCartDot(PmCartesian v1, PmCartesian v2, double *d)
 {
-   *d = v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+   *d = pmCartCartDotI(&v1, &v2);
 
    return pmErrno = 0;
 }
 
 int pmCartCartCross(PmCartesian v1, PmCartesian v2, PmCartesian * vout)
 {
-   vout->x = v1.y * v2.z - v1.z * v2.y;
-   vout->y = v1.z * v2.x - v1.x * v2.z;
-   vout->z = v1.x * v2.y - v1.y * v2.x;
+   pmCartCartCrossI(&v1, &v2, vout);
 
    return pmErrno = 0;
 }
 
 int pmCartMag(PmCartesian v, double *d)
 {
-   *d = pmSqrt(pmSq(v.x) + pmSq(v.y) + pmSq(v.z));
+   *d = pmCartMagI(&v);
 
    return pmErrno = 0;
 }
 
 int pmCartCartDisp(PmCartesian v1, PmCartesian v2, double *d)
 {
-   *d = pmSqrt(pmSq(v2.x - v1.x) + pmSq(v2.y - v1.y) + pmSq(v2.z - v1.z));
+   *d = pmCartCartDispI(&v1, &v2);
 
    return pmErrno = 0;
 }
 
 int pmCartCartAdd(PmCartesian v1, PmCartesian v2, PmCartesian * vout)
 {
-   vout->x = v1.x + v2.x;
-   vout->y = v1.y + v2.y;
-   vout->z = v1.z + v2.z;
+   pmCartCartAddI(&v1, &v2, vout);
 
    return pmErrno = 0;
 }
 
 int pmCartCartSub(PmCartesian v1, PmCartesian v2, PmCartesian * vout)
 {
-   vout->x = v1.x - v2.x;
-   vout->y = v1.y - v2.y;
-   vout->z = v1.z - v2.z;
+   pmCartCartSubI(&v1, &v2, vout);
 
    return pmErrno = 0;
 }
 
 int pmCartScalMult(PmCartesian v1, double d, PmCartesian * vout)
 {
-   vout->x = v1.x * d;
-   vout->y = v1.y * d;
-   vout->z = v1.z * d;
+   pmCartScalMultI(&v1, d, vout);
 
    return pmErrno = 0;
 }
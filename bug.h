@@ -7,13 +7,30 @@
 #define _STRINGIZE(x) #x
 #define STRINGIZE(x) _STRINGIZE(x)
 
-#define BUG(args...) emc_logger_cb(__FILE__ " " STRINGIZE(__LINE__) ": " args)
-#define MSG(args...) emc_logger_cb(args)
+/* Log levels, see emc_ui_logger_level_set(). */
+#define EMC_LOG_BUG 1
+#define EMC_LOG_MSG 2
+#define EMC_LOG_DBG 3
 
+/* Compile time gate, messages above EMC_LOG_MAX are dead code. Their
+ * arguments still have to compile, but are never evaluated. */
+#ifndef EMC_LOG_MAX
 #ifdef DEBUG_RTSTEPPEREMC
-#define DBG(args...) emc_logger_cb(__FILE__ " " STRINGIZE(__LINE__) ": " args)
+#define EMC_LOG_MAX EMC_LOG_DBG
 #else
-#define DBG(args...)
+#define EMC_LOG_MAX EMC_LOG_MSG
 #endif
+#endif
+
+/* Run time gate, arguments are only evaluated if the level is enabled. */
+#define EMC_LOG(level, args...) \
+   do { \
+      if ((level) <= EMC_LOG_MAX && (level) <= emc_log_level) \
+         emc_logger_cb(args); \
+   } while (0)
+
+#define BUG(args...) EMC_LOG(EMC_LOG_BUG, __FILE__ " " STRINGIZE(__LINE__) ": " args)
+#define MSG(args...) EMC_LOG(EMC_LOG_MSG, args)
+#define DBG(args...) EMC_LOG(EMC_LOG_DBG, __FILE__ " " STRINGIZE(__LINE__) ": " args)
 
 #endif /* _BUG_H */
@@ -27,22 +27,47 @@
 \*****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
+#include <new>
 #include "emc.h"
 #include "interpl.h"
 #include "interp_return.h"
 #include "rs274ngc_interp.h"    // the interpreter
 #include "bug.h"
 
-static Interp interp;
-MSG_INTERP_LIST interp_list;    /* MSG Union, for interpreter */
+/* Interpreter side of an emc_session, one per dsp_open(). */
+struct dsp_session
+{
+   Interp interp;
+   CANON_CONTEXT *canon;        /* canonical state of this session */
+   MSG_INTERP_LIST *list;       /* canonical commands from interp */
+   unsigned int sync_msg_cnt;   /* rate limits MSG() warnings */
+   unsigned int limit_msg_cnt;
+};
+
+/* Make the session's canonical context current for the calling thread while an entry point runs the
+ * interpreter or canonical functions, whichever thread calls in. The previous context comes back when
+ * the entry point returns, no thread is left pointing at a context dsp_close() frees. */
+struct dsp_enter
+{
+   CANON_CONTEXT *old;
+   struct dsp_session *pd;
 
-static unsigned int sync_msg_cnt;
+   dsp_enter(struct emc_session *ps):old(SET_CANON_CONTEXT(ps->dsp->canon)), pd(ps->dsp)
+   {
+   }
+   ~dsp_enter()
+   {
+      SET_CANON_CONTEXT(old);
+   }
+};
 
-static void _interp_error(int retval, int line_number, EmcPose position)
+static void _interp_error(struct dsp_session *pd, int retval, int line_number, EmcPose position)
 {
    char buf[LINELEN];
    int i;
@@ -56,7 +81,7 @@ static void _interp_error(int retval, int line_number, EmcPose position)
    }
 
    buf[0] = 0;
-   interp.error_text(retval, buf, sizeof(buf));
+   pd->interp.error_text(retval, buf, sizeof(buf));
    if (buf[0] != 0)
    {
       if (line_number > 0)
@@ -73,20 +98,305 @@ static void _interp_error(int retval, int line_number, EmcPose position)
    for (i = 0; i < 5; i++)
    {
       buf[0] = 0;
-      interp.stack_name(i, buf, sizeof(buf));
+      pd->interp.stack_name(i, buf, sizeof(buf));
       if (buf[0] == 0)
          break;
       DBG("  %s\n", buf);
    }
 }       /* _interp_error() */
 
-/* Run trajectory planner cycles until the move is complete. */
-static void _run_tp(struct emc_session *ps, struct rtstepper_io_req *io)
+/* Grow the min/max box to include pos. */
+static void _pose_extent(EmcPose *min, EmcPose *max, EmcPose pos)
+{
+   if (pos.tran.x < min->tran.x) min->tran.x = pos.tran.x;
+   if (pos.tran.y < min->tran.y) min->tran.y = pos.tran.y;
+   if (pos.tran.z < min->tran.z) min->tran.z = pos.tran.z;
+   if (pos.a < min->a) min->a = pos.a;
+   if (pos.b < min->b) min->b = pos.b;
+   if (pos.c < min->c) min->c = pos.c;
+   if (pos.u < min->u) min->u = pos.u;
+   if (pos.v < min->v) min->v = pos.v;
+   if (pos.w < min->w) min->w = pos.w;
+   if (pos.tran.x > max->tran.x) max->tran.x = pos.tran.x;
+   if (pos.tran.y > max->tran.y) max->tran.y = pos.tran.y;
+   if (pos.tran.z > max->tran.z) max->tran.z = pos.tran.z;
+   if (pos.a > max->a) max->a = pos.a;
+   if (pos.b > max->b) max->b = pos.b;
+   if (pos.c > max->c) max->c = pos.c;
+   if (pos.u > max->u) max->u = pos.u;
+   if (pos.v > max->v) max->v = pos.v;
+   if (pos.w > max->w) max->w = pos.w;
+}   /* _pose_extent() */
+
+/* Set up the circle of a circular move starting at start, the same way tpAddCircle() does. */
+static void _arc_init(PmCircle *circle, EmcPose start, emc_traj_circular_move_msg_t *p)
+{
+   PmPose startPose, endPose;
+
+   startPose.tran = start.tran;
+   startPose.rot.s = 1.0;
+   startPose.rot.x = startPose.rot.y = startPose.rot.z = 0.0;
+   endPose.tran = p->end.tran;
+   endPose.rot = startPose.rot;
+   pmCircleInit(circle, startPose, endPose, p->center, p->normal, p->turn);
+}   /* _arc_init() */
+
+/* Grow the min/max box to include the xyz extremes of an arc, end supplies the other axes. */
+static void _arc_extent(PmCircle *circle, EmcPose end, EmcPose *min, EmcPose *max)
+{
+   PmPose point;
+   EmcPose pos;
+   double rtan[3], rperp[3], th;
+   int i;
+
+   if (circle->angle < V_FUZZ)
+      return;
+
+   /* Each axis peaks where the derivative of rTan*cos(th) + rPerp*sin(th) is zero. */
+   rtan[0] = circle->rTan.x; rtan[1] = circle->rTan.y; rtan[2] = circle->rTan.z;
+   rperp[0] = circle->rPerp.x; rperp[1] = circle->rPerp.y; rperp[2] = circle->rPerp.z;
+   pos = end;
+   for (i = 0; i < 3; i++)
+   {
+      th = atan2(rperp[i], rtan[i]);
+      if (th < 0.0)
+         th += PM_PI;
+      for (; th <= circle->angle; th += PM_PI)
+      {
+         pmCirclePoint(circle, th, &point);
+         pos.tran = point.tran;
+         _pose_extent(min, max, pos);
+      }
+   }
+}   /* _arc_extent() */
+
+/* Drill cycle being expanded into moves, see emc_traj_drill_cycle_msg_t. */
+struct drill_cycle
+{
+   emc_traj_drill_cycle_msg_t *p;
+   EmcPose start;               /* R point */
+   double depth;                /* distance from start to the bottom */
+   double peck;                 /* depth drilled so far */
+   int step;
+};
+
+static void _drill_init(struct drill_cycle *dc, emc_traj_drill_cycle_msg_t *p, EmcPose start)
+{
+   EmcPose *b = &p->bottom;
+
+   dc->p = p;
+   dc->start = start;
+   dc->depth = sqrt(pmSq(b->tran.x - start.tran.x) + pmSq(b->tran.y - start.tran.y) + pmSq(b->tran.z - start.tran.z) +
+                    pmSq(b->u - start.u) + pmSq(b->v - start.v) + pmSq(b->w - start.w));
+   dc->peck = 0.0;
+   dc->step = 0;
+}   /* _drill_init() */
+
+/* Point at distance s along the drill line, negative s is above the start. */
+static EmcPose _drill_pose(struct drill_cycle *dc, double s)
+{
+   EmcPose *a = &dc->start, *b = &dc->p->bottom;
+   EmcPose pos = *b;
+   double t = (dc->depth > 0.0) ? s / dc->depth : 0.0;
+
+   pos.tran.x = a->tran.x + (b->tran.x - a->tran.x) * t;
+   pos.tran.y = a->tran.y + (b->tran.y - a->tran.y) * t;
+   pos.tran.z = a->tran.z + (b->tran.z - a->tran.z) * t;
+   pos.u = a->u + (b->u - a->u) * t;
+   pos.v = a->v + (b->v - a->v) * t;
+   pos.w = a->w + (b->w - a->w) * t;
+   return pos;
+}   /* _drill_pose() */
+
+/* Next move of the cycle, the same moves the interpreter expanded G73 and G83 to. Returns 0 when done. */
+static int _drill_next(struct drill_cycle *dc, EmcPose *end, int *traverse)
+{
+   emc_traj_drill_cycle_msg_t *p = dc->p;
+   double s;
+
+   switch (dc->step)
+   {
+   case 0:      /* feed one peck deeper, or to the bottom */
+      dc->peck += p->delta;
+      if (dc->peck < dc->depth)
+         dc->step = 1;
+      else
+      {
+         dc->peck = dc->depth;
+         dc->step = 3;
+      }
+      s = dc->peck;
+      *traverse = 0;
+      break;
+   case 1:      /* G83 out to the clearance point, G73 back off a bit */
+      if (p->mode == EMC_DRILL_PECK)
+      {
+         s = -p->clear;
+         dc->step = 2;
+      }
+      else
+      {
+         s = dc->peck - p->retract;
+         dc->step = 0;
+      }
+      *traverse = 1;
+      break;
+   case 2:      /* G83 back in, stopping short of the last peck */
+      s = dc->peck - p->retract;
+      dc->step = 0;
+      *traverse = 1;
+      break;
+   case 3:      /* retract to the clearance point */
+      s = -p->clear;
+      dc->step = 4;
+      *traverse = 1;
+      break;
+   default:
+      return 0;
+   }
+
+   *end = _drill_pose(dc, s);
+   return 1;
+}   /* _drill_next() */
+
+/*
+ * Return 1 if the box min..max, widened by the backlash allowance, is inside the soft limits of every axis.
+ * Segments inside the limits can skip the per-cycle clamp in _run_tp(), it would never change a position.
+ */
+static int _limits_inside(struct emc_session *ps, EmcPose *min, EmcPose *max)
+{
+   double lo[EMC_MAX_AXIS], hi[EMC_MAX_AXIS], bl;
+   unsigned int i;
+   int c;
+
+   emcpos2a(lo, *min);
+   emcpos2a(hi, *max);
+   for (i=0; i < ps->axes; i++)
+   {
+      c = ps->axis[i].coordinate_map;
+      bl = 0.5 * fabs(ps->axis[i].backlash);   /* backlash_filt stays within +-backlash/2 */
+      if (lo[c] - bl < ps->axis[i].min_pos_limit || hi[c] + bl > ps->axis[i].max_pos_limit)
+         return 0;
+   }
+   return 1;
+}   /* _limits_inside() */
+
+/* Check a segment from the planner goal position to end before it is queued. */
+static int _segment_inside(struct emc_session *ps, EmcPose end, emc_traj_circular_move_msg_t *arc, int id)
+{
+   PmCircle circle;
+   EmcPose min, max;
+
+   min = max = ps->tp_queue.goalPos;
+   _pose_extent(&min, &max, end);
+   if (arc != NULL)
+   {
+      _arc_init(&circle, ps->tp_queue.goalPos, arc);
+      _arc_extent(&circle, end, &min, &max);
+   }
+
+   if (_limits_inside(ps, &min, &max))
+      return 1;
+
+   if (ps->dsp->limit_msg_cnt++ < 5)
+      MSG("Warning line %d exceeds soft limits, motion is clamped.", id);
+   return 0;
+}   /* _segment_inside() */
+
+/* Encode one cycle of the commanded axis positions plus backlash. Soft limits are only applied if clamp is set. */
+static void _encode_cycle(struct emc_session *ps, struct rtstepper_io_req *io, int clamp)
 {
    double sm_pos[EMC_MAX_AXIS];
-   int cnt;
    unsigned int i;
 
+   /* Apply backlash. */
+   for (i=0; i < ps->axes; i++)
+      sm_pos[i] = ps->axis[i].pos_cmd + ps->axis[i].backlash_filt;
+
+   /* Check soft position limit. */
+   if (clamp)
+   {
+      for (i=0; i < ps->axes; i++)
+      {
+         if (sm_pos[i] > 0.0)
+            sm_pos[i] = (sm_pos[i] > ps->axis[i].max_pos_limit) ? ps->axis[i].max_pos_limit : sm_pos[i];
+         if (sm_pos[i] < 0.0)
+            sm_pos[i] = (sm_pos[i] < ps->axis[i].min_pos_limit) ? ps->axis[i].min_pos_limit : sm_pos[i];
+      }
+   }
+
+   //DBG("X vel_cmd=%0.9f, X bl_vel=%0.9f, X pos_cmd=%0.9f, X sm=%0.9f, X backlash=%0.9f\n", 
+   //ps->axis[0].vel_cmd, ps->axis[0].backlash_vel, ps->axis[0].pos_cmd, sm_pos[0], ps->axis[0].backlash_filt);
+
+   /* Encode step buffer. */
+   rtstepper_encode(ps, io, sm_pos);
+}  /* _encode_cycle() */
+
+/*
+ * Direction of travel of the segment from start to end (arc is NULL for lines) at its start, or at its end if
+ * at_end is set, indexed by coordinate. Only the sign of each coordinate is meaningful.
+ */
+static void _segment_dir(EmcPose start, EmcPose end, emc_traj_circular_move_msg_t *arc, int at_end, double *dir)
+{
+   double pos[EMC_MAX_AXIS], th;
+   PmCircle circle;
+   PmCartesian rad, tangent;
+   unsigned int i;
+
+   emcpos2a(pos, start);
+   emcpos2a(dir, end);
+   for (i=0; i < EMC_MAX_AXIS; i++)
+      dir[i] -= pos[i];
+
+   if (arc == NULL)
+      return;
+
+   /* Tangent at th, derivative of rTan*cos(th) + rPerp*sin(th) plus the spiral and helix terms. */
+   _arc_init(&circle, start, arc);
+   if (circle.angle < V_FUZZ)
+      return;
+   th = at_end ? circle.angle : 0.0;
+   rad.x = circle.rTan.x * cos(th) + circle.rPerp.x * sin(th);
+   rad.y = circle.rTan.y * cos(th) + circle.rPerp.y * sin(th);
+   rad.z = circle.rTan.z * cos(th) + circle.rPerp.z * sin(th);
+   tangent.x = circle.rPerp.x * cos(th) - circle.rTan.x * sin(th);
+   tangent.y = circle.rPerp.y * cos(th) - circle.rTan.y * sin(th);
+   tangent.z = circle.rPerp.z * cos(th) - circle.rTan.z * sin(th);
+   pmCartUnit(rad, &rad);
+   dir[EMC_AXIS_X] = tangent.x + (circle.spiral * rad.x + circle.rHelix.x) / circle.angle;
+   dir[EMC_AXIS_Y] = tangent.y + (circle.spiral * rad.y + circle.rHelix.y) / circle.angle;
+   dir[EMC_AXIS_Z] = tangent.z + (circle.spiral * rad.z + circle.rHelix.z) / circle.angle;
+}  /* _segment_dir() */
+
+/*
+ * Take up backlash before the segment from the planner goal position to end (arc is NULL for lines). Direction
+ * reversals are found from the segment geometry, the take-up runs from rest before the segment starts.
+ */
+static void _segment_takeup(struct emc_session *ps, struct rtstepper_io_req *io, EmcPose end, emc_traj_circular_move_msg_t *arc, int clamp)
+{
+   double dir[EMC_MAX_AXIS];
+   unsigned int mask;
+
+   if (ps->backlash_mask == 0)
+      return;
+
+   _segment_dir(ps->tp_queue.goalPos, end, arc, 0, dir);
+
+   for (mask = reverse_screw_comp(ps, dir); mask; )
+   {
+      mask = takeup_screw_comp(ps, mask);
+      _encode_cycle(ps, io, clamp);
+   }
+}  /* _segment_takeup() */
+
+/*
+ * Run trajectory planner cycles until the move is complete. Soft limits are only applied if clamp is set.
+ * Backlash is computed per cycle only for the axes in comp, the ones that may reverse inside the segment.
+ */
+static void _run_tp(struct emc_session *ps, struct rtstepper_io_req *io, int clamp, unsigned int comp)
+{
+   int cnt;
+
    for (cnt=1; !tpIsDone(&ps->tp_queue); cnt++)
    {
       tpRunCycle(&ps->tp_queue);
@@ -101,27 +411,40 @@ static void _run_tp(struct emc_session *ps, struct rtstepper_io_req *io)
       update_tp_position(ps, tpGetPos(&ps->tp_queue));
 
       /* Calculate leadscrew compensation (backlash). */
-      compute_screw_comp(ps);
+      if (comp)
+         compute_screw_comp(ps, comp);
 
-      for (i=0; i < ps->axes; i++)
-      {
-         /* Apply backlash. */
-         sm_pos[i] = ps->axis[i].pos_cmd + ps->axis[i].backlash_filt;
+      _encode_cycle(ps, io, clamp);
+   }
+}  /* _run_tp() */
 
-         /* Check soft position limit. */
-         if (sm_pos[i] > 0.0)
-            sm_pos[i] = (sm_pos[i] > ps->axis[i].max_pos_limit) ? ps->axis[i].max_pos_limit : sm_pos[i];
-         if (sm_pos[i] < 0.0)
-            sm_pos[i] = (sm_pos[i] < ps->axis[i].min_pos_limit) ? ps->axis[i].min_pos_limit : sm_pos[i];
-      }
+/* Queue a linear move, dogleg rapids run each axis at its own ini limits. */
+static void _tp_add_line(struct emc_session *ps, TP_STRUCT *tp, emc_traj_linear_move_msg_t *p)
+{
+   double vmax[TC_DOGLEG_AXES], amax[TC_DOGLEG_AXES];
+   unsigned int i;
+   int c;
 
-      //DBG("X vel_cmd=%0.9f, X bl_vel=%0.9f, X pos_cmd=%0.9f, X sm=%0.9f, X backlash=%0.9f\n", 
-      //ps->axis[0].vel_cmd, ps->axis[0].backlash_vel, ps->axis[0].pos_cmd, sm_pos[0], ps->axis[0].backlash_filt);
+   if (p->type != EMC_MOTION_TYPE_DOGLEG || ps->sync_enabled)
+   {
+      tpAddLine(tp, p->end);
+      return;
+   }
 
-      /* Encode step buffer. */
-      rtstepper_encode(ps, io, sm_pos);
+   /* Lanes are coordinates. A coordinate driven by several axes runs at the slowest of them,
+    * one driven by no axis stays 0 and gets the move limits. */
+   for (i=0; i < TC_DOGLEG_AXES; i++)
+      vmax[i] = amax[i] = 0.0;
+   for (i=0; i < ps->axes; i++)
+   {
+      c = ps->axis[i].coordinate_map;
+      if (vmax[c] == 0.0 || ps->axis[i].max_velocity < vmax[c])
+         vmax[c] = ps->axis[i].max_velocity;
+      if (amax[c] == 0.0 || ps->axis[i].max_acceleration < amax[c])
+         amax[c] = ps->axis[i].max_acceleration;
    }
-}  /* _run_tp() */
+   tpAddDogleg(tp, p->end, vmax, amax);
+}   /* _tp_add_line() */
 
 /* Dispatch interpreter command. */
 static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t *cmd, int id)
@@ -137,6 +460,7 @@ static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t
          emc_traj_linear_move_msg_t *p = (emc_traj_linear_move_msg_t *)cmd;
          struct rtstepper_io_req *io;
          double vel = p->vel;
+         int clamp;
          enum RTSTEPPER_IO_TYPE io_type = RTSTEPPER_IO_TYPE_SPINDLE_ASYNC;
 
          if (ps->sync_enabled)
@@ -150,16 +474,22 @@ static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t
             io_type = RTSTEPPER_IO_TYPE_SPINDLE_SYNC;
          }
 
-         tpSetId(&ps->tp_queue, id);
-         tpSetVmax(&ps->tp_queue, vel);
-         tpSetAmax(&ps->tp_queue, p->acc);
-         tpAddLine(&ps->tp_queue, p->end);
+         /* Soft limit precheck, clamp only segments that may leave the envelope. */
+         clamp = !_segment_inside(ps, p->end, NULL, id);
 
          /* Allocate an io request transfer. */ 
          io = rtstepper_io_req_alloc(ps, id, io_type);       
 
+         /* Lines never reverse an axis part way, backlash is all taken up before the move. */
+         _segment_takeup(ps, io, p->end, NULL, clamp);
+
+         tpSetId(&ps->tp_queue, id);
+         tpSetVmax(&ps->tp_queue, vel);
+         tpSetAmax(&ps->tp_queue, p->acc);
+         _tp_add_line(ps, &ps->tp_queue, p);
+
          /* Run trajectory planner. */
-         _run_tp(ps, io);
+         _run_tp(ps, io, clamp, 0);
 
          DBG("L line=%d x_pos=%0.5f, x_master=%d y_pos=%0.5f, y_master=%d z_pos=%0.5f, z_master=%d, vel=%0.5f\n", id, 
          p->end.tran.x, ps->axis[EMC_AXIS_X].master_index, 
@@ -177,17 +507,24 @@ static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t
       {
          emc_traj_circular_move_msg_t *p = (emc_traj_circular_move_msg_t *)cmd;
          struct rtstepper_io_req *io;
+         int clamp;
+
+         /* Soft limit precheck, clamp only segments that may leave the envelope. */
+         clamp = !_segment_inside(ps, p->end, p, id);
+
+         /* Allocate an io request transfer. */ 
+         io = rtstepper_io_req_alloc(ps, id, RTSTEPPER_IO_TYPE_SPINDLE_ASYNC);       
+
+         /* Arcs can reverse an axis part way, those reversals are still compensated per cycle. */
+         _segment_takeup(ps, io, p->end, p, clamp);
 
          tpSetId(&ps->tp_queue, id);
          tpSetVmax(&ps->tp_queue, p->vel);
          tpSetAmax(&ps->tp_queue, p->acc);
          tpAddCircle(&ps->tp_queue, p->end, p->center, p->normal, p->turn);
 
-         /* Allocate an io request transfer. */ 
-         io = rtstepper_io_req_alloc(ps, id, RTSTEPPER_IO_TYPE_SPINDLE_ASYNC);       
-
          /* Run trajectory planner. */
-         _run_tp(ps, io);
+         _run_tp(ps, io, clamp, ps->backlash_mask);
 
          DBG("C line=%d x_pos=%0.5f, x_master=%d y_pos=%0.5f, y_master=%d z_pos=%0.5f, z_master=%d\n", id, 
          p->end.tran.x, ps->axis[EMC_AXIS_X].master_index, 
@@ -201,6 +538,44 @@ static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t
          stat = EMC_R_OK;
       }
       break;
+   case EMC_TRAJ_DRILL_CYCLE_TYPE:
+      {
+         emc_traj_drill_cycle_msg_t *p = (emc_traj_drill_cycle_msg_t *)cmd;
+         struct rtstepper_io_req *io;
+         struct drill_cycle dc;
+         EmcPose end;
+         int clamp, traverse;
+
+         _drill_init(&dc, p, ps->tp_queue.goalPos);
+
+         /* Soft limit precheck, the cycle stays on the line from the clearance point to the bottom. */
+         clamp = !(_segment_inside(ps, p->bottom, NULL, id) && _segment_inside(ps, _drill_pose(&dc, -p->clear), NULL, id));
+
+         tpSetId(&ps->tp_queue, id);
+
+         /* One io request transfer for the whole cycle. */
+         io = rtstepper_io_req_alloc(ps, id, RTSTEPPER_IO_TYPE_SPINDLE_ASYNC);
+
+         /* Run trajectory planner for each move of the cycle. */
+         while (_drill_next(&dc, &end, &traverse))
+         {
+            _segment_takeup(ps, io, end, NULL, clamp);
+            tpSetVmax(&ps->tp_queue, traverse ? p->rapid_vel : p->vel);
+            tpSetAmax(&ps->tp_queue, traverse ? p->rapid_acc : p->acc);
+            tpAddLine(&ps->tp_queue, end);
+            _run_tp(ps, io, clamp, 0);
+         }
+
+         DBG("D line=%d x_pos=%0.5f, y_pos=%0.5f, z_pos=%0.5f, delta=%0.5f\n", id,
+         p->bottom.tran.x, p->bottom.tran.y, p->bottom.tran.z, p->delta);
+
+         /* Dispatch step buffer package to IO system. */
+         if (rtstepper_xfr_start(ps, io, tpGetPos(&ps->tp_queue)) != EMC_R_OK)
+            goto bugout;
+
+         stat = EMC_R_OK;
+      }
+      break;
    case EMC_TASK_PLAN_PAUSE_TYPE:
       {
          /* Wait for any current IO to finish. */
@@ -308,7 +683,7 @@ static enum EMC_RESULT _dsp_interp_cmd(struct emc_session *ps, emc_command_msg_t
       }
       else
       {
-         if (sync_msg_cnt++ < 5)
+         if (ps->dsp->sync_msg_cnt++ < 5)
             MSG("Warning no synchronization performed.");
       }
       stat = EMC_R_OK;
@@ -354,6 +729,17 @@ static enum EMC_RESULT _dsp_interp_verify(struct emc_session *ps, emc_command_ms
          stat = EMC_R_OK;
       }
       break;
+   case EMC_TRAJ_DRILL_CYCLE_TYPE:
+      {
+         emc_traj_drill_cycle_msg_t *p = (emc_traj_drill_cycle_msg_t *)cmd;
+         struct drill_cycle dc;
+         _drill_init(&dc, p, ps->position);
+         ps->position = _drill_pose(&dc, -p->clear);
+         DBG("D line=%d x_pos=%0.5f, y_pos=%0.5f, z_pos=%0.5f\n", id, p->bottom.tran.x, p->bottom.tran.y, p->bottom.tran.z);
+         emc_position_post_cb(id, ps->position);
+         stat = EMC_R_OK;
+      }
+      break;
    case EMC_TASK_PLAN_PAUSE_TYPE:
       {
          emc_position_post_cb(id, ps->position); 
@@ -399,28 +785,378 @@ static enum EMC_RESULT _dsp_interp_verify(struct emc_session *ps, emc_command_ms
    return stat;
 }   /* _dsp_interp_verify() */
 
+#define VERIFY_ARC_STEP (PM_PI / 8.0)   /* toolpath sample spacing on arcs, radians */
+
+/* Downsampled toolpath for dsp_verify_summary(). */
+struct verify_path
+{
+   struct emc_verify_point *pt;
+   int max;                     /* size of pt[] */
+   int cnt;                     /* points in pt[] */
+   int stride;                  /* keep every stride'th point */
+   int n;                       /* points offered so far */
+   struct emc_verify_point last;        /* last point offered */
+};
+
+/*
+ * Add a point to the toolpath. The total number of points is not known up front, so every stride'th point
+ * is kept and when the array fills up every other kept point is dropped and the stride doubled.
+ */
+static void _verify_path_add(struct verify_path *vp, int id, EmcPose pos)
+{
+   int i;
+
+   vp->last.id = id;
+   vp->last.pos = pos;
+
+   if (vp->max <= 0 || (vp->n++ % vp->stride) != 0)
+      return;
+
+   if (vp->cnt == vp->max)
+   {
+      for (i = 0; i < (vp->cnt + 1) / 2; i++)
+         vp->pt[i] = vp->pt[i * 2];
+      vp->cnt = (vp->cnt + 1) / 2;
+      vp->stride *= 2;
+      if (((vp->n - 1) % vp->stride) != 0)
+         return;
+   }
+
+   vp->pt[vp->cnt++] = vp->last;
+}   /* _verify_path_add() */
+
+/* Make sure the toolpath ends where the program ends. */
+static void _verify_path_close(struct verify_path *vp)
+{
+   if (vp->max <= 0 || vp->n == 0 || ((vp->n - 1) % vp->stride) == 0)
+      return;      /* last point already kept */
+   if (vp->cnt == vp->max)
+      vp->cnt--;
+   vp->pt[vp->cnt++] = vp->last;
+}   /* _verify_path_close() */
+
+/* Arc length, extents and toolpath samples of a circular move starting at *start. */
+static void _verify_arc(struct emc_verify_summary *sum, struct verify_path *vp, emc_traj_circular_move_msg_t *p, EmcPose *start, int id)
+{
+   PmCircle circle;
+   PmPose point;
+   EmcPose pos;
+   int i, n;
+
+   _arc_init(&circle, *start, p);
+   sum->arc_length += sqrt(pmSq(circle.angle * circle.radius) + pmSq(circle.rHelix.x) + pmSq(circle.rHelix.y) + pmSq(circle.rHelix.z));
+   _arc_extent(&circle, p->end, &sum->min, &sum->max);
+
+   if (circle.angle < V_FUZZ)
+      return;
+
+   n = (int)ceil(circle.angle / VERIFY_ARC_STEP);
+   pos = p->end;
+   for (i = 1; i < n; i++)
+   {
+      pmCirclePoint(&circle, circle.angle * i / n, &point);
+      pos.tran = point.tran;
+      _verify_path_add(vp, id, pos);
+   }
+}   /* _verify_arc() */
+
+/* Count segments that leave the soft limits, the run would clamp them. */
+static void _verify_limits(struct emc_session *ps, struct emc_verify_summary *sum, EmcPose *min, EmcPose *max, int id)
+{
+   if (_limits_inside(ps, min, max))
+      return;
+   if (sum->limit_cnt == 0)
+      sum->limit_line = id;
+   sum->limit_cnt++;
+}   /* _verify_limits() */
+
+/* Add one interpreter command to the verify summary, ps->position is the current position. */
+static void _dsp_interp_summary(struct emc_session *ps, struct emc_verify_summary *sum, struct verify_path *vp, emc_command_msg_t *cmd, int id)
+{
+   EmcPose *pos = &ps->position;
+   EmcPose min, max;
+   PmCircle circle;
+   double len;
+   int slot;
+
+   switch (cmd->msg.type)
+   {
+   case EMC_TRAJ_LINEAR_MOVE_TYPE:
+      {
+         emc_traj_linear_move_msg_t *p = (emc_traj_linear_move_msg_t *)cmd;
+         pmCartCartDisp(pos->tran, p->end.tran, &len);
+         if (p->type == EMC_MOTION_TYPE_TRAVERSE || p->type == EMC_MOTION_TYPE_DOGLEG)
+            sum->traverse_length += len;
+         else
+            sum->feed_length += len;
+         min = max = *pos;
+         _pose_extent(&min, &max, p->end);
+         _verify_limits(ps, sum, &min, &max, id);
+         *pos = p->end;
+         _pose_extent(&sum->min, &sum->max, *pos);
+         _verify_path_add(vp, id, *pos);
+      }
+      break;
+   case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+      {
+         emc_traj_circular_move_msg_t *p = (emc_traj_circular_move_msg_t *)cmd;
+         _verify_arc(sum, vp, p, pos, id);
+         min = max = *pos;
+         _pose_extent(&min, &max, p->end);
+         _arc_init(&circle, *pos, p);
+         _arc_extent(&circle, p->end, &min, &max);
+         _verify_limits(ps, sum, &min, &max, id);
+         *pos = p->end;
+         _pose_extent(&sum->min, &sum->max, *pos);
+         _verify_path_add(vp, id, *pos);
+      }
+      break;
+   case EMC_TRAJ_DRILL_CYCLE_TYPE:
+      {
+         emc_traj_drill_cycle_msg_t *p = (emc_traj_drill_cycle_msg_t *)cmd;
+         struct drill_cycle dc;
+         EmcPose end;
+         int traverse;
+
+         _drill_init(&dc, p, *pos);
+         min = max = *pos;
+         _pose_extent(&min, &max, p->bottom);
+         _pose_extent(&min, &max, _drill_pose(&dc, -p->clear));
+         _verify_limits(ps, sum, &min, &max, id);
+         while (_drill_next(&dc, &end, &traverse))
+         {
+            pmCartCartDisp(pos->tran, end.tran, &len);
+            if (traverse)
+               sum->traverse_length += len;
+            else
+               sum->feed_length += len;
+            *pos = end;
+            _pose_extent(&sum->min, &sum->max, *pos);
+            _verify_path_add(vp, id, *pos);
+         }
+      }
+      break;
+   case EMC_SYSTEM_CMD_TYPE:
+      {
+         emc_system_cmd_msg_t *p = (emc_system_cmd_msg_t *)cmd;
+         if (p->index == 6)
+         {
+            /* M6, p_number is the pocket, pocket 0 is the empty spindle */
+            slot = (int)p->p_number;
+            if (sum->tool_change_cnt < EMC_VERIFY_TOOLS_MAX && slot >= 0 && slot < CANON_POCKETS_MAX)
+               sum->tool[sum->tool_change_cnt] = slot ? ps->toolTable[slot].toolno : 0;
+            sum->tool_change_cnt++;
+         }
+         else if (p->index >= 100 && p->index < EMC_VERIFY_MCODES_MAX)
+         {
+            /* M100-M199, may be queued behind cutter compensation and sent with a later line */
+            sum->mcode[p->index] = 1;
+         }
+      }
+      break;
+   case EMC_TASK_PLAN_END_TYPE:
+      FINISH();    /* M2 or M30 */
+      break;
+   default:
+      break;
+   }
+}   /* _dsp_interp_summary() */
+
+#define ESTIMATE_TC_QUEUE_SIZE 4
+
+/* Private planner and bookkeeping for dsp_estimate(). */
+struct estimate_ctx
+{
+   TP_STRUCT tp;
+   TC_STRUCT tc_queue[ESTIMATE_TC_QUEUE_SIZE + 10];
+   TC_GEOM tc_geom[ESTIMATE_TC_QUEUE_SIZE + 10];
+   struct emc_estimate *est;
+   double *range_time;
+   int range_lines;
+   int range_cnt;
+   int tool_index;              /* est->tool[] entry of the tool in the spindle, -1 if not listed */
+   double backlash[EMC_MAX_AXIS];       /* backlash side of each axis after the planned moves */
+};
+
+/* Charge time spent on gcode line id. */
+static void _estimate_add(struct estimate_ctx *ec, int id, double t)
+{
+   int i;
+
+   ec->est->time += t;
+   if (ec->tool_index >= 0)
+      ec->est->tool_time[ec->tool_index] += t;
+   if (ec->range_time != NULL && ec->range_lines > 0 && id > 0)
+   {
+      i = (id - 1) / ec->range_lines;
+      if (i < ec->range_cnt)
+         ec->range_time[i] += t;
+   }
+}   /* _estimate_add() */
+
+static void _estimate_tool(struct estimate_ctx *ec, int tool)
+{
+   struct emc_estimate *est = ec->est;
+   int i;
+
+   for (i = 0; i < est->tool_cnt; i++)
+   {
+      if (est->tool[i] == tool)
+         break;
+   }
+   if (i == est->tool_cnt)
+   {
+      if (i == EMC_ESTIMATE_TOOLS_MAX)
+      {
+         ec->tool_index = -1;
+         return;
+      }
+      est->tool[i] = tool;
+      est->tool_time[i] = 0.0;
+      est->tool_cnt++;
+   }
+   ec->tool_index = i;
+}   /* _estimate_tool() */
+
+/* Time of the backlash take-up before the segment from the planner goal position to end (arc is NULL for lines). */
+static double _estimate_takeup(struct emc_session *ps, struct estimate_ctx *ec, EmcPose end, emc_traj_circular_move_msg_t *arc)
+{
+   double dir[EMC_MAX_AXIS], t;
+
+   if (ps->backlash_mask == 0)
+      return 0.0;
+
+   _segment_dir(ec->tp.goalPos, end, arc, 0, dir);
+   t = estimate_screw_comp(ps, ec->backlash, dir);
+   if (arc != NULL)
+   {
+      /* Reversals inside an arc are compensated per cycle during the move, only the side it ends on carries over. */
+      _segment_dir(ec->tp.goalPos, end, arc, 1, dir);
+      estimate_screw_comp(ps, ec->backlash, dir);
+   }
+   return t;
+}   /* _estimate_takeup() */
+
+/* Estimate one interpreter command. Moves are run through the same planner as _dsp_interp_cmd() but without encoding. */
+static void _dsp_interp_estimate(struct emc_session *ps, struct estimate_ctx *ec, emc_command_msg_t *cmd, int id)
+{
+   double t;
+   int slot;
+
+   switch (cmd->msg.type)
+   {
+   case EMC_TRAJ_LINEAR_MOVE_TYPE:
+      {
+         emc_traj_linear_move_msg_t *p = (emc_traj_linear_move_msg_t *)cmd;
+
+         t = _estimate_takeup(ps, ec, p->end, NULL);
+         tpSetVmax(&ec->tp, p->vel);
+         tpSetAmax(&ec->tp, p->acc);
+         _tp_add_line(ps, &ec->tp, p);
+         t += tpRunEstimate(&ec->tp) * ps->cycle_time;
+         ec->est->motion_time += t;
+         _estimate_add(ec, id, t);
+      }
+      break;
+   case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+      {
+         emc_traj_circular_move_msg_t *p = (emc_traj_circular_move_msg_t *)cmd;
+
+         t = _estimate_takeup(ps, ec, p->end, p);
+         tpSetVmax(&ec->tp, p->vel);
+         tpSetAmax(&ec->tp, p->acc);
+         tpAddCircle(&ec->tp, p->end, p->center, p->normal, p->turn);
+         t += tpRunEstimate(&ec->tp) * ps->cycle_time;
+         ec->est->motion_time += t;
+         _estimate_add(ec, id, t);
+      }
+      break;
+   case EMC_TRAJ_DRILL_CYCLE_TYPE:
+      {
+         emc_traj_drill_cycle_msg_t *p = (emc_traj_drill_cycle_msg_t *)cmd;
+         struct drill_cycle dc;
+         EmcPose end;
+         int traverse;
+
+         _drill_init(&dc, p, ec->tp.goalPos);
+         t = 0.0;
+         while (_drill_next(&dc, &end, &traverse))
+         {
+            t += _estimate_takeup(ps, ec, end, NULL);
+            tpSetVmax(&ec->tp, traverse ? p->rapid_vel : p->vel);
+            tpSetAmax(&ec->tp, traverse ? p->rapid_acc : p->acc);
+            tpAddLine(&ec->tp, end);
+            t += tpRunEstimate(&ec->tp) * ps->cycle_time;
+         }
+         ec->est->motion_time += t;
+         _estimate_add(ec, id, t);
+      }
+      break;
+   case EMC_TRAJ_DELAY_TYPE:
+      {
+         emc_traj_delay_msg_t *p = (emc_traj_delay_msg_t *)cmd;
+
+         if (p->delay > 0.0)
+         {
+            ec->est->dwell_time += p->delay;
+            _estimate_add(ec, id, p->delay);
+         }
+      }
+      break;
+   case EMC_TRAJ_SET_TERM_COND_TYPE:
+      {
+         emc_traj_set_term_cond_msg_t *p = (emc_traj_set_term_cond_msg_t *)cmd;
+         tpSetTermCond(&ec->tp, p->cond);
+      }
+      break;
+   case EMC_TASK_PLAN_PAUSE_TYPE:
+      ec->est->pause_cnt++;
+      break;
+   case EMC_SYSTEM_CMD_TYPE:
+      {
+         emc_system_cmd_msg_t *p = (emc_system_cmd_msg_t *)cmd;
+         if (p->index == 6)
+         {
+            /* M6, p_number is the pocket, pocket 0 is the empty spindle */
+            slot = (int)p->p_number;
+            ec->est->tool_change_cnt++;
+            _estimate_tool(ec, (slot > 0 && slot < CANON_POCKETS_MAX) ? ps->toolTable[slot].toolno : 0);
+         }
+      }
+      break;
+   case EMC_TASK_PLAN_END_TYPE:
+      FINISH();    /* M2 or M30 */
+      break;
+   default:
+      break;
+   }
+}   /* _dsp_interp_estimate() */
+
 enum EMC_RESULT dsp_mdi(struct emc_session *ps, const char *mdi)
 {
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
    enum EMC_RESULT stat;
    int retval, len;
    int line_number=0;
 
    DBG("dsp_mdi() cmd=%s\n", mdi);
 
-   retval = interp.execute(mdi, line_number);
+   retval = pd->interp.execute(mdi, line_number);
    if (retval > INTERP_MIN_ERROR)
    {
-      _interp_error(retval, line_number, ps->position);
+      _interp_error(pd, retval, line_number, ps->position);
       stat = EMC_R_INTERPRETER_ERROR;
       goto bugout;
    }
    else
    {
+      pd->interp.hole_order_flush();    /* G81-G89 holes held for reordering */
       FINISH();
-      len = interp_list.len();
+      len = pd->list->len();
       while (len)
       {
-         if (_dsp_interp_cmd(ps, interp_list.get(), line_number) < EMC_R_OK)
+         if (_dsp_interp_cmd(ps, pd->list->get(), line_number) < EMC_R_OK)
          {            
             stat = EMC_R_ERROR;
             goto bugout;
@@ -434,51 +1170,37 @@ bugout:
    return stat;
 }       /* dsp_mdi() */
 
-enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile)
+/* Run gcode from the current ps->gfile position until end of file, pause, cancel or error. */
+static enum EMC_RESULT _dsp_auto_run(struct emc_session *ps)
 {
+   struct dsp_session *pd = ps->dsp;
    emc_command_msg_t *cmd;
    enum EMC_RESULT stat;
    int retval, len, id;
-   char line[LINELEN];
 
-   DBG("dsp_auto() file=%s, paused=%d\n", gcodefile, ps->state_bits & EMC_STATE_PAUSED_BIT); 
-
-   if (ps->state_bits & EMC_STATE_PAUSED_BIT)
-   {
-      /* Pause is set, clear it. */
-      ps->state_bits &= ~EMC_STATE_PAUSED_BIT;
-   }
-   else
+   if ((retval = pd->interp.preparse_open(ps->gfile)) != INTERP_OK)
    {
-      /* Pause is NOT set, start gcode from beginning. */ 
-      if((ps->gfile = fopen(gcodefile, "r")) == NULL) 
-      {
-         BUG("unable to open %s\n", gcodefile);
-         stat = EMC_R_INVALID_GCODE_FILE;
-         goto bugout;
-      } 
-      ps->line_number=1;  /* set file sequence number */
-
-      /* Clear runtime stats. */
-      rtstepper_clear_stats(ps);
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      stat = EMC_R_INTERPRETER_ERROR;
+      goto bugout;
    }
 
    /* Read, interpret and execute each line in the gcode file */
-   while ((fgets(line, sizeof(line), ps->gfile) != NULL))
+   while (pd->interp.preparse_read() == INTERP_OK)
    {
-      retval = interp.execute(line, ps->line_number);
+      retval = pd->interp.preparse_execute(ps->line_number);
       if (retval > INTERP_MIN_ERROR)
       {
          /* Interpreter error, wait for current IO to finish so the error msg is at the appropiate line #. */
          rtstepper_xfr_wait(ps);
 
-         _interp_error(retval, ps->line_number, ps->position);
+         _interp_error(pd, retval, ps->line_number, ps->position);
          stat = EMC_R_INTERPRETER_ERROR;
          goto bugout;
       }
       else
       {
-         len = interp_list.len();
+         len = pd->list->len();
          while (len)
          {
             rtstepper_xfr_hysteresis(ps);
@@ -492,14 +1214,14 @@ enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile)
             if (ps->state_bits & EMC_STATE_CANCEL_BIT)
             {
                FINISH();
-               interp_list.clear();
+               pd->list->clear();
                stat = EMC_R_OK;
                goto bugout;     /* user cancel */          
             }
 
             /* Get comand and line number. */
-            cmd = interp_list.get();
-            id = interp_list.get_line_number(); /* Note, Mn commands don't increment the line number. */
+            cmd = pd->list->get();
+            id = pd->list->get_line_number(); /* Note, Mn commands don't increment the line number. */
 
             if ((stat = _dsp_interp_cmd(ps, cmd, id)) != EMC_R_OK)
             {
@@ -512,6 +1234,7 @@ enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile)
                   emc_position_post_cb(ps->line_number, ps->position); 
 
                   ps->line_number++;
+                  pd->interp.preparse_close();   /* leave gfile at the next line for resume */
                   return stat;
                }
                else
@@ -524,22 +1247,194 @@ enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile)
          }
       }
       ps->line_number++;
+      pd->interp.snapshot_save(pd->interp.preparse_tell(), ps->line_number);
    }
 
    stat = EMC_R_OK;
 
 bugout:
+   pd->interp.preparse_close();
    if (ps->gfile != NULL)
       fclose(ps->gfile);
    return stat;
+}       /* _dsp_auto_run() */
+
+enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile)
+{
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
+
+   DBG("dsp_auto() file=%s, paused=%d\n", gcodefile, ps->state_bits & EMC_STATE_PAUSED_BIT); 
+
+   if (ps->state_bits & EMC_STATE_PAUSED_BIT)
+   {
+      /* Pause is set, clear it. */
+      ps->state_bits &= ~EMC_STATE_PAUSED_BIT;
+   }
+   else
+   {
+      /* Pause is NOT set, start gcode from beginning. */ 
+      if((ps->gfile = fopen(gcodefile, "r")) == NULL) 
+      {
+         BUG("unable to open %s\n", gcodefile);
+         return EMC_R_INVALID_GCODE_FILE;
+      } 
+      ps->line_number=1;  /* set file sequence number */
+
+      /* Clear runtime stats. */
+      rtstepper_clear_stats(ps);
+      pd->limit_msg_cnt = 0;
+
+      /* Take new run-from-line snapshots as we go. */
+      pd->interp.snapshot_clear(gcodefile);
+   }
+
+   return _dsp_auto_run(ps);
 }       /* dsp_auto() */
 
+/*
+ * Start gcode at line_number. The interpreter state is restored from the nearest snapshot taken by an
+ * earlier verify or auto run of the same file, the remaining lines up to line_number are interpreted
+ * without motion. The tool, spindle and coolant state of the skipped lines is replayed, then the
+ * machine rapids from the current position to the start point: Z up, across, Z down.
+ */
+enum EMC_RESULT dsp_auto_from_line(struct emc_session *ps, const char *gcodefile, int line_number)
+{
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
+   emc_command_msg_t *cmd;
+   enum EMC_RESULT stat;
+   CANON_MOTION_MODE mode;
+   int g_codes[ACTIVE_G_CODES], m_codes[ACTIVE_M_CODES];
+   double settings[ACTIVE_SETTINGS];
+   long offset;
+   int retval, len, id;
+
+   DBG("dsp_auto_from_line() file=%s, line=%d\n", gcodefile, line_number); 
+
+   if (ps->state_bits & EMC_STATE_PAUSED_BIT)
+   {
+      /* Drop the paused program. */
+      ps->state_bits &= ~EMC_STATE_PAUSED_BIT;
+      if (ps->gfile != NULL)
+         fclose(ps->gfile);
+   }
+
+   if((ps->gfile = fopen(gcodefile, "r")) == NULL) 
+   {
+      BUG("unable to open %s\n", gcodefile);
+      return EMC_R_INVALID_GCODE_FILE;
+   } 
+
+   rtstepper_clear_stats(ps);
+
+   pd->interp.snapshot_restore(gcodefile, line_number, &offset, &ps->line_number);
+   if (offset == 0)
+      pd->interp.init();    /* no snapshot, interpret from the top with default settings */
+   else if (fseek(ps->gfile, offset, SEEK_SET) != 0)
+   {
+      BUG("unable to seek %s to %ld\n", gcodefile, offset);
+      stat = EMC_R_INVALID_GCODE_FILE;
+      goto bugout;
+   }
+   DBG("dsp_auto_from_line() snapshot line=%d offset=%ld\n", ps->line_number, offset); 
+
+   if ((retval = pd->interp.preparse_open(ps->gfile)) != INTERP_OK)
+   {
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      stat = EMC_R_INTERPRETER_ERROR;
+      goto bugout;
+   }
+
+   /* Interpret up to the start line, throw away the commands. */
+   while (ps->line_number < line_number && pd->interp.preparse_read() == INTERP_OK)
+   {
+      if (ps->state_bits & EMC_STATE_CANCEL_BIT)
+      {
+         stat = EMC_R_OK;
+         goto bugout;     /* user cancel */          
+      }
+
+      retval = pd->interp.preparse_execute(ps->line_number);
+      if (retval > INTERP_MIN_ERROR)
+      {
+         _interp_error(pd, retval, ps->line_number, ps->position);
+         stat = EMC_R_INTERPRETER_ERROR;
+         goto bugout;
+      }
+      pd->list->clear();
+      ps->line_number++;
+      pd->interp.snapshot_save(pd->interp.preparse_tell(), ps->line_number);
+   }
+   pd->interp.preparse_close();
+
+   /* Drop moves still chained from the skipped lines. */
+   FINISH();
+   pd->list->clear();
+
+   /* The skipped lines may have changed G61/G64, tell the planner. */
+   if ((mode = GET_EXTERNAL_MOTION_CONTROL_MODE()) != 0)
+      SET_MOTION_CONTROL_MODE(mode, GET_EXTERNAL_MOTION_CONTROL_TOLERANCE());
+
+   /* The M6, M3/M4 and M7/M8 of the skipped lines were dropped, replay the modal state. */
+   pd->interp.active_g_codes(g_codes);
+   pd->interp.active_m_codes(m_codes);
+   pd->interp.active_settings(settings);
+   if (pd->interp.current_pocket() > 0)
+      CHANGE_TOOL(pd->interp.current_pocket());
+   if (g_codes[7] == G_94)
+      SET_FEED_RATE(settings[1]);
+   SET_SPINDLE_SPEED(settings[2]);
+   if (m_codes[2] == 3)
+      START_SPINDLE_CLOCKWISE();
+   else if (m_codes[2] == 4)
+      START_SPINDLE_COUNTERCLOCKWISE();
+   if (m_codes[4] == 7)
+      MIST_ON();
+   if (m_codes[5] == 8)
+      FLOOD_ON();
+
+   /* Move to where the skipped lines left the tool, an arc must start on its circle. */
+   CANON_APPROACH_END_POINT(ps->line_number);
+
+   len = pd->list->len();
+   while (len)
+   {
+      rtstepper_xfr_hysteresis(ps);
+
+      if (ps->state_bits & (EMC_STATE_ESTOP_BIT | EMC_STATE_CANCEL_BIT))
+      {
+         stat = EMC_R_OK;
+         goto bugout;
+      }
+
+      cmd = pd->list->get();
+      id = pd->list->get_line_number();
+      if ((stat = _dsp_interp_cmd(ps, cmd, id)) != EMC_R_OK)
+      {
+         stat = EMC_R_ERROR;
+         goto bugout;
+      }
+      len--;
+   }
+
+   return _dsp_auto_run(ps);
+
+bugout:
+   pd->interp.preparse_close();
+   FINISH();
+   pd->list->clear();
+   fclose(ps->gfile);
+   return stat;
+}       /* dsp_auto_from_line() */
+
 enum EMC_RESULT dsp_verify(struct emc_session *ps, const char *gcodefile)
 {
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
    emc_command_msg_t *cmd;
    enum EMC_RESULT stat;
    int retval, len, id;
-   char line[LINELEN];
 
    DBG("dsp_verify() file=%s\n", gcodefile); 
 
@@ -553,40 +1448,48 @@ enum EMC_RESULT dsp_verify(struct emc_session *ps, const char *gcodefile)
       goto bugout;
    } 
    ps->line_number=1;
+   pd->interp.snapshot_clear(gcodefile);
+
+   if ((retval = pd->interp.preparse_open(ps->gfile)) != INTERP_OK)
+   {
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      stat = EMC_R_INTERPRETER_ERROR;
+      goto bugout;
+   }
 
    /* Read, interpret and execute each line in the gcode file */
-   while ((fgets(line, sizeof(line), ps->gfile) != NULL))
+   while (pd->interp.preparse_read() == INTERP_OK)
    {
       if (ps->state_bits & EMC_STATE_CANCEL_BIT)
       {
          FINISH();      /* user cancel */
-         interp_list.clear();
+         pd->list->clear();
          emc_position_post_cb(ps->line_number, ps->position); 
          goto bugout;               
       }
 
-      retval = interp.execute(line, ps->line_number);
+      retval = pd->interp.preparse_execute(ps->line_number);
       if (retval > INTERP_MIN_ERROR)
       {
-         _interp_error(retval, ps->line_number, ps->position);
+         _interp_error(pd, retval, ps->line_number, ps->position);
          stat = EMC_R_INTERPRETER_ERROR;
          goto bugout;
       }
       else
       {
-         len = interp_list.len();
+         len = pd->list->len();
          while (len)
          {
             if (ps->state_bits & EMC_STATE_CANCEL_BIT)
             {
                FINISH();      /* user cancel */
-               interp_list.clear();
+               pd->list->clear();
                emc_position_post_cb(ps->line_number, ps->position); 
                goto bugout;               
             }
 
-            cmd = interp_list.get();
-            id = interp_list.get_line_number(); 
+            cmd = pd->list->get();
+            id = pd->list->get_line_number(); 
             if ((stat = _dsp_interp_verify(ps, cmd, id)) != EMC_R_OK)
             {
                stat = EMC_R_ERROR;
@@ -601,16 +1504,238 @@ enum EMC_RESULT dsp_verify(struct emc_session *ps, const char *gcodefile)
          }
       }
       ps->line_number++;
+      pd->interp.snapshot_save(pd->interp.preparse_tell(), ps->line_number);
    }
 
    stat = EMC_R_OK;
 
 bugout:
+   pd->interp.preparse_close();
    if (ps->gfile != NULL)
       fclose(ps->gfile);
    return stat;
 }       /* dsp_verify() */
 
+/*
+ * Headless verify. Same as dsp_verify() but runs at full speed without position callbacks, interpreter
+ * errors are recorded and verify continues with the next line. Results are returned in one summary and
+ * an optional toolpath downsampled to at most path_max points.
+ */
+enum EMC_RESULT dsp_verify_summary(struct emc_session *ps, const char *gcodefile, struct emc_verify_summary *sum, struct emc_verify_point *path, int path_max)
+{
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
+   emc_command_msg_t *cmd;
+   struct verify_path vp;
+   int mcodes[BLOCK_M_CODES];
+   char buf[LINELEN];
+   enum EMC_RESULT stat;
+   double hole_saved;
+   int retval, i;
+
+   DBG("dsp_verify_summary() file=%s\n", gcodefile); 
+
+   memset(sum, 0, sizeof(*sum));
+   hole_saved = pd->interp.hole_order_saved();
+   sum->min = sum->max = ps->position;
+   memset(&vp, 0, sizeof(vp));
+   vp.pt = path;
+   vp.max = path == NULL ? 0 : path_max;
+   vp.stride = 1;
+   _verify_path_add(&vp, 0, ps->position);
+
+   /* Force "All Zero" after verify. */
+   ps->state_bits &= ~EMC_STATE_HOMED_BIT;
+
+   if((ps->gfile = fopen(gcodefile, "r")) == NULL) 
+   {
+      BUG("unable to open %s\n", gcodefile);
+      stat = EMC_R_INVALID_GCODE_FILE;
+      goto bugout;
+   } 
+   ps->line_number=1;
+   pd->interp.snapshot_clear(gcodefile);
+
+   if ((retval = pd->interp.preparse_open(ps->gfile)) != INTERP_OK)
+   {
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      stat = EMC_R_INTERPRETER_ERROR;
+      goto bugout;
+   }
+
+   /* Read, interpret and execute each line in the gcode file */
+   while (pd->interp.preparse_read() == INTERP_OK)
+   {
+      if (ps->state_bits & EMC_STATE_CANCEL_BIT)
+         break;      /* user cancel, return what we have so far */
+
+      retval = pd->interp.preparse_execute(ps->line_number);
+      if (retval > INTERP_MIN_ERROR)
+      {
+         if (sum->error_cnt < EMC_VERIFY_ERRORS_MAX)
+         {
+            buf[0] = 0;
+            pd->interp.error_text(retval, buf, sizeof(buf));
+            DBG("interpreter error: line %d %s\n", ps->line_number, buf);
+            sum->error_line[sum->error_cnt] = ps->line_number;
+            snprintf(sum->error_text[sum->error_cnt], EMC_VERIFY_TEXT_LEN, "%s", buf);
+         }
+         sum->error_cnt++;
+      }
+      else
+      {
+         pd->interp.block_m_codes(mcodes);
+         for (i = 0; i < BLOCK_M_CODES; i++)
+         {
+            if (mcodes[i] >= 0 && mcodes[i] < EMC_VERIFY_MCODES_MAX)
+               sum->mcode[mcodes[i]] = 1;
+         }
+      }
+
+      while (pd->list->len())
+      {
+         cmd = pd->list->get();
+         _dsp_interp_summary(ps, sum, &vp, cmd, pd->list->get_line_number());
+      }
+
+      ps->line_number++;
+      pd->interp.snapshot_save(pd->interp.preparse_tell(), ps->line_number);
+   }
+
+   /* Flush moves still chained by the canon. */
+   FINISH();
+   while (pd->list->len())
+   {
+      cmd = pd->list->get();
+      _dsp_interp_summary(ps, sum, &vp, cmd, pd->list->get_line_number());
+   }
+
+   stat = sum->error_cnt ? EMC_R_INTERPRETER_ERROR : EMC_R_OK;
+
+bugout:
+   pd->interp.preparse_close();
+   if (ps->gfile != NULL)
+      fclose(ps->gfile);
+   sum->lines = ps->line_number - 1;
+   sum->hole_order_saved = (pd->interp.hole_order_saved() - hole_saved) * GET_EXTERNAL_LENGTH_UNITS();
+   _verify_path_close(&vp);
+   sum->path_cnt = vp.cnt;
+   return stat;
+}       /* dsp_verify_summary() */
+
+/*
+ * Estimate the run time of gcodefile. Moves are timed with the real trajectory planner, but cycles are counted
+ * instead of encoded. Time per tool goes in est, time per range_lines lines in range_time[0..range_cnt-1].
+ * The machine position is not changed. The interpreter state is kept aside before and put back when done, so
+ * offsets and modal state set since dsp_open() (G10, G92, G20, G43 ...) are still in effect afterwards.
+ */
+enum EMC_RESULT dsp_estimate(struct emc_session *ps, const char *gcodefile, struct emc_estimate *est, double *range_time, int range_lines, int range_cnt)
+{
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
+   struct estimate_ctx *ec;
+   emc_command_msg_t *cmd;
+   enum EMC_RESULT stat;
+   unsigned int i;
+   int retval;
+
+   DBG("dsp_estimate() file=%s\n", gcodefile); 
+
+   memset(est, 0, sizeof(*est));
+   if (range_time != NULL && range_cnt > 0)
+      memset(range_time, 0, range_cnt * sizeof(double));
+
+   if ((ec = (struct estimate_ctx *)calloc(1, sizeof(struct estimate_ctx))) == NULL)
+   {
+      BUG("unable to allocate estimate planner\n");
+      return EMC_R_ERROR;
+   }
+   ec->est = est;
+   ec->range_time = range_time;
+   ec->range_lines = range_lines;
+   ec->range_cnt = range_cnt;
+   _estimate_tool(ec, 0);
+   for (i = 0; i < ps->axes; i++)
+      ec->backlash[i] = ps->axis[i].backlash_filt;
+
+   tpCreate(&ec->tp, ESTIMATE_TC_QUEUE_SIZE, ec->tc_queue, ec->tc_geom);
+   tpSetCycleTime(&ec->tp, ps->cycle_time);
+   tpSetPos(&ec->tp, ps->position);
+   tpSetVlimit(&ec->tp, ps->maxVelocity);
+
+   if ((retval = pd->interp.snapshot_push()) != INTERP_OK)
+   {
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      tpDelete(&ec->tp);
+      free(ec);
+      return EMC_R_INTERPRETER_ERROR;
+   }
+
+   if((ps->gfile = fopen(gcodefile, "r")) == NULL) 
+   {
+      BUG("unable to open %s\n", gcodefile);
+      stat = EMC_R_INVALID_GCODE_FILE;
+      goto bugout;
+   } 
+   ps->line_number=1;
+   pd->interp.snapshot_clear(gcodefile);
+
+   if ((retval = pd->interp.preparse_open(ps->gfile)) != INTERP_OK)
+   {
+      _interp_error(pd, retval, ps->line_number, ps->position);
+      stat = EMC_R_INTERPRETER_ERROR;
+      goto bugout;
+   }
+
+   /* Read, interpret and estimate each line in the gcode file */
+   while (pd->interp.preparse_read() == INTERP_OK)
+   {
+      if (ps->state_bits & EMC_STATE_CANCEL_BIT)
+         break;      /* user cancel, return what we have so far */
+
+      retval = pd->interp.preparse_execute(ps->line_number);
+      if (retval > INTERP_MIN_ERROR)
+      {
+         est->error_line = ps->line_number;
+         pd->interp.error_text(retval, est->error_text, sizeof(est->error_text));
+         DBG("interpreter error: line %d %s\n", ps->line_number, est->error_text);
+         stat = EMC_R_INTERPRETER_ERROR;
+         goto bugout;
+      }
+
+      while (pd->list->len())
+      {
+         cmd = pd->list->get();
+         _dsp_interp_estimate(ps, ec, cmd, pd->list->get_line_number());
+      }
+
+      ps->line_number++;
+      pd->interp.snapshot_save(pd->interp.preparse_tell(), ps->line_number);
+   }
+
+   /* Flush moves still chained by the canon. */
+   FINISH();
+   while (pd->list->len())
+   {
+      cmd = pd->list->get();
+      _dsp_interp_estimate(ps, ec, cmd, pd->list->get_line_number());
+   }
+
+   stat = EMC_R_OK;
+
+bugout:
+   pd->interp.preparse_close();
+   pd->list->clear();
+   if (ps->gfile != NULL)
+      fclose(ps->gfile);
+   est->lines = ps->line_number - 1;
+   tpDelete(&ec->tp);
+   free(ec);
+   pd->interp.snapshot_pop();
+   CANON_RESET_END_POINT();
+   return stat;
+}       /* dsp_estimate() */
+
 enum EMC_RESULT dsp_auto_cancel_set(struct emc_session *ps)
 {
    ps->state_bits |= EMC_STATE_CANCEL_BIT;
@@ -652,18 +1777,21 @@ enum EMC_RESULT dsp_estop(struct emc_session *ps)
 
 enum EMC_RESULT dsp_estop_reset(struct emc_session *ps)
 {
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
    enum EMC_RESULT stat;
 
    MSG("User estop_reset...\n");
    ps->state_bits &= ~(EMC_STATE_ESTOP_BIT | EMC_STATE_PAUSED_BIT | EMC_STATE_CANCEL_BIT);
    FINISH();
-   interp_list.clear();
+   pd->list->clear();
    /* Don't reset backlash compensation, xfr_cancel() will force dsp_home() if needed. DES 10/15/2017 */
    //reset_screw_comp(ps);
    rtstepper_close(ps);
    if ((stat = rtstepper_open(ps)) != EMC_R_OK)
       emc_estop_post_cb(ps);
-   sync_msg_cnt = 0;
+   pd->sync_msg_cnt = 0;
+   pd->limit_msg_cnt = 0;
    return stat;
 }  /* dsp_estop_reset() */
 
@@ -688,8 +1816,11 @@ enum EMC_RESULT dsp_home(struct emc_session *ps)
 
 enum EMC_RESULT dsp_position_set(struct emc_session *ps, EmcPose pos)
 {
+   struct dsp_enter enter(ps);
+   struct dsp_session *pd = enter.pd;
+
    ps->position = pos;
-   interp.init();
+   pd->interp.init();
    tpSetPos(&ps->tp_queue, ps->position); 
    rtstepper_position_set(ps, ps->position);
    reset_screw_comp(ps);   /* reset leadscrew backlash compensation */
@@ -876,14 +2007,27 @@ enum EMC_RESULT dsp_io_done_wait(struct emc_session *ps)
 
 enum EMC_RESULT dsp_open(struct emc_session *ps)
 {
+   struct dsp_session *pd;
+   CANON_CONTEXT *old = NULL;
    enum EMC_RESULT stat = EMC_R_ERROR;
    int r;
 
    DBG("dsp_open()\n");
 
+   /* Value-initialize so the interpreter starts zeroed, as it did when it was a static object. */
+   if ((pd = new(std::nothrow) dsp_session()) == NULL)
+   {
+      BUG("dsp_open() unable to malloc dsp_session\n");
+      goto bugout;
+   }
+   pd->canon = CANON_CONTEXT_NEW(ps);
+   old = SET_CANON_CONTEXT(pd->canon);
+   pd->list = GET_CANON_INTERP_LIST();
+   ps->dsp = pd;
+
    /* Initialize gcode interpreter. */
-   interp.ini_load(ps->ini_file);
-   r = interp.init();   /* clears interp.file() */
+   pd->interp.ini_load(ps->ini_file);
+   r = pd->interp.init();   /* clears interp.file() */
    if (r > INTERP_MIN_ERROR)
    {
       BUG("dsp_open() interpreter error: %d\n", r);
@@ -891,7 +2035,7 @@ enum EMC_RESULT dsp_open(struct emc_session *ps)
    }
 
    /* Initialize trajectory planner. */
-   if (tpCreate(&ps->tp_queue, DEFAULT_TC_QUEUE_SIZE, ps->tc_queue) == -1)
+   if (tpCreate(&ps->tp_queue, DEFAULT_TC_QUEUE_SIZE, ps->tc_queue, ps->tc_geom) == -1)
    {
       BUG("dsp_open() unabled to initialize trajectory planner\n");
       goto bugout;
@@ -902,13 +2046,24 @@ enum EMC_RESULT dsp_open(struct emc_session *ps)
 
    stat = EMC_R_OK;
 bugout:
+   SET_CANON_CONTEXT(old);
    return stat;
 }  /* dsp_open() */
 
 enum EMC_RESULT dsp_close(struct emc_session *ps)
 {
+   struct dsp_session *pd = ps->dsp;
+   CANON_CONTEXT *old;
+
    DBG("dsp_close()\n");
-   interp.exit();
+   if (pd == NULL)
+      return EMC_R_OK;
+   old = SET_CANON_CONTEXT(pd->canon);
+   pd->interp.exit();
    tpDelete(&ps->tp_queue);
+   SET_CANON_CONTEXT(old);
+   CANON_CONTEXT_FREE(pd->canon);
+   delete pd;
+   ps->dsp = NULL;
    return EMC_R_OK;
 }  /* dsp_close() */
@@ -137,9 +137,14 @@ struct emc_axis
 #define EMC_STATE_HOMED_BIT 0x040000
 #define EMC_STATE_CANCEL_BIT 0x080000
 
-/* size of motion queue, a TC_STRUCT is about 512 bytes so this queue is about a megabyte.  */
+/* size of motion queue, a TC_STRUCT is about 170 bytes plus about 1200 bytes of TC_GEOM so this queue is under three megabytes.  */
 #define DEFAULT_TC_QUEUE_SIZE 2000
 
+struct dsp_session;
+
+/* One per emc_ui_open(), each machine in the process has its own session. All interpreter and planner
+ * state lives in the session, so sessions may be driven from any threads, several from one thread or one
+ * from different threads over time. Calls on the same session must not overlap. */
 struct emc_session
 {
    char ini_file[LINELEN];
@@ -149,12 +154,14 @@ struct emc_session
    /* interpreter */
    FILE *gfile;                    /* gcode file */
    int line_number;                /* saved during program pause */
+   struct dsp_session *dsp;        /* interpreter and canonical context, see dsp_open() */
 
    /* trajectory planner */
    double cycle_time;              /* waypoint period in seconds */
    double cycle_freq;              /* 1 / cycle_time */
    TP_STRUCT tp_queue;             /* trajectory planner based on TC elements */
    TC_STRUCT tc_queue[DEFAULT_TC_QUEUE_SIZE + 10]; /* discriminate-based trajectory planning */
+   TC_GEOM tc_geom[DEFAULT_TC_QUEUE_SIZE + 10];    /* setup only geometry of tc_queue[] */
 
    /* rtstepper dongle */
    int req_cnt;                 /* number of queued usb io requests */
@@ -186,9 +193,11 @@ struct emc_session
    double angularUnits;         // units per degree (ini: TRAJ, ANGULAR_UNITS)
    unsigned int axes;           // maximum axis number (ini: TRAJ, AXES)
    unsigned int axes_mask;      // mask of axes actually present
+   unsigned int backlash_mask;  // mask of axes with backlash compensation (ini: AXIS_n, BACKLASH)
    EmcPose position;            // current commanded position
    double maxVelocity;          // max system velocity
    double maxAcceleration;      // max system acceleration
+   int rapid_mode;              // EMC_RAPID_MODE (ini: TRAJ, RAPID_MODE)
    double sync_feed_per_sec;    /* feed_per_second used for syncronized motion */
    int sync_enabled;            /* syncronized motion, 0=false, 1=true) */
 
@@ -255,6 +264,13 @@ enum EMC_MOTION_TYPE
    EMC_MOTION_TYPE_ARC,
    EMC_MOTION_TYPE_TOOLCHANGE,
    EMC_MOTION_TYPE_PROBING,
+   EMC_MOTION_TYPE_DOGLEG,         /* G0, axes not coordinated */
+};
+
+enum EMC_RAPID_MODE
+{
+   EMC_RAPID_COORDINATED = 0,      /* G0 along a straight line */
+   EMC_RAPID_DOGLEG = 1,           /* each axis at its own limits, Z first going up and last going down */
 };
 
 enum EMC_COMMAND_MSG_TYPE
@@ -269,6 +285,7 @@ enum EMC_COMMAND_MSG_TYPE
    EMC_TASK_PLAN_END_TYPE,
    EMC_START_SPEED_FEED_SYNCH,
    EMC_STOP_SPEED_FEED_SYNCH,
+   EMC_TRAJ_DRILL_CYCLE_TYPE,
 };
 
 /* message header */
@@ -319,6 +336,29 @@ typedef struct _emc_traj_circular_move_msg_t
    int feed_mode;
 } emc_traj_circular_move_msg_t;
 
+enum EMC_DRILL_MODE
+{
+   EMC_DRILL_CHIP_BREAK,        /* G73, back off by retract after each peck */
+   EMC_DRILL_PECK,              /* G83, back out to clear after each peck */
+};
+
+/*
+ * Peck drilling cycle, expanded into feeds and traverses by the dispatcher. The cycle
+ * starts at the current position (the R point) and drills along the line to bottom.
+ * Distances are measured along that line, clear is the retract point above the start.
+ */
+typedef struct _emc_traj_drill_cycle_msg_t
+{
+   emc_msg_t msg;
+   enum EMC_DRILL_MODE mode;
+   EmcPose bottom;              // bottom of the hole
+   double clear;                // distance from the start back out to the clearance point
+   double delta;                // peck depth
+   double retract;              // G73 back off, G83 stop short of the last peck on the way in
+   double vel, ini_maxvel, acc; // feeds
+   double rapid_vel, rapid_acc; // traverses
+} emc_traj_drill_cycle_msg_t;
+
 typedef struct _emc_traj_delay_msg_t
 {
    emc_msg_t msg;
@@ -353,9 +393,61 @@ typedef struct _emc_command_msg_t
       emc_traj_circular_move_msg_t m5;
       emc_traj_delay_msg_t m6;
       emc_system_cmd_msg_t m7;
+      emc_traj_drill_cycle_msg_t m8;
    };
 } emc_command_msg_t;
 
+#define EMC_VERIFY_ERRORS_MAX 8
+#define EMC_VERIFY_TEXT_LEN 128
+#define EMC_VERIFY_TOOLS_MAX 32
+#define EMC_VERIFY_MCODES_MAX 200
+
+/* Headless verify results, see dsp_verify_summary(). */
+struct emc_verify_summary
+{
+   int lines;                   /* gcode lines interpreted */
+   int error_cnt;               /* interpreter errors, the first EMC_VERIFY_ERRORS_MAX are kept */
+   int error_line[EMC_VERIFY_ERRORS_MAX];
+   char error_text[EMC_VERIFY_ERRORS_MAX][EMC_VERIFY_TEXT_LEN];
+   EmcPose min;                 /* axis extents of all moves, including the start position */
+   EmcPose max;
+   double traverse_length;      /* xyz path length of G0 moves */
+   double feed_length;          /* xyz path length of G1 moves */
+   double arc_length;           /* xyz path length of G2/G3 moves */
+   double hole_order_saved;     /* G0 length saved by reordering canned cycle holes, see HOLE_ORDER_MS */
+   int tool_change_cnt;         /* M6 count, the first EMC_VERIFY_TOOLS_MAX tool numbers are kept */
+   int tool[EMC_VERIFY_TOOLS_MAX];
+   unsigned char mcode[EMC_VERIFY_MCODES_MAX];  /* mcode[n] is set if Mn was used */
+   int limit_cnt;               /* moves outside the soft limits, backlash allowance included */
+   int limit_line;              /* line of the first such move */
+   int path_cnt;                /* number of points returned in the downsampled toolpath */
+};
+
+/* Downsampled toolpath point, same layout as struct post_position_py. */
+struct emc_verify_point
+{
+   int id;                      /* gcode line number */
+   EmcPose pos;
+};
+
+#define EMC_ESTIMATE_TOOLS_MAX 32
+
+/* Cycle time estimate, see dsp_estimate(). Times are in seconds. */
+struct emc_estimate
+{
+   int lines;                   /* gcode lines interpreted */
+   int error_line;              /* line of the interpreter error that stopped the estimate, 0 if none */
+   char error_text[EMC_VERIFY_TEXT_LEN];
+   double time;                 /* total of motion and dwell time */
+   double motion_time;          /* G0, G1, G2/G3 moves */
+   double dwell_time;           /* G4 */
+   int pause_cnt;               /* M0, M1 and M60, operator time is not included */
+   int tool_change_cnt;         /* M6, tool change time is not included */
+   int tool_cnt;                /* entries in tool[] and tool_time[] */
+   int tool[EMC_ESTIMATE_TOOLS_MAX];    /* tool in the spindle, 0 until the first M6 */
+   double tool_time[EMC_ESTIMATE_TOOLS_MAX];
+};
+
 struct post_position_py;
 typedef void *(*logger_cb_t) (const char *msg);
 typedef void *(*post_position_cb_t) (int cmd, struct post_position_py *pospy);
@@ -363,7 +455,7 @@ typedef void *(*post_event_cb_t) (int cmd);
 typedef int (*plugin_cb_t) (int mcode, double p_number, double q_number);
 
 extern char USER_HOME_DIR[];
-extern struct emc_session session;
+extern int emc_log_level;         /* EMC_LOG_xxx, see bug.h */
 
 /* Forward declarations. */
 struct emcpose_py;
@@ -383,6 +475,7 @@ extern "C"
    DLL_EXPORT enum EMC_RESULT emc_ui_estop(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_estop_reset(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_logger_register_cb(logger_cb_t fp);
+   DLL_EXPORT enum EMC_RESULT emc_ui_logger_level_set(int level);
    DLL_EXPORT enum EMC_RESULT emc_ui_gui_event_register_cb(post_event_cb_t fp);
    DLL_EXPORT enum EMC_RESULT emc_ui_position_register_cb(post_position_cb_t fp);
    DLL_EXPORT enum EMC_RESULT emc_ui_plugin_register_cb(plugin_cb_t fp);
@@ -393,11 +486,14 @@ extern "C"
    DLL_EXPORT enum EMC_RESULT emc_ui_position_set(void *hd, struct emcpose_py *pospy);
    DLL_EXPORT enum EMC_RESULT emc_ui_mdi_cmd(void *hd, const char *mdi);
    DLL_EXPORT enum EMC_RESULT emc_ui_auto_cmd(void *hd, const char *gcode_file);
+   DLL_EXPORT enum EMC_RESULT emc_ui_auto_from_line_cmd(void *hd, const char *gcode_file, int line_number);
    DLL_EXPORT enum EMC_RESULT emc_ui_auto_cancel_set(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_auto_cancel_clear(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_din_abort_enable(void *hd, int input_num);
    DLL_EXPORT enum EMC_RESULT emc_ui_din_abort_disable(void *hd, int input_num);
    DLL_EXPORT enum EMC_RESULT emc_ui_verify_cmd(void *hd, const char *gcode_file);
+   DLL_EXPORT enum EMC_RESULT emc_ui_verify_summary_cmd(void *hd, const char *gcode_file, struct emc_verify_summary *sum, struct emc_verify_point *path, int path_max);
+   DLL_EXPORT enum EMC_RESULT emc_ui_estimate_cmd(void *hd, const char *gcode_file, struct emc_estimate *est, double *range_time, int range_lines, int range_cnt);
    DLL_EXPORT enum EMC_RESULT emc_ui_verify_cancel_set(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_verify_cancel_clear(void *hd);
    DLL_EXPORT enum EMC_RESULT emc_ui_test(const char *snum);
@@ -407,10 +503,12 @@ extern "C"
    DLL_EXPORT enum EMC_RESULT emc_ui_din_frequency_avg_get(void *hd, int input_num, double *value);
    DLL_EXPORT enum EMC_RESULT emc_ui_din_frequency_max_get(void *hd, int input_num, double *value);
    DLL_EXPORT enum EMC_RESULT emc_ui_din_frequency_min_get(void *hd, int input_num, double *value);
+   DLL_EXPORT enum EMC_RESULT emc_ui_ini_get(void *hd, const char *section, const char *key, char *value, int value_size);
    enum EMC_RESULT dsp_open(struct emc_session *ps);
    enum EMC_RESULT dsp_close(struct emc_session *ps);
    enum EMC_RESULT dsp_mdi(struct emc_session *ps, const char *mdi);
    enum EMC_RESULT dsp_auto(struct emc_session *ps, const char *gcodefile);
+   enum EMC_RESULT dsp_auto_from_line(struct emc_session *ps, const char *gcodefile, int line_number);
    enum EMC_RESULT dsp_auto_cancel_set(struct emc_session *ps);
    enum EMC_RESULT dsp_auto_cancel_clear(struct emc_session *ps);
    enum EMC_RESULT dsp_estop(struct emc_session *ps);
@@ -420,6 +518,8 @@ extern "C"
    enum EMC_RESULT dsp_din_abort_enable(struct emc_session *ps, int num);
    enum EMC_RESULT dsp_din_abort_disable(struct emc_session *ps, int num);
    enum EMC_RESULT dsp_verify(struct emc_session *ps, const char *gcodefile);
+   enum EMC_RESULT dsp_verify_summary(struct emc_session *ps, const char *gcodefile, struct emc_verify_summary *sum, struct emc_verify_point *path, int path_max);
+   enum EMC_RESULT dsp_estimate(struct emc_session *ps, const char *gcodefile, struct emc_estimate *est, double *range_time, int range_lines, int range_cnt);
    enum EMC_RESULT dsp_verify_cancel_set(struct emc_session *ps);
    enum EMC_RESULT dsp_verify_cancel_clear(struct emc_session *ps);
    enum EMC_RESULT dsp_position_set(struct emc_session *ps, EmcPose pos);
@@ -431,9 +531,13 @@ extern "C"
    enum EMC_RESULT dsp_input_mode(struct emc_session *ps, int input_num, int param);
    const char *lookup_task_interp_state(int type);
    const char *lookup_message(int type);
-   void compute_screw_comp(struct emc_session *ps);
+   void compute_screw_comp(struct emc_session *ps, unsigned int mask);
+   unsigned int reverse_screw_comp(struct emc_session *ps, const double *dir);
+   unsigned int takeup_screw_comp(struct emc_session *ps, unsigned int mask);
+   double estimate_screw_comp(struct emc_session *ps, double *filt, const double *dir);
    void reset_screw_comp(struct emc_session *ps);
    void update_tp_position(struct emc_session *ps, EmcPose pos);
+   void emcpos2a(double *a, EmcPose pos);
 
 #ifdef __cplusplus
 }                               /* matches extern "C" at top */
@@ -41,20 +41,171 @@
 #include <ctype.h>      // isspace()
 #include "emc.h"        // EMC NML
 #include "canon.h"      // these decls
-#include "interpl.h"    // interp_list
+#include "interpl.h"    // MSG_INTERP_LIST
 #include "bug.h"
 
 /* 
  * There are a lot of ugly globals in emccanon.cc. They should all be moved 
  * into a session object. The session object should be passed in as pointer input
  * parameter. DES 12/26/2014 
+ *
+ * The canonical state now lives in a CANON_CONTEXT. The thread running an Interp makes
+ * its context current (see SET_CANON_CONTEXT) for the duration of the call, so Interp
+ * instances do not share canonical state. The context also carries the emc_session of
+ * the machine it drives.
  */
 
 static int debug_velacc = 0;
-static double css_maximum;
 
 static const double tiny = 1e-7;
-static double xy_rotation = 0.;
+
+/* A segment queued for the naive cam detector. */
+struct pt
+{
+   double x, y, z, a, b, c, u, v, w;
+   int line_no;
+};
+
+/* A joined G1 move held back by the arc fitter. */
+struct arc_chord
+{
+   emc_traj_linear_move_msg_t msg;
+   int line_no;
+};
+
+struct canon_context
+{
+   canon_context(MSG_INTERP_LIST *l, struct emc_session *s);
+
+   double css_maximum;
+   double xy_rotation;
+
+   /*
+     Origin offsets, length units, and active plane are all maintained
+     here in this file. Controller runs in absolute mode, and does not
+     have plane select concept.
+
+     programOrigin is stored in mm always, and converted when set or read.
+     When it's applied to positions, convert positions to mm units first
+     and then add programOrigin.
+
+     Units are then converted from mm to external units, as reported by
+     the GET_EXTERNAL_LENGTH_UNITS() function.
+   */
+   CANON_POSITION programOrigin;
+   CANON_UNITS lengthUnits;
+   CANON_PLANE activePlane;
+
+   int feed_mode;
+   int synched;
+
+   /* Tool length offset is saved here */
+   EmcPose currentToolOffset;
+
+   /*
+     canonEndPoint is the last programmed end point, stored in case it's
+     needed for subsequent calculations. It's in absolute frame, mm units.
+
+     note that when segments are queued for the naive cam detector that the
+     canonEndPoint may not be the last programmed endpoint.  get_last_pos()
+     retrieves the xyz position after the last of the queued segments.  these
+     are also in absolute frame, mm units.
+   */
+   CANON_POSITION canonEndPoint;
+
+   /* motion control mode is used to signify blended v. stop-at-end moves.
+      Set to 0 (invalid) at start, so first call will send command out */
+   CANON_MOTION_MODE canonMotionMode;
+
+   /* motion path-following tolerance is used to set the max path-following
+      deviation during CANON_CONTINUOUS.
+      If this param is 0, then it will behave as emc always did, allowing
+      almost any deviation trying to keep speed up. */
+   double canonMotionTolerance;
+
+   double canonNaivecamTolerance;
+
+   /* Spindle speed is saved here */
+   double spindleSpeed;
+
+   /* Prepped tool is saved here */
+   int preppedTool;
+
+   bool optional_program_stop;  /* optional program stop */
+   bool block_delete;           /* optional block delete */
+
+   /*
+     Feed rate is saved here; values are in mm/sec or deg/sec.
+     It will be initially set in INIT_CANON() below.
+   */
+   double currentLinearFeedRate;
+   double currentAngularFeedRate;
+
+   /* Used to indicate whether the current move is linear, angular, or 
+      a combination of both. */
+   //AJ says: linear means axes XYZ move (lines or even circles)
+   //         angular means axes ABC move
+   int cartesian_move;
+   int angular_move;
+
+   std::vector < struct pt >chained_points;     /* segments queued for the naive cam detector */
+
+   /* Every queued point lies within naivecam_tolerance() of any line from
+      canonEndPoint whose direction is inside the cone (chain_axis, chain_angle)
+      and which is at least chain_reach long. Kept up to date as points are
+      queued so linkable() does not have to walk the whole chain. */
+   PM_CARTESIAN chain_axis;
+   double chain_angle;
+   double chain_reach;
+   int naivecam_chain_max;      /* most segments joined into one move */
+
+   /* Joined G1 moves that may still be replaced by one arc. The run starts at
+      arc_start and every chord is within naivecam_tolerance() of the circle
+      (arc_center, arc_radius), arc_rotation is 0 while there is no circle yet.
+      All in external units. */
+   std::vector < struct arc_chord >arc_run;
+   EmcPose arc_start;
+   PmCartesian arc_center;
+   double arc_radius;
+   double arc_sweep;
+   int arc_rotation;
+   int naivecam_arc_chords;     /* fewest chords replaced by an arc, 0 = no arc fitting */
+
+   MSG_INTERP_LIST *list;       /* where the canonical commands go */
+   struct emc_session *session; /* machine limits, units, position and tool table */
+};
+
+canon_context::canon_context(MSG_INTERP_LIST *l, struct emc_session *s):css_maximum(0.0), xy_rotation(0.0),
+programOrigin(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0), lengthUnits(CANON_UNITS_MM), activePlane(CANON_PLANE_XY),
+feed_mode(0), synched(0), canonEndPoint(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0), canonMotionMode(0),
+canonMotionTolerance(0.0), canonNaivecamTolerance(0.0), spindleSpeed(0.0), preppedTool(0),
+optional_program_stop(ON),      //set enabled by default (previous EMC behaviour)
+block_delete(ON),               //set enabled by default (previous EMC behaviour)
+currentLinearFeedRate(0.0), currentAngularFeedRate(0.0), cartesian_move(0), angular_move(0),
+chain_angle(M_PI), chain_reach(0.0), naivecam_chain_max(NAIVECAM_CHAIN_MAX_DEFAULT),
+arc_radius(0.0), arc_sweep(0.0), arc_rotation(0), naivecam_arc_chords(0), list(l), session(s)
+{
+   ZERO_EMC_POSE(currentToolOffset);
+   ZERO_EMC_POSE(arc_start);
+}
+
+/* The default context drives no machine, its commands go to a list nobody reads. */
+static MSG_INTERP_LIST canon_default_list;
+static CANON_CONTEXT canon_default(&canon_default_list, NULL);
+static __thread CANON_CONTEXT *canon = &canon_default;
+static struct emc_session canon_no_session;
+
+/* A canonical call from a thread without a context (see SET_CANON_CONTEXT) is a bug in the
+   caller. Report it and answer from an all zero session instead of dereferencing NULL. */
+static struct emc_session *canon_session(void)
+{
+   if (canon->session == NULL)
+   {
+      BUG("canonical call without a context\n");
+      return &canon_no_session;
+   }
+   return canon->session;
+}
 
 #ifndef MIN
 #define MIN(a,b) ((a)<(b)?(a):(b))
@@ -89,11 +240,11 @@ static double xy_rotation = 0.;
 #define FROM_EXT_ANG(ext) ((ext) / GET_EXTERNAL_ANGLE_UNITS())
 
 /* macros for converting internal (mm/deg) units to program units */
-#define TO_PROG_LEN(mm) ((mm) / (lengthUnits == CANON_UNITS_INCHES ? 25.4 : lengthUnits == CANON_UNITS_CM ? 10.0 : 1.0))
+#define TO_PROG_LEN(mm) ((mm) / (canon->lengthUnits == CANON_UNITS_INCHES ? 25.4 : canon->lengthUnits == CANON_UNITS_CM ? 10.0 : 1.0))
 #define TO_PROG_ANG(deg) (deg)
 
 /* macros for converting program units to internal (mm/deg) units */
-#define FROM_PROG_LEN(prog) ((prog) * (lengthUnits == CANON_UNITS_INCHES ? 25.4 : lengthUnits == CANON_UNITS_CM ? 10.0 : 1.0))
+#define FROM_PROG_LEN(prog) ((prog) * (canon->lengthUnits == CANON_UNITS_INCHES ? 25.4 : canon->lengthUnits == CANON_UNITS_CM ? 10.0 : 1.0))
 #define FROM_PROG_ANG(prog) (prog)
 
 /* Certain axes are periodic.  Hardcode this for now */
@@ -109,117 +260,96 @@ static double xy_rotation = 0.;
 static PM_QUATERNION quat(1, 0, 0, 0);
 
 static void flush_segments(void);
-
-/*
-  Origin offsets, length units, and active plane are all maintained
-  here in this file. Controller runs in absolute mode, and does not
-  have plane select concept.
-
-  programOrigin is stored in mm always, and converted when set or read.
-  When it's applied to positions, convert positions to mm units first
-  and then add programOrigin.
-
-  Units are then converted from mm to external units, as reported by
-  the GET_EXTERNAL_LENGTH_UNITS() function.
-  */
-static CANON_POSITION programOrigin(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
-static CANON_UNITS lengthUnits = CANON_UNITS_MM;
-static CANON_PLANE activePlane = CANON_PLANE_XY;
-
-static int feed_mode = 0;
-static int synched = 0;
-
-/* Tool length offset is saved here */
-static EmcPose currentToolOffset;
+static void traverse_append(int line_number, enum EMC_MOTION_TYPE type, double x, double y, double z, double a, double b, double c, double u, double v, double w);
 
 static double offset_x(double x)
 {
-   return x + programOrigin.x + currentToolOffset.tran.x;
+   return x + canon->programOrigin.x + canon->currentToolOffset.tran.x;
 }
 
 static double offset_y(double y)
 {
-   return y + programOrigin.y + currentToolOffset.tran.y;
+   return y + canon->programOrigin.y + canon->currentToolOffset.tran.y;
 }
 
 static double offset_z(double z)
 {
-   return z + programOrigin.z + currentToolOffset.tran.z;
+   return z + canon->programOrigin.z + canon->currentToolOffset.tran.z;
 }
 
 static double offset_a(double a)
 {
-   return a + programOrigin.a + currentToolOffset.a;
+   return a + canon->programOrigin.a + canon->currentToolOffset.a;
 }
 
 static double offset_b(double b)
 {
-   return b + programOrigin.b + currentToolOffset.b;
+   return b + canon->programOrigin.b + canon->currentToolOffset.b;
 }
 
 static double offset_c(double c)
 {
-   return c + programOrigin.c + currentToolOffset.c;
+   return c + canon->programOrigin.c + canon->currentToolOffset.c;
 }
 
 static double offset_u(double u)
 {
-   return u + programOrigin.u + currentToolOffset.u;
+   return u + canon->programOrigin.u + canon->currentToolOffset.u;
 }
 
 static double offset_v(double v)
 {
-   return v + programOrigin.v + currentToolOffset.v;
+   return v + canon->programOrigin.v + canon->currentToolOffset.v;
 }
 
 static double offset_w(double w)
 {
-   return w + programOrigin.w + currentToolOffset.w;
+   return w + canon->programOrigin.w + canon->currentToolOffset.w;
 }
 
 static double unoffset_x(double x)
 {
-   return x - programOrigin.x - currentToolOffset.tran.x;
+   return x - canon->programOrigin.x - canon->currentToolOffset.tran.x;
 }
 
 static double unoffset_y(double y)
 {
-   return y - programOrigin.y - currentToolOffset.tran.y;
+   return y - canon->programOrigin.y - canon->currentToolOffset.tran.y;
 }
 
 static double unoffset_z(double z)
 {
-   return z - programOrigin.z - currentToolOffset.tran.z;
+   return z - canon->programOrigin.z - canon->currentToolOffset.tran.z;
 }
 
 static double unoffset_a(double a)
 {
-   return a - programOrigin.a - currentToolOffset.a;
+   return a - canon->programOrigin.a - canon->currentToolOffset.a;
 }
 
 static double unoffset_b(double b)
 {
-   return b - programOrigin.b - currentToolOffset.b;
+   return b - canon->programOrigin.b - canon->currentToolOffset.b;
 }
 
 static double unoffset_c(double c)
 {
-   return c - programOrigin.c - currentToolOffset.c;
+   return c - canon->programOrigin.c - canon->currentToolOffset.c;
 }
 
 static double unoffset_u(double u)
 {
-   return u - programOrigin.u - currentToolOffset.u;
+   return u - canon->programOrigin.u - canon->currentToolOffset.u;
 }
 
 static double unoffset_v(double v)
 {
-   return v - programOrigin.v - currentToolOffset.v;
+   return v - canon->programOrigin.v - canon->currentToolOffset.v;
 }
 
 static double unoffset_w(double w)
 {
-   return w - programOrigin.w - currentToolOffset.w;
+   return w - canon->programOrigin.w - canon->currentToolOffset.w;
 }
 
 #ifndef D2R
@@ -237,7 +367,7 @@ static void rotate(double &x, double &y, double theta)
 
 static void rotate_and_offset_pos(double &x, double &y, double &z, double &a, double &b, double &c, double &u, double &v, double &w)
 {
-   rotate(x, y, xy_rotation);
+   rotate(x, y, canon->xy_rotation);
    x = offset_x(x);
    y = offset_y(y);
    z = offset_z(z);
@@ -254,7 +384,7 @@ static CANON_POSITION unoffset_and_unrotate_pos(const CANON_POSITION pos)
    CANON_POSITION res;
    res.x = unoffset_x(pos.x);
    res.y = unoffset_y(pos.y);
-   rotate(res.x, res.y, -xy_rotation);
+   rotate(res.x, res.y, -canon->xy_rotation);
    res.z = unoffset_z(pos.z);
    res.a = unoffset_a(pos.a);
    res.b = unoffset_b(pos.b);
@@ -323,33 +453,23 @@ static void to_prog(CANON_POSITION & e)
 
 static int axis_valid(int n)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    return ps->axes_mask & (1 << n);
 }
 
-/*
-  canonEndPoint is the last programmed end point, stored in case it's
-  needed for subsequent calculations. It's in absolute frame, mm units.
-
-  note that when segments are queued for the naive cam detector that the
-  canonEndPoint may not be the last programmed endpoint.  get_last_pos()
-  retrieves the xyz position after the last of the queued segments.  these
-  are also in absolute frame, mm units.
-  */
-static CANON_POSITION canonEndPoint;
 static void canonUpdateEndPoint(double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
-   canonEndPoint.x = x;
-   canonEndPoint.y = y;
-   canonEndPoint.z = z;
+   canon->canonEndPoint.x = x;
+   canon->canonEndPoint.y = y;
+   canon->canonEndPoint.z = z;
 
-   canonEndPoint.a = a;
-   canonEndPoint.b = b;
-   canonEndPoint.c = c;
+   canon->canonEndPoint.a = a;
+   canon->canonEndPoint.b = b;
+   canon->canonEndPoint.c = c;
 
-   canonEndPoint.u = u;
-   canonEndPoint.v = v;
-   canonEndPoint.w = w;
+   canon->canonEndPoint.u = u;
+   canon->canonEndPoint.v = v;
+   canon->canonEndPoint.w = w;
 }
 
 /* External call to update the canon end point.
@@ -360,56 +480,59 @@ void CANON_UPDATE_END_POINT(double x, double y, double z, double a, double b, do
                        FROM_PROG_ANG(a), FROM_PROG_ANG(b), FROM_PROG_ANG(c), FROM_PROG_LEN(u), FROM_PROG_LEN(v), FROM_PROG_LEN(w));
 }
 
+/* External call to put the canon end point back at the machine position. The queued segments belong to
+   the program that was interpreted without moving the machine, they are dropped. */
+void CANON_RESET_END_POINT()
+{
+   struct emc_session *ps = canon_session();
+   EmcPose pos = ps->position;
 
-/* motion control mode is used to signify blended v. stop-at-end moves.
-   Set to 0 (invalid) at start, so first call will send command out */
-static CANON_MOTION_MODE canonMotionMode = 0;
-
-/* motion path-following tolerance is used to set the max path-following
-   deviation during CANON_CONTINUOUS.
-   If this param is 0, then it will behave as emc always did, allowing
-   almost any deviation trying to keep speed up. */
-static double canonMotionTolerance = 0.0;
-
-static double canonNaivecamTolerance = 0.0;
-
-/* Spindle speed is saved here */
-static double spindleSpeed = 0.0;
+   canon->chained_points.clear();
+   canon->arc_run.clear();
+   canonUpdateEndPoint(FROM_EXT_LEN(pos.tran.x), FROM_EXT_LEN(pos.tran.y), FROM_EXT_LEN(pos.tran.z),
+                       FROM_EXT_ANG(pos.a), FROM_EXT_ANG(pos.b), FROM_EXT_ANG(pos.c), FROM_EXT_LEN(pos.u), FROM_EXT_LEN(pos.v), FROM_EXT_LEN(pos.w));
+}
 
-/* Prepped tool is saved here */
-static int preppedTool = 0;
+/* Run-from-line approach. The skipped lines left the canon end point where the program expects the
+   tool, the machine is still at ps->position. Clear at the higher Z of the two, move the other axes
+   and plunge, so the first program move (maybe an arc) starts at its own start point. */
+void CANON_APPROACH_END_POINT(int line_number)
+{
+   struct emc_session *ps = canon_session();
+   CANON_POSITION end;
+   EmcPose pos;
+   double z_clear;
 
-/* optional program stop */
-static bool optional_program_stop = ON; //set enabled by default (previous EMC behaviour)
+   flush_segments();
+   end = canon->canonEndPoint;
+   pos = ps->position;
 
-/* optional block delete */
-static bool block_delete = ON;  //set enabled by default (previous EMC behaviour)
+   canonUpdateEndPoint(FROM_EXT_LEN(pos.tran.x), FROM_EXT_LEN(pos.tran.y), FROM_EXT_LEN(pos.tran.z),
+                       FROM_EXT_ANG(pos.a), FROM_EXT_ANG(pos.b), FROM_EXT_ANG(pos.c), FROM_EXT_LEN(pos.u), FROM_EXT_LEN(pos.v), FROM_EXT_LEN(pos.w));
 
-/*
-  Feed rate is saved here; values are in mm/sec or deg/sec.
-  It will be initially set in INIT_CANON() below.
-*/
-static double currentLinearFeedRate = 0.0;
-static double currentAngularFeedRate = 0.0;
+   z_clear = canon->canonEndPoint.z > end.z ? canon->canonEndPoint.z : end.z;
+   if (canon->canonEndPoint.z < z_clear)
+   {
+      CANON_POSITION &start = canon->canonEndPoint;
+      traverse_append(line_number, EMC_MOTION_TYPE_TRAVERSE, start.x, start.y, z_clear, start.a, start.b, start.c, start.u, start.v, start.w);
+   }
+   traverse_append(line_number, EMC_MOTION_TYPE_TRAVERSE, end.x, end.y, z_clear, end.a, end.b, end.c, end.u, end.v, end.w);
+   if (end.z < z_clear)
+      traverse_append(line_number, EMC_MOTION_TYPE_TRAVERSE, end.x, end.y, end.z, end.a, end.b, end.c, end.u, end.v, end.w);
+}
 
-/* Used to indicate whether the current move is linear, angular, or 
-   a combination of both. */
-   //AJ says: linear means axes XYZ move (lines or even circles)
-   //         angular means axes ABC move
-static int cartesian_move = 0;
-static int angular_move = 0;
 
 static double toExtVel(double vel)
 {
-   if (cartesian_move && !angular_move)
+   if (canon->cartesian_move && !canon->angular_move)
    {
       return TO_EXT_LEN(vel);
    }
-   else if (!cartesian_move && angular_move)
+   else if (!canon->cartesian_move && canon->angular_move)
    {
       return TO_EXT_ANG(vel);
    }
-   else if (cartesian_move && angular_move)
+   else if (canon->cartesian_move && canon->angular_move)
    {
       return TO_EXT_LEN(vel);
    }
@@ -433,29 +556,29 @@ static void send_origin_msg(void)
       read-ahead time */
    emc_traj_set_origin_msg_t set_origin_msg = { {EMC_TRAJ_SET_ORIGIN_TYPE} };
 
-   set_origin_msg.origin.tran.x = TO_EXT_LEN(programOrigin.x);
-   set_origin_msg.origin.tran.y = TO_EXT_LEN(programOrigin.y);
-   set_origin_msg.origin.tran.z = TO_EXT_LEN(programOrigin.z);
+   set_origin_msg.origin.tran.x = TO_EXT_LEN(canon->programOrigin.x);
+   set_origin_msg.origin.tran.y = TO_EXT_LEN(canon->programOrigin.y);
+   set_origin_msg.origin.tran.z = TO_EXT_LEN(canon->programOrigin.z);
 
-   set_origin_msg.origin.a = TO_EXT_ANG(programOrigin.a);
-   set_origin_msg.origin.b = TO_EXT_ANG(programOrigin.b);
-   set_origin_msg.origin.c = TO_EXT_ANG(programOrigin.c);
+   set_origin_msg.origin.a = TO_EXT_ANG(canon->programOrigin.a);
+   set_origin_msg.origin.b = TO_EXT_ANG(canon->programOrigin.b);
+   set_origin_msg.origin.c = TO_EXT_ANG(canon->programOrigin.c);
 
-   set_origin_msg.origin.u = TO_EXT_LEN(programOrigin.u);
-   set_origin_msg.origin.v = TO_EXT_LEN(programOrigin.v);
-   set_origin_msg.origin.w = TO_EXT_LEN(programOrigin.w);
+   set_origin_msg.origin.u = TO_EXT_LEN(canon->programOrigin.u);
+   set_origin_msg.origin.v = TO_EXT_LEN(canon->programOrigin.v);
+   set_origin_msg.origin.w = TO_EXT_LEN(canon->programOrigin.w);
 #if 0
-   if (css_maximum)
+   if (canon->css_maximum)
    {
       emc_spindle_speed_msg_t emc_spindle_speed_msg = { {EMC_SPINDLE_SPEED_TYPE}
       };
-      emc_spindle_speed_msg.speed = css_maximum;
+      emc_spindle_speed_msg.speed = canon->css_maximum;
       emc_spindle_speed_msg.factor = css_numerator;
-      emc_spindle_speed_msg.xoffset = TO_EXT_LEN(programOrigin.x + currentToolOffset.tran.x);
-      interp_list.append((emc_command_msg_t *) & emc_spindle_speed_msg);
+      emc_spindle_speed_msg.xoffset = TO_EXT_LEN(canon->programOrigin.x + canon->currentToolOffset.tran.x);
+      canon->list->append((emc_command_msg_t *) & emc_spindle_speed_msg);
    }
 #endif
-   interp_list.append((emc_command_msg_t *) & set_origin_msg);
+   canon->list->append((emc_command_msg_t *) & set_origin_msg);
 }
 #endif
 
@@ -463,7 +586,7 @@ static void send_origin_msg(void)
 
 void SET_XY_ROTATION(double t)
 {
-   xy_rotation = t;
+   canon->xy_rotation = t;
 }
 
 void SET_ORIGIN_OFFSETS(double x, double y, double z, double a, double b, double c, double u, double v, double w)
@@ -479,17 +602,17 @@ void SET_ORIGIN_OFFSETS(double x, double y, double z, double a, double b, double
    v = FROM_PROG_LEN(v);
    w = FROM_PROG_LEN(w);
 
-   programOrigin.x = x;
-   programOrigin.y = y;
-   programOrigin.z = z;
+   canon->programOrigin.x = x;
+   canon->programOrigin.y = y;
+   canon->programOrigin.z = z;
 
-   programOrigin.a = a;
-   programOrigin.b = b;
-   programOrigin.c = c;
+   canon->programOrigin.a = a;
+   canon->programOrigin.b = b;
+   canon->programOrigin.c = c;
 
-   programOrigin.u = u;
-   programOrigin.v = v;
-   programOrigin.w = w;
+   canon->programOrigin.u = u;
+   canon->programOrigin.v = v;
+   canon->programOrigin.w = w;
 
    //   send_origin_msg();
 }
@@ -497,8 +620,8 @@ void SET_ORIGIN_OFFSETS(double x, double y, double z, double a, double b, double
 
 void USE_LENGTH_UNITS(CANON_UNITS in_unit)
 {
-   struct emc_session *ps = &session; 
-   lengthUnits = in_unit;
+   struct emc_session *ps = canon_session();
+   canon->lengthUnits = in_unit;
    ps->programUnits = in_unit;
 }
 
@@ -511,18 +634,18 @@ void SET_TRAVERSE_RATE(double rate)
 void SET_FEED_MODE(int mode)
 {
    flush_segments();
-   feed_mode = mode;
-   //if (feed_mode == 0)
+   canon->feed_mode = mode;
+   //if (canon->feed_mode == 0)
    //   STOP_SPEED_FEED_SYNCH();
 }
 
 void SET_FEED_RATE(double rate)
 {
 
-   //if (feed_mode)
+   //if (canon->feed_mode)
    //{
    //   START_SPEED_FEED_SYNCH(rate, 1);
-   //   currentLinearFeedRate = rate;
+   //   canon->currentLinearFeedRate = rate;
    //}
    //else
    //{
@@ -533,11 +656,11 @@ void SET_FEED_RATE(double rate)
       /* convert to traj units (mm & deg) if needed */
       double newLinearFeedRate = FROM_PROG_LEN(rate), newAngularFeedRate = FROM_PROG_ANG(rate);
 
-      if (newLinearFeedRate != currentLinearFeedRate || newAngularFeedRate != currentAngularFeedRate)
+      if (newLinearFeedRate != canon->currentLinearFeedRate || newAngularFeedRate != canon->currentAngularFeedRate)
          flush_segments();
 
-      currentLinearFeedRate = newLinearFeedRate;
-      currentAngularFeedRate = newAngularFeedRate;
+      canon->currentLinearFeedRate = newLinearFeedRate;
+      canon->currentAngularFeedRate = newAngularFeedRate;
    //}
 }
 
@@ -548,7 +671,7 @@ void SET_FEED_REFERENCE(CANON_FEED_REFERENCE reference)
 
 double getStraightAcceleration(double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    double dx, dy, dz, du, dv, dw, da, db, dc;
    double tx, ty, tz, tu, tv, tw, ta, tb, tc, tmax;
    double acc, dtot;
@@ -556,15 +679,15 @@ double getStraightAcceleration(double x, double y, double z, double a, double b,
    acc = 0.0;   // if a move to nowhere
 
    // Compute absolute travel distance for each axis:
-   dx = fabs(x - canonEndPoint.x);
-   dy = fabs(y - canonEndPoint.y);
-   dz = fabs(z - canonEndPoint.z);
-   da = fabs(a - canonEndPoint.a);
-   db = fabs(b - canonEndPoint.b);
-   dc = fabs(c - canonEndPoint.c);
-   du = fabs(u - canonEndPoint.u);
-   dv = fabs(v - canonEndPoint.v);
-   dw = fabs(w - canonEndPoint.w);
+   dx = fabs(x - canon->canonEndPoint.x);
+   dy = fabs(y - canon->canonEndPoint.y);
+   dz = fabs(z - canon->canonEndPoint.z);
+   da = fabs(a - canon->canonEndPoint.a);
+   db = fabs(b - canon->canonEndPoint.b);
+   dc = fabs(c - canon->canonEndPoint.c);
+   du = fabs(u - canon->canonEndPoint.u);
+   dv = fabs(v - canon->canonEndPoint.v);
+   dw = fabs(w - canon->canonEndPoint.w);
 
    if (!axis_valid(0) || dx < tiny)
       dx = 0.0;
@@ -592,23 +715,23 @@ double getStraightAcceleration(double x, double y, double z, double a, double b,
    // the units of vel/acc.
    if (dx <= 0.0 && dy <= 0.0 && dz <= 0.0 && du <= 0.0 && dv <= 0.0 && dw <= 0.0)
    {
-      cartesian_move = 0;
+      canon->cartesian_move = 0;
    }
    else
    {
-      cartesian_move = 1;
+      canon->cartesian_move = 1;
    }
    if (da <= 0.0 && db <= 0.0 && dc <= 0.0)
    {
-      angular_move = 0;
+      canon->angular_move = 0;
    }
    else
    {
-      angular_move = 1;
+      canon->angular_move = 1;
    }
 
    // Pure linear move:
-   if (cartesian_move && !angular_move)
+   if (canon->cartesian_move && !canon->angular_move)
    {
       tx = dx ? (dx / FROM_EXT_LEN(ps->axis[0].max_acceleration)) : 0.0;
       ty = dy ? (dy / FROM_EXT_LEN(ps->axis[1].max_acceleration)) : 0.0;
@@ -630,7 +753,7 @@ double getStraightAcceleration(double x, double y, double z, double a, double b,
       }
    }
    // Pure angular move:
-   else if (!cartesian_move && angular_move)
+   else if (!canon->cartesian_move && canon->angular_move)
    {
       ta = da ? (da / FROM_EXT_ANG(ps->axis[3].max_acceleration)) : 0.0;
       tb = db ? (db / FROM_EXT_ANG(ps->axis[4].max_acceleration)) : 0.0;
@@ -644,7 +767,7 @@ double getStraightAcceleration(double x, double y, double z, double a, double b,
       }
    }
    // Combination angular and linear move:
-   else if (cartesian_move && angular_move)
+   else if (canon->cartesian_move && canon->angular_move)
    {
       tx = dx ? (dx / FROM_EXT_LEN(ps->axis[0].max_acceleration)) : 0.0;
       ty = dy ? (dy / FROM_EXT_LEN(ps->axis[1].max_acceleration)) : 0.0;
@@ -674,32 +797,32 @@ double getStraightAcceleration(double x, double y, double z, double a, double b,
       }
    }
    if (debug_velacc)
-      printf("cartesian %d ang %d acc %g\n", cartesian_move, angular_move, acc);
+      printf("cartesian %d ang %d acc %g\n", canon->cartesian_move, canon->angular_move, acc);
    return acc;
 }
 
 double getStraightVelocity(double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    double dx, dy, dz, da, db, dc, du, dv, dw;
    double tx, ty, tz, ta, tb, tc, tu, tv, tw, tmax;
    double vel, dtot;
 
-/* If we get a move to nowhere (!cartesian_move && !angular_move)
+/* If we get a move to nowhere (!canon->cartesian_move && !canon->angular_move)
    we might as well go there at the currentLinearFeedRate...
 */
-   vel = currentLinearFeedRate;
+   vel = canon->currentLinearFeedRate;
 
    // Compute absolute travel distance for each axis:
-   dx = fabs(x - canonEndPoint.x);
-   dy = fabs(y - canonEndPoint.y);
-   dz = fabs(z - canonEndPoint.z);
-   da = fabs(a - canonEndPoint.a);
-   db = fabs(b - canonEndPoint.b);
-   dc = fabs(c - canonEndPoint.c);
-   du = fabs(u - canonEndPoint.u);
-   dv = fabs(v - canonEndPoint.v);
-   dw = fabs(w - canonEndPoint.w);
+   dx = fabs(x - canon->canonEndPoint.x);
+   dy = fabs(y - canon->canonEndPoint.y);
+   dz = fabs(z - canon->canonEndPoint.z);
+   da = fabs(a - canon->canonEndPoint.a);
+   db = fabs(b - canon->canonEndPoint.b);
+   dc = fabs(c - canon->canonEndPoint.c);
+   du = fabs(u - canon->canonEndPoint.u);
+   dv = fabs(v - canon->canonEndPoint.v);
+   dw = fabs(w - canon->canonEndPoint.w);
 
    if (!axis_valid(0) || dx < tiny)
       dx = 0.0;
@@ -726,23 +849,23 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
    // Figure out what kind of move we're making:
    if (dx <= 0.0 && dy <= 0.0 && dz <= 0.0 && du <= 0.0 && dv <= 0.0 && dw <= 0.0)
    {
-      cartesian_move = 0;
+      canon->cartesian_move = 0;
    }
    else
    {
-      cartesian_move = 1;
+      canon->cartesian_move = 1;
    }
    if (da <= 0.0 && db <= 0.0 && dc <= 0.0)
    {
-      angular_move = 0;
+      canon->angular_move = 0;
    }
    else
    {
-      angular_move = 1;
+      canon->angular_move = 1;
    }
 
    // Pure linear move:
-   if (cartesian_move && !angular_move)
+   if (canon->cartesian_move && !canon->angular_move)
    {
       tx = dx ? fabs(dx / FROM_EXT_LEN(ps->axis[0].max_velocity)) : 0.0;
       ty = dy ? fabs(dy / FROM_EXT_LEN(ps->axis[1].max_velocity)) : 0.0;
@@ -760,7 +883,7 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
 
       if (tmax <= 0.0)
       {
-         vel = currentLinearFeedRate;
+         vel = canon->currentLinearFeedRate;
       }
       else
       {
@@ -768,7 +891,7 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
       }
    }
    // Pure angular move:
-   else if (!cartesian_move && angular_move)
+   else if (!canon->cartesian_move && canon->angular_move)
    {
       ta = da ? fabs(da / FROM_EXT_ANG(ps->axis[3].max_velocity)) : 0.0;
       tb = db ? fabs(db / FROM_EXT_ANG(ps->axis[4].max_velocity)) : 0.0;
@@ -778,7 +901,7 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
       dtot = sqrt(da * da + db * db + dc * dc);
       if (tmax <= 0.0)
       {
-         vel = currentAngularFeedRate;
+         vel = canon->currentAngularFeedRate;
       }
       else
       {
@@ -786,7 +909,7 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
       }
    }
    // Combination angular and linear move:
-   else if (cartesian_move && angular_move)
+   else if (canon->cartesian_move && canon->angular_move)
    {
       tx = dx ? fabs(dx / FROM_EXT_LEN(ps->axis[0].max_velocity)) : 0.0;
       ty = dy ? fabs(dy / FROM_EXT_LEN(ps->axis[1].max_velocity)) : 0.0;
@@ -812,7 +935,7 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
 
       if (tmax <= 0.0)
       {
-         vel = currentLinearFeedRate;
+         vel = canon->currentLinearFeedRate;
       }
       else
       {
@@ -820,70 +943,250 @@ double getStraightVelocity(double x, double y, double z, double a, double b, dou
       }
    }
    if (debug_velacc)
-      printf("cartesian %d ang %d vel %g\n", cartesian_move, angular_move, vel);
+      printf("cartesian %d ang %d vel %g\n", canon->cartesian_move, canon->angular_move, vel);
    return vel;
 }
 
-#include <vector>
-struct pt
+/* Return the start of chord i in the arc run. */
+static const EmcPose *arc_chord_start(int i)
 {
-   double x, y, z, a, b, c, u, v, w;
-   int line_no;
-};
+   return (i == 0) ? &canon->arc_start : &canon->arc_run[i - 1].msg.end;
+}
+
+/* Check chord i against the arc circle and add its angle to the sweep, return 1 if it fits. */
+static int arc_chord_fits(int i, double tol)
+{
+   const EmcPose *a = arc_chord_start(i), *b = &canon->arc_run[i].msg.end;
+   double ax = a->tran.x - canon->arc_center.x, ay = a->tran.y - canon->arc_center.y;
+   double bx = b->tran.x - canon->arc_center.x, by = b->tran.y - canon->arc_center.y;
+   double dx = bx - ax, dy = by - ay, len2 = dx * dx + dy * dy, t, step;
 
-static std::vector < struct pt >&chained_points(void)
+   if (fabs(hypot(ax, ay) - canon->arc_radius) > tol || fabs(hypot(bx, by) - canon->arc_radius) > tol)
+      return 0;
+
+   /* The chord is closest to the center where the center projects onto it. */
+   t = (len2 > 0) ? -(ax * dx + ay * dy) / len2 : 0;
+   if (t > 0 && t < 1 && canon->arc_radius - hypot(ax + t * dx, ay + t * dy) > tol)
+      return 0;
+
+   step = atan2(ax * by - ay * bx, ax * bx + ay * by);
+   if (step * canon->arc_rotation <= 0)
+      return 0;
+   canon->arc_sweep += fabs(step);
+   return canon->arc_sweep < 2 * M_PI - 1e-3;
+}
+
+/* Points dropped by chaining are within the tolerance of the chord, chords replaced by an arc are within
+   the tolerance of the arc. When both run each gets half, so the arc stays within the tolerance of the points. */
+static double naivecam_tolerance(void)
 {
-   static std::vector < struct pt >points;
-   return points;
+   return (canon->naivecam_arc_chords > 0) ? 0.5 * canon->canonNaivecamTolerance : canon->canonNaivecamTolerance;
 }
 
-static void flush_segments(void)
+/* Return 1 if the whole arc run is within tolerance of one circle. */
+static int arc_run_fits(void)
+{
+   int i, n = canon->arc_run.size();
+   double tol = TO_EXT_LEN(naivecam_tolerance());
+
+   if (n < 2)
+      return 1;
+
+   if (canon->arc_rotation != 0 && arc_chord_fits(n - 1, tol))
+      return 1;
+
+   /* Try the circle through the start, middle and end of the run. */
+   const EmcPose *p0 = &canon->arc_start, *p1 = &canon->arc_run[n / 2 - 1].msg.end, *p2 = &canon->arc_run[n - 1].msg.end;
+   double x1 = p1->tran.x - p0->tran.x, y1 = p1->tran.y - p0->tran.y;
+   double x2 = p2->tran.x - p0->tran.x, y2 = p2->tran.y - p0->tran.y;
+   double den = 2 * (x1 * y2 - y1 * x2), cx, cy;
+
+   canon->arc_rotation = 0;
+   if (fabs(den) < tiny * (x1 * x1 + y1 * y1 + x2 * x2 + y2 * y2))
+      return 0; /* straight */
+   cx = (y2 * (x1 * x1 + y1 * y1) - y1 * (x2 * x2 + y2 * y2)) / den;
+   cy = (x1 * (x2 * x2 + y2 * y2) - x2 * (x1 * x1 + y1 * y1)) / den;
+   canon->arc_center.x = p0->tran.x + cx;
+   canon->arc_center.y = p0->tran.y + cy;
+   canon->arc_center.z = p0->tran.z;
+   canon->arc_radius = hypot(cx, cy);
+   canon->arc_rotation = (den > 0) ? 1 : -1;
+   canon->arc_sweep = 0;
+
+   for (i = 0; i < n; i++)
+   {
+      if (!arc_chord_fits(i, tol))
+      {
+         canon->arc_rotation = 0;
+         return 0;
+      }
+   }
+   return 1;
+}
+
+/* Send the first n chords of the arc run, as one arc if there are enough of them. */
+static void arc_run_send(int n)
+{
+   struct emc_session *ps = canon_session();
+   int i;
+
+   if (n >= canon->naivecam_arc_chords && canon->arc_rotation != 0)
+   {
+      emc_traj_circular_move_msg_t circularMoveMsg = { {EMC_TRAJ_CIRCULAR_MOVE_TYPE} };
+      emc_traj_linear_move_msg_t *last = &canon->arc_run[n - 1].msg;
+
+      circularMoveMsg.feed_mode = last->feed_mode;
+      circularMoveMsg.end = last->end;
+      circularMoveMsg.center = canon->arc_center;
+      circularMoveMsg.normal.x = 0.0;
+      circularMoveMsg.normal.y = 0.0;
+      circularMoveMsg.normal.z = 1.0;
+      circularMoveMsg.turn = (canon->arc_rotation > 0) ? 0 : -1;
+      circularMoveMsg.type = EMC_MOTION_TYPE_ARC;
+
+      /* The chords already honour feed and axis limits, add the centripetal limit. */
+      circularMoveMsg.vel = last->vel;
+      circularMoveMsg.ini_maxvel = last->ini_maxvel;
+      circularMoveMsg.acc = last->acc;
+      for (i = 0; i < n - 1; i++)
+      {
+         circularMoveMsg.vel = MIN(circularMoveMsg.vel, canon->arc_run[i].msg.vel);
+         circularMoveMsg.ini_maxvel = MIN(circularMoveMsg.ini_maxvel, canon->arc_run[i].msg.ini_maxvel);
+         circularMoveMsg.acc = MIN(circularMoveMsg.acc, canon->arc_run[i].msg.acc);
+      }
+      circularMoveMsg.ini_maxvel = MIN(circularMoveMsg.ini_maxvel,
+                                       sqrt(MIN(ps->axis[0].max_acceleration, ps->axis[1].max_acceleration) * canon->arc_radius));
+      circularMoveMsg.vel = MIN(circularMoveMsg.vel, circularMoveMsg.ini_maxvel);
+
+      canon->list->set_line_number(canon->arc_run[n - 1].line_no);
+      canon->list->append((emc_command_msg_t *) & circularMoveMsg);
+   }
+   else
+   {
+      for (i = 0; i < n; i++)
+      {
+         canon->list->set_line_number(canon->arc_run[i].line_no);
+         canon->list->append((emc_command_msg_t *) & canon->arc_run[i].msg);
+      }
+   }
+
+   canon->arc_start = canon->arc_run[n - 1].msg.end;
+   canon->arc_run.erase(canon->arc_run.begin(), canon->arc_run.begin() + n);
+   canon->arc_rotation = 0;
+}
+
+static void flush_arc_run(void)
 {
-   if (chained_points().empty())
+   if (!canon->arc_run.empty())
+      arc_run_send(canon->arc_run.size());
+}
+
+/* Queue a joined G1 move for the arc fitter, sending whatever can no longer be part of an arc. */
+static void arc_run_add(const emc_traj_linear_move_msg_t * msg, int line_no)
+{
+   EmcPose start = to_ext_pose(canon->canonEndPoint.x, canon->canonEndPoint.y, canon->canonEndPoint.z,
+                               canon->canonEndPoint.a, canon->canonEndPoint.b, canon->canonEndPoint.c,
+                               canon->canonEndPoint.u, canon->canonEndPoint.v, canon->canonEndPoint.w);
+   struct arc_chord chord;
+
+   /* Only flat moves in the XY plane are fitted. */
+   if (msg->end.tran.z != start.tran.z || msg->end.a != start.a || msg->end.b != start.b || msg->end.c != start.c ||
+       msg->end.u != start.u || msg->end.v != start.v || msg->end.w != start.w)
+   {
+      flush_arc_run();
+      canon->list->set_line_number(line_no);
+      canon->list->append((emc_command_msg_t *) msg);
       return;
+   }
 
-   struct pt &pos = chained_points().back();
+   if (canon->arc_run.empty() || msg->feed_mode != canon->arc_run[0].msg.feed_mode)
+   {
+      flush_arc_run();
+      canon->arc_start = start;
+   }
 
-   double x = pos.x, y = pos.y, z = pos.z;
-   double a = pos.a, b = pos.b, c = pos.c;
-   double u = pos.u, v = pos.v, w = pos.w;
+   /* Remember the circle the run fits so far. */
+   PmCartesian center = canon->arc_center;
+   double radius = canon->arc_radius, sweep = canon->arc_sweep;
+   int rotation = canon->arc_rotation;
 
-   int line_no = pos.line_no;
+   chord.msg = *msg;
+   chord.line_no = line_no;
+   canon->arc_run.push_back(chord);
 
-#ifdef SHOW_JOINED_SEGMENTS
-   for (unsigned int i = 0; i != chained_points().size(); i++)
+   if (!arc_run_fits() && (int)canon->arc_run.size() - 1 >= canon->naivecam_arc_chords)
    {
-      printf(".");
+      /* The run before this chord is an arc, send it and start over from here. */
+      canon->arc_run.pop_back();
+      canon->arc_center = center;
+      canon->arc_radius = radius;
+      canon->arc_sweep = sweep;
+      canon->arc_rotation = rotation;
+      flush_arc_run();
+      canon->arc_run.push_back(chord);
+   }
+   else
+   {
+      while (!arc_run_fits())
+         arc_run_send(1);       /* too few chords for an arc, give up on the oldest */
    }
-   printf("\n");
-#endif
 
-   double ini_maxvel = getStraightVelocity(x, y, z, a, b, c, u, v, w), vel = ini_maxvel;
+   if ((int)canon->arc_run.size() >= canon->naivecam_chain_max)
+      flush_arc_run();
+}
 
-   if (cartesian_move && !angular_move)
+/* Cap the velocity of the move getStraightVelocity() was last called for at the feed rate. */
+static double limitFeedVelocity(double vel)
+{
+   if (canon->cartesian_move && !canon->angular_move)
    {
-      if (vel > currentLinearFeedRate)
+      if (vel > canon->currentLinearFeedRate)
       {
-         vel = currentLinearFeedRate;
+         vel = canon->currentLinearFeedRate;
       }
    }
-   else if (!cartesian_move && angular_move)
+   else if (!canon->cartesian_move && canon->angular_move)
    {
-      if (vel > currentAngularFeedRate)
+      if (vel > canon->currentAngularFeedRate)
       {
-         vel = currentAngularFeedRate;
+         vel = canon->currentAngularFeedRate;
       }
    }
-   else if (cartesian_move && angular_move)
+   else if (canon->cartesian_move && canon->angular_move)
    {
-      if (vel > currentLinearFeedRate)
+      if (vel > canon->currentLinearFeedRate)
       {
-         vel = currentLinearFeedRate;
+         vel = canon->currentLinearFeedRate;
       }
    }
+   return vel;
+}
+
+static void flush_chain(void)
+{
+   if (canon->chained_points.empty())
+      return;
+
+   struct pt &pos = canon->chained_points.back();
+
+   double x = pos.x, y = pos.y, z = pos.z;
+   double a = pos.a, b = pos.b, c = pos.c;
+   double u = pos.u, v = pos.v, w = pos.w;
+
+   int line_no = pos.line_no;
+
+#ifdef SHOW_JOINED_SEGMENTS
+   for (unsigned int i = 0; i != canon->chained_points.size(); i++)
+   {
+      printf(".");
+   }
+   printf("\n");
+#endif
+
+   double ini_maxvel = getStraightVelocity(x, y, z, a, b, c, u, v, w), vel = limitFeedVelocity(ini_maxvel);
 
    emc_traj_linear_move_msg_t linearMoveMsg = { {EMC_TRAJ_LINEAR_MOVE_TYPE} };
-   linearMoveMsg.feed_mode = feed_mode;
+   linearMoveMsg.feed_mode = canon->feed_mode;
 
    // now x, y, z, and b are in absolute mm or degree units
    linearMoveMsg.end.tran.x = TO_EXT_LEN(x);
@@ -905,27 +1208,38 @@ static void flush_segments(void)
    linearMoveMsg.acc = toExtAcc(acc);
 
    linearMoveMsg.type = EMC_MOTION_TYPE_FEED;
-   if ((vel && acc) || synched)
+   if (vel && acc && !canon->synched && canon->naivecam_arc_chords > 0 && canon->canonMotionMode == CANON_CONTINUOUS && canon->canonNaivecamTolerance > 0)
    {
-      interp_list.set_line_number(line_no);
-      interp_list.append((emc_command_msg_t *) & linearMoveMsg);
+      arc_run_add(&linearMoveMsg, line_no);
+   }
+   else if ((vel && acc) || canon->synched)
+   {
+      flush_arc_run();
+      canon->list->set_line_number(line_no);
+      canon->list->append((emc_command_msg_t *) & linearMoveMsg);
    }
    canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 
-   chained_points().clear();
+   canon->chained_points.clear();
+}
+
+static void flush_segments(void)
+{
+   flush_chain();
+   flush_arc_run();
 }
 
 static void get_last_pos(double &lx, double &ly, double &lz)
 {
-   if (chained_points().empty())
+   if (canon->chained_points.empty())
    {
-      lx = canonEndPoint.x;
-      ly = canonEndPoint.y;
-      lz = canonEndPoint.z;
+      lx = canon->canonEndPoint.x;
+      ly = canon->canonEndPoint.y;
+      lz = canon->canonEndPoint.z;
    }
    else
    {
-      struct pt &pos = chained_points().back();
+      struct pt &pos = canon->chained_points.back();
       lx = pos.x;
       ly = pos.y;
       lz = pos.z;
@@ -934,11 +1248,11 @@ static void get_last_pos(double &lx, double &ly, double &lz)
 
 static bool linkable(double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
-   struct pt &pos = chained_points().back();
-   if (canonMotionMode != CANON_CONTINUOUS || canonNaivecamTolerance == 0)
+   struct pt &pos = canon->chained_points.back();
+   if (canon->canonMotionMode != CANON_CONTINUOUS || canon->canonNaivecamTolerance == 0)
       return false;
 
-   if (chained_points().size() > 100)
+   if ((int)canon->chained_points.size() >= canon->naivecam_chain_max)
       return false;
 
    if (a != pos.a)
@@ -954,41 +1268,85 @@ static bool linkable(double x, double y, double z, double a, double b, double c,
    if (w != pos.w)
       return false;
 
-   if (x == canonEndPoint.x && y == canonEndPoint.y && z == canonEndPoint.z)
+   if (x == canon->canonEndPoint.x && y == canon->canonEndPoint.y && z == canon->canonEndPoint.z)
+      return false;
+
+   /* The new end point must reach past every queued point (so none of them
+      project beyond it) and point along a direction inside the chain cone. */
+   PM_CARTESIAN M(x - canon->canonEndPoint.x, y - canon->canonEndPoint.y, z - canon->canonEndPoint.z);
+   double len = mag(M);
+   if (len < canon->chain_reach)
       return false;
+   if (canon->chain_angle >= M_PI)
+      return true;
+   return dot(M, canon->chain_axis) >= len * cos(canon->chain_angle);
+}
 
-   for (std::vector < struct pt >::iterator it = chained_points().begin(); it != chained_points().end(); it++)
+/* Narrow the chain cone to the directions that pass within tolerance of the point just queued. */
+static void chain_add(const struct pt &pos)
+{
+   PM_CARTESIAN P(pos.x - canon->canonEndPoint.x, pos.y - canon->canonEndPoint.y, pos.z - canon->canonEndPoint.z);
+   double len = mag(P), tol = naivecam_tolerance(), alpha, beta, gamma, theta;
+
+   if (canon->chained_points.size() == 1)
+   {
+      canon->chain_angle = M_PI;
+      canon->chain_reach = 0.0;
+   }
+   if (len > canon->chain_reach)
+      canon->chain_reach = len;
+   if (len <= tol)
+      return;   /* any direction passes close enough */
+
+   PM_CARTESIAN dir = P / len;
+   alpha = canon->chain_angle;
+   beta = asin(tol / len);
+
+   if (alpha >= M_PI)
    {
-      PM_CARTESIAN M(x - canonEndPoint.x, y - canonEndPoint.y, z - canonEndPoint.z),
-         B(canonEndPoint.x, canonEndPoint.y, canonEndPoint.z), P(it->x, it->y, it->z);
-      double t0 = dot(M, P - B) / dot(M, M);
-      if (t0 < 0)
-         t0 = 0;
-      if (t0 > 1)
-         t0 = 1;
+      canon->chain_axis = dir;
+      canon->chain_angle = beta;
+      return;
+   }
 
-      double D = mag(P - (B + t0 * M));
-      if (D > canonNaivecamTolerance)
-         return false;
+   gamma = acos(fmax(-1.0, fmin(1.0, dot(canon->chain_axis, dir))));
+   if (gamma + beta <= alpha)
+   {
+      canon->chain_axis = dir;  /* new cone lies inside the old one */
+      canon->chain_angle = beta;
+      return;
+   }
+   if (gamma + alpha <= beta || gamma < tiny)
+   {
+      canon->chain_angle = fmin(alpha, beta);
+      return;
    }
-   return true;
+
+   /* Keep the largest cone inside the intersection of both, it is centered
+      on the great circle between the two axes. */
+   theta = (gamma - beta + alpha) / 2;
+   PM_CARTESIAN perp = dir - dot(dir, canon->chain_axis) * canon->chain_axis;
+   perp = perp / mag(perp);
+   canon->chain_axis = cos(theta) * canon->chain_axis + sin(theta) * perp;
+   canon->chain_angle = fmax(0.0, (alpha + beta - gamma) / 2);
 }
 
 static void see_segment(int line_number, double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
-   bool changed_abc = (a != canonEndPoint.a) || (b != canonEndPoint.b) || (c != canonEndPoint.c);
+   bool changed_abc = (a != canon->canonEndPoint.a) || (b != canon->canonEndPoint.b) || (c != canon->canonEndPoint.c);
 
-   bool changed_uvw = (u != canonEndPoint.u) || (v != canonEndPoint.v) || (w != canonEndPoint.w);
+   bool changed_uvw = (u != canon->canonEndPoint.u) || (v != canon->canonEndPoint.v) || (w != canon->canonEndPoint.w);
 
-   if (!chained_points().empty() && !linkable(x, y, z, a, b, c, u, v, w))
+   if (!canon->chained_points.empty() && !linkable(x, y, z, a, b, c, u, v, w))
    {
-      flush_segments();
+      flush_chain();
    }
    pt pos = { x, y, z, a, b, c, u, v, w, line_number };
-   chained_points().push_back(pos);
+   canon->chained_points.push_back(pos);
+   chain_add(pos);
    if (changed_abc || changed_uvw)
    {
-      flush_segments();
+      flush_chain();
    }
 }
 
@@ -997,20 +1355,15 @@ void FINISH()
    flush_segments();
 }
 
-/* Rapid move no cutting (G0). */
-void STRAIGHT_TRAVERSE(int line_number, double x, double y, double z, double a, double b, double c, double u, double v, double w)
+/* Append one rapid move from the canon end point. */
+static void traverse_append(int line_number, enum EMC_MOTION_TYPE type, double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
    double vel, acc;
 
-   flush_segments();
-
    emc_traj_linear_move_msg_t linearMoveMsg = { {EMC_TRAJ_LINEAR_MOVE_TYPE} };
 
    linearMoveMsg.feed_mode = 0;
-   linearMoveMsg.type = EMC_MOTION_TYPE_TRAVERSE;
-
-   from_prog(x, y, z, a, b, c, u, v, w);
-   rotate_and_offset_pos(x, y, z, a, b, c, u, v, w);
+   linearMoveMsg.type = type;
 
    vel = getStraightVelocity(x, y, z, a, b, c, u, v, w);
    acc = getStraightAcceleration(x, y, z, a, b, c, u, v, w);
@@ -1019,22 +1372,51 @@ void STRAIGHT_TRAVERSE(int line_number, double x, double y, double z, double a,
    linearMoveMsg.vel = linearMoveMsg.ini_maxvel = toExtVel(vel);
    linearMoveMsg.acc = toExtAcc(acc);
 
-   //int old_feed_mode = feed_mode;
-   //if (feed_mode)
+   //int old_feed_mode = canon->feed_mode;
+   //if (canon->feed_mode)
    //   STOP_SPEED_FEED_SYNCH();
 
    if (vel && acc)
    {
-      interp_list.set_line_number(line_number);
-      interp_list.append((emc_command_msg_t *) & linearMoveMsg);
+      canon->list->set_line_number(line_number);
+      canon->list->append((emc_command_msg_t *) & linearMoveMsg);
    }
 
    //if (old_feed_mode)
-   //   START_SPEED_FEED_SYNCH(currentLinearFeedRate, 1);
+   //   START_SPEED_FEED_SYNCH(canon->currentLinearFeedRate, 1);
 
    canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 }
 
+/* Rapid move no cutting (G0). With RAPID_MODE = 1 Z goes up first or down last on its own
+   and the rest is a dogleg move, every axis runs at its own MAX_VELOCITY and MAX_ACCELERATION. */
+void STRAIGHT_TRAVERSE(int line_number, double x, double y, double z, double a, double b, double c, double u, double v, double w)
+{
+   struct emc_session *ps = canon_session();
+   enum EMC_MOTION_TYPE type = EMC_MOTION_TYPE_TRAVERSE;
+
+   flush_segments();
+
+   from_prog(x, y, z, a, b, c, u, v, w);
+   rotate_and_offset_pos(x, y, z, a, b, c, u, v, w);
+
+   if (ps->rapid_mode == EMC_RAPID_DOGLEG)
+   {
+      CANON_POSITION start = canon->canonEndPoint;
+
+      type = EMC_MOTION_TYPE_DOGLEG;
+      if (z > start.z)
+         traverse_append(line_number, EMC_MOTION_TYPE_TRAVERSE, start.x, start.y, z, start.a, start.b, start.c, start.u, start.v, start.w);
+      else if (z < start.z)
+      {
+         traverse_append(line_number, EMC_MOTION_TYPE_DOGLEG, x, y, start.z, a, b, c, u, v, w);
+         type = EMC_MOTION_TYPE_TRAVERSE;
+      }
+   }
+
+   traverse_append(line_number, type, x, y, z, a, b, c, u, v, w);
+}
+
 /* Move at cutting feed rate (G1). */
 void STRAIGHT_FEED(int line_number, double x, double y, double z, double a, double b, double c, double u, double v, double w)
 {
@@ -1043,6 +1425,51 @@ void STRAIGHT_FEED(int line_number, double x, double y, double z, double a, doub
    see_segment(line_number, x, y, z, a, b, c, u, v, w);
 }
 
+/* Peck drilling cycle (G73, G83), sent as one message and expanded by the dispatcher. */
+void DRILL_CYCLE(int line_number, int chip_break, double x, double y, double z, double a, double b, double c, double u, double v, double w,
+                 double clear, double delta, double retract)
+{
+   double ini_maxvel, vel, rapid_vel, acc, depth, k;
+   CANON_POSITION &start = canon->canonEndPoint;
+
+   flush_segments();
+
+   from_prog(x, y, z, a, b, c, u, v, w);
+   rotate_and_offset_pos(x, y, z, a, b, c, u, v, w);
+
+   depth = sqrt(pmSq(x - start.x) + pmSq(y - start.y) + pmSq(z - start.z) + pmSq(u - start.u) + pmSq(v - start.v) + pmSq(w - start.w));
+   if (depth == 0.0)
+      return;
+
+   /* All moves of the cycle are along the same line, so they share the axis limits. */
+   rapid_vel = ini_maxvel = getStraightVelocity(x, y, z, a, b, c, u, v, w);
+   vel = limitFeedVelocity(ini_maxvel);
+   acc = getStraightAcceleration(x, y, z, a, b, c, u, v, w);
+
+   emc_traj_drill_cycle_msg_t drillCycleMsg = { {EMC_TRAJ_DRILL_CYCLE_TYPE} };
+   drillCycleMsg.mode = chip_break ? EMC_DRILL_CHIP_BREAK : EMC_DRILL_PECK;
+   drillCycleMsg.bottom = to_ext_pose(x, y, z, a, b, c, u, v, w);
+   drillCycleMsg.clear = TO_EXT_LEN(FROM_PROG_LEN(clear));
+   drillCycleMsg.delta = TO_EXT_LEN(FROM_PROG_LEN(delta));
+   drillCycleMsg.retract = TO_EXT_LEN(FROM_PROG_LEN(retract));
+   drillCycleMsg.vel = toExtVel(vel);
+   drillCycleMsg.ini_maxvel = toExtVel(ini_maxvel);
+   drillCycleMsg.acc = toExtAcc(acc);
+   drillCycleMsg.rapid_vel = toExtVel(rapid_vel);
+   drillCycleMsg.rapid_acc = toExtAcc(acc);
+
+   if (vel && acc)
+   {
+      canon->list->set_line_number(line_number);
+      canon->list->append((emc_command_msg_t *) & drillCycleMsg);
+   }
+
+   /* The cycle ends at the clearance point, back out from the start. */
+   k = FROM_PROG_LEN(clear) / depth;
+   canonUpdateEndPoint(start.x + (start.x - x) * k, start.y + (start.y - y) * k, start.z + (start.z - z) * k, a, b, c,
+                       start.u + (start.u - u) * k, start.v + (start.v - v) * k, start.w + (start.w - w) * k);
+}
+
 void RIGID_TAP(int line_number, double x, double y, double z)
 {
    DBG("warning rigid_tap command is unimplemented: line number=%d\n", line_number);
@@ -1065,14 +1492,14 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode, double tolerance)
 
    flush_segments();
 
-   canonMotionMode = mode;
-   canonMotionTolerance = FROM_PROG_LEN(tolerance);
+   canon->canonMotionMode = mode;
+   canon->canonMotionTolerance = FROM_PROG_LEN(tolerance);
 
    switch (mode)
    {
    case CANON_CONTINUOUS:
       setTermCondMsg.cond = TC_TERM_COND_BLEND;                /* G64 */
-      setTermCondMsg.tolerance = TO_EXT_LEN(canonMotionTolerance);  /* not support by EMC-2.1 TP */
+      setTermCondMsg.tolerance = TO_EXT_LEN(canon->canonMotionTolerance);  /* not support by EMC-2.1 TP */
       break;
 
    default:
@@ -1080,17 +1507,27 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode, double tolerance)
       break;
    }
 
-   interp_list.append((emc_command_msg_t *) & setTermCondMsg);
+   canon->list->append((emc_command_msg_t *) & setTermCondMsg);
 }
 
 void SET_NAIVECAM_TOLERANCE(double tolerance)
 {
-   canonNaivecamTolerance = FROM_PROG_LEN(tolerance);
+   canon->canonNaivecamTolerance = FROM_PROG_LEN(tolerance);
+}
+
+void SET_NAIVECAM_CHAIN_MAX(int max)
+{
+   canon->naivecam_chain_max = (max > 0) ? max : 1;
+}
+
+void SET_NAIVECAM_ARC_CHORDS(int chords)
+{
+   canon->naivecam_arc_chords = (chords > 0) ? MAX(chords, 2) : 0;
 }
 
 void SELECT_PLANE(CANON_PLANE in_plane)
 {
-   activePlane = in_plane;
+   canon->activePlane = in_plane;
 }
 
 void SET_CUTTER_RADIUS_COMPENSATION(double radius)
@@ -1115,18 +1552,18 @@ void START_SPEED_FEED_SYNCH(int line_number, double feed_per_revolution, bool ve
    emc_start_speed_feed_synch_msg_t sync_start = { {EMC_START_SPEED_FEED_SYNCH} };
    sync_start.feed_per_revolution = feed_per_revolution;
    sync_start.velocity_mode = velocity_mode;
-   interp_list.set_line_number(line_number);
-   interp_list.append((emc_command_msg_t *) & sync_start);
-   synched = 1;
+   canon->list->set_line_number(line_number);
+   canon->list->append((emc_command_msg_t *) & sync_start);
+   canon->synched = 1;
 }
 
 void STOP_SPEED_FEED_SYNCH(int line_number)
 {
    flush_segments();
    emc_msg_t sync_stop = { EMC_STOP_SPEED_FEED_SYNCH };
-   interp_list.set_line_number(line_number);
-   interp_list.append((emc_command_msg_t *) & sync_stop);
-   synched = 0;
+   canon->list->set_line_number(line_number);
+   canon->list->append((emc_command_msg_t *) & sync_stop);
+   canon->synched = 0;
 }
 
 /* Machining Functions */
@@ -1181,18 +1618,28 @@ static void unit(double *x, double *y)
    }
 }
 
-static void arc(int lineno, double x0, double y0, double x1, double y1, double dx, double dy)
+/* Center and signed radius of the arc from x0,y0 to x1,y1 leaving in direction dx,dy, 0 if it is straight. */
+static int arc_center(double x0, double y0, double x1, double y1, double dx, double dy, double *cx, double *cy, double *r)
 {
    double small_ = 0.000001;    /* "small" is a reserved word in windows.h */
    double x = x1 - x0, y = y1 - y0;
+   unit(&dx, &dy);
    double den = 2 * (y * dx - x * dy);
-   CANON_POSITION p = unoffset_and_unrotate_pos(canonEndPoint);
+   if (fabs(den) <= small_)
+      return 0;
+   *r = -(x * x + y * y) / den;
+   *cx = x0 + dy * *r;
+   *cy = y0 - dx * *r;
+   return 1;
+}
+
+static void arc(int lineno, double x0, double y0, double x1, double y1, double dx, double dy)
+{
+   double cx, cy, r;
+   CANON_POSITION p = unoffset_and_unrotate_pos(canon->canonEndPoint);
    to_prog(p);
-   if (fabs(den) > small_)
+   if (arc_center(x0, y0, x1, y1, dx, dy, &cx, &cy, &r))
    {
-      double r = -(x * x + y * y) / den;
-      double i = dy * r, j = -dx * r;
-      double cx = x1 + i, cy = y1 + j;
       ARC_FEED(lineno, x1, y1, cx, cy, r < 0 ? 1 : -1, p.z, p.a, p.b, p.c, p.u, p.v, p.w);
    }
    else
@@ -1201,7 +1648,40 @@ static void arc(int lineno, double x0, double y0, double x1, double y1, double d
    }
 }
 
-static int biarc(int lineno, double p0x, double p0y, double tsx, double tsy, double p4x, double p4y, double tex, double tey, double r = 1.0)
+/* Distance from qx,qy to the arc that arc() would make. */
+static double arc_distance(double qx, double qy, double x0, double y0, double x1, double y1, double dx, double dy)
+{
+   double cx, cy, r, t0, t1, tq, sweep, at;
+
+   if (!arc_center(x0, y0, x1, y1, dx, dy, &cx, &cy, &r))
+   {
+      double x = x1 - x0, y = y1 - y0, len2 = x * x + y * y, t = 0;
+      if (len2 > 0)
+         t = fmax(0.0, fmin(1.0, ((qx - x0) * x + (qy - y0) * y) / len2));
+      return hypot(qx - x0 - t * x, qy - y0 - t * y);
+   }
+
+   t0 = atan2(y0 - cy, x0 - cx);
+   t1 = atan2(y1 - cy, x1 - cx);
+   tq = atan2(qy - cy, qx - cx);
+   if (r > 0)
+   {
+      /* clockwise, measure the angles the other way */
+      t0 = -t0;
+      t1 = -t1;
+      tq = -tq;
+   }
+   sweep = fmod(t1 - t0 + 4 * M_PI, 2 * M_PI);
+   at = fmod(tq - t0 + 4 * M_PI, 2 * M_PI);
+   if (at <= sweep)
+      return fabs(hypot(qx - cx, qy - cy) - fabs(r));
+   return fmin(hypot(qx - x0, qy - y0), hypot(qx - x1, qy - y1));
+}
+
+/* Biarc from p0 to p4 with start and end tangents ts, te, returns 0 if there is none.
+   The two arcs meet at p2 with tangent tm. */
+static int biarc_fit(double p0x, double p0y, double tsx, double tsy, double p4x, double p4y, double tex, double tey,
+                     double *p2x, double *p2y, double *tmx, double *tmy, double r = 1.0)
 {
    unit(&tsx, &tsy);
    unit(&tex, &tey);
@@ -1211,53 +1691,106 @@ static int biarc(int lineno, double p0x, double p0y, double tsx, double tsy, dou
    double b = 2 * (vx * (r * tsx + tex) + vy * (r * tsy + tey));
    double a = 2 * r * (tsx * tex + tsy * tey - 1);
 
-   double discr = b * b - 4 * a * c;
-   if (discr < 0)
-      return 0;
+   double beta;
+   if (a == 0)
+   {
+      /* parallel tangents */
+      if (b == 0)
+         return 0;
+      beta = -c / b;
+   }
+   else
+   {
+      double discr = b * b - 4 * a * c;
+      if (discr < 0)
+         return 0;
 
-   double disq = sqrt(discr);
-   double beta1 = (-b - disq) / 2 / a;
-   double beta2 = (-b + disq) / 2 / a;
+      double disq = sqrt(discr);
+      double beta1 = (-b - disq) / 2 / a;
+      double beta2 = (-b + disq) / 2 / a;
 
-   if (beta1 > 0 && beta2 > 0)
-      return 0;
-   double beta = max(beta1, beta2);
+      if (beta1 > 0 && beta2 > 0)
+         return 0;
+      beta = max(beta1, beta2);
+   }
    double alpha = beta * r;
    double ab = alpha + beta;
    double p1x = p0x + alpha * tsx, p1y = p0y + alpha * tsy,
-      p3x = p4x - beta * tex, p3y = p4y - beta * tey, p2x = (p1x * beta + p3x * alpha) / ab, p2y = (p1y * beta + p3y * alpha) / ab;
-   double tmx = p3x - p2x, tmy = p3y - p2y;
-   unit(&tmx, &tmy);
-
-   arc(lineno, p0x, p0y, p2x, p2y, tsx, tsy);
-   arc(lineno, p2x, p2y, p4x, p4y, tmx, tmy);
+      p3x = p4x - beta * tex, p3y = p4y - beta * tey;
+   *p2x = (p1x * beta + p3x * alpha) / ab;
+   *p2y = (p1y * beta + p3y * alpha) / ab;
+   *tmx = p3x - *p2x;
+   *tmy = p3y - *p2y;
+   unit(tmx, tmy);
    return 1;
 }
 
+#define NURBS_TOLERANCE 0.01    /* mm, path tolerance when G64 Q is not set */
+#define NURBS_DEPTH_MAX 16      /* most times a knot span is halved */
+#define NURBS_CHECKS 8          /* curve points checked against each biarc */
 
 /* Canon calls */
 
 void NURBS_FEED(int lineno, std::vector < CONTROL_POINT > nurbs_control_points, unsigned int k)
 {
+   struct nurbs_sample
+   {
+      double u;
+      PLANE_POINT p, t;
+   } left, mid, stack[NURBS_DEPTH_MAX + 1];
+   int top = 0, fits, i;
+   double p2x, p2y, tmx, tmy, tol;
+
    flush_segments();
 
    unsigned int n = nurbs_control_points.size() - 1;
-   double umax = n - k + 2;
-   unsigned int div = nurbs_control_points.size() * 4;
+   unsigned int span, umax = n - k + 2;
    std::vector < unsigned int >knot_vector = knot_vector_creator(n, k);
-   PLANE_POINT P0, P0T, P1, P1T;
+   std::vector < CONTROL_POINT > work(k);
+
+   tol = TO_PROG_LEN((canon->canonNaivecamTolerance > 0) ? canon->canonNaivecamTolerance : NURBS_TOLERANCE);
 
-   P0 = nurbs_point(0, k, nurbs_control_points, knot_vector);
-   P0T = nurbs_tangent(0, k, nurbs_control_points, knot_vector);
+   left.u = 0;
+   left.p = nurbs_deboor(0, k, nurbs_control_points, knot_vector, work, &left.t);
 
-   for (unsigned int i = 1; i <= div; i++)
+   /* Each knot span is a polynomial piece, halve it until one biarc is close enough. */
+   for (span = 1; span <= umax; span++)
    {
-      double u = umax * i / div;
-      P1 = nurbs_point(u, k, nurbs_control_points, knot_vector);
-      P1T = nurbs_tangent(u, k, nurbs_control_points, knot_vector);
-      biarc(lineno, P0.X, P0.Y, P0T.X, P0T.Y, P1.X, P1.Y, P1T.X, P1T.Y);
-      P0 = P1;
-      P0T = P1T;
+      stack[0].u = span;
+      stack[0].p = nurbs_deboor(span, k, nurbs_control_points, knot_vector, work, &stack[0].t);
+      top = 0;
+      while (top >= 0)
+      {
+         struct nurbs_sample *right = &stack[top];
+         fits = biarc_fit(left.p.X, left.p.Y, left.t.X, left.t.Y, right->p.X, right->p.Y, right->t.X, right->t.Y, &p2x, &p2y, &tmx, &tmy);
+         for (i = 1; fits && i < NURBS_CHECKS; i++)
+         {
+            /* Check the curve at evenly spaced points in between. */
+            double u = left.u + (right->u - left.u) * i / NURBS_CHECKS;
+            PLANE_POINT q = nurbs_deboor(u, k, nurbs_control_points, knot_vector, work, NULL);
+            if (fmin(arc_distance(q.X, q.Y, left.p.X, left.p.Y, p2x, p2y, left.t.X, left.t.Y),
+                     arc_distance(q.X, q.Y, p2x, p2y, right->p.X, right->p.Y, tmx, tmy)) > tol)
+               fits = 0;
+         }
+
+         if (!fits && top < NURBS_DEPTH_MAX)
+         {
+            mid.u = (left.u + right->u) / 2;
+            mid.p = nurbs_deboor(mid.u, k, nurbs_control_points, knot_vector, work, &mid.t);
+            stack[++top] = mid;
+            continue;
+         }
+
+         if (fits)
+         {
+            arc(lineno, left.p.X, left.p.Y, p2x, p2y, left.t.X, left.t.Y);
+            arc(lineno, p2x, p2y, right->p.X, right->p.Y, tmx, tmy);
+         }
+         else
+            arc(lineno, left.p.X, left.p.Y, right->p.X, right->p.Y, right->p.X - left.p.X, right->p.Y - left.p.Y);
+         left = *right;
+         top--;
+      }
    }
    knot_vector.clear();
 }
@@ -1267,7 +1800,7 @@ void ARC_FEED(int line_number,
               double first_end, double second_end,
               double first_axis, double second_axis, int rotation, double axis_end_point, double a, double b, double c, double u, double v, double w)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    EmcPose end;
 //    PM_CARTESIAN center, normal;
    PmCartesian center, normal;
@@ -1285,18 +1818,18 @@ void ARC_FEED(int line_number,
    get_last_pos(lx, ly, lz);
 
    // XXX rotation?
-   if ((activePlane == CANON_PLANE_XY)
-       && canonMotionMode == CANON_CONTINUOUS
+   if ((canon->activePlane == CANON_PLANE_XY)
+       && canon->canonMotionMode == CANON_CONTINUOUS
        && chord_deviation(lx, ly,
                           offset_x(FROM_PROG_LEN(first_end)), offset_y(FROM_PROG_LEN(second_end)),
-                          offset_x(FROM_PROG_LEN(first_axis)), offset_y(FROM_PROG_LEN(second_axis)), rotation, mx, my) < canonNaivecamTolerance)
+                          offset_x(FROM_PROG_LEN(first_axis)), offset_y(FROM_PROG_LEN(second_axis)), rotation, mx, my) < canon->canonNaivecamTolerance)
    {
       double x = FROM_PROG_LEN(first_end), y = FROM_PROG_LEN(second_end), z = FROM_PROG_LEN(axis_end_point);
       rotate_and_offset_pos(x, y, z, a, b, c, u, v, w);
       see_segment(line_number, mx, my,
                   (lz + z) / 2,
-                  (canonEndPoint.a + a) / 2,
-                  (canonEndPoint.b + b) / 2, (canonEndPoint.c + c) / 2, (canonEndPoint.u + u) / 2, (canonEndPoint.v + v) / 2, (canonEndPoint.w + w) / 2);
+                  (canon->canonEndPoint.a + a) / 2,
+                  (canon->canonEndPoint.b + b) / 2, (canon->canonEndPoint.c + c) / 2, (canon->canonEndPoint.u + u) / 2, (canon->canonEndPoint.v + v) / 2, (canon->canonEndPoint.w + w) / 2);
       see_segment(line_number, x, y, z, a, b, c, u, v, w);
       return;
    }
@@ -1304,8 +1837,8 @@ void ARC_FEED(int line_number,
    //circ_maxvel = max vel defined by ini constraints in the circle plane (XY, YZ or XZ)
    //axial_maxvel = max vel defined by ini constraints in the axial direction (Z, X or Y)
 
-   linearMoveMsg.feed_mode = feed_mode;
-   circularMoveMsg.feed_mode = feed_mode;
+   linearMoveMsg.feed_mode = canon->feed_mode;
+   circularMoveMsg.feed_mode = canon->feed_mode;
    flush_segments();
 
    a = FROM_PROG_ANG(a);
@@ -1317,17 +1850,17 @@ void ARC_FEED(int line_number,
 
    rotate_and_offset_pos(unused, unused, unused, a, b, c, u, v, w);
 
-   da = fabs(canonEndPoint.a - a);
-   db = fabs(canonEndPoint.b - b);
-   dc = fabs(canonEndPoint.c - c);
+   da = fabs(canon->canonEndPoint.a - a);
+   db = fabs(canon->canonEndPoint.b - b);
+   dc = fabs(canon->canonEndPoint.c - c);
 
-   du = fabs(canonEndPoint.u - u);
-   dv = fabs(canonEndPoint.v - v);
-   dw = fabs(canonEndPoint.w - w);
+   du = fabs(canon->canonEndPoint.u - u);
+   dv = fabs(canon->canonEndPoint.v - v);
+   dw = fabs(canon->canonEndPoint.w - w);
 
    /* Since there's no default case here,
       we need to initialise vel to something safe! */
-   vel = ini_maxvel = currentLinearFeedRate;
+   vel = ini_maxvel = canon->currentLinearFeedRate;
 
    // convert to absolute mm units
    first_axis = FROM_PROG_LEN(first_axis);
@@ -1337,7 +1870,7 @@ void ARC_FEED(int line_number,
    axis_end_point = FROM_PROG_LEN(axis_end_point);
 
    /* associate x with x, etc., offset by program origin, and set normals */
-   switch (activePlane)
+   switch (canon->activePlane)
    {
    default:    // to eliminate "uninitalized" warnings
    case CANON_PLANE_XY:
@@ -1355,10 +1888,10 @@ void ARC_FEED(int line_number,
       normal.y = 0.0;
       normal.z = 1.0;
 
-      theta1 = atan2(canonEndPoint.y - center.y, canonEndPoint.x - center.x);
+      theta1 = atan2(canon->canonEndPoint.y - center.y, canon->canonEndPoint.x - center.x);
       theta2 = atan2(end.tran.y - center.y, end.tran.x - center.x);
-      radius = hypot(canonEndPoint.x - center.x, canonEndPoint.y - center.y);
-      axis_len = fabs(end.tran.z - canonEndPoint.z);
+      radius = hypot(canon->canonEndPoint.x - center.x, canon->canonEndPoint.y - center.y);
+      axis_len = fabs(end.tran.z - canon->canonEndPoint.z);
 
       v1 = FROM_EXT_LEN(ps->axis[0].max_velocity);
       v2 = FROM_EXT_LEN(ps->axis[1].max_velocity);
@@ -1389,12 +1922,12 @@ void ARC_FEED(int line_number,
       normal.y = 0.0;
       normal.z = 0.0;
       normal.x = 1.0;
-      rotate(normal.x, normal.y, xy_rotation);
+      rotate(normal.x, normal.y, canon->xy_rotation);
 
-      theta1 = atan2(canonEndPoint.z - center.z, canonEndPoint.y - center.y);
+      theta1 = atan2(canon->canonEndPoint.z - center.z, canon->canonEndPoint.y - center.y);
       theta2 = atan2(end.tran.z - center.z, end.tran.y - center.y);
-      radius = hypot(canonEndPoint.y - center.y, canonEndPoint.z - center.z);
-      axis_len = fabs(end.tran.x - canonEndPoint.x);
+      radius = hypot(canon->canonEndPoint.y - center.y, canon->canonEndPoint.z - center.z);
+      axis_len = fabs(end.tran.x - canon->canonEndPoint.x);
 
       v1 = FROM_EXT_LEN(ps->axis[1].max_velocity);
       v2 = FROM_EXT_LEN(ps->axis[2].max_velocity);
@@ -1426,12 +1959,12 @@ void ARC_FEED(int line_number,
       normal.z = 0.0;
       normal.x = 0.0;
       normal.y = 1.0;
-      rotate(normal.x, normal.y, xy_rotation);
+      rotate(normal.x, normal.y, canon->xy_rotation);
 
-      theta1 = atan2(canonEndPoint.x - center.x, canonEndPoint.z - center.z);
+      theta1 = atan2(canon->canonEndPoint.x - center.x, canon->canonEndPoint.z - center.z);
       theta2 = atan2(end.tran.x - center.x, end.tran.z - center.z);
-      radius = hypot(canonEndPoint.x - center.x, canonEndPoint.z - center.z);
-      axis_len = fabs(end.tran.y - canonEndPoint.y);
+      radius = hypot(canon->canonEndPoint.x - center.x, canon->canonEndPoint.z - center.z);
+      axis_len = fabs(end.tran.y - canon->canonEndPoint.y);
 
       v1 = FROM_EXT_LEN(ps->axis[0].max_velocity);
       v2 = FROM_EXT_LEN(ps->axis[2].max_velocity);
@@ -1490,7 +2023,7 @@ void ARC_FEED(int line_number,
 
    if (tmax <= 0.0)
    {
-      vel = currentLinearFeedRate;
+      vel = canon->currentLinearFeedRate;
    }
    else
    {
@@ -1501,7 +2034,7 @@ void ARC_FEED(int line_number,
    // for arcs we always user linear move since there is no
    // arc possible with only ABC motion
 
-   cartesian_move = 1;
+   canon->cartesian_move = 1;
 
 // COMPUTE ACCELS
 
@@ -1562,8 +2095,8 @@ void ARC_FEED(int line_number,
       linearMoveMsg.acc = toExtAcc(acc);
       if (vel && acc)
       {
-         interp_list.set_line_number(line_number);
-         interp_list.append((emc_command_msg_t *) & linearMoveMsg);
+         canon->list->set_line_number(line_number);
+         canon->list->append((emc_command_msg_t *) & linearMoveMsg);
       }
    }
    else
@@ -1606,8 +2139,8 @@ void ARC_FEED(int line_number,
       circularMoveMsg.acc = toExtAcc(acc);
       if (vel && acc)
       {
-         interp_list.set_line_number(line_number);
-         interp_list.append((emc_command_msg_t *) & circularMoveMsg);
+         canon->list->set_line_number(line_number);
+         canon->list->append((emc_command_msg_t *) & circularMoveMsg);
       }
    }
    // update the end point
@@ -1623,7 +2156,7 @@ void DWELL(double seconds)
 
    delayMsg.delay = seconds;
 
-   interp_list.append((emc_command_msg_t *) & delayMsg);
+   canon->list->append((emc_command_msg_t *) & delayMsg);
 }
 
 /* Spindle Functions */
@@ -1634,7 +2167,7 @@ void SPINDLE_RETRACT_TRAVERSE()
 
 void SET_SPINDLE_MODE(double css_max)
 {
-   css_maximum = css_max;
+   canon->css_maximum = css_max;
 }
 
 void START_SPINDLE_CLOCKWISE()
@@ -1643,9 +2176,9 @@ void START_SPINDLE_CLOCKWISE()
 
    flush_segments();
    emc_system_cmd_msg.index = 3;    /* M3 */
-   emc_system_cmd_msg.p_number = spindleSpeed;
+   emc_system_cmd_msg.p_number = canon->spindleSpeed;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void START_SPINDLE_COUNTERCLOCKWISE()
@@ -1654,15 +2187,15 @@ void START_SPINDLE_COUNTERCLOCKWISE()
 
    flush_segments();
    emc_system_cmd_msg.index = 4;  /* M4 */
-   emc_system_cmd_msg.p_number = spindleSpeed;
+   emc_system_cmd_msg.p_number = canon->spindleSpeed;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void SET_SPINDLE_SPEED(double r)
 {
    // speed is in RPMs everywhere
-   spindleSpeed = r;
+   canon->spindleSpeed = r;
 }
 
 void STOP_SPINDLE_TURNING()
@@ -1673,7 +2206,7 @@ void STOP_SPINDLE_TURNING()
    emc_system_cmd_msg.index = 5;          /* M5 */
    emc_system_cmd_msg.p_number = 0;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void SPINDLE_RETRACT()
@@ -1713,7 +2246,7 @@ void USE_NO_SPINDLE_FORCE(void)
 /* This is called with distances in external (machine) units (G10) */
 void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diameter, double frontangle, double backangle, int orientation)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
 
    flush_segments();
    ps->toolTable[toolno].toolno = toolno;
@@ -1733,15 +2266,15 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset)
    flush_segments();
 
    /* convert to mm units for internal canonical use */
-   currentToolOffset.tran.x = FROM_PROG_LEN(offset.tran.x);
-   currentToolOffset.tran.y = FROM_PROG_LEN(offset.tran.y);
-   currentToolOffset.tran.z = FROM_PROG_LEN(offset.tran.z);
-   currentToolOffset.a = FROM_PROG_ANG(offset.a);
-   currentToolOffset.b = FROM_PROG_ANG(offset.b);
-   currentToolOffset.c = FROM_PROG_ANG(offset.c);
-   currentToolOffset.u = FROM_PROG_LEN(offset.u);
-   currentToolOffset.v = FROM_PROG_LEN(offset.v);
-   currentToolOffset.w = FROM_PROG_LEN(offset.w);
+   canon->currentToolOffset.tran.x = FROM_PROG_LEN(offset.tran.x);
+   canon->currentToolOffset.tran.y = FROM_PROG_LEN(offset.tran.y);
+   canon->currentToolOffset.tran.z = FROM_PROG_LEN(offset.tran.z);
+   canon->currentToolOffset.a = FROM_PROG_ANG(offset.a);
+   canon->currentToolOffset.b = FROM_PROG_ANG(offset.b);
+   canon->currentToolOffset.c = FROM_PROG_ANG(offset.c);
+   canon->currentToolOffset.u = FROM_PROG_LEN(offset.u);
+   canon->currentToolOffset.v = FROM_PROG_LEN(offset.v);
+   canon->currentToolOffset.w = FROM_PROG_LEN(offset.w);
 }
 
 /* CHANGE_TOOL results from M6, for example */
@@ -1753,7 +2286,7 @@ void CHANGE_TOOL(int slot)
    emc_system_cmd_msg.index = 6;        /* M6 */
    emc_system_cmd_msg.p_number = slot;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 /* SELECT_POCKET results from T1, for example */
@@ -1833,7 +2366,7 @@ void FLOOD_OFF()
    emc_system_cmd_msg.index = 9;            /* M9 */
    emc_system_cmd_msg.p_number = 0;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void FLOOD_ON()
@@ -1844,7 +2377,7 @@ void FLOOD_ON()
    emc_system_cmd_msg.index = 8;           /* M8 */
    emc_system_cmd_msg.p_number = 0;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void MESSAGE(char *s)
@@ -1871,7 +2404,7 @@ void MIST_OFF()
    emc_system_cmd_msg.index = 9;          /* M9 */
    emc_system_cmd_msg.p_number = 0;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void MIST_ON()
@@ -1882,7 +2415,7 @@ void MIST_ON()
    emc_system_cmd_msg.index = 7;          /* M7 */
    emc_system_cmd_msg.p_number = 0;
    emc_system_cmd_msg.q_number = 0;
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void PALLET_SHUTTLE()
@@ -1913,28 +2446,28 @@ void PROGRAM_STOP()
 
    flush_segments();
 
-   interp_list.append((emc_command_msg_t *) & pauseMsg);
+   canon->list->append((emc_command_msg_t *) & pauseMsg);
 }
 
 void SET_BLOCK_DELETE(bool state)
 {
-   block_delete = state;        //state == ON, means we don't interpret lines starting with "/"
+   canon->block_delete = state;        //state == ON, means we don't interpret lines starting with "/"
 }
 
 bool GET_BLOCK_DELETE()
 {
-   return block_delete; //state == ON, means we  don't interpret lines starting with "/"
+   return canon->block_delete; //state == ON, means we  don't interpret lines starting with "/"
 }
 
 
 void SET_OPTIONAL_PROGRAM_STOP(bool state)
 {
-   optional_program_stop = state;       //state == ON, means we stop
+   canon->optional_program_stop = state;       //state == ON, means we stop
 }
 
 bool GET_OPTIONAL_PROGRAM_STOP()
 {
-   return optional_program_stop;        //state == ON, means we stop
+   return canon->optional_program_stop;        //state == ON, means we stop
 }
 
 void OPTIONAL_PROGRAM_STOP()
@@ -1948,52 +2481,52 @@ void PROGRAM_END()
 
    emc_msg_t endMsg = { EMC_TASK_PLAN_END_TYPE };   /* M2 and M30 */
 
-   interp_list.append((emc_command_msg_t *) & endMsg);
+   canon->list->append((emc_command_msg_t *) & endMsg);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_XOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.tran.x);
+   return TO_PROG_LEN(canon->currentToolOffset.tran.x);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_YOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.tran.y);
+   return TO_PROG_LEN(canon->currentToolOffset.tran.y);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_ZOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.tran.z);
+   return TO_PROG_LEN(canon->currentToolOffset.tran.z);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_AOFFSET()
 {
-   return TO_PROG_ANG(currentToolOffset.a);
+   return TO_PROG_ANG(canon->currentToolOffset.a);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_BOFFSET()
 {
-   return TO_PROG_ANG(currentToolOffset.b);
+   return TO_PROG_ANG(canon->currentToolOffset.b);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_COFFSET()
 {
-   return TO_PROG_ANG(currentToolOffset.c);
+   return TO_PROG_ANG(canon->currentToolOffset.c);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_UOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.u);
+   return TO_PROG_LEN(canon->currentToolOffset.u);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_VOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.v);
+   return TO_PROG_LEN(canon->currentToolOffset.v);
 }
 
 double GET_EXTERNAL_TOOL_LENGTH_WOFFSET()
 {
-   return TO_PROG_LEN(currentToolOffset.w);
+   return TO_PROG_LEN(canon->currentToolOffset.w);
 }
 
 /*
@@ -2004,28 +2537,29 @@ void INIT_CANON()
 {
    double units;
 
-   chained_points().clear();
+   canon->chained_points.clear();
+   canon->arc_run.clear();
 
    // initialize locals to original values
-   programOrigin.x = 0.0;
-   programOrigin.y = 0.0;
-   programOrigin.z = 0.0;
-   programOrigin.a = 0.0;
-   programOrigin.b = 0.0;
-   programOrigin.c = 0.0;
-   programOrigin.u = 0.0;
-   programOrigin.v = 0.0;
-   programOrigin.w = 0.0;
-   xy_rotation = 0.;
-   activePlane = CANON_PLANE_XY;
+   canon->programOrigin.x = 0.0;
+   canon->programOrigin.y = 0.0;
+   canon->programOrigin.z = 0.0;
+   canon->programOrigin.a = 0.0;
+   canon->programOrigin.b = 0.0;
+   canon->programOrigin.c = 0.0;
+   canon->programOrigin.u = 0.0;
+   canon->programOrigin.v = 0.0;
+   canon->programOrigin.w = 0.0;
+   canon->xy_rotation = 0.;
+   canon->activePlane = CANON_PLANE_XY;
    canonUpdateEndPoint(0, 0, 0, 0, 0, 0, 0, 0, 0);
-   spindleSpeed = 0.0;
-   preppedTool = 0;
-   cartesian_move = 0;
-   angular_move = 0;
-   currentLinearFeedRate = 0.0;
-   currentAngularFeedRate = 0.0;
-   ZERO_EMC_POSE(currentToolOffset);
+   canon->spindleSpeed = 0.0;
+   canon->preppedTool = 0;
+   canon->cartesian_move = 0;
+   canon->angular_move = 0;
+   canon->currentLinearFeedRate = 0.0;
+   canon->currentAngularFeedRate = 0.0;
+   ZERO_EMC_POSE(canon->currentToolOffset);
    /* 
       to set the units, note that GET_EXTERNAL_LENGTH_UNITS() returns
       traj->linearUnits, which is already set from the .ini file in
@@ -2035,19 +2569,105 @@ void INIT_CANON()
    units = GET_EXTERNAL_LENGTH_UNITS();
    if (fabs(units - 1.0 / 25.4) < 1.0e-3)
    {
-      lengthUnits = CANON_UNITS_INCHES;
+      canon->lengthUnits = CANON_UNITS_INCHES;
    }
    else if (fabs(units - 1.0) < 1.0e-3)
    {
-      lengthUnits = CANON_UNITS_MM;
+      canon->lengthUnits = CANON_UNITS_MM;
    }
    else
    {
       BUG("non-standard length units, setting interpreter to mm");
-      lengthUnits = CANON_UNITS_MM;
+      canon->lengthUnits = CANON_UNITS_MM;
    }
 }
 
+CANON_CONTEXT *CANON_CONTEXT_NEW(struct emc_session *session)
+{
+   return new CANON_CONTEXT(new MSG_INTERP_LIST, session);
+}
+
+void CANON_CONTEXT_FREE(CANON_CONTEXT * context)
+{
+   if (context == NULL || context == &canon_default)
+      return;
+   if (canon == context)
+      canon = &canon_default;
+   delete context->list;
+   delete context;
+}
+
+CANON_CONTEXT *SET_CANON_CONTEXT(CANON_CONTEXT * context)
+{
+   CANON_CONTEXT *old = canon;
+
+   canon = (context != NULL) ? context : &canon_default;
+   return old;
+}
+
+MSG_INTERP_LIST *GET_CANON_INTERP_LIST()
+{
+   return canon->list;
+}
+
+/*
+  SAVE_CANON_STATE(), RESTORE_CANON_STATE()
+  Copy the canonical local variables for an interpreter snapshot. The end
+  point is taken after any queued segments, as if they had been flushed.
+  */
+void SAVE_CANON_STATE(CANON_STATE * state)
+{
+   state->program_origin = canon->programOrigin;
+   if (canon->chained_points.empty())
+      state->end_point = canon->canonEndPoint;
+   else
+   {
+      struct pt &pos = canon->chained_points.back();
+      state->end_point = CANON_POSITION(pos.x, pos.y, pos.z, pos.a, pos.b, pos.c, pos.u, pos.v, pos.w);
+   }
+   state->length_units = canon->lengthUnits;
+   state->plane = canon->activePlane;
+   state->tool_offset = canon->currentToolOffset;
+   state->xy_rotation = canon->xy_rotation;
+   state->css_maximum = canon->css_maximum;
+   state->spindle_speed = canon->spindleSpeed;
+   state->linear_feed_rate = canon->currentLinearFeedRate;
+   state->angular_feed_rate = canon->currentAngularFeedRate;
+   state->motion_mode = canon->canonMotionMode;
+   state->motion_tolerance = canon->canonMotionTolerance;
+   state->naivecam_tolerance = canon->canonNaivecamTolerance;
+   state->feed_mode = canon->feed_mode;
+   state->synched = canon->synched;
+   state->prepped_tool = canon->preppedTool;
+   state->optional_program_stop = canon->optional_program_stop;
+   state->block_delete = canon->block_delete;
+}
+
+void RESTORE_CANON_STATE(const CANON_STATE * state)
+{
+   canon->chained_points.clear();
+   canon->arc_run.clear();
+
+   canon->programOrigin = state->program_origin;
+   canon->canonEndPoint = state->end_point;
+   canon->lengthUnits = state->length_units;
+   canon->activePlane = state->plane;
+   canon->currentToolOffset = state->tool_offset;
+   canon->xy_rotation = state->xy_rotation;
+   canon->css_maximum = state->css_maximum;
+   canon->spindleSpeed = state->spindle_speed;
+   canon->currentLinearFeedRate = state->linear_feed_rate;
+   canon->currentAngularFeedRate = state->angular_feed_rate;
+   canon->canonMotionMode = state->motion_mode;
+   canon->canonMotionTolerance = state->motion_tolerance;
+   canon->canonNaivecamTolerance = state->naivecam_tolerance;
+   canon->feed_mode = state->feed_mode;
+   canon->synched = state->synched;
+   canon->preppedTool = state->prepped_tool;
+   canon->optional_program_stop = state->optional_program_stop;
+   canon->block_delete = state->block_delete;
+}
+
 /*
   GET_EXTERNAL_TOOL_TABLE(int pocket)
 
@@ -2059,7 +2679,7 @@ void INIT_CANON()
   */
 CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    CANON_TOOL_TABLE retval;
 
    if (pocket < 0 || pocket >= CANON_POCKETS_MAX)
@@ -2081,11 +2701,12 @@ CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket)
 
 CANON_POSITION GET_EXTERNAL_POSITION()
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    CANON_POSITION position;
    EmcPose pos;
 
-   chained_points().clear();
+   /* Send the queued naivecam segments and arc chords, they are program moves. */
+   flush_segments();
 
    pos = ps->position;
 
@@ -2094,7 +2715,7 @@ CANON_POSITION GET_EXTERNAL_POSITION()
                        FROM_EXT_ANG(pos.a), FROM_EXT_ANG(pos.b), FROM_EXT_ANG(pos.c), FROM_EXT_LEN(pos.u), FROM_EXT_LEN(pos.v), FROM_EXT_LEN(pos.w));
 
    // now calculate position in program units, for interpreter
-   position = unoffset_and_unrotate_pos(canonEndPoint);
+   position = unoffset_and_unrotate_pos(canon->canonEndPoint);
    to_prog(position);
 
    return position;
@@ -2107,7 +2728,7 @@ double GET_EXTERNAL_FEED_RATE()
 
    // convert from internal to program units
    // it is wrong to use emcStatus->motion.traj.velocity here, as that is the traj speed regardless of G0 / G1
-   feed = TO_PROG_LEN(currentLinearFeedRate);
+   feed = TO_PROG_LEN(canon->currentLinearFeedRate);
    // now convert from per-sec to per-minute
    feed *= 60.0;
 
@@ -2117,7 +2738,7 @@ double GET_EXTERNAL_FEED_RATE()
 // traverse rate wanted is in program units per minute
 double GET_EXTERNAL_TRAVERSE_RATE()
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    double traverse;
 
    // convert from external to program units
@@ -2131,7 +2752,7 @@ double GET_EXTERNAL_TRAVERSE_RATE()
 
 double GET_EXTERNAL_LENGTH_UNITS(void)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    double u;
 
    u = ps->linearUnits;
@@ -2149,7 +2770,7 @@ double GET_EXTERNAL_LENGTH_UNITS(void)
 
 double GET_EXTERNAL_ANGLE_UNITS(void)
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    double u;
 
    u = ps->angularUnits;
@@ -2301,17 +2922,17 @@ int GET_EXTERNAL_PROBE_TRIPPED_VALUE()
 
 CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE()
 {
-   return canonMotionMode;
+   return canon->canonMotionMode;
 }
 
 double GET_EXTERNAL_MOTION_CONTROL_TOLERANCE()
 {
-   return TO_PROG_LEN(canonMotionTolerance);
+   return TO_PROG_LEN(canon->canonMotionTolerance);
 }
 
 CANON_UNITS GET_EXTERNAL_LENGTH_UNIT_TYPE()
 {
-   return lengthUnits;
+   return canon->lengthUnits;
 }
 
 int GET_EXTERNAL_QUEUE_EMPTY(void)
@@ -2333,13 +2954,13 @@ int GET_EXTERNAL_SELECTED_TOOL_SLOT()
 
 int GET_EXTERNAL_AXIS_MASK()
 {
-   struct emc_session *ps = &session;
+   struct emc_session *ps = canon_session();
    return ps->axes_mask;
 }
 
 CANON_PLANE GET_EXTERNAL_PLANE()
 {
-   return activePlane;
+   return canon->activePlane;
 }
 
 int GET_EXTERNAL_DIGITAL_INPUT(int index, int def)
@@ -2387,7 +3008,7 @@ void EXEC_USER_DEFINED_FUNCTION(int index, double p_number, double q_number)
    emc_system_cmd_msg.p_number = p_number;
    emc_system_cmd_msg.q_number = q_number;
 
-   interp_list.append((emc_command_msg_t *)&emc_system_cmd_msg);
+   canon->list->append((emc_command_msg_t *)&emc_system_cmd_msg);
 }
 
 void SET_MOTION_OUTPUT_BIT(int index)
@@ -34,4 +34,48 @@ pos.u = 0.0;                    \
 pos.v = 0.0;                    \
 pos.w = 0.0; } while(0)
 
+/* All nine axes at once, laid out flat so the compiler can vectorize them. */
+
+/* pout = p1 + p2 */
+static inline void emcPoseAddI(const EmcPose *p1, const EmcPose *p2, EmcPose *pout)
+{
+   pout->tran.x = p1->tran.x + p2->tran.x;
+   pout->tran.y = p1->tran.y + p2->tran.y;
+   pout->tran.z = p1->tran.z + p2->tran.z;
+   pout->a = p1->a + p2->a;
+   pout->b = p1->b + p2->b;
+   pout->c = p1->c + p2->c;
+   pout->u = p1->u + p2->u;
+   pout->v = p1->v + p2->v;
+   pout->w = p1->w + p2->w;
+}
+
+/* pout = p1 - p2 */
+static inline void emcPoseSubI(const EmcPose *p1, const EmcPose *p2, EmcPose *pout)
+{
+   pout->tran.x = p1->tran.x - p2->tran.x;
+   pout->tran.y = p1->tran.y - p2->tran.y;
+   pout->tran.z = p1->tran.z - p2->tran.z;
+   pout->a = p1->a - p2->a;
+   pout->b = p1->b - p2->b;
+   pout->c = p1->c - p2->c;
+   pout->u = p1->u - p2->u;
+   pout->v = p1->v - p2->v;
+   pout->w = p1->w - p2->w;
+}
+
+/* a[] indexed by coordinate, x y z a b c u v w */
+static inline void emcPoseToArray(const EmcPose *pos, double *a)
+{
+   a[0] = pos->tran.x;
+   a[1] = pos->tran.y;
+   a[2] = pos->tran.z;
+   a[3] = pos->a;
+   a[4] = pos->b;
+   a[5] = pos->c;
+   a[6] = pos->u;
+   a[7] = pos->v;
+   a[8] = pos->w;
+}
+
 #endif
@@ -22,10 +22,44 @@
 #include <math.h>       // M_PI
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include "emc.h"
 #include "ini.h"        // these decls
 #include "bug.h"
 
+/*
+ * Parsed files are kept in a small store so ini_get() does a stat() and a hash lookup instead of
+ * reading the whole file for every key. A file is parsed again when its mtime, size or inode changes.
+ */
+#define INI_STORE_FILES 4               /* ini file, tool table and a spare or two */
+#define INI_HASH_SIZE 256               /* buckets, power of 2 */
+
+struct ini_entry
+{
+   unsigned int hash;                   /* of section and key, case folded */
+   int next;                            /* next entry in the same bucket, -1 ends the chain */
+   const char *section;
+   const char *key;
+   const char *value;
+};
+
+struct ini_store
+{
+   char file[LINELEN];
+   time_t mtime;
+   off_t size;
+   ino_t ino;
+   char *text;                          /* section, key and value strings */
+   struct ini_entry *entry;
+   int entry_cnt;
+   int bucket[INI_HASH_SIZE];
+   unsigned long used;                  /* last use, for replacing the oldest file */
+};
+
+static struct ini_store _store[INI_STORE_FILES];
+static unsigned long _store_clock;
+static pthread_mutex_t _store_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static char *_trim_tail(char *buf)
 {
    int len;
@@ -35,60 +69,210 @@ static char *_trim_tail(char *buf)
    return buf;
 }
 
-/* Get string value from specified section, key and file. */
-char *ini_get(const char *file, const char *section, const char *key, char *value, int value_size, const char *value_default, int verbose)
+/* FNV-1a of section and key, case insensitive like the lookups. */
+static unsigned int _hash(const char *section, const char *key)
 {
-   char rcbuf[255];
-   char new_section[64];
-   FILE *inFile;
-   char *p = (char *)value_default;
-   int i, j, len;
+   unsigned int h = 2166136261u;
+
+   for (; *section; section++)
+      h = (h ^ (unsigned char)tolower((unsigned char)*section)) * 16777619u;
+   h = (h ^ '[') * 16777619u;
+   for (; *key; key++)
+      h = (h ^ (unsigned char)tolower((unsigned char)*key)) * 16777619u;
+   return h;
+}
 
-   value[0] = j = 0;
+static struct ini_entry *_find(struct ini_store *st, const char *section, const char *key)
+{
+   unsigned int h = _hash(section, key);
+   int i;
 
-   if((inFile = fopen(file, "r")) == NULL) 
+   for (i = st->bucket[h & (INI_HASH_SIZE - 1)]; i >= 0; i = st->entry[i].next)
    {
-      BUG("unable to open %s\n", file);
-      goto bugout;
-   } 
+      if (st->entry[i].hash == h && strcasecmp(st->entry[i].section, section) == 0 && strcasecmp(st->entry[i].key, key) == 0)
+         return &st->entry[i];
+   }
+   return NULL;
+}
 
-   len = strlen(key);
-   new_section[0] = 0;
+static void _store_free(struct ini_store *st)
+{
+   free(st->text);
+   free(st->entry);
+   st->text = NULL;
+   st->entry = NULL;
+   st->entry_cnt = 0;
+   st->file[0] = 0;
+}
+
+/* Copy n bytes of s into the text arena, NULL if it is full. */
+static char *_text_add(char **pos, const char *end, const char *s, int n)
+{
+   char *p = *pos;
+
+   if (p + n + 1 > end)
+      return NULL;
+   memcpy(p, s, n);
+   p[n] = 0;
+   *pos = p + n + 1;
+   return p;
+}
+
+/* Parse the file with the same line rules ini_get() always had. First key in a section wins. */
+static enum EMC_RESULT _store_load(struct ini_store *st, FILE *inFile, const struct stat *sb)
+{
+   char rcbuf[255];
+   char *pos, *end, *section = NULL, *key, *value;
+   struct ini_entry *e;
+   int i, j, k, max, cnt = 0;
+   enum EMC_RESULT stat = EMC_R_ERROR;
+
+   /* Every string comes from a line of the file, so twice the file size holds them all. */
+   st->text = (char *)malloc(2 * sb->st_size + sizeof(rcbuf) + 1);
+   max = sb->st_size / 4 + 16;
+   st->entry = (struct ini_entry *)malloc(max * sizeof(struct ini_entry));
+   if (st->text == NULL || st->entry == NULL)
+   {
+      BUG("unable to allocate ini store\n");
+      goto bugout;
+   }
+   pos = st->text;
+   end = st->text + 2 * sb->st_size + sizeof(rcbuf) + 1;
+   section = _text_add(&pos, end, "", 0);
+   for (i = 0; i < INI_HASH_SIZE; i++)
+      st->bucket[i] = -1;
 
-   /* Read the config file */
    while ((fgets(rcbuf, sizeof(rcbuf), inFile) != NULL))
    {
       if (rcbuf[0] == '[')
       {
          /* Found new section. Remove [] brackets */
-         strncpy(new_section, _trim_tail(rcbuf+1), sizeof(new_section));
-         new_section[sizeof(new_section) -1] = 0;
+         _trim_tail(rcbuf+1);
+         if ((section = _text_add(&pos, end, rcbuf+1, strnlen(rcbuf+1, 63))) == NULL)
+            break;
+         continue;
       }
-      else if ((strcasecmp(new_section, section) == 0) && (strncasecmp(rcbuf, key, len) == 0))
-      {
-         for (i=len; rcbuf[i] == ' ' && rcbuf[i]; i++);  /* eat white space before = */
 
-         if (rcbuf[i] != '=')
-            continue;  /* keep looking... */
+      for (i=0; rcbuf[i] != ' ' && rcbuf[i] != '=' && rcbuf[i]; i++);  /* key */
+      if (i == 0)
+         continue;
+      for (j=i; rcbuf[j] == ' ' && rcbuf[j]; j++);  /* eat white space before = */
 
-         for (i++; rcbuf[i] == ' ' && rcbuf[i]; i++);  /* eat white space after = */
-  
-         for (j=0; rcbuf[i] >= ' ' && j < value_size; i++, j++) /* copy value(s) */
-            value[j] = rcbuf[i];
+      if (rcbuf[j] != '=')
+         continue;
 
-         if (j < value_size)
-            value[j] = 0;      /* zero terminate */
-         else
-            value[value_size -1] = 0;  /* force zero termination */
+      for (j++; rcbuf[j] == ' ' && rcbuf[j]; j++);  /* eat white space after = */
+      for (k=j; rcbuf[k] >= ' '; k++);  /* value(s) */
 
-         p = value;
-         break;  /* done */
+      if ((key = _text_add(&pos, end, rcbuf, i)) == NULL || (value = _text_add(&pos, end, rcbuf+j, k-j)) == NULL)
+         break;
+      if (_find(st, section, key) != NULL)
+         continue;  /* keep the first one */
+
+      if (cnt == max)
+      {
+         max *= 2;
+         if ((e = (struct ini_entry *)realloc(st->entry, max * sizeof(struct ini_entry))) == NULL)
+         {
+            BUG("unable to allocate ini store\n");
+            goto bugout;
+         }
+         st->entry = e;
       }
+      e = &st->entry[cnt];
+      e->hash = _hash(section, key);
+      e->section = section;
+      e->key = key;
+      e->value = value;
+      e->next = st->bucket[e->hash & (INI_HASH_SIZE - 1)];
+      st->bucket[e->hash & (INI_HASH_SIZE - 1)] = cnt;
+      st->entry_cnt = ++cnt;
    }
-        
-bugout:        
+
+   st->mtime = sb->st_mtime;
+   st->size = sb->st_size;
+   st->ino = sb->st_ino;
+   stat = EMC_R_OK;
+
+bugout:
+   if (stat != EMC_R_OK)
+      _store_free(st);
+   return stat;
+}
+
+/* Get the parsed store for file, parsing it if it is new or changed. Call with _store_mutex held. */
+static struct ini_store *_store_get(const char *file)
+{
+   struct ini_store *st = NULL, *oldest = &_store[0];
+   struct stat sb;
+   FILE *inFile = NULL;
+   int i;
+
+   for (i = 0; i < INI_STORE_FILES; i++)
+   {
+      if (strcmp(_store[i].file, file) == 0)
+         st = &_store[i];
+      if (_store[i].used < oldest->used)
+         oldest = &_store[i];
+   }
+
+   if (stat(file, &sb) != 0)
+   {
+      BUG("unable to open %s\n", file);
+      if (st != NULL)
+         _store_free(st);
+      st = NULL;
+      goto bugout;
+   }
+
+   if (st != NULL && st->mtime == sb.st_mtime && st->size == sb.st_size && st->ino == sb.st_ino)
+      goto bugout;  /* unchanged */
+
+   if((inFile = fopen(file, "r")) == NULL || fstat(fileno(inFile), &sb) != 0) 
+   {
+      BUG("unable to open %s\n", file);
+      if (st != NULL)
+         _store_free(st);
+      st = NULL;
+      goto bugout;
+   } 
+
+   if (st == NULL)
+      st = oldest;
+   _store_free(st);
+   if (_store_load(st, inFile, &sb) != EMC_R_OK)
+   {
+      st = NULL;
+      goto bugout;
+   }
+   strncpy(st->file, file, sizeof(st->file));
+   st->file[sizeof(st->file) -1] = 0;
+
+bugout:
    if (inFile != NULL)
       fclose(inFile);
+   if (st != NULL)
+      st->used = ++_store_clock;
+   return st;
+}
+
+/* Get string value from specified section, key and file. */
+char *ini_get(const char *file, const char *section, const char *key, char *value, int value_size, const char *value_default, int verbose)
+{
+   struct ini_store *st;
+   struct ini_entry *e = NULL;
+   char *p = (char *)value_default;
+
+   value[0] = 0;
+
+   pthread_mutex_lock(&_store_mutex);
+   if ((st = _store_get(file)) != NULL && (e = _find(st, section, key)) != NULL)
+   {
+      strncpy(value, e->value, value_size);
+      value[value_size -1] = 0;  /* force zero termination */
+      p = value;
+   }
+   pthread_mutex_unlock(&_store_mutex);
 
    if (p == value_default && verbose)
       BUG("unable to find %s %s in %s\n", section, key, file);
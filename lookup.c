@@ -56,6 +56,8 @@ const char *lookup_message(int type)
       return "EMC_START_SPEED_FEED_SYNCH";
    case EMC_STOP_SPEED_FEED_SYNCH:
       return "EMC_STOP_SPEED_FEED_SYNCH";
+   case EMC_TRAJ_DRILL_CYCLE_TYPE:
+      return "EMC_TRAJ_DRILL_CYCLE_TYPE";
    default:
       return "UNKNOWN";
       break;
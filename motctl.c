@@ -17,64 +17,13 @@
 #include "emc.h"
 #include "bug.h"
 
-static void _compute_axis(struct emc_session *ps, struct emc_axis *axis)
-{
-   double a_max, v_max, v, s_to_go, ds_stop, ds_vel, ds_acc, dv_acc;
-
-   /* determine which way the compensation should be applied */
-   if (axis->vel_cmd > 0.0)
-   {
-      /* moving "up". apply positive backlash comp */
-      axis->backlash_corr = 0.5 * axis->backlash;
-   }
-   else if (axis->vel_cmd < 0.0)
-   {
-      /* moving "down". apply negative backlash comp */
-      axis->backlash_corr = -0.5 * axis->backlash;
-   }
-   else
-   {
-      /* not moving, use whatever was there before */
-   }
-
-   /* at this point, the correction has been computed, but
-      the value may make abrupt jumps on direction reversal */
-   /*
-    * 07/09/2005 - S-curve implementation by Bas Laarhoven
-    *
-    * Implementation:
-    *   Generate a ramped velocity profile for backlash or screw error comp.
-    *   The velocity is ramped up to the maximum speed setting (if possible),
-    *   using the maximum acceleration setting.
-    *   At the end, the speed is ramped dowm using the same acceleration.
-    *   The algorithm keeps looking ahead. Depending on the distance to go,
-    *   the speed is increased, kept constant or decreased.
-    *   
-    * Limitations:
-    *   Since the compensation adds up to the normal movement, total
-    *   accelleration and total velocity may exceed maximum settings!
-    *   Currently this is limited to 150% by implementation.
-    *   To fix this, the calculations in get_pos_cmd should include
-    *   information from the backlash corection. This makes things
-    *   rather complicated and it might be better to implement the
-    *   backlash compensation at another place to prevent this kind
-    *   of interaction.
-    *   More testing under different circumstances will show if this
-    *   needs a more complicate solution.
-    *   For now this implementation seems to generate smoother
-    *   movements and less following errors than the original code.
-    */
+#define SCREW_COMP_EPSILON 1e-9    /* segment travel below which an axis is not moving */
 
-   /* Limit maximum accelleration and velocity 'overshoot'
-    * to 150% of the maximum settings.
-    * The TP and backlash shouldn't use more than 100%
-    * (together) but this requires some interaction that
-    * isn't implemented yet.
-    */
+/* Ramp backlash_filt one cycle toward backlash_corr within v_max and a_max. */
+static void _ramp_axis(struct emc_session *ps, struct emc_axis *axis, double v_max, double a_max)
+{
+   double v, s_to_go, ds_stop, ds_vel, ds_acc, dv_acc;
 
-   /* Changed following from 50% to 105% to accommodate pymini's TP. Otherwise we will not hit the "last step targets". David Suffield 1-30-2015 */
-   v_max = 1.05 * axis->max_velocity;
-   a_max = 1.05 * axis->max_acceleration;
    v = axis->backlash_vel;
    if (axis->backlash_corr >= axis->backlash_filt)
    {
@@ -190,19 +139,168 @@ static void _compute_axis(struct emc_session *ps, struct emc_axis *axis)
 	 axis->backlash_filt = axis->backlash_corr;
       }
    }
+}  /* _ramp_axis() */
+
+static void _compute_axis(struct emc_session *ps, struct emc_axis *axis)
+{
+   /* determine which way the compensation should be applied */
+   if (axis->vel_cmd > 0.0)
+   {
+      /* moving "up". apply positive backlash comp */
+      axis->backlash_corr = 0.5 * axis->backlash;
+   }
+   else if (axis->vel_cmd < 0.0)
+   {
+      /* moving "down". apply negative backlash comp */
+      axis->backlash_corr = -0.5 * axis->backlash;
+   }
+   else
+   {
+      /* not moving, use whatever was there before */
+   }
+
+   /* at this point, the correction has been computed, but
+      the value may make abrupt jumps on direction reversal */
+   /*
+    * 07/09/2005 - S-curve implementation by Bas Laarhoven
+    *
+    * Implementation:
+    *   Generate a ramped velocity profile for backlash or screw error comp.
+    *   The velocity is ramped up to the maximum speed setting (if possible),
+    *   using the maximum acceleration setting.
+    *   At the end, the speed is ramped dowm using the same acceleration.
+    *   The algorithm keeps looking ahead. Depending on the distance to go,
+    *   the speed is increased, kept constant or decreased.
+    *   
+    * Limitations:
+    *   Since the compensation adds up to the normal movement, total
+    *   accelleration and total velocity may exceed maximum settings!
+    *   Currently this is limited to 150% by implementation.
+    *   To fix this, the calculations in get_pos_cmd should include
+    *   information from the backlash corection. This makes things
+    *   rather complicated and it might be better to implement the
+    *   backlash compensation at another place to prevent this kind
+    *   of interaction.
+    *   More testing under different circumstances will show if this
+    *   needs a more complicate solution.
+    *   For now this implementation seems to generate smoother
+    *   movements and less following errors than the original code.
+    */
+
+   /* Limit maximum accelleration and velocity 'overshoot'
+    * to 150% of the maximum settings.
+    * The TP and backlash shouldn't use more than 100%
+    * (together) but this requires some interaction that
+    * isn't implemented yet.
+    */
+
+   /* Changed following from 50% to 105% to accommodate pymini's TP. Otherwise we will not hit the "last step targets". David Suffield 1-30-2015 */
+   _ramp_axis(ps, axis, 1.05 * axis->max_velocity, 1.05 * axis->max_acceleration);
 }  /* _compute_axis() */
 
-/* Calculate leadscrew compensation (backlash). */
-void compute_screw_comp(struct emc_session *ps)
+/* Calculate leadscrew compensation (backlash) for the axes in mask, ps->backlash_mask at most. */
+void compute_screw_comp(struct emc_session *ps, unsigned int mask)
 {
    int i;
 
    for (i=0; i < ps->axes; i++)
    {
-      _compute_axis(ps, &ps->axis[i]);
+      if (mask & (1 << i))
+         _compute_axis(ps, &ps->axis[i]);
    }
 }       /* compute_screw_comp() */
 
+/*
+ * Pick the compensation side of each backlash axis from the start direction of the next segment, dir is
+ * indexed by coordinate (x y z a b c u v w) and only its sign is used. Returns the axes that need a take-up
+ * move before the segment, reversals plus any ramp left over from the last segment.
+ */
+unsigned int reverse_screw_comp(struct emc_session *ps, const double *dir)
+{
+   struct emc_axis *axis;
+   unsigned int mask = 0;
+   double d;
+   int i;
+
+   for (i=0; i < ps->axes; i++)
+   {
+      if (!(ps->backlash_mask & (1 << i)))
+         continue;
+
+      axis = &ps->axis[i];
+      d = dir[axis->coordinate_map];
+      if (d > SCREW_COMP_EPSILON)
+         axis->backlash_corr = 0.5 * axis->backlash;
+      else if (d < -SCREW_COMP_EPSILON)
+         axis->backlash_corr = -0.5 * axis->backlash;
+
+      if (axis->backlash_filt != axis->backlash_corr)
+         mask |= 1 << i;
+   }
+   return mask;
+}       /* reverse_screw_comp() */
+
+/*
+ * Run one cycle of the take-up move for the axes in mask. Segments start from rest so the take-up
+ * gets the full axis limits to itself. Returns the axes still short of their correction.
+ */
+unsigned int takeup_screw_comp(struct emc_session *ps, unsigned int mask)
+{
+   struct emc_axis *axis;
+   int i;
+
+   for (i=0; i < ps->axes; i++)
+   {
+      if (!(mask & (1 << i)))
+         continue;
+
+      axis = &ps->axis[i];
+      _ramp_axis(ps, axis, axis->max_velocity, axis->max_acceleration);
+      if (axis->backlash_filt == axis->backlash_corr)
+         mask &= ~(1 << i);
+   }
+   return mask;
+}       /* takeup_screw_comp() */
+
+/*
+ * Time of the take-up move reverse_screw_comp() and takeup_screw_comp() would run before a segment starting in
+ * direction dir. The corrections come from filt[] instead of the axis state so a planner that does not move the
+ * machine can track its own, filt[] is updated to the new side. Rounded up to whole cycles like the run.
+ */
+double estimate_screw_comp(struct emc_session *ps, double *filt, const double *dir)
+{
+   struct emc_axis *axis;
+   double corr, d, s, t, t_max = 0.0;
+   int i;
+
+   for (i=0; i < ps->axes; i++)
+   {
+      if (!(ps->backlash_mask & (1 << i)))
+         continue;
+
+      axis = &ps->axis[i];
+      d = dir[axis->coordinate_map];
+      if (d > SCREW_COMP_EPSILON)
+         corr = 0.5 * axis->backlash;
+      else if (d < -SCREW_COMP_EPSILON)
+         corr = -0.5 * axis->backlash;
+      else
+         continue;
+
+      s = fabs(corr - filt[i]);
+      filt[i] = corr;
+
+      /* From rest to rest, a triangle if v_max is never reached. */
+      if (s * axis->max_acceleration >= axis->max_velocity * axis->max_velocity)
+         t = s / axis->max_velocity + axis->max_velocity / axis->max_acceleration;
+      else
+         t = 2.0 * sqrt(s / axis->max_acceleration);
+      if (t > t_max)
+         t_max = t;
+   }
+   return ceil(t_max / ps->cycle_time) * ps->cycle_time;
+}       /* estimate_screw_comp() */
+
 void reset_screw_comp(struct emc_session *ps)
 {
    int i;
@@ -216,21 +314,11 @@ void reset_screw_comp(struct emc_session *ps)
    }
 }
 
-#if 0
 /* Convert EmcPose structure to array. */
 void emcpos2a(double *a, EmcPose pos)
 {
-   a[EMC_AXIS_X] = pos.tran.x;
-   a[EMC_AXIS_Y] = pos.tran.y;
-   a[EMC_AXIS_Z] = pos.tran.z;
-   a[EMC_AXIS_A] = pos.a;
-   a[EMC_AXIS_B] = pos.b;
-   a[EMC_AXIS_C] = pos.c;
-   a[EMC_AXIS_U] = pos.u;
-   a[EMC_AXIS_V] = pos.v;
-   a[EMC_AXIS_W] = pos.w;
+   emcPoseToArray(&pos, a);
 }
-#endif
 
 void update_tp_position(struct emc_session *ps, EmcPose pos)
 {
@@ -242,15 +330,7 @@ void update_tp_position(struct emc_session *ps, EmcPose pos)
       old_pos_cmd[i] = ps->axis[i].pos_cmd;
 
    /* Convert coordinates into array. */
-   new_pos_cmd[EMC_AXIS_X] = pos.tran.x;
-   new_pos_cmd[EMC_AXIS_Y] = pos.tran.y;
-   new_pos_cmd[EMC_AXIS_Z] = pos.tran.z;
-   new_pos_cmd[EMC_AXIS_A] = pos.a;
-   new_pos_cmd[EMC_AXIS_B] = pos.b;
-   new_pos_cmd[EMC_AXIS_C] = pos.c;
-   new_pos_cmd[EMC_AXIS_U] = pos.u;
-   new_pos_cmd[EMC_AXIS_V] = pos.v;
-   new_pos_cmd[EMC_AXIS_W] = pos.w;
+   emcPoseToArray(&pos, new_pos_cmd);
 
    /* Map coordinate to each axis (step/dir pins). One coordinate may map to more than one axis. */
    for (i=0; i < EMC_MAX_AXIS; i++)
@@ -0,0 +1,92 @@
+/********************************************************************
+* pminline.h - inline PmCartesian kernels for the trajectory planner.
+*
+* The posemath C API passes PmCartesian by value through out of line
+* calls that each set pmErrno. The kernels here take pointers, return
+* their result directly, leave pmErrno alone and have no data dependent
+* branches, so tpRunCycle() and tcGetPos() get them inlined. The
+* pmCart*() functions in _posemath.c are wrappers around them.
+*
+* Output pointers may alias the inputs.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+#ifndef PMINLINE_H
+#define PMINLINE_H
+
+#include <math.h>
+#include "posemath.h"
+
+/* vout = v1 + v2 */
+static inline void pmCartCartAddI(const PmCartesian *v1, const PmCartesian *v2, PmCartesian *vout)
+{
+   vout->x = v1->x + v2->x;
+   vout->y = v1->y + v2->y;
+   vout->z = v1->z + v2->z;
+}
+
+/* vout = v1 - v2 */
+static inline void pmCartCartSubI(const PmCartesian *v1, const PmCartesian *v2, PmCartesian *vout)
+{
+   vout->x = v1->x - v2->x;
+   vout->y = v1->y - v2->y;
+   vout->z = v1->z - v2->z;
+}
+
+/* vout = v1 * d */
+static inline void pmCartScalMultI(const PmCartesian *v1, double d, PmCartesian *vout)
+{
+   vout->x = v1->x * d;
+   vout->y = v1->y * d;
+   vout->z = v1->z * d;
+}
+
+/* vout += v1 * d */
+static inline void pmCartScalMultAddI(const PmCartesian *v1, double d, PmCartesian *vout)
+{
+   vout->x += v1->x * d;
+   vout->y += v1->y * d;
+   vout->z += v1->z * d;
+}
+
+/* vout = v1 x v2 */
+static inline void pmCartCartCrossI(const PmCartesian *v1, const PmCartesian *v2, PmCartesian *vout)
+{
+   double x = v1->y * v2->z - v1->z * v2->y;
+   double y = v1->z * v2->x - v1->x * v2->z;
+   double z = v1->x * v2->y - v1->y * v2->x;
+
+   vout->x = x;
+   vout->y = y;
+   vout->z = z;
+}
+
+static inline double pmCartCartDotI(const PmCartesian *v1, const PmCartesian *v2)
+{
+   return v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+}
+
+/* A sum of squares is never negative, so no pmSqrt() fuzz handling is needed. */
+static inline double pmCartMagI(const PmCartesian *v)
+{
+   return sqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+}
+
+static inline double pmCartCartDispI(const PmCartesian *v1, const PmCartesian *v2)
+{
+   return sqrt(pmSq(v2->x - v1->x) + pmSq(v2->y - v1->y) + pmSq(v2->z - v1->z));
+}
+
+/* Translation part of pmLinePoint(), the rotation is left out. */
+static inline void pmLinePointI(const PmLine *line, double len, PmCartesian *vout)
+{
+   const PmCartesian *base = line->tmag_zero ? &line->end.tran : &line->start.tran;
+
+   len = line->tmag_zero ? 0.0 : len;
+   vout->x = base->x + line->uVec.x * len;
+   vout->y = base->y + line->uVec.y * len;
+   vout->z = base->z + line->uVec.z * len;
+}
+
+#endif
@@ -26,7 +26,7 @@
 # 12/16/2014 - New
 
 import os, sys, logging
-from ctypes import cdll, c_int, c_char_p, c_void_p, c_double, c_long, c_void_p, byref, cast, Structure, POINTER, CFUNCTYPE
+from ctypes import cdll, c_int, c_char, c_ubyte, c_char_p, c_void_p, c_double, c_long, c_void_p, byref, cast, Structure, POINTER, CFUNCTYPE, create_string_buffer
 import sys, importlib
 from version import Version
 
@@ -47,6 +47,11 @@ class MechResult(object):
     RTSTEPPER_R_INPUT_FALSE = 2
     EMC_R_PROGRAM_PAUSED = 3
 
+class MechLogLevel(object):
+    BUG = 1
+    MSG = 2
+    DBG = 3
+
 class MechStateBit(object):
     ABORT = 0x1
     EMPTY = 0x2
@@ -78,6 +83,49 @@ class EmcPose(Structure):
 class mech_pos(Structure):
     _fields_ = [("id", c_int), ("pos", EmcPose)]
 
+# See Makefile.in -DLINELEN
+LINELEN = 255
+
+# See emc.h EMC_VERIFY_*
+VERIFY_ERRORS_MAX = 8
+VERIFY_TEXT_LEN = 128
+VERIFY_TOOLS_MAX = 32
+VERIFY_MCODES_MAX = 200
+
+class VerifySummary(Structure):
+    _fields_ = [("lines", c_int),
+       ("error_cnt", c_int),
+       ("error_line", c_int * VERIFY_ERRORS_MAX),
+       ("error_text", (c_char * VERIFY_TEXT_LEN) * VERIFY_ERRORS_MAX),
+       ("min", EmcPose),
+       ("max", EmcPose),
+       ("traverse_length", c_double),
+       ("feed_length", c_double),
+       ("arc_length", c_double),
+       ("hole_order_saved", c_double),
+       ("tool_change_cnt", c_int),
+       ("tool", c_int * VERIFY_TOOLS_MAX),
+       ("mcode", c_ubyte * VERIFY_MCODES_MAX),
+       ("limit_cnt", c_int),
+       ("limit_line", c_int),
+       ("path_cnt", c_int)]
+
+# See emc.h EMC_ESTIMATE_*
+ESTIMATE_TOOLS_MAX = 32
+
+class Estimate(Structure):
+    _fields_ = [("lines", c_int),
+       ("error_line", c_int),
+       ("error_text", c_char * VERIFY_TEXT_LEN),
+       ("time", c_double),
+       ("motion_time", c_double),
+       ("dwell_time", c_double),
+       ("pause_cnt", c_int),
+       ("tool_change_cnt", c_int),
+       ("tool_cnt", c_int),
+       ("tool", c_int * ESTIMATE_TOOLS_MAX),
+       ("tool_time", c_double * ESTIMATE_TOOLS_MAX)]
+
 # Define dll to python callback functions. First param is the return type.
 LOGGER_CB_FUNC = CFUNCTYPE(None, c_char_p)
 POSITION_CB_FUNC = CFUNCTYPE(None, c_int, POINTER(mech_pos))
@@ -116,6 +164,11 @@ class EmcMech(object):
             self._register_logger_cb.argtype = [self.cb_logger]
             self._register_logger_cb.restype = c_int
 
+            # enum EMC_RESULT emc_ui_logger_level_set(int level)
+            self._logger_level_set = self.lib.emc_ui_logger_level_set
+            self._logger_level_set.argtypes = [c_int]
+            self._logger_level_set.restype = c_int
+
             # enum EMC_RESULT emc_ui_plugin_register_cb(void (*fp)(const char *msg))
             self.cb_plugin = PLUGIN_CB_FUNC(self.call_plugin_cb)
             self._register_plugin_cb = self.lib.emc_ui_plugin_register_cb
@@ -154,6 +207,11 @@ class EmcMech(object):
             self._auto_cmd.argtypes = [c_void_p, c_char_p]
             self._auto_cmd.restype = c_int
 
+            # enum EMC_RESULT emc_ui_auto_from_line_cmd(void *hd, const char *gcodefile, int line_number)
+            self._auto_from_line_cmd = self.lib.emc_ui_auto_from_line_cmd
+            self._auto_from_line_cmd.argtypes = [c_void_p, c_char_p, c_int]
+            self._auto_from_line_cmd.restype = c_int
+
             # enum EMC_RESULT emc_ui_auto_cancel_set(void *hd)
             self._auto_cancel_set = self.lib.emc_ui_auto_cancel_set
             self._auto_cancel_set.argtypes = [c_void_p]
@@ -229,6 +287,16 @@ class EmcMech(object):
             self._verify_cmd.argtypes = [c_void_p, c_char_p]
             self._verify_cmd.restype = c_int
 
+            # enum EMC_RESULT emc_ui_verify_summary_cmd(void *hd, const char *gcodefile, struct emc_verify_summary *sum, struct emc_verify_point *path, int path_max)
+            self._verify_summary_cmd = self.lib.emc_ui_verify_summary_cmd
+            self._verify_summary_cmd.argtypes = [c_void_p, c_char_p, POINTER(VerifySummary), POINTER(mech_pos), c_int]
+            self._verify_summary_cmd.restype = c_int
+
+            # enum EMC_RESULT emc_ui_estimate_cmd(void *hd, const char *gcodefile, struct emc_estimate *est, double *range_time, int range_lines, int range_cnt)
+            self._estimate_cmd = self.lib.emc_ui_estimate_cmd
+            self._estimate_cmd.argtypes = [c_void_p, c_char_p, POINTER(Estimate), POINTER(c_double), c_int, c_int]
+            self._estimate_cmd.restype = c_int
+
             # enum EMC_RESULT emc_ui_verify_cancel_set(void *hd)
             self._verify_cancel_set = self.lib.emc_ui_verify_cancel_set
             self._verify_cancel_set.argtypes = [c_void_p]
@@ -274,6 +342,11 @@ class EmcMech(object):
             self._input_adc_get.argtypes = [c_void_p, c_int, POINTER(c_int)]
             self._input_adc_get.restype= c_int
 
+            # enum EMC_RESULT emc_ui_ini_get(void *hd, const char *section, const char *key, char *value, int value_size)
+            self._ini_get = self.lib.emc_ui_ini_get
+            self._ini_get.argtypes = [c_void_p, c_char_p, c_char_p, c_char_p, c_int]
+            self._ini_get.restype= c_int
+
         except Exception as err:
             logging.error("unable to load library: %s %s" % (self.LIBRARY_FILE, err))
 
@@ -316,6 +389,10 @@ class EmcMech(object):
     def auto_cmd(self, gcodefile):
         return self._auto_cmd(self.hd, gcodefile.encode('ascii'))
 
+    #############################################################################################################
+    def auto_from_line_cmd(self, gcodefile, line_number):
+        return self._auto_from_line_cmd(self.hd, gcodefile.encode('ascii'), line_number)
+
     #############################################################################################################
     def auto_cancel_set(self):
         return self._auto_cancel_set(self.hd)
@@ -328,6 +405,23 @@ class EmcMech(object):
     def verify_cmd(self, gcodefile):
         return self._verify_cmd(self.hd, gcodefile.encode('ascii'))
 
+    #############################################################################################################
+    # Verify at full speed, returns (result, VerifySummary, toolpath) where toolpath is a list of mech_pos.
+    def verify_summary_cmd(self, gcodefile, path_max=0):
+        summary = VerifySummary()
+        path = (mech_pos * path_max)() if path_max > 0 else None
+        ret = self._verify_summary_cmd(self.hd, gcodefile.encode('ascii'), byref(summary), path, path_max)
+        return (ret, summary, path[:summary.path_cnt] if path_max > 0 else [])
+
+    #############################################################################################################
+    # Estimate run time in seconds, returns (result, Estimate, range_time) where range_time[i] is the time
+    # spent in lines i*range_lines+1 to (i+1)*range_lines.
+    def estimate_cmd(self, gcodefile, range_lines=0, range_cnt=0):
+        est = Estimate()
+        range_time = (c_double * range_cnt)() if range_cnt > 0 else None
+        ret = self._estimate_cmd(self.hd, gcodefile.encode('ascii'), byref(est), range_time, range_lines, range_cnt)
+        return (ret, est, list(range_time) if range_cnt > 0 else [])
+
     #############################################################################################################
     def verify_cancel_set(self):
         return self._verify_cancel_set(self.hd)
@@ -445,6 +539,13 @@ class EmcMech(object):
         self._input_adc_get(self.hd, input_num, byref(s))
         return s.value
 
+    #############################################################################################################
+    def ini_get(self, section, key, default=None):
+        s = create_string_buffer(LINELEN)
+        if (self._ini_get(self.hd, section.encode('ascii'), key.encode('ascii'), s, LINELEN) != MechResult.EMC_R_OK):
+            return default
+        return s.value.decode('ascii', 'replace')
+
     #############################################################################################################
     def get_version(self):
         p = c_void_p()
@@ -456,6 +557,10 @@ class EmcMech(object):
     def register_logger_cb(self):
         return self._register_logger_cb(self.cb_logger)
 
+    #############################################################################################################
+    def logger_level_set(self, level):
+        return self._logger_level_set(level)
+
     #############################################################################################################
     def register_event_cb(self, queue):
         self.guiq = queue
@@ -482,7 +587,9 @@ class EmcMech(object):
 
     #############################################################################################################
     def close(self):
-        return self._close(self.hd)
+        ret = self._close(self.hd)
+        self.hd = None   # the session is freed
+        return ret
 
 ################################################################################################################
 if __name__ == "__main__":
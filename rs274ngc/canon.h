@@ -160,6 +160,55 @@ struct CANON_POSITION
 /* reads world model data into the canonical interface */
 extern void INIT_CANON();
 
+/* The canonical interface state is kept in a context. Each thread has a
+   current context; by default it is one that drives no machine, calls made
+   with it are reported and their commands dropped. A thread running an
+   Interp instance creates a context, makes it current while it runs the
+   interpreter and reads its commands from GET_CANON_INTERP_LIST(). The
+   GET_EXTERNAL_*() queries answer from the emc_session the context was
+   created for. */
+class MSG_INTERP_LIST;
+struct emc_session;
+typedef struct canon_context CANON_CONTEXT;
+
+extern CANON_CONTEXT *CANON_CONTEXT_NEW(struct emc_session *session);
+extern void CANON_CONTEXT_FREE(CANON_CONTEXT * context);
+
+/* Returns the previous context. NULL selects the default context. */
+extern CANON_CONTEXT *SET_CANON_CONTEXT(CANON_CONTEXT * context);
+extern MSG_INTERP_LIST *GET_CANON_INTERP_LIST();
+
+/* Canonical interface state saved with an interpreter snapshot, so a
+   program can be started at a later line (run-from-line). Positions are
+   absolute, mm and degrees. */
+typedef struct
+{
+   CANON_POSITION program_origin;
+   CANON_POSITION end_point;    /* after any queued naivecam segments */
+   CANON_UNITS length_units;
+   CANON_PLANE plane;
+   EmcPose tool_offset;
+   double xy_rotation;
+   double css_maximum;
+   double spindle_speed;
+   double linear_feed_rate;
+   double angular_feed_rate;
+   CANON_MOTION_MODE motion_mode;
+   double motion_tolerance;
+   double naivecam_tolerance;
+   int feed_mode;
+   int synched;
+   int prepped_tool;
+   bool optional_program_stop;
+   bool block_delete;
+} CANON_STATE;
+
+extern void SAVE_CANON_STATE(CANON_STATE * state);
+
+/* Queued naivecam segments are dropped on restore, they belong to lines
+   before the snapshot. */
+extern void RESTORE_CANON_STATE(const CANON_STATE * state);
+
 /* Representation */
 
 extern void SET_ORIGIN_OFFSETS(double x, double y, double z, double a, double b, double c, double u, double v, double w);
@@ -175,6 +224,15 @@ extern void CANON_UPDATE_END_POINT(double x, double y, double z, double a, doubl
 /* Called from emctask to update the canon position during skipping through
    programs started with start-from-line > 0. */
 
+extern void CANON_RESET_END_POINT();
+/* Called after a program was interpreted without moving the machine (estimate).
+   The canon end point goes back to the machine position, queued naivecam
+   segments are dropped. */
+
+extern void CANON_APPROACH_END_POINT(int line_number);
+/* Called after skipping to the start line. Rapid from the machine position
+   to the canon end point: Z up first, the other axes, then Z down. */
+
 extern void USE_LENGTH_UNITS(CANON_UNITS u);
 
 /* Use the specified units for length. Conceptually, the units must
@@ -321,6 +379,17 @@ If tolerance=0 then any path deviation may occur, speed is maximized.
 
 */
 
+#define NAIVECAM_CHAIN_MAX_DEFAULT 2000
+
+extern void SET_NAIVECAM_CHAIN_MAX(int max);
+
+/* Most short G1 segments the naive cam detector joins into one move (1 = no joining). */
+
+extern void SET_NAIVECAM_ARC_CHORDS(int chords);
+
+/* Fewest joined G1 moves the naive cam detector replaces by one arc in the
+   XY plane, within the naive cam tolerance (0 = no arc fitting). */
+
 extern void SET_CUTTER_RADIUS_COMPENSATION(double radius);
 
 /* Set the radius to use when performing cutter radius compensation. */
@@ -402,10 +471,8 @@ extern void STRAIGHT_FEED(int lineno, double x, double y, double z, double a, do
 /* Additional functions needed to calculate nurbs points */
 
 extern std::vector < unsigned int >knot_vector_creator(unsigned int n, unsigned int k);
-extern double Nmix(unsigned int i, unsigned int k, double u, std::vector < unsigned int >knot_vector);
-extern double Rden(double u, unsigned int k, std::vector < CONTROL_POINT > nurbs_control_points, std::vector < unsigned int >knot_vector);
-extern PLANE_POINT nurbs_point(double u, unsigned int k, std::vector < CONTROL_POINT > nurbs_control_points, std::vector < unsigned int >knot_vector);
-extern PLANE_POINT nurbs_tangent(double u, unsigned int k, std::vector < CONTROL_POINT > nurbs_control_points, std::vector < unsigned int >knot_vector);
+extern PLANE_POINT nurbs_deboor(double u, unsigned int k, const std::vector < CONTROL_POINT > &nurbs_control_points,
+                                const std::vector < unsigned int >&knot_vector, std::vector < CONTROL_POINT > &work, PLANE_POINT * tangent);
 extern double alpha_finder(double dx, double dy);
 
 /* Canon calls */
@@ -424,6 +491,16 @@ extern void RIGID_TAP(int lineno, double x, double y, double z);
 /* Move linear and synced with the previously set pitch.
 Only linear moves are allowed, axes A,B,C are not allowed to move.*/
 
+extern void DRILL_CYCLE(int lineno, int chip_break, double x, double y, double z, double a, double b, double c, double u, double v, double w,
+                        double clear, double delta, double retract);
+
+/* Peck drill from the current location, the R point, to (x, y, z, a, b, c, u, v, w),
+the bottom of the hole. Each peck feeds delta deeper, then G83 backs out at traverse rate
+to the clearance point and back in to retract short of the last peck, while G73
+(chip_break) only backs off by retract. The cycle ends at the clearance point, clear
+away from the R point on the far side of the bottom. Distances are in program length units
+along the line to the bottom. The executing system expands the cycle into feeds and traverses. */
+
 
 extern void STRAIGHT_PROBE(int lineno, double x, double y, double z, double a, double b, double c, double u, double v, double w, unsigned char probe_type);
 
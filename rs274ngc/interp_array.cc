@@ -309,12 +309,10 @@ const read_function_pointer Interp::default_readers[256] = {
 // And now indent can continue.
 /****************************************************************************/
 
-/* There are four global variables*. The first three are _gees, _ems,
-and _readers. The last one, declared here, is for interpreter settings */
+/* There are three global variables*. They are _gees, _ems, and _readers.
+The interpreter settings are in Interp::_setup, one per Interp instance. */
 
-setup Interp::_setup;
-
-/* The notion of "global variables" is a misnomer - These last four should only
+/* The notion of "global variables" is a misnomer - These last three should only
    be accessable by the interpreter and not exported to the rest of emc */
 
 
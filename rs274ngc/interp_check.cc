@@ -24,6 +24,124 @@
 #include "interp_internal.h"
 #include "rs274ngc_interp.h"
 
+/* Words checked by check_other_codes(), one bit each. The bits from A to R
+   are in the order their "word with no code to use it" errors are reported. */
+enum
+{
+  WORD_A, WORD_B, WORD_C, WORD_D, WORD_E, WORD_H, WORD_I, WORD_J, WORD_K,
+  WORD_L, WORD_P, WORD_Q, WORD_R, WORD_S, WORD_F
+};
+
+#define WORD_FLAG(word) (1U << (word))
+#define WORDS_ABC (WORD_FLAG(WORD_A) | WORD_FLAG(WORD_B) | WORD_FLAG(WORD_C))
+#define WORDS_USER_M (WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q))
+
+/* What a g or m code does with the words above. */
+typedef struct
+{
+  int code;
+  unsigned short allowed;       // words the code can use
+  unsigned short required;      // words the code must have
+  unsigned short forbidden;     // words the code must not have
+} word_rule;
+
+static const word_rule _g_word_rules[] = {
+  { G_2,    WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_K) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_3,    WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_K) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_4,    WORD_FLAG(WORD_P), 0, 0 },
+  { G_5,    WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q), 0, 0 },
+  { G_5_1,  WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J), 0, 0 },
+  { G_5_2,  WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P), 0, 0 },
+  { G_10,   WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_33,   WORD_FLAG(WORD_K), WORD_FLAG(WORD_K), WORD_FLAG(WORD_F) },
+  { G_33_1, WORD_FLAG(WORD_K), WORD_FLAG(WORD_K), WORD_FLAG(WORD_F) },
+  { G_41,   WORD_FLAG(WORD_D) | WORD_FLAG(WORD_L), 0, 0 },
+  { G_41_1, WORD_FLAG(WORD_D) | WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_42,   WORD_FLAG(WORD_D) | WORD_FLAG(WORD_L), 0, 0 },
+  { G_42_1, WORD_FLAG(WORD_D) | WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_43,   WORD_FLAG(WORD_H), 0, 0 },
+  { G_64,   WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q), 0, 0 },
+  { G_73,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_Q) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_76,   WORD_FLAG(WORD_E) | WORD_FLAG(WORD_H) | WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_K) | WORD_FLAG(WORD_L) |
+            WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q) | WORD_FLAG(WORD_R),
+            WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_K) | WORD_FLAG(WORD_P), 0 },
+  { G_81,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_82,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_83,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_Q) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_84,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_85,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_86,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_87,   WORD_FLAG(WORD_I) | WORD_FLAG(WORD_J) | WORD_FLAG(WORD_K) | WORD_FLAG(WORD_L) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_88,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_89,   WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_R), 0, 0 },
+  { G_96,   WORD_FLAG(WORD_D), WORD_FLAG(WORD_S), 0 },
+};
+
+static const word_rule _m_word_rules[] = {
+  { 50, WORD_FLAG(WORD_P), 0, 0 },
+  { 51, WORD_FLAG(WORD_P), 0, 0 },
+  { 52, WORD_FLAG(WORD_P), 0, 0 },
+  { 53, WORD_FLAG(WORD_P), 0, 0 },
+  { 61, WORD_FLAG(WORD_Q), 0, 0 },
+  { 62, WORD_FLAG(WORD_P), 0, 0 },
+  { 63, WORD_FLAG(WORD_P), 0, 0 },
+  { 64, WORD_FLAG(WORD_P), 0, 0 },
+  { 65, WORD_FLAG(WORD_P), 0, 0 },
+  { 66, WORD_FLAG(WORD_E) | WORD_FLAG(WORD_L) | WORD_FLAG(WORD_P) | WORD_FLAG(WORD_Q), 0, 0 },
+  { 67, WORD_FLAG(WORD_E) | WORD_FLAG(WORD_Q), 0, 0 },
+  { 68, WORD_FLAG(WORD_E) | WORD_FLAG(WORD_Q), 0, 0 },
+};
+
+/* The rules above expanded into tables indexed by code + 1, so "no code"
+   (-1) lands on the empty first entry. G codes are unique across modal
+   groups, so one table serves every group; likewise for m codes. */
+typedef struct
+{
+  unsigned short allowed;
+  unsigned short required;
+  unsigned short forbidden;
+} word_mask;
+
+static struct word_tables
+{
+  word_mask g[1000 + 1];
+  word_mask m[200 + 1];
+
+  static void fill(word_mask *table, const word_rule *rule, int n)
+  {
+    for (; n > 0; n--, rule++) {
+      table[rule->code + 1].allowed = rule->allowed;
+      table[rule->code + 1].required = rule->required;
+      table[rule->code + 1].forbidden = rule->forbidden;
+    }
+  }
+
+  word_tables()
+  {
+    memset(this, 0, sizeof(*this));
+    fill(g, _g_word_rules, sizeof(_g_word_rules) / sizeof(_g_word_rules[0]));
+    fill(m, _m_word_rules, sizeof(_m_word_rules) / sizeof(_m_word_rules[0]));
+  }
+} _word_tables;
+
+/* check_other_codes() error for a word no code on the line can use, by word bit */
+static const char *const _word_errors[] = {
+  NCE_CANNOT_PUT_AN_A_IN_CANNED_CYCLE,
+  NCE_CANNOT_PUT_A_B_IN_CANNED_CYCLE,
+  NCE_CANNOT_PUT_A_C_IN_CANNED_CYCLE,
+  EMC_I18N("D word with no G41, G41.1, G42, G42.1, or G96 to use it"),
+  EMC_I18N("E word with no G76, M66, M67 or M68 to use it"),
+  EMC_I18N("H word with no G43 or G76 to use it"),
+  EMC_I18N("I word with no G2, G3, G5, G5.1, G10, G76, or G87 to use it"),
+  EMC_I18N("J word with no G2, G3, G5, G5.1, G10, G76 or G87 to use it"),
+  EMC_I18N("K word with no G2, G3, G33, G33.1, G76, or G87 to use it"),
+  EMC_I18N("L word with no G10, cutter compensation, canned cycle, digital/analog input, or NURBS code"),
+  EMC_I18N("P word with no G4 G10 G64 G5 G5.2 G76 G82 G86 G88 G89"
+    " or M50 M51 M52 M53 M62 M63 M64 M65 M66 or user M code to use it"),
+  EMC_I18N("Q word with no G5, G10, G64, G73, G76, G83, M66, M67, M68 or user M code that uses it"),
+  NCE_R_WORD_WITH_NO_G_CODE_THAT_USES_IT,
+};
+
 /****************************************************************************/
 
 /*! check_g_codes
@@ -83,8 +201,11 @@ int Interp::check_g_codes(block_pointer block,   //!< pointer to a block to be c
 
   mode0 = block->g_modes[0];
   mode1 = block->g_modes[1];
-  if (mode0 == -1) {
-  } else if (mode0 == G_4) {
+  if (mode0 == -1)
+    return INTERP_OK;
+  CHKS((_gees[mode0] != 0), NCE_BUG_BAD_G_CODE_MODAL_GROUP_0);
+
+  if (mode0 == G_4) {
     CHKS((block->p_number == -1.0), NCE_DWELL_TIME_MISSING_WITH_G4);
   } else if (mode0 == G_10) {
     p_int = (int) (block->p_number + 0.0001);
@@ -92,23 +213,16 @@ int Interp::check_g_codes(block_pointer block,   //!< pointer to a block to be c
     CHKS((((block->p_number + 0.0001) - p_int) > 0.0002),  "P value not an integer with G10");
     CHKS((((block->l_number == 2 || block->l_number == 20) && ((p_int < 1) || (p_int > 9)))), "P value out of range with G10 L2 or G10 L20");
     CHKS((((block->l_number == 1 || block->l_number == 10) && p_int < 1)), "P value out of range with G10 L1 or G10 L10");
-  } else if (mode0 == G_28) {
-  } else if (mode0 == G_30) {
   } else if (mode0 == G_5_3) { 
       CHKS(((mode1 != G_5_2) && (mode1 != -1)), EMC_I18N("Between G5.2 and G5.3 codes, only additional G5.2 codes are allowed."));
-  } else if (mode1 == G_5_2){
-  } else if (mode0 == G_28_1 || mode0 == G_30_1) {
-  } else if (mode0 == G_53) {
+  } else if (mode0 == G_53 && mode1 != G_5_2) {
     CHKS(((block->motion_to_be != G_0) && (block->motion_to_be != G_1)),
         NCE_MUST_USE_G0_OR_G1_WITH_G53);
     CHKS(((block->g_modes[3] == G_91) ||
          ((block->g_modes[3] != G_90) &&
           (settings->distance_mode == MODE_INCREMENTAL))),
         NCE_CANNOT_USE_G53_INCREMENTAL);
-  } else if (mode0 == G_92) {
-  } else if ((mode0 == G_92_1) || (mode0 == G_92_2) || (mode0 == G_92_3)) {
-  } else
-    ERS(NCE_BUG_BAD_G_CODE_MODAL_GROUP_0);
+  }
   return INTERP_OK;
 }
 
@@ -224,101 +338,65 @@ not m or g codes.
 The functions named read_XXXX check for errors which would foul up the
 reading. This function checks for additional logical errors in codes.
 
+The words on the line are gathered into a bit mask and checked against
+the masks _word_tables holds for the codes on the line, so a legal line
+costs a few table lookups. Only a line with a required word missing or
+a forbidden one present goes through the individual checks, which keep
+the error order above.
+
 */
 
 int Interp::check_other_codes(block_pointer block)       //!< pointer to a block of RS274/NGC instructions
 {
-  int motion;
+  const word_mask *g = _word_tables.g + 1;
+  const word_mask *m = _word_tables.m + 1;
+  unsigned int words, given, allowed, required, forbidden, stray;
+  int motion, g1, n;
 
   motion = block->motion_to_be;
-  if (block->a_flag != OFF) {
-    CHKS(((block->g_modes[1] > G_80) && (block->g_modes[1] < G_90)),
-        NCE_CANNOT_PUT_AN_A_IN_CANNED_CYCLE);
-  }
-  if (block->b_flag != OFF) {
-    CHKS(((block->g_modes[1] > G_80) && (block->g_modes[1] < G_90)),
-        NCE_CANNOT_PUT_A_B_IN_CANNED_CYCLE);
-  }
-  if (block->c_flag != OFF) {
-    CHKS(((block->g_modes[1] > G_80) && (block->g_modes[1] < G_90)),
-        NCE_CANNOT_PUT_A_C_IN_CANNED_CYCLE);
-  }
-  if (block->d_flag == ON) {
-    CHKS(((block->g_modes[7] != G_41) && (block->g_modes[7] != G_42) &&
-        (block->g_modes[7] != G_41_1) && (block->g_modes[7] != G_42_1) &&
-	(block->g_modes[14] != G_96)),
-        EMC_I18N("D word with no G41, G41.1, G42, G42.1, or G96 to use it"));
-  }
-
-  if (block->e_flag == ON) {
-    CHKS(((motion != G_76) && (block->m_modes[5] != 66) && 
-      (block->m_modes[5] != 67) && (block->m_modes[5] != 68)),
-       EMC_I18N("E word with no G76, M66, M67 or M68 to use it"));
-  }
-
-  if (block->h_flag == ON) {
-    CHKS((block->g_modes[8] != G_43 && motion != G_76),
-      EMC_I18N("H word with no G43 or G76 to use it"));
-  }
-
-  if (block->i_flag == ON) {    /* could still be useless if yz_plane arc */
-    CHKS(((motion != G_2) && (motion != G_3) && (motion != G_5) && (motion != G_5_1) &&
-          (motion != G_76) && (motion != G_87) && (block->g_modes[0] != G_10)),
-        EMC_I18N("I word with no G2, G3, G5, G5.1, G10, G76, or G87 to use it"));
-  }
-
-  if (block->j_flag == ON) {    /* could still be useless if xz_plane arc */
-    CHKS(((motion != G_2) && (motion != G_3) && (motion != G_5) && (motion != G_5_1) && 
-          (motion != G_76) && (motion != G_87) && (block->g_modes[0] != G_10)),
-        EMC_I18N("J word with no G2, G3, G5, G5.1, G10, G76 or G87 to use it"));
-  }
-
-  if (block->k_flag == ON) {    /* could still be useless if xy_plane arc */
-    CHKS(((motion != G_2) && (motion != G_3) && (motion != G_33) &&
-        (motion != G_33_1) && (motion != G_76) && (motion != G_87)),
-        EMC_I18N("K word with no G2, G3, G33, G33.1, G76, or G87 to use it"));
-  }
-
-  if (block->l_number != -1) {
-    CHKS((((motion < G_81) || (motion > G_89)) && (motion != G_76) &&
-         (motion != G_5_2) && (motion != G_73) &&
-         (block->g_modes[0] != G_10) &&
-         (block->g_modes[7] != G_41) && (block->g_modes[7] != G_41_1) &&
-         (block->g_modes[7] != G_42) && (block->g_modes[7] != G_42_1) &&
-	 (block->m_modes[5] != 66)),
-         EMC_I18N("L word with no G10, cutter compensation, canned cycle, digital/analog input, or NURBS code"));
-  }
 
-  if (block->p_flag == ON) {
-      CHKS(((block->g_modes[0] != G_10) && (block->g_modes[0] != G_4) && (block->g_modes[13] != G_64) &&
-          (motion != G_76) && (motion != G_82) && (motion != G_86) && (motion != G_88) && 
-          (motion != G_89) && (motion != G_5) && (motion != G_5_2) &&
-          (block->m_modes[9] != 50) && (block->m_modes[9] != 51) && (block->m_modes[9] != 52) &&
-          (block->m_modes[9] != 53) && (block->m_modes[5] != 62) && (block->m_modes[5] != 63) &&
-          (block->m_modes[5] != 64) && (block->m_modes[5] != 65) && (block->m_modes[5] != 66) &&
-          (block->user_m != 1)),
-          EMC_I18N("P word with no G4 G10 G64 G5 G5.2 G76 G82 G86 G88 G89"
-            " or M50 M51 M52 M53 M62 M63 M64 M65 M66 or user M code to use it"));
+  /* Words present on the line. block->dirty tells which reader groups ran,
+     most lines skip one or both halves. */
+  words = 0;
+  if (block->dirty & BLOCK_DIRTY_AXES)
+    words = (block->a_flag != OFF) << WORD_A | (block->b_flag != OFF) << WORD_B |
+      (block->c_flag != OFF) << WORD_C;
+  if (block->dirty & BLOCK_DIRTY_WORDS)
+    words |= (block->d_flag == ON) << WORD_D | (block->e_flag == ON) << WORD_E |
+      (block->h_flag == ON) << WORD_H | (block->i_flag == ON) << WORD_I |
+      (block->j_flag == ON) << WORD_J | (block->k_flag == ON) << WORD_K |
+      (block->l_number != -1) << WORD_L | (block->p_flag == ON) << WORD_P |
+      (block->q_number != -1.0) << WORD_Q | (block->r_flag == ON) << WORD_R;
+
+  if (words) {
+    /* Axis words A B C are fine anywhere but in a canned cycle, every other
+       word needs a code on the line that uses it. */
+    g1 = block->g_modes[1];
+    allowed = ((g1 > G_80) && (g1 < G_90)) ? 0 : WORDS_ABC;
+    allowed |= g[motion].allowed | g[block->g_modes[0]].allowed |
+      g[block->g_modes[7]].allowed | g[block->g_modes[8]].allowed |
+      g[block->g_modes[13]].allowed | g[block->g_modes[14]].allowed |
+      m[block->m_modes[5]].allowed | m[block->m_modes[6]].allowed |
+      m[block->m_modes[9]].allowed | ((block->user_m == 1) ? WORDS_USER_M : 0);
+    stray = words & ~allowed;
+    if (stray) {
+      for (n = 0; !(stray & WORD_FLAG(n)); n++);
+      ERS("%s", _word_errors[n]);
+    }
   }
 
-  if (block->q_number != -1.0) {
-      CHKS((motion != G_83) && (motion != G_73) && (motion != G_5) && (block->user_m != 1) && (motion != G_76) &&
-          (block->m_modes[5] != 66) && (block->m_modes[5] != 67) && (block->m_modes[5] != 68) && 
-          (block->g_modes[0] != G_10) && (block->m_modes[6] != 61) && (block->g_modes[13] != G_64), 
-          EMC_I18N("Q word with no G5, G10, G64, G73, G76, G83, M66, M67, M68 or user M code that uses it"));
-  }
+  required = g[motion].required | g[block->g_modes[14]].required;
+  forbidden = g[motion].forbidden;
+  if ((required | forbidden) == 0)
+    return INTERP_OK;
 
-  if (block->r_flag == ON) {
-    CHKS(((motion != G_2) && (motion != G_3) && (motion != G_76) &&
-         ((motion < G_81) || (motion > G_89)) && (motion != G_73) && 
-         (block->g_modes[7] != G_41_1) && (block->g_modes[7] != G_42_1) &&
-         (block->g_modes[0] != G_10)),
-        NCE_R_WORD_WITH_NO_G_CODE_THAT_USES_IT);
-  }
+  /* P, S and F count as given by their numbers, as the readers leave them. */
+  given = (words & ~WORD_FLAG(WORD_P)) | (block->p_number != -1.0) << WORD_P |
+    (block->s_number >= 0) << WORD_S | (block->f_number != -1) << WORD_F;
+  if (((required & ~given) | (forbidden & given)) == 0)
+    return INTERP_OK;
 
-  if (block->s_number < 0) {
-    CHKS((block->g_modes[14] == G_96), NCE_S_WORD_MISSING_WITH_G96);
-  }
+  CHKS((block->g_modes[14] == G_96 && !(given & WORD_FLAG(WORD_S))), NCE_S_WORD_MISSING_WITH_G96);
 
   if (motion == G_33 || motion == G_33_1) {
     CHKS((block->k_flag == OFF), NCE_K_WORD_MISSING_WITH_G33);
@@ -124,9 +124,6 @@ int Interp::comp_set_programmed(setup_pointer settings, double x, double y, doub
  * Side effects: Generates a nurbs move and updates the position of the tool
  */
 
-static unsigned int nurbs_order;
-static std::vector<CONTROL_POINT> nurbs_control_points;
-
 int Interp::convert_nurbs(int mode,
       block_pointer block,     //!< pointer to a block of RS274 instructions
       setup_pointer settings)  //!< pointer to machine settings
@@ -138,16 +135,16 @@ int Interp::convert_nurbs(int mode,
 	CHKS((((block->x_flag) && !(block->y_flag)) || (!(block->x_flag) && (block->y_flag))), (
              "You must specify both X and Y coordinates for Control Points"));
 	CHKS((!(block->x_flag) && !(block->y_flag) && (block->p_number > 0) && 
-             (!nurbs_control_points.empty())), (
+             (!_nurbs_control_points.empty())), (
              "Can specify P without X and Y only for the first control point"));
 
-        CHKS(((block->p_number <= 0) && (!nurbs_control_points.empty())), (
+        CHKS(((block->p_number <= 0) && (!_nurbs_control_points.empty())), (
              "Must specify positive weight P for every Control Point"));
         if (settings->feed_mode == UNITS_PER_MINUTE) {
             CHKS((settings->feed_rate == 0.0), (
                  "Cannot make a NURBS with 0 feedrate"));
         }
-        if (nurbs_control_points.empty()) {
+        if (_nurbs_control_points.empty()) {
             CP.X = settings->current_x;
             CP.Y = settings->current_y;
             if (!(block->x_flag) && !(block->y_flag) && (block->p_number > 0)) {
@@ -155,24 +152,24 @@ int Interp::convert_nurbs(int mode,
             } else {
                 CP.W = 1;
             }
-            nurbs_order = 3;
-            nurbs_control_points.push_back(CP);
+            _nurbs_order = 3;
+            _nurbs_control_points.push_back(CP);
         } 
         if (block->l_number != -1 && block->l_number > 3) {
-            nurbs_order = block->l_number;  
+            _nurbs_order = block->l_number;  
         } 
         if ((block->x_flag) && (block->y_flag)) {
             CHP(find_ends(block, settings, &CP.X, &CP.Y, &end_z, &AA_end, &BB_end, &CC_end,
                           &u_end, &v_end, &w_end));
             CP.W = block->p_number;
-            nurbs_control_points.push_back(CP);
+            _nurbs_control_points.push_back(CP);
             }
 
-//for (i=0;i<nurbs_control_points.size();i++){
+//for (i=0;i<_nurbs_control_points.size();i++){
 //                printf( "X %8.4f, Y %8.4f, W %8.4f\n",
-//              nurbs_control_points[i].X,
-//               nurbs_control_points[i].Y,
-//               nurbs_control_points[i].W);
+//              _nurbs_control_points[i].X,
+//               _nurbs_control_points[i].Y,
+//               _nurbs_control_points[i].W);
 //       }
 //        printf("*-----------------------------------------*\n");
         settings->motion_mode = mode;
@@ -181,13 +178,13 @@ int Interp::convert_nurbs(int mode,
     else if (mode == G_5_3){
         CHKS((settings->motion_mode != G_5_2), (
              "Cannot use G5.3 without G5.2 first"));
-        CHKS((nurbs_control_points.size()<nurbs_order), EMC_I18N("You must specify a number of control points at least equal to the order L = %d"), nurbs_order);
-	settings->current_x = nurbs_control_points[nurbs_control_points.size()-1].X;
-        settings->current_y = nurbs_control_points[nurbs_control_points.size()-1].Y;
-        NURBS_FEED(block->line_number, nurbs_control_points, nurbs_order);
+        CHKS((_nurbs_control_points.size()<_nurbs_order), EMC_I18N("You must specify a number of control points at least equal to the order L = %d"), _nurbs_order);
+	settings->current_x = _nurbs_control_points[_nurbs_control_points.size()-1].X;
+        settings->current_y = _nurbs_control_points[_nurbs_control_points.size()-1].Y;
+        NURBS_FEED(block->line_number, _nurbs_control_points, _nurbs_order);
 	//printf("hello\n");
-	nurbs_control_points.clear();
-	//printf("%d\n", 	nurbs_control_points.size());
+	_nurbs_control_points.clear();
+	//printf("%d\n", 	_nurbs_control_points.size());
 	settings->motion_mode = -1;
     }
     return INTERP_OK;
@@ -236,13 +233,13 @@ int Interp::convert_spline(int mode,
                     &u_end, &v_end, &w_end));
       cp.W = 1;
       cp.X = settings->current_x, cp.Y = settings->current_y;
-      nurbs_control_points.push_back(cp);
+      _nurbs_control_points.push_back(cp);
       cp.X = x1, cp.Y = y1;
-      nurbs_control_points.push_back(cp);
+      _nurbs_control_points.push_back(cp);
       cp.X = x2, cp.Y = y2;
-      nurbs_control_points.push_back(cp);
-      NURBS_FEED(block->line_number, nurbs_control_points, 3);
-      nurbs_control_points.clear();
+      _nurbs_control_points.push_back(cp);
+      NURBS_FEED(block->line_number, _nurbs_control_points, 3);
+      _nurbs_control_points.clear();
       settings->current_x = x2;
       settings->current_y = y2;
     } else {
@@ -265,15 +262,15 @@ int Interp::convert_spline(int mode,
 
       cp.W = 1;
       cp.X = settings->current_x, cp.Y = settings->current_y;
-      nurbs_control_points.push_back(cp);
+      _nurbs_control_points.push_back(cp);
       cp.X = x1, cp.Y = y1;
-      nurbs_control_points.push_back(cp);
+      _nurbs_control_points.push_back(cp);
       cp.X = x2, cp.Y = y2;
-      nurbs_control_points.push_back(cp);
+      _nurbs_control_points.push_back(cp);
       cp.X = x3, cp.Y = y3;
-      nurbs_control_points.push_back(cp);
-      NURBS_FEED(block->line_number, nurbs_control_points, 4);
-      nurbs_control_points.clear();
+      _nurbs_control_points.push_back(cp);
+      NURBS_FEED(block->line_number, _nurbs_control_points, 4);
+      _nurbs_control_points.clear();
 
       settings->cycle_i = -block->p_number;
       settings->cycle_j = -block->q_number;
@@ -707,7 +704,7 @@ int Interp::convert_arc_comp1(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
                               0, 0, 0,
                               cx, cy, cz,
                               AA_end, BB_end, CC_end, u_end, v_end, w_end);
-        set_endpoint(cx, cy);
+        set_endpoint(settings, cx, cy);
     }
     
     enqueue_ARC_FEED(settings, block->line_number, 
@@ -848,7 +845,7 @@ int Interp::convert_arc_comp2(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
         (fabs(beta - M_PI) < small_ && !TOOL_INSIDE_ARC(side, turn))
         ) {
         // concave
-        if (qc().front().type != QARC_FEED) {
+        if (qc(settings).front().type != QARC_FEED) {
             // line->arc
             double cy = arc_radius * sin(beta - M_PI_2);
             double toward_nominal;
@@ -884,7 +881,7 @@ int Interp::convert_arc_comp2(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
             CHP(move_endpoint_and_flush(settings, midx, midy));
         } else {
             // arc->arc
-            struct arc_feed &prev = qc().front().data.arc_feed;
+            struct arc_feed &prev = qc(settings).front().data.arc_feed;
             double oldrad = hypot(prev.center2 - prev.end2, prev.center1 - prev.end1);
             double newrad;
             if TOOL_INSIDE_ARC(side, turn) {
@@ -935,14 +932,14 @@ int Interp::convert_arc_comp2(int move,  //!< either G_2 (cw arc) or G_3 (ccw ar
                          cz,
                          AA_end, BB_end, CC_end, u, v, w);
         dequeue_canons(settings);
-        set_endpoint(midx, midy);
+        set_endpoint(settings, midx, midy);
         enqueue_ARC_FEED(settings, block->line_number, 
                          find_turn(opx, opy, centerx, centery, turn, end_x, end_y),
                          new_end_x, new_end_y, centerx, centery, turn, end_z,
                          AA_end, BB_end, CC_end, u, v, w);
     } else {                      /* convex, one arc needed */
         dequeue_canons(settings);
-        set_endpoint(cx, cy);
+        set_endpoint(settings, cx, cy);
         enqueue_ARC_FEED(settings, block->line_number, 
                          find_turn(opx, opy, centerx, centery, turn, end_x, end_y),
                          new_end_x, new_end_y, centerx, centery, turn, end_z,
@@ -1426,7 +1423,7 @@ int Interp::convert_comment(char *comment)       //!< string with comment
       return INTERP_OK;
   }
   // else it's a real comment
-  enqueue_COMMENT(comment + start);
+  enqueue_COMMENT(&_setup, comment + start);
   return INTERP_OK;
 }
 
@@ -1618,7 +1615,7 @@ int Interp::convert_coordinate_system(int g_code,        //!< g_code called (mus
 
   if (origin == settings->origin_index) {       /* already using this origin */
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: continuing to use same coordinate system");
+    enqueue_COMMENT(settings, "interpreter: continuing to use same coordinate system");
 #endif
     return INTERP_OK;
   }
@@ -1724,7 +1721,7 @@ Called by: convert_cutter_compensation
 int Interp::convert_cutter_compensation_off(setup_pointer settings)      //!< pointer to machine settings
 {
 #ifdef DEBUG_EMC
-  enqueue_COMMENT("interpreter: cutter radius compensation off");
+  enqueue_COMMENT(settings, "interpreter: cutter radius compensation off");
 #endif
   if(settings->cutter_comp_side != OFF && settings->cutter_comp_radius > 0.0) {
       double cx, cy, cz;
@@ -1846,9 +1843,9 @@ int Interp::convert_cutter_compensation_on(int side,     //!< side of path cutte
   }
 #ifdef DEBUG_EMC
   if (side == RIGHT)
-    enqueue_COMMENT("interpreter: cutter radius compensation on right");
+    enqueue_COMMENT(settings, "interpreter: cutter radius compensation on right");
   else
-    enqueue_COMMENT("interpreter: cutter radius compensation on left");
+    enqueue_COMMENT(settings, "interpreter: cutter radius compensation on left");
 #endif
 
   settings->cutter_comp_radius = radius;
@@ -1888,14 +1885,14 @@ int Interp::convert_distance_mode(int g_code,    //!< g_code being executed (mus
   if (g_code == G_90) {
     if (settings->distance_mode != MODE_ABSOLUTE) {
 #ifdef DEBUG_EMC
-      enqueue_COMMENT("interpreter: distance mode changed to absolute");
+      enqueue_COMMENT(settings, "interpreter: distance mode changed to absolute");
 #endif
       settings->distance_mode = MODE_ABSOLUTE;
     }
   } else if (g_code == G_91) {
     if (settings->distance_mode != MODE_INCREMENTAL) {
 #ifdef DEBUG_EMC
-      enqueue_COMMENT("interpreter: distance mode changed to incremental");
+      enqueue_COMMENT(settings, "interpreter: distance mode changed to incremental");
 #endif
       settings->distance_mode = MODE_INCREMENTAL;
     }
@@ -1935,14 +1932,14 @@ int Interp::convert_ijk_distance_mode(int g_code,    //!< g_code being executed
   if (g_code == G_90_1) {
     if (settings->ijk_distance_mode != MODE_ABSOLUTE) {
 #ifdef DEBUG_EMC
-      enqueue_COMMENT("interpreter: IJK distance mode changed to absolute");
+      enqueue_COMMENT(settings, "interpreter: IJK distance mode changed to absolute");
 #endif
       settings->ijk_distance_mode = MODE_ABSOLUTE;
     }
   } else if (g_code == G_91_1) {
     if (settings->ijk_distance_mode != MODE_INCREMENTAL) {
 #ifdef DEBUG_EMC
-      enqueue_COMMENT("interpreter: IJK distance mode changed to incremental");
+      enqueue_COMMENT(settings, "interpreter: IJK distance mode changed to incremental");
 #endif
       settings->ijk_distance_mode = MODE_INCREMENTAL;
     }
@@ -2030,7 +2027,7 @@ Called by: convert_g.
 
 int Interp::convert_dwell(setup_pointer settings, double time)   //!< time in seconds to dwell  */
 {
-  enqueue_DWELL(time);
+  enqueue_DWELL(settings, time);
   return INTERP_OK;
 }
 
@@ -2061,27 +2058,27 @@ int Interp::convert_feed_mode(int g_code,        //!< g_code being executed (mus
 {
   if (g_code == G_93) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: feed mode set to inverse time");
+    enqueue_COMMENT(settings, "interpreter: feed mode set to inverse time");
 #endif
     settings->feed_mode = INVERSE_TIME;
-    enqueue_SET_FEED_MODE(0);
+    enqueue_SET_FEED_MODE(settings, 0);
   } else if (g_code == G_94) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: feed mode set to units per minute");
+    enqueue_COMMENT(settings, "interpreter: feed mode set to units per minute");
 #endif
     settings->feed_mode = UNITS_PER_MINUTE;
-    enqueue_SET_FEED_MODE(0);
+    enqueue_SET_FEED_MODE(settings, 0);
     settings->feed_rate = 0.0;
-    enqueue_SET_FEED_RATE(0);
+    enqueue_SET_FEED_RATE(settings, 0);
   } else if(g_code == G_95) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: feed mode set to units per revolution");
+    enqueue_COMMENT(settings, "interpreter: feed mode set to units per revolution");
 #endif
     ERS("G95 set units per revolution mode is not supported. Use G33 or G76.\n");
     //settings->feed_mode = UNITS_PER_REVOLUTION;
-    //enqueue_SET_FEED_MODE(1);
+    //enqueue_SET_FEED_MODE(settings, 1);
     //settings->feed_rate = 0.0;
-    //enqueue_SET_FEED_RATE(0);
+    //enqueue_SET_FEED_RATE(settings, 0);
   } else
     ERS("BUG: Code not G93, G94, or G95");
   return INTERP_OK;
@@ -2108,7 +2105,7 @@ int Interp::convert_feed_rate(block_pointer block,       //!< pointer to a block
                              setup_pointer settings)    //!< pointer to machine settings             
 {
   settings->feed_rate = block->f_number;
-  enqueue_SET_FEED_RATE(block->f_number);
+  enqueue_SET_FEED_RATE(settings, block->f_number);
   return INTERP_OK;
 }
 
@@ -2468,7 +2465,7 @@ int Interp::convert_length_units(int g_code,     //!< g_code being executed (mus
       settings->program_x = (settings->program_x * INCH_PER_MM);
       settings->program_y = (settings->program_y * INCH_PER_MM);
       settings->program_z = (settings->program_z * INCH_PER_MM);
-      qc_scale(INCH_PER_MM);
+      qc_scale(settings, INCH_PER_MM);
       settings->cutter_comp_radius *= INCH_PER_MM;
       settings->axis_offset_x = (settings->axis_offset_x * INCH_PER_MM);
       settings->axis_offset_y = (settings->axis_offset_y * INCH_PER_MM);
@@ -2508,7 +2505,7 @@ int Interp::convert_length_units(int g_code,     //!< g_code being executed (mus
       settings->program_x = (settings->program_x * MM_PER_INCH);
       settings->program_y = (settings->program_y * MM_PER_INCH);
       settings->program_z = (settings->program_z * MM_PER_INCH);
-      qc_scale(MM_PER_INCH);
+      qc_scale(settings, MM_PER_INCH);
       settings->cutter_comp_radius *= MM_PER_INCH;
       settings->axis_offset_x = (settings->axis_offset_x * MM_PER_INCH);
       settings->axis_offset_y = (settings->axis_offset_y * MM_PER_INCH);
@@ -2709,16 +2706,19 @@ int Interp::convert_m(block_pointer block,       //!< pointer to a block of RS27
     // and then not worry about it through the program.  When you
     // finally unload the last tool, G43 mode is canceled.
 
+    write_active(settings);
     if(settings->active_g_codes[9] == G_43) {
         if(settings->selected_tool_slot > 0) {
-            struct block_struct g43;
+            struct block_struct g43 = block_struct();
             init_block(&g43);
             block->g_modes[_gees[G_43]] = G_43;
+            block->g_dirty |= 1 << _gees[G_43];
             CHP(convert_tool_length_offset(G_43, &g43, settings));
         } else {
-            struct block_struct g49;
+            struct block_struct g49 = block_struct();
             init_block(&g49);
             block->g_modes[_gees[G_49]] = G_49;
+            block->g_dirty |= 1 << _gees[G_49];
             CHP(convert_tool_length_offset(G_49, &g49, settings));
         }
     }
@@ -2726,26 +2726,26 @@ int Interp::convert_m(block_pointer block,       //!< pointer to a block of RS27
   }
 
   if (block->m_modes[7] == 3) {
-      enqueue_START_SPINDLE_CLOCKWISE();
+      enqueue_START_SPINDLE_CLOCKWISE(settings);
       settings->spindle_turning = CANON_CLOCKWISE;
   } else if (block->m_modes[7] == 4) {
-      enqueue_START_SPINDLE_COUNTERCLOCKWISE();
+      enqueue_START_SPINDLE_COUNTERCLOCKWISE(settings);
       settings->spindle_turning = CANON_COUNTERCLOCKWISE;
   } else if (block->m_modes[7] == 5) {
-      enqueue_STOP_SPINDLE_TURNING();
+      enqueue_STOP_SPINDLE_TURNING(settings);
       settings->spindle_turning = CANON_STOPPED;
   }
 
   if (block->m_modes[8] == 7) {
-      enqueue_MIST_ON();
+      enqueue_MIST_ON(settings);
       settings->mist = ON;
   } else if (block->m_modes[8] == 8) {
-      enqueue_FLOOD_ON();
+      enqueue_FLOOD_ON(settings);
       settings->flood = ON;
   } else if (block->m_modes[8] == 9) {
-      enqueue_MIST_OFF();
+      enqueue_MIST_OFF(settings);
       settings->mist = OFF;
-      enqueue_FLOOD_OFF();
+      enqueue_FLOOD_OFF(settings);
       settings->flood = OFF;
   }
 
@@ -2841,7 +2841,7 @@ int Interp::convert_m(block_pointer block,       //!< pointer to a block of RS27
   /* user-defined M codes */
   if (block->m_modes[10] != -1) {
     int index = block->m_modes[10];
-    enqueue_M_USER_COMMAND(index,block->p_number,block->q_number);
+    enqueue_M_USER_COMMAND(settings, index,block->p_number,block->q_number);
   }
   return INTERP_OK;
 }
@@ -2933,7 +2933,7 @@ int Interp::convert_motion(int motion,   //!< g_code for a line, arc, canned cyc
     CHP(convert_probe(block, motion, settings));
   } else if (motion == G_80) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: motion mode set to none");
+    enqueue_COMMENT(settings, "interpreter: motion mode set to none");
 #endif
     settings->motion_mode = G_80;
   } else if (motion == G_73 || ((motion > G_80) && (motion < G_90))) {
@@ -3068,12 +3068,12 @@ int Interp::convert_retract_mode(int g_code,     //!< g_code being executed (mus
        (EMC_I18N("Cannot change retract mode with cutter radius compensation on")));
   if (g_code == G_98) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: retract mode set to old_z");
+    enqueue_COMMENT(settings, "interpreter: retract mode set to old_z");
 #endif
     settings->retract_mode = OLD_Z;
   } else if (g_code == G_99) {
 #ifdef DEBUG_EMC
-    enqueue_COMMENT("interpreter: retract mode set to r_plane");
+    enqueue_COMMENT(settings, "interpreter: retract mode set to r_plane");
 #endif
     settings->retract_mode = R_PLANE;
   } else
@@ -3417,7 +3417,7 @@ int Interp::convert_setup(block_pointer block,   //!< pointer to a block of RS27
   }
 #ifdef DEBUG_EMC
   else
-    enqueue_COMMENT("interpreter: setting coordinate system origin");
+    enqueue_COMMENT(settings, "interpreter: setting coordinate system origin");
 #endif
   return INTERP_OK;
 }
@@ -3495,7 +3495,7 @@ Called by: execute_block.
 int Interp::convert_speed(block_pointer block,   //!< pointer to a block of RS274 instructions
                          setup_pointer settings)        //!< pointer to machine settings             
 {
-  enqueue_SET_SPINDLE_SPEED(block->s_number);
+  enqueue_SET_SPINDLE_SPEED(settings, block->s_number);
   settings->speed = block->s_number;
   return INTERP_OK;
 }
@@ -3503,12 +3503,12 @@ int Interp::convert_speed(block_pointer block,   //!< pointer to a block of RS27
 int Interp::convert_spindle_mode(block_pointer block, setup_pointer settings)
 {
     if(block->g_modes[14] == G_97) {
-	enqueue_SET_SPINDLE_MODE(0);
+	enqueue_SET_SPINDLE_MODE(settings, 0);
     } else { /* G_96 */
 	if(block->d_flag)
-	    enqueue_SET_SPINDLE_MODE(block->d_number_float);
+	    enqueue_SET_SPINDLE_MODE(settings, block->d_number_float);
 	else
-	    enqueue_SET_SPINDLE_MODE(1e30);
+	    enqueue_SET_SPINDLE_MODE(settings, 1e30);
     }
     return INTERP_OK;
 }
@@ -3692,7 +3692,7 @@ int Interp::convert_stop(block_pointer block,    //!< pointer to a block of RS27
       line = _setup.linetext;
       for (;;) {                /* check for ending percent sign and comment if missing */
         if (fgets(line, LINELEN, _setup.file_pointer) == NULL) {
-          enqueue_COMMENT("interpreter: percent sign missing from end of file");
+          enqueue_COMMENT(settings, "interpreter: percent sign missing from end of file");
           break;
         }
         length = strlen(line);
@@ -4098,7 +4098,7 @@ int Interp::convert_straight_comp1(int move,     //!< either G_0 or G_1
     // they cannot get reversed because they are guaranteed to be long
     // enough.
 
-    set_endpoint(cx, cy);
+    set_endpoint(settings, cx, cy);
 
     if (move == G_0) {
         enqueue_STRAIGHT_TRAVERSE(settings, block->line_number, 
@@ -4261,9 +4261,9 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
         if ((beta < -small_) || (beta > (M_PI + small_))) {
             concave = 1;
         } else if (beta > (M_PI - small_) && 
-                   (!qc().empty() && qc().front().type == QARC_FEED && 
-                    ((side == RIGHT && qc().front().data.arc_feed.turn == 1) || 
-                     (side == LEFT && qc().front().data.arc_feed.turn == -1)))) {
+                   (!qc(settings).empty() && qc(settings).front().type == QARC_FEED && 
+                    ((side == RIGHT && qc(settings).front().data.arc_feed.turn == 1) || 
+                     (side == LEFT && qc(settings).front().data.arc_feed.turn == -1)))) {
             // this is an "h" shape, tool on right, going right to left
             // over the hemispherical round part, then up next to the
             // vertical part (or, the mirror case).  there are two ways
@@ -4285,7 +4285,7 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
                                  ((side == LEFT) ? -1 : 1), cz,
                                  AA_end, BB_end, CC_end, u_end, v_end, w_end);
                 dequeue_canons(settings);
-                set_endpoint(mid_x, mid_y);
+                set_endpoint(settings, mid_x, mid_y);
             } else if(move == G_0) {
                 // we can't go around the corner because there is no
                 // arc traverse.  but, if we do this anyway, at least
@@ -4298,10 +4298,10 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
                                           AA_end, BB_end, CC_end,
                                           u_end, v_end, w_end);
                 dequeue_canons(settings);
-                set_endpoint(mid_x, mid_y);
+                set_endpoint(settings, mid_x, mid_y);
             } else ERS(NCE_BUG_CODE_NOT_G0_OR_G1);
         } else if (concave) {
-            if (qc().front().type != QARC_FEED) {
+            if (qc(settings).front().type != QARC_FEED) {
                 // line->line
                 double retreat;
                 // half the angle of the inside corner
@@ -4318,7 +4318,7 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
             } else {
                 // arc->line
                 // beware: the arc we saved is the compensated one.
-                arc_feed prev = qc().front().data.arc_feed;
+                arc_feed prev = qc(settings).front().data.arc_feed;
                 double oldrad = hypot(prev.center2 - prev.end2, prev.center1 - prev.end1);
                 double oldrad_uncomp;
 
@@ -4365,7 +4365,7 @@ int Interp::convert_straight_comp2(int move,     //!< either G_0 or G_1
         } else {
             // no arc needed, also not concave (colinear lines or tangent arc->line)
             dequeue_canons(settings);
-            set_endpoint(cx, cy);
+            set_endpoint(settings, cx, cy);
         }
         (move == G_0? enqueue_STRAIGHT_TRAVERSE: enqueue_STRAIGHT_FEED)
             (settings, block->line_number, 
@@ -133,6 +133,9 @@ hole.
 
 For the XZ and YZ planes, this makes analogous motions.
 
+The whole hole is sent as one DRILL_CYCLE command, see cycle_drill.
+Only a hole that does not go below R is written out move by move.
+
 */
 
 int Interp::convert_cycle_g83(block_pointer block,
@@ -156,6 +159,9 @@ int Interp::convert_cycle_g83(block_pointer block,
   if (_setup.length_units == CANON_UNITS_MM)
     rapid_delta = (rapid_delta * 25.4);
 
+  if (bottom_z < r)
+    return cycle_drill(block, plane, x, y, bottom_z, clear_z - r, delta, rapid_delta, 0);
+
   for (current_depth = (r - delta);
        current_depth > bottom_z; current_depth = (current_depth - delta)) {
     cycle_feed(block, plane, x, y, current_depth);
@@ -197,6 +203,9 @@ hole.
 
 For the XZ and YZ planes, this makes analogous motions.
 
+The whole hole is sent as one DRILL_CYCLE command, see cycle_drill.
+Only a hole that does not go below R is written out move by move.
+
 */
 
 int Interp::convert_cycle_g73(block_pointer block,
@@ -220,6 +229,9 @@ int Interp::convert_cycle_g73(block_pointer block,
   if (_setup.length_units == CANON_UNITS_MM)
     rapid_delta = (rapid_delta * 25.4);
 
+  if (bottom_z < r)
+    return cycle_drill(block, plane, x, y, bottom_z, clear_z - r, delta, rapid_delta, 1);
+
   for (current_depth = (r - delta);
        current_depth > bottom_z; current_depth = (current_depth - delta)) {
     cycle_feed(block, plane, x, y, current_depth);
@@ -752,6 +764,9 @@ does not require checking that the original z-position is above r.
 
 The rotary axes may not move during a canned cycle.
 
+If [RS274NGC] HOLE_ORDER_MS is set, a hole that may be drilled out of
+order is handed to hole_order_hold before any move is made for it.
+
 */
 
 int Interp::convert_cycle_xy(int motion, //!< a g-code between G_81 and G_89, a canned cycle
@@ -773,6 +788,7 @@ int Interp::convert_cycle_xy(int motion, //!< a g-code between G_81 and G_89, a
   CANON_PLANE plane;
   double r;
   int repeat;
+  int held;
   CANON_MOTION_MODE save_mode;
   double save_tolerance;
 
@@ -819,6 +835,10 @@ int Interp::convert_cycle_xy(int motion, //!< a g-code between G_81 and G_89, a
     ERS(NCE_BUG_DISTANCE_MODE_NOT_G90_OR_G91);
   CHKS((r < cc), NCE_R_LESS_THAN_Z_IN_CYCLE_IN_XY_PLANE);
 
+  CHP(hole_order_hold(motion, aa, bb, r, cc, old_cc, &held));
+  if (held)
+    return INTERP_OK;           /* drilled later, see interp_holes.cc */
+
   if (old_cc < r) {
     STRAIGHT_TRAVERSE(block->line_number, settings->current_x, settings->current_y, r,
                       settings->AA_current, settings->BB_current, settings->CC_current, 
@@ -1845,6 +1865,66 @@ int Interp::convert_cycle_wu(int motion, //!< a g-code between G_81 and G_89, a
 }
 /****************************************************************************/
 
+/*! cycle_drill
+
+Returned Value: int (INTERP_OK)
+
+Side effects:
+  DRILL_CYCLE is called.
+
+Called by:
+  convert_cycle_g73
+  convert_cycle_g83
+
+This writes a DRILL_CYCLE command from the current point, the R plane,
+down to the bottom of the hole given with respect to the plane. The
+pecks are expanded downstream, so a hole is one command however many
+pecks it takes. No rotary axis motion takes place.
+
+*/
+
+int Interp::cycle_drill(block_pointer block,
+                        CANON_PLANE plane,       //!< currently selected plane  
+                        double end1,     //!< first coordinate value    
+                        double end2,     //!< second coordinate value   
+                        double end3,     //!< third coordinate value, hole bottom
+                        double clear,    //!< clear plane above the R plane
+                        double delta,    //!< peck depth
+                        double retract,  //!< G73 back off, G83 stop short of the last peck
+                        int chip_break)  //!< 1 for G73, 0 for G83
+{
+    if (plane == CANON_PLANE_XY)
+        DRILL_CYCLE(block->line_number, chip_break, end1, end2, end3,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    _setup.u_current, _setup.v_current, _setup.w_current,
+                    clear, delta, retract);
+    else if (plane == CANON_PLANE_YZ)
+        DRILL_CYCLE(block->line_number, chip_break, end3, end1, end2,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    _setup.u_current, _setup.v_current, _setup.w_current,
+                    clear, delta, retract);
+    else if (plane == CANON_PLANE_XZ)
+        DRILL_CYCLE(block->line_number, chip_break, end2, end3, end1,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    _setup.u_current, _setup.v_current, _setup.w_current,
+                    clear, delta, retract);
+    else if (plane == CANON_PLANE_UV)
+        DRILL_CYCLE(block->line_number, chip_break, _setup.current_x, _setup.current_y, _setup.current_z,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    end1, end2, end3, clear, delta, retract);
+    else if (plane == CANON_PLANE_VW)
+        DRILL_CYCLE(block->line_number, chip_break, _setup.current_x, _setup.current_y, _setup.current_z,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    end3, end1, end2, clear, delta, retract);
+    else // (plane == CANON_PLANE_UW)
+        DRILL_CYCLE(block->line_number, chip_break, _setup.current_x, _setup.current_y, _setup.current_z,
+                    _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                    end2, end3, end1, clear, delta, retract);
+    return INTERP_OK;
+}
+
+/****************************************************************************/
+
 /*! cycle_feed
 
 Returned Value: int (INTERP_OK)
@@ -0,0 +1,474 @@
+/********************************************************************
+* Description: interp_holes.cc
+*
+*   Hole order optimisation for canned cycles.
+*
+*   Simple post processors write drilling programs as one G81..G89
+*   block followed by a list of X/Y positions in whatever order the
+*   holes were drawn. When [RS274NGC] HOLE_ORDER_MS is set, such a run
+*   of holes is held back instead of being drilled block by block. When
+*   the run ends, the holes are put in a shorter order with a nearest
+*   neighbour tour improved by 2-opt, and drilled.
+*
+*   A run only takes holes that are drilled exactly alike: same cycle,
+*   R plane, retract plane (see convert_retract_mode), bottom, dwell,
+*   peck and feed. Any block that would do something other than add a
+*   hole ends the run first, so nothing else is reordered. The last hole
+*   of the run is always drilled last, which leaves the machine where
+*   the interpreter already thinks it is. The moves between holes stay
+*   at the height the program used for them.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rs274ngc.h"
+#include "rs274ngc_return.h"
+#include "interp_internal.h"
+#include "rs274ngc_interp.h"
+
+/* Length of the moves from the start of the run through holes h[0] .. h[cnt-1]. */
+static double _hole_path(hole_run * hr, hole * h)
+{
+   double len = 0.0, x = hr->start_x, y = hr->start_y;
+   int i;
+
+   for (i = 0; i < hr->cnt; i++)
+   {
+      len += hypot(h[i].x - x, h[i].y - y);
+      x = h[i].x;
+      y = h[i].y;
+   }
+   return len;
+}
+
+/* Return 1 once the time budget ending at end is used up. */
+static int _hole_order_late(const struct timespec *end)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (now.tv_sec > end->tv_sec || (now.tv_sec == end->tv_sec && now.tv_nsec >= end->tv_nsec));
+}
+
+/****************************************************************************/
+
+/*! hole_order_tour
+
+Returned Value: none
+
+Side Effects:
+   The held holes are put in a shorter order if one is found within
+   HOLE_ORDER_MS milliseconds. The saved distance is added to
+   _hole_order_saved.
+
+Called By: hole_order_flush
+
+The tour starts where the tool was before the first hole and ends at
+the last hole of the run, which stays fixed. A nearest neighbour tour
+is built first, then 2-opt reverses any stretch of it that makes the
+tour shorter until no such stretch is left. If time runs out the
+holes not yet placed keep their program order. The new order is only
+used if it is shorter than the program order.
+
+*/
+
+void Interp::hole_order_tour(hole_run * hr)
+{
+   struct timespec end;
+   hole *t = hr->tour;
+   hole tmp;
+   int n = hr->cnt - 1;         /* holes that may move */
+   int i, j, k, improved;
+   double x, y, d, best, before, after;
+
+   if (n < 2)
+      return;
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+   end.tv_sec += _hole_order_ms / 1000;
+   end.tv_nsec += (_hole_order_ms % 1000) * 1000000L;
+   if (end.tv_nsec >= 1000000000L)
+   {
+      end.tv_sec++;
+      end.tv_nsec -= 1000000000L;
+   }
+
+   memcpy(t, hr->held, hr->cnt * sizeof(hole));
+
+   /* Nearest neighbour. */
+   x = hr->start_x;
+   y = hr->start_y;
+   for (i = 0; i < n - 1 && !_hole_order_late(&end); i++)
+   {
+      k = i;
+      best = hypot(t[i].x - x, t[i].y - y);
+      for (j = i + 1; j < n; j++)
+      {
+         d = hypot(t[j].x - x, t[j].y - y);
+         if (d < best)
+         {
+            best = d;
+            k = j;
+         }
+      }
+      tmp = t[i];
+      t[i] = t[k];
+      t[k] = tmp;
+      x = t[i].x;
+      y = t[i].y;
+   }
+
+   /* 2-opt, t[n] is the fixed last hole. */
+   do
+   {
+      improved = 0;
+      for (i = 0; i < n - 1 && !_hole_order_late(&end); i++)
+      {
+         x = i ? t[i - 1].x : hr->start_x;
+         y = i ? t[i - 1].y : hr->start_y;
+         for (j = i + 1; j < n; j++)
+         {
+            d = hypot(t[j].x - x, t[j].y - y) + hypot(t[j + 1].x - t[i].x, t[j + 1].y - t[i].y)
+               - hypot(t[i].x - x, t[i].y - y) - hypot(t[j + 1].x - t[j].x, t[j + 1].y - t[j].y);
+            if (d < -1e-9)
+            {
+               for (k = 0; k < (j - i + 1) / 2; k++)
+               {
+                  tmp = t[i + k];
+                  t[i + k] = t[j - k];
+                  t[j - k] = tmp;
+               }
+               improved = 1;
+            }
+         }
+      }
+   }
+   while (improved && !_hole_order_late(&end));
+
+   before = _hole_path(hr, hr->held);
+   after = _hole_path(hr, t);
+   DBG("hole_order_tour() holes=%d rapid=%0.4f reordered=%0.4f\n", hr->cnt, before, after);
+   if (after >= before)
+      return;
+
+   memcpy(hr->held, t, hr->cnt * sizeof(hole));
+   if (_setup.length_units == CANON_UNITS_INCHES)
+      _hole_order_saved += (before - after) * 25.4;
+   else if (_setup.length_units == CANON_UNITS_CM)
+      _hole_order_saved += (before - after) * 10.0;
+   else
+      _hole_order_saved += before - after;
+}
+
+/****************************************************************************/
+
+/*! hole_order_grow
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if memory runs out.
+
+Side Effects:
+   The hole run is allocated if there is none, and made room for
+   HOLE_ORDER_ALLOC_UNIT more holes if it is full.
+
+Called By: hole_order_hold
+
+*/
+
+int Interp::hole_order_grow()
+{
+   hole_run *hr = _holes;
+   hole *h;
+
+   if (hr == NULL)
+   {
+      if ((hr = (hole_run *) calloc(1, sizeof(hole_run))) == NULL)
+         ERS(NCE_OUT_OF_MEMORY);
+      _holes = hr;
+   }
+
+   if (hr->cnt == hr->max)
+   {
+      if ((h = (hole *) realloc(hr->held, (hr->max + HOLE_ORDER_ALLOC_UNIT) * sizeof(hole))) == NULL)
+         ERS(NCE_OUT_OF_MEMORY);
+      hr->held = h;
+      if ((h = (hole *) realloc(hr->tour, (hr->max + HOLE_ORDER_ALLOC_UNIT) * sizeof(hole))) == NULL)
+         ERS(NCE_OUT_OF_MEMORY);
+      hr->tour = h;
+      hr->max += HOLE_ORDER_ALLOC_UNIT;
+   }
+   return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! hole_order_hold
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if memory runs out. If the run that was
+   held before has to be drilled first, any error from that.
+
+Side Effects:
+   If the hole can go into the run, it is added and *held is set. The
+   interpreter position and cycle settings are updated as if the hole
+   had been drilled. Otherwise the held run, if any, is drilled and
+   *held is cleared.
+
+Called By: convert_cycle_xy, with the block in _setup.block1
+
+Only absolute G81, G82, G83, G73, G85 and G89 holes without repeats are
+held. The other cycles stop or reverse the spindle, which is left to
+the program order. A hole is held before any move is made for it, so
+the R plane move of the first hole is made by hole_order_flush.
+
+*/
+
+int Interp::hole_order_hold(int motion, double x, double y, double r, double bottom, double old_z, int *held)
+{
+   block_pointer block = &_setup.block1;
+   setup_pointer settings = &_setup;
+   hole_run *hr = _holes;
+   hole *h;
+   double p = 0.0, q = 0.0, clear;
+
+   *held = 0;
+
+   if (_hole_order_ms <= 0 || settings->distance_mode != MODE_ABSOLUTE || block->l_number != 1)
+      return hole_order_flush();
+
+   switch (motion)
+   {
+   case G_82:
+   case G_89:
+      if (settings->motion_mode != motion && block->p_number == -1.0)
+         return hole_order_flush();     /* let convert_cycle_xy report it */
+      p = (block->p_number == -1.0) ? settings->cycle_p : block->p_number;
+      break;
+   case G_83:
+   case G_73:
+      if (settings->motion_mode != motion && block->q_number == -1.0)
+         return hole_order_flush();
+      q = (block->q_number == -1.0) ? settings->cycle_q : block->q_number;
+      if (q <= 0.0)
+         return hole_order_flush();
+      break;
+   case G_81:
+   case G_85:
+      break;
+   default:
+      return hole_order_flush();
+   }
+   clear = (settings->retract_mode == R_PLANE || old_z < r) ? r : old_z;
+
+   if (hr != NULL && hr->cnt > 0)
+   {
+      if (hr->motion != motion || hr->r != r || hr->bottom != bottom || hr->clear != clear ||
+          hr->p != p || hr->q != q || hr->feed_rate != settings->feed_rate || old_z != clear)
+         CHP(hole_order_flush());
+   }
+
+   CHP(hole_order_grow());
+   hr = _holes;
+
+   if (hr->cnt == 0)
+   {
+      hr->motion = motion;
+      hr->start_x = settings->current_x;
+      hr->start_y = settings->current_y;
+      hr->start_z = old_z;
+      hr->r = r;
+      hr->clear = clear;
+      hr->bottom = bottom;
+      hr->p = p;
+      hr->q = q;
+      hr->feed_rate = settings->feed_rate;
+   }
+
+   h = &hr->held[hr->cnt++];
+   h->x = x;
+   h->y = y;
+   h->line_number = block->line_number;
+
+   if (motion == G_82 || motion == G_89)
+      settings->cycle_p = p;
+   else if (motion == G_83 || motion == G_73)
+      settings->cycle_q = q;
+   settings->current_x = x;
+   settings->current_y = y;
+   settings->current_z = clear;
+   settings->cycle_cc = block->z_number;
+
+   *held = 1;
+   return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! hole_order_continues
+
+Returned Value: int
+   1 if executing block can at most add a hole to the held run, else 0.
+
+Called By: Interp::execute
+
+The block may repeat the cycle g-code and its z, r, p, q and f words,
+hole_order_hold compares the values. Anything else may make a canon
+call, which has to come after the held holes.
+
+*/
+
+int Interp::hole_order_continues(block_pointer block)
+{
+   int i;
+
+   if (block->comment[0] != 0 || block->o_number != 0 || block->o_name != 0)
+      return 0;
+   for (i = 0; i < BLOCK_G_CODES; i++)
+   {
+      if (block->g_modes[i] != -1 && (i != 1 || block->g_modes[i] != _holes->motion))
+         return 0;
+   }
+   if (block->m_count != 0 || block->s_number > -1.0 || block->t_number != -1)
+      return 0;
+   if (block->f_number > -1.0 && block->f_number != _setup.feed_rate)
+      return 0;
+   if (block->a_flag || block->b_flag || block->c_flag || block->u_flag || block->v_flag || block->w_flag)
+      return 0;
+   if (block->i_flag || block->j_flag || block->k_flag || block->l_flag)
+      return 0;
+   if (block->d_flag || block->e_flag || block->h_flag)
+      return 0;
+   return (_setup.motion_mode == _holes->motion);
+}
+
+/****************************************************************************/
+
+/*! hole_order_flush
+
+Returned Value: int
+   INTERP_OK, or the first error from a cycle function.
+
+Side Effects:
+   The held holes are reordered and drilled, the run is emptied.
+
+Called By:
+   Interp::execute
+   hole_order_hold
+   preparse_execute
+   external programs, after an mdi command
+
+*/
+
+int Interp::hole_order_flush()
+{
+   hole_run *hr = _holes;
+   block_pointer block = &_setup.block1;
+   CANON_MOTION_MODE save_mode;
+   double save_tolerance, z;
+   hole *h;
+   int line_number, i, status = INTERP_OK;
+
+   if (hr == NULL || hr->cnt == 0)
+      return INTERP_OK;
+
+   hole_order_tour(hr);
+
+   /* The cycle functions take the line number from the block. */
+   line_number = block->line_number;
+
+   z = hr->start_z;
+   if (z < hr->r)
+   {
+      STRAIGHT_TRAVERSE(hr->held[0].line_number, hr->start_x, hr->start_y, hr->r,
+                        _setup.AA_current, _setup.BB_current, _setup.CC_current,
+                        _setup.u_current, _setup.v_current, _setup.w_current);
+      z = hr->r;
+   }
+
+   save_mode = GET_EXTERNAL_MOTION_CONTROL_MODE();
+   save_tolerance = GET_EXTERNAL_MOTION_CONTROL_TOLERANCE();
+   if (save_mode != CANON_EXACT_PATH)
+      SET_MOTION_CONTROL_MODE(CANON_EXACT_PATH, 0);
+
+   for (i = 0; i < hr->cnt && status == INTERP_OK; i++)
+   {
+      h = &hr->held[i];
+      block->line_number = h->line_number;
+      cycle_traverse(block, CANON_PLANE_XY, h->x, h->y, z);
+      if (z != hr->r)
+         cycle_traverse(block, CANON_PLANE_XY, h->x, h->y, hr->r);
+      switch (hr->motion)
+      {
+      case G_81:
+         status = convert_cycle_g81(block, CANON_PLANE_XY, h->x, h->y, hr->clear, hr->bottom);
+         break;
+      case G_82:
+         status = convert_cycle_g82(block, CANON_PLANE_XY, h->x, h->y, hr->clear, hr->bottom, hr->p);
+         break;
+      case G_83:
+         status = convert_cycle_g83(block, CANON_PLANE_XY, h->x, h->y, hr->r, hr->clear, hr->bottom, hr->q);
+         break;
+      case G_73:
+         status = convert_cycle_g73(block, CANON_PLANE_XY, h->x, h->y, hr->r, hr->clear, hr->bottom, hr->q);
+         break;
+      case G_85:
+         status = convert_cycle_g85(block, CANON_PLANE_XY, h->x, h->y, hr->clear, hr->bottom);
+         break;
+      default:         /* G_89 */
+         status = convert_cycle_g89(block, CANON_PLANE_XY, h->x, h->y, hr->clear, hr->bottom, hr->p);
+         break;
+      }
+      z = hr->clear;
+   }
+
+   if (save_mode != CANON_EXACT_PATH)
+      SET_MOTION_CONTROL_MODE(save_mode, save_tolerance);
+
+   block->line_number = line_number;
+   hr->cnt = 0;
+   return status;
+}
+
+/****************************************************************************/
+
+/*! hole_order_clear
+
+Returned Value: none
+
+Side Effects:
+   Held holes are dropped without being drilled.
+
+Called By:
+   Interp::reset
+   preparse_close
+
+*/
+
+void Interp::hole_order_clear()
+{
+   if (_holes != NULL)
+      _holes->cnt = 0;
+}
+
+/****************************************************************************/
+
+/*! hole_order_saved
+
+Returned Value: double
+   Rapid distance in mm saved by reordering holes since the interpreter
+   was created. Callers take the difference over a run.
+
+Called By: external programs
+
+*/
+
+double Interp::hole_order_saved()
+{
+   return _hole_order_saved;
+}
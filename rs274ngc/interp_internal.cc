@@ -238,61 +238,81 @@ The rules for the indicators for slots whose values may be read are:
 4. If the value is a character string (only the comment slot is one), the
    first character is set to 0 (NULL).
 
+The readers record which slots they wrote in block->dirty, g_dirty and
+m_dirty, so only those are reset here. A block that has never been through
+init_block (BLOCK_DIRTY_INIT clear, as in zeroed memory) is reset in full.
+A block must therefore be zeroed or value-initialized before its first use.
+
 */
 
 int Interp::init_block(block_pointer block)      //!< pointer to a block to be initialized or reset
 {
+  unsigned int mask;
   int n;
-  block->a_flag = OFF;
-  block->b_flag = OFF;
-  block->c_flag = OFF;
-  block->comment[0] = 0;
-  block->d_flag = OFF;
-  block->e_flag = OFF;
-  block->f_number = -1.0;
-  for (n = 0; n < 16; n++) {
-    block->g_modes[n] = -1;
+
+  if (!(block->dirty & BLOCK_DIRTY_INIT)) {
+    block->dirty = ~0U;
+    block->g_dirty = (1U << BLOCK_G_CODES) - 1;
+    block->m_dirty = (1U << BLOCK_M_CODES) - 1;
+  }
+
+  if (block->dirty & BLOCK_DIRTY_AXES) {
+    block->a_flag = OFF;
+    block->b_flag = OFF;
+    block->c_flag = OFF;
+    block->u_flag = OFF;
+    block->v_flag = OFF;
+    block->w_flag = OFF;
+    block->x_flag = OFF;
+    block->y_flag = OFF;
+    block->z_flag = OFF;
+  }
+  if (block->dirty & BLOCK_DIRTY_WORDS) {
+    block->comment[0] = 0;
+    block->d_flag = OFF;
+    block->e_flag = OFF;
+    block->f_number = -1.0;
+    block->h_flag = OFF;
+    block->h_number = -1;
+    block->i_flag = OFF;
+    block->j_flag = OFF;
+    block->k_flag = OFF;
+    block->l_flag = OFF;
+    block->p_number = -1.0;
+    block->p_flag = OFF;
+    block->q_flag = OFF;
+    block->q_number = -1.0;
+    block->r_flag = OFF;
+    block->s_number = -1.0;
+    block->t_number = -1;
+    block->theta_flag = OFF;
+    block->radius_flag = OFF;
+  }
+  for (n = 0, mask = block->g_dirty; mask; n++, mask >>= 1) {
+    if (mask & 1)
+      block->g_modes[n] = -1;
   }
-  block->h_flag = OFF;
-  block->h_number = -1;
-  block->i_flag = OFF;
-  block->j_flag = OFF;
-  block->k_flag = OFF;
+  for (n = 0, mask = block->m_dirty; mask; n++, mask >>= 1) {
+    if (mask & 1)
+      block->m_modes[n] = -1;
+  }
+
+  /* These are also written outside the readers, always reset them. */
   block->l_number = -1;
-  block->l_flag = OFF;
   block->line_number = -1;
   block->n_number = -1;
   block->motion_to_be = -1;
   block->m_count = 0;
-  for (n = 0; n < 11; n++) {
-    block->m_modes[n] = -1;
-  }
   block->user_m = 0;
-  block->p_number = -1.0;
-  block->p_flag = OFF;
-  block->q_flag = OFF;
-  block->q_number = -1.0;
-  block->r_flag = OFF;
-  block->s_number = -1.0;
-  block->t_number = -1;
-  block->u_flag = OFF;
-  block->v_flag = OFF;
-  block->w_flag = OFF;
-  block->x_flag = OFF;
-  block->y_flag = OFF;
-  block->z_flag = OFF;
-
-  block->theta_flag = OFF;
-  block->radius_flag = OFF;
 
   block->o_type = O_none;
   block->o_number = 0;
 
-  if(block->o_name)
-    {
-      free(block->o_name);
-      block->o_name = 0;
-    }
+  block->o_name = 0;           // owned by _setup.line_arena
+
+  block->dirty = BLOCK_DIRTY_INIT;
+  block->g_dirty = 0;
+  block->m_dirty = 0;
 
   return INTERP_OK;
 }
@@ -455,3 +475,93 @@ int Interp::set_probe_data(setup_pointer settings)       //!< pointer to machine
   return INTERP_OK;
 }
 
+/****************************************************************************/
+
+/*! string_arena_dup
+
+Returned Value: char *
+   A copy of s in the arena, or NULL if memory runs out or s does not
+   fit in a chunk.
+
+Side Effects:
+   The next chunk is taken, or allocated if there is none, when the
+   current one is full. Chunks are never given back before string_arena_free.
+
+Called By:
+   Interp::read_o
+   Interp::read_parameter_setting
+   Interp::add_named_param
+   Interp::convert_control_functions
+   enqueue_COMMENT
+
+*/
+
+char *string_arena_dup(string_arena * arena, const char *s)
+{
+  string_arena_chunk *chunk;
+  int len = strlen(s) + 1;
+  char *dup;
+
+  if(len > STRING_ARENA_CHUNK)
+    return NULL;
+
+  if(arena->cur == NULL || arena->used + len > STRING_ARENA_CHUNK)
+    {
+      chunk = arena->cur ? arena->cur->next : arena->head;
+      if(chunk == NULL)
+        {
+          if((chunk = (string_arena_chunk *) malloc(sizeof(string_arena_chunk))) == NULL)
+            return NULL;
+          chunk->next = NULL;
+          if(arena->cur)
+            arena->cur->next = chunk;
+          else
+            arena->head = chunk;
+        }
+      arena->cur = chunk;
+      arena->used = 0;
+    }
+
+  dup = arena->cur->text + arena->used;
+  memcpy(dup, s, len);
+  arena->used += len;
+  return dup;
+}
+
+/*! string_arena_reset
+
+Returned Value: none
+
+Side Effects:
+   All strings in the arena are released at once. The text is left in
+   place until it is overwritten by the next string_arena_dup.
+
+*/
+
+void string_arena_reset(string_arena * arena)
+{
+  arena->cur = NULL;
+  arena->used = 0;
+}
+
+/*! string_arena_free
+
+Returned Value: none
+
+Side Effects: The chunks of the arena are freed.
+
+Called By: Interp::~Interp
+
+*/
+
+void string_arena_free(string_arena * arena)
+{
+  string_arena_chunk *chunk;
+
+  while((chunk = arena->head) != NULL)
+    {
+      arena->head = chunk->next;
+      free(chunk);
+    }
+  string_arena_reset(arena);
+}
@@ -15,6 +15,9 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
+#include <vector>
 #include "canon.h"
 #include "emcpos.h"
 //#include "libintl.h"
@@ -260,7 +263,7 @@ typedef struct block_struct
    ON_OFF e_flag;
    double e_number;
    double f_number;
-   int g_modes[16];
+   int g_modes[BLOCK_G_CODES];
    ON_OFF h_flag;
    int h_number;
    ON_OFF i_flag;
@@ -275,7 +278,7 @@ typedef struct block_struct
    int n_number;
    int motion_to_be;
    int m_count;
-   int m_modes[11];
+   int m_modes[BLOCK_M_CODES];
    int user_m;
    double p_number;
    ON_OFF p_flag;
@@ -307,13 +310,177 @@ typedef struct block_struct
    long offset;                 // start of line in file
    int o_type;
    int o_number;
-   char *o_name;                // !!!KL be sure to free this
+   char *o_name;                // in _setup.line_arena, valid until the next line is parsed
    double params[INTERP_SUB_PARAMS];
+
+   // what the readers wrote since the last init_block(), see BLOCK_DIRTY_*
+   unsigned int dirty;
+   unsigned int g_dirty;        // bit n set if g_modes[n] was written
+   unsigned int m_dirty;        // bit n set if m_modes[n] was written
 }
 block;
 
+/* block_struct dirty bits */
+#define BLOCK_DIRTY_AXES  0x1   // a b c u v w x y z flags
+#define BLOCK_DIRTY_WORDS 0x2   // comment, d e f h i j k l p q r s t words, polar flags
+#define BLOCK_DIRTY_INIT  0x80000000    // block has been through init_block(), zeroed memory has not
+
 typedef block *block_pointer;
 
+/* Pre-parse batch, see interp_preparse.cc. Lines without parameters, expressions
+   or o-words are "pure" and are parsed up front by worker threads. */
+#define PREPARSE_BATCH_MIN 64          /* first batch is small so motion starts quickly */
+#define PREPARSE_BATCH_MAX 2048
+#define PREPARSE_THREADS_MAX 16
+
+typedef struct preparse_line_struct
+{
+   long end;                    // ftell() after this line, for pause/resume
+   int pure;                    // 1 = blk holds a valid pre-parsed line
+   int length;                  // length of block_text
+   char text[LINELEN];          // raw line as read from the file
+   char block_text[LINELEN];    // downcased line without spaces
+   block blk;
+}
+preparse_line;
+
+typedef struct preparse_struct
+{
+   FILE *inport;
+   int threads;                 // worker threads, 1 = pre-parse disabled
+   int batch;                   // size of the next batch
+   int cnt;                     // lines in current batch
+   int next;                    // next line to hand out
+   int lathe_diameter_mode;     // lathe mode the current batch was parsed with
+   preparse_line *line;
+}
+preparse;
+
+/* Interpreter state snapshot, see interp_snapshot.cc. Only the modal part of
+   _setup is kept; snapshots are not taken inside subroutines, o-word blocks
+   or cutter compensation, so there is no call stack to save. */
+#define SNAPSHOT_LINES_DEFAULT 1000
+
+typedef struct snapshot_struct
+{
+   long offset;                 // file offset of the next line
+   int line_number;             // sequence number of the next line
+   double *parameters;          // shared with the previous snapshot if unchanged
+   CANON_STATE canon;
+
+   double AA_axis_offset, AA_current, AA_origin_offset;
+   double BB_axis_offset, BB_current, BB_origin_offset;
+   double CC_axis_offset, CC_current, CC_origin_offset;
+   double u_axis_offset, u_current, u_origin_offset;
+   double v_axis_offset, v_current, v_origin_offset;
+   double w_axis_offset, w_current, w_origin_offset;
+   double axis_offset_x, axis_offset_y, axis_offset_z;
+   double origin_offset_x, origin_offset_y, origin_offset_z;
+   double current_x, current_y, current_z;
+   double program_x, program_y, program_z;
+   int active_g_codes[ACTIVE_G_CODES];
+   int active_m_codes[ACTIVE_M_CODES];
+   double active_settings[ACTIVE_SETTINGS];
+   ON_OFF arc_not_allowed;
+   CANON_MOTION_MODE control_mode;
+   int current_pocket;
+   int selected_pocket;
+   double cutter_comp_radius;
+   int cutter_comp_orientation;
+   int cutter_comp_side;        // always OFF in run-from-line snapshots
+   ON_OFF cutter_comp_firstmove;
+   double cycle_cc, cycle_i, cycle_j, cycle_k, cycle_p, cycle_q, cycle_r;
+   int cycle_l;
+   DISTANCE_MODE distance_mode;
+   DISTANCE_MODE ijk_distance_mode;
+   int feed_mode;
+   ON_OFF feed_override;
+   double feed_rate;
+   ON_OFF flood;
+   ON_OFF mist;
+   int tool_offset_index;
+   CANON_UNITS length_units;
+   int motion_mode;
+   int origin_index;
+   double rotation_xy;
+   CANON_PLANE plane;
+   RETRACT_MODE retract_mode;
+   double speed;
+   SPINDLE_MODE spindle_mode;
+   CANON_SPEED_FEED_MODE speed_feed_mode;
+   ON_OFF speed_override;
+   CANON_DIRECTION spindle_turning;
+   EmcPose tool_offset;
+   double traverse_rate;
+   ON_OFF adaptive_feed;
+   ON_OFF feed_hold;
+   ON_OFF lathe_diameter_mode;
+}
+snapshot;
+
+typedef struct snapshot_list_struct
+{
+   char filename[PATH_MAX];     // program the snapshots belong to
+   time_t mtime;                // program modification time and size, to catch edits
+   off_t size;
+   int next_line;               // first line another snapshot may be taken at
+   int cnt;
+   int max;
+   snapshot *snap;              // in increasing line order
+}
+snapshot_list;
+
+/* Canned cycle holes held back so they can be drilled in a shorter order,
+   see interp_holes.cc. Every hole of a run shares the cycle, its z levels
+   and its dwell or peck, only x and y differ. */
+#define HOLE_ORDER_ALLOC_UNIT 64
+
+typedef struct hole_struct
+{
+   double x, y;
+   int line_number;             // sequence number of the block the hole came from
+}
+hole;
+
+typedef struct hole_run_struct
+{
+   int motion;                  // G_81, G_82, G_83, G_73, G_85 or G_89
+   double start_x, start_y, start_z;    // position before the first hole
+   double r, clear, bottom;     // R plane, retract plane and hole bottom
+   double p, q;                 // dwell and peck depth, if the cycle takes them
+   double feed_rate;
+   int cnt;
+   int max;
+   hole *held;                  // in program order until drilled
+   hole *tour;                  // scratch copy for the reordering
+}
+hole_run;
+
+/* Bump allocator for interpreter strings with a known lifetime: o-word names
+   and named parameter settings live for one line, subroutine names and local
+   parameter names for one call frame. Chunks are kept across resets, so once
+   warmed up parsing a line does no heap allocation. See interp_internal.cc. */
+#define STRING_ARENA_CHUNK 4096
+
+typedef struct string_arena_chunk_struct
+{
+   struct string_arena_chunk_struct *next;
+   char text[STRING_ARENA_CHUNK];
+}
+string_arena_chunk;
+
+typedef struct string_arena_struct
+{
+   string_arena_chunk *head;    // first chunk, kept across resets
+   string_arena_chunk *cur;     // chunk being filled
+   int used;                    // bytes used in cur
+}
+string_arena;
+
+char *string_arena_dup(string_arena * arena, const char *s);
+void string_arena_reset(string_arena * arena);
+void string_arena_free(string_arena * arena);
+
 #define NAMED_PARAMETERS_ALLOC_UNIT 20
 struct named_parameters_struct
 {
@@ -327,10 +494,11 @@ typedef struct context_struct
 {
    long position;               // location (ftell) in file
    int sequence_number;         // location (line number) in file
-   char *filename;              // name of file for this context
-   char *subName;               // name of the subroutine (oword)
+   char filename[PATH_MAX];     // name of file for this context
+   char *subName;               // name of the subroutine (oword), in names
    double saved_params[INTERP_SUB_PARAMS];
    struct named_parameters_struct named_parameters;
+   string_arena names;          // subName and local parameter names, reset on return
 } context;
 
 
@@ -363,6 +531,8 @@ and is not represented here
 #define STACK_LEN 50
 #define STACK_ENTRY_LEN 80
 
+struct queued_canon;            // interp_queue.h
+
 typedef struct setup_struct
 {
    double AA_axis_offset;       // A-axis g92 offset
@@ -382,6 +552,11 @@ typedef struct setup_struct
    int active_g_codes[ACTIVE_G_CODES];  // array of active G codes
    int active_m_codes[ACTIVE_M_CODES];  // array of active M codes
    double active_settings[ACTIVE_SETTINGS];     // array of feed, speed, etc.
+   int active_stale;            // active_* arrays need write_active, set by mark_active
+   int active_sequence_number;  // sequence number of the last executed block
+   int active_block_g0;         // group 0 G code of the last executed block, -1 if none
+   int active_block_m4;         // stopping M code of the last executed block, -1 if none
+   int active_block_m6;         // tool change M code of the last executed block, -1 if none
    ON_OFF arc_not_allowed;      // we just exited cutter compensation, so we error if the next move isn't straight
    double axis_offset_x;        // X-axis g92 offset
    double axis_offset_y;        // Y-axis g92 offset
@@ -396,6 +571,10 @@ typedef struct setup_struct
    double cutter_comp_radius;   // current cutter compensation radius
    int cutter_comp_orientation; // current cutter compensation tool orientation
    int cutter_comp_side;        // current cutter compensation side
+   std::vector<queued_canon> queue;      // canon calls held back by cutter compensation (interp_queue.cc)
+   string_arena queue_comments; // text of the queued comments
+   double endpoint[2];          // where the last queued move was clipped to
+   int endpoint_valid;          // endpoint is set
    double cycle_cc;             // cc-value (normal) for canned cycles
    double cycle_i;              // i-value for canned cycles
    double cycle_j;              // j-value for canned cycles
@@ -428,7 +607,7 @@ typedef struct setup_struct
    int parameter_numbers[50];   // parameter number buffer
    double parameter_values[50]; // parameter value buffer
    int named_parameter_occurrence;
-   char *named_parameters[50];
+   char *named_parameters[50];  // in line_arena
    double named_parameter_values[50];
    ON_OFF percent_flag;         // ON means first line was percent sign
    CANON_PLANE plane;           // active plane, XY-, YZ-, or XZ-plane
@@ -459,12 +638,16 @@ typedef struct setup_struct
 
    /* stuff for subroutines and control structures */
    int defining_sub;            // true if in a subroutine defn
-   char *sub_name;              // name of sub we are defining (free this)
+   char *sub_name;              // name of sub we are defining (or zero), points to sub_name_text
    int doing_continue;          // true if doing a continue
    //int doing_break;                 // true if doing a break
    int executed_if;             // true if executed in current if
-   char *skipping_o;            // o_name we are skipping for (or zero)
-   char *skipping_to_sub;       // o_name of sub skipping to (or zero)
+   char *skipping_o;            // o_name we are skipping for (or zero), points to skipping_o_text
+   char *skipping_to_sub;       // o_name of sub skipping to (or zero), points to skipping_to_sub_text
+   char sub_name_text[2 * LINELEN + 1];
+   char skipping_o_text[2 * LINELEN + 1];
+   char skipping_to_sub_text[2 * LINELEN + 1];
+   string_arena line_arena;     // o_name and named parameter settings of the current line
    int skipping_start;          // start of skipping (sequence)
    double test_value;           // value for "if", "while", "elseif"
    int call_level;              // current subroutine level
@@ -508,11 +691,17 @@ would contain such a thing, but the check is included to make the
 macros totally crash-proof. If the function call stack is deeper than
 49, the top of the stack will be missing.
 
+Pre-parse worker threads share _setup, so they record nothing and just
+return the error code. The line is then re-read by the normal reader,
+which reports the error.
+
 */
 
 // Set an error string using printf-style formats and return
 #define ERS(fmt, ...)                                      \
     do {                                                   \
+        if (_preparse_worker)                              \
+            return INTERP_ERROR;                           \
         setError (fmt, ## __VA_ARGS__);                    \
         _setup.stack_index = 0;                            \
         strncpy(_setup.stack[_setup.stack_index], __PRETTY_FUNCTION__, STACK_ENTRY_LEN); \
@@ -525,6 +714,8 @@ macros totally crash-proof. If the function call stack is deeper than
 // Return one of the very few numeric errors
 #define ERN(error_code)                                    \
     do {                                                   \
+        if (_preparse_worker)                              \
+            return error_code;                             \
         _setup.stack_index = 0;                            \
         strncpy(_setup.stack[_setup.stack_index], __PRETTY_FUNCTION__, STACK_ENTRY_LEN); \
         _setup.stack[_setup.stack_index][STACK_ENTRY_LEN-1] = 0; \
@@ -537,7 +728,7 @@ macros totally crash-proof. If the function call stack is deeper than
 // Propagate an error up the stack
 #define ERP(error_code)                                        \
     do {                                                       \
-        if (_setup.stack_index < STACK_LEN - 1) {                         \
+        if (!_preparse_worker && _setup.stack_index < STACK_LEN - 1) {    \
             strncpy(_setup.stack[_setup.stack_index], __PRETTY_FUNCTION__, STACK_ENTRY_LEN); \
             _setup.stack[_setup.stack_index][STACK_ENTRY_LEN-1] = 0;    \
             _setup.stack_index++;                                       \
@@ -63,7 +63,7 @@ int Interp::inverse_time_rate_arc(double x1,     //!< x coord of start point of
 
   length = find_arc_length(x1, y1, z1, cx, cy, turn, x2, y2, z2);
   rate = MAX(0.1, (length * block->f_number));
-  enqueue_SET_FEED_RATE(rate);
+  enqueue_SET_FEED_RATE(settings, rate);
   settings->feed_rate = rate;
 
   return INTERP_OK;
@@ -122,7 +122,7 @@ int Interp::inverse_time_rate_straight(double end_x,     //!< x coordinate of en
                                 settings->u_current, settings->v_current, settings->w_current);
 
   rate = MAX(0.1, (length * block->f_number));
-  enqueue_SET_FEED_RATE(rate);
+  enqueue_SET_FEED_RATE(settings, rate);
   settings->feed_rate = rate;
 
   return INTERP_OK;
@@ -259,11 +259,9 @@ int Interp::control_back_to( /* ARGUMENTS                       */
      ERS(NCE_UNABLE_TO_OPEN_FILE,tmpFileName);
   }
 
-  if(settings->skipping_o)free(settings->skipping_o);
-  settings->skipping_o = strdup(block->o_name); // start skipping
+  settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name); // start skipping
 
-  if(settings->skipping_to_sub)free(settings->skipping_to_sub);
-  settings->skipping_to_sub = strdup(block->o_name); // start skipping
+  settings->skipping_to_sub = strcpy(settings->skipping_to_sub_text, block->o_name); // start skipping
 
   settings->skipping_start = settings->sequence_number;
   //ERS(NCE_UNKNOWN_OWORD_NUMBER);
@@ -341,12 +339,10 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
       if(settings->skipping_o)
 	{
 	  logDebug("no longer skipping to:|%s|", settings->skipping_o);
-	  free(settings->skipping_o);
           settings->skipping_o = 0; // this IS our block number
 	}
       if(settings->skipping_to_sub)
 	{
-	  free(settings->skipping_to_sub);
           settings->skipping_to_sub = 0; // this IS our block number
 	}
       if(settings->call_level != 0)
@@ -362,13 +358,11 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  // a definition
 	  CHKS((settings->defining_sub == 1), NCE_NESTED_SUBROUTINE_DEFN);
 	  CHP(control_save_offset(block->o_number, block, settings));
-          if(settings->skipping_o)free(settings->skipping_o);
-          settings->skipping_o = strdup(block->o_name); // start skipping
+          settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name); // start skipping
 
           settings->skipping_start = settings->sequence_number;
 	  settings->defining_sub = 1;
-	  if(settings->sub_name)free(settings->sub_name);
-	  settings->sub_name = strdup(block->o_name);
+	  settings->sub_name = strcpy(settings->sub_name_text, block->o_name);
 	  logDebug("will now skip to: |%s| %d", settings->sub_name,
 		   block->o_number);
 	}
@@ -381,7 +375,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	{
 	  logDebug("case O_endsub -- no longer skipping to:|%s|",
 	       settings->skipping_o);
-	  free(settings->skipping_o);
           settings->skipping_o = 0;
 	}
       if(settings->call_level != 0)
@@ -391,11 +384,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
           // restore file position from context
 
           free_named_parameters(settings->call_level, settings);
-	  if(settings->sub_context[settings->call_level].subName)
-	    {
-	      free(settings->sub_context[settings->call_level].subName);
-	      settings->sub_context[settings->call_level].subName = 0;
-	    }
           settings->call_level--;
 
           for(i=0; i<INTERP_SUB_PARAMS; i++)
@@ -432,16 +420,11 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  settings->sequence_number =
 	    settings->sub_context[settings->call_level].sequence_number;
 
-	  if(settings->sub_name)
-	    {
-	      free(settings->sub_name);
-	      settings->sub_name = 0;
-	    }
-
 	  if(settings->sub_context[settings->call_level].subName)
 	    {
 	      settings->sub_name =
-		strdup(settings->sub_context[settings->call_level].subName);
+		strcpy(settings->sub_name_text,
+		       settings->sub_context[settings->call_level].subName);
 	    }
 	  else
 	    {
@@ -457,11 +440,9 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	    {
 	      logDebug("case O_endsub in defn -- no longer skipping to:|%s|",
 		   settings->skipping_o);
-	      free(settings->skipping_o);
               settings->skipping_o = 0;
 	    }
 	  settings->defining_sub = 0;
-	  if(settings->sub_name)free(settings->sub_name);
 	  settings->sub_name = 0;
 	}
       break;
@@ -474,7 +455,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	{
 	  logDebug("case O_call -- no longer skipping to:|%s|",
 	       settings->skipping_o);
-	  free(settings->skipping_o);
           settings->skipping_o = 0;
 	}
       if(settings->call_level >= INTERP_SUB_ROUTINE_LEVELS)
@@ -498,15 +478,10 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
           }
         settings->sub_context[settings->call_level].position =
 	    ftell(settings->file_pointer);
-        if(settings->sub_context[settings->call_level].filename)
-          {
-              // if there is a string here, free it
-              free(settings->sub_context[settings->call_level].filename);
-          }
         // save the previous filename
-	logDebug("Duping |%s|", settings->filename);
-        settings->sub_context[settings->call_level].filename =
-              strdup(settings->filename);
+	logDebug("Saving |%s|", settings->filename);
+        strcpy(settings->sub_context[settings->call_level].filename,
+               settings->filename);
 
 	settings->sub_context[settings->call_level].sequence_number
 	    = settings->sequence_number;
@@ -518,10 +493,14 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 
       settings->call_level++;
 
-      // set the new subName
-      // !!!KL do we need to free old subName?
+      // set the new subName, in a clean frame in case an error
+      // left the previous call at this level behind
+      free_named_parameters(settings->call_level, settings);
       settings->sub_context[settings->call_level].subName =
-	strdup(block->o_name);
+	string_arena_dup(&settings->sub_context[settings->call_level].names,
+			 block->o_name);
+      CHKS((settings->sub_context[settings->call_level].subName == 0),
+	  NCE_OUT_OF_MEMORY);
 
       if (control_back_to(block,settings) == INTERP_ERROR) {
           ERS(NCE_UNABLE_TO_OPEN_FILE,block->o_name);
@@ -530,7 +509,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
       break;
     case O_do:
       // if we were skipping, no longer
-      if(settings->skipping_o)free(settings->skipping_o);
       settings->skipping_o = 0;
       // save the loop point
       // we hit this again on loop back -- so test first
@@ -542,7 +520,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 
     case O_repeat:
       // if we were skipping, no longer
-      if(settings->skipping_o)free(settings->skipping_o);
       settings->skipping_o = 0;
       status = control_find_oword(block, settings, &index);
 
@@ -573,8 +550,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	      // skip forward
 	      logDebug("skipping forward: [%s] in 'repeat'",
 		       block->o_name);
-              if(settings->skipping_o)free(settings->skipping_o);
-	      settings->skipping_o = strdup(block->o_name);
+	      settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
               settings->skipping_start = settings->sequence_number;
               // cause the repeat count to be recalculated
 	      // if we do this loop again
@@ -585,7 +561,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 
     case O_while:
       // if we were skipping, no longer
-      if(settings->skipping_o)free(settings->skipping_o);
       settings->skipping_o = 0;
       status = control_find_oword(block, settings, &index);
 
@@ -617,8 +592,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	      // skip forward
 	      logDebug("skipping forward: [%s] in 'while'",
 		       block->o_name);
-              if(settings->skipping_o)free(settings->skipping_o);
-	      settings->skipping_o = strdup(block->o_name);
+	      settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
               settings->skipping_start = settings->sequence_number;
 	    }
 	}
@@ -650,7 +624,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  //true
 	  logDebug("executing forward: [%s] in 'if'",
 	      block->o_name);
-          if(settings->skipping_o)free(settings->skipping_o);
           settings->skipping_o = 0;
 	  settings->executed_if = 1;
 	}
@@ -659,8 +632,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  //false
           logDebug("skipping forward: [%s] in 'if'",
 	      block->o_name);
-          if(settings->skipping_o)free(settings->skipping_o);
-          settings->skipping_o = strdup(block->o_name);
+          settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
           settings->skipping_start = settings->sequence_number;
 	  settings->executed_if = 0;
 	}
@@ -678,8 +650,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  // we were not skipping -- start skipping
           logDebug("start skipping forward: [%s] in 'elseif'",
 	      block->o_name);
-          if(settings->skipping_o)free(settings->skipping_o);
-	  settings->skipping_o = strdup(block->o_name);
+	  settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
           settings->skipping_start = settings->sequence_number;
           return INTERP_OK;
 #else
@@ -699,8 +670,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 		   "skipping forward: [%s] in 'elseif'",
 	      block->o_name);
 	  //settings->skipping_0 = block->o_number;
-          if(settings->skipping_o)free(settings->skipping_o);
-          settings->skipping_o = strdup(block->o_name);
+          settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
           settings->skipping_start = settings->sequence_number;
           return INTERP_OK;
 	}
@@ -710,7 +680,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  //true -- start executing
           logDebug("start executing forward: [%s] in 'elseif'",
 	      block->o_name);
-         if(settings->skipping_o)free(settings->skipping_o);
 	  settings->skipping_o = 0;
 	  settings->executed_if = 1;
 	}
@@ -730,8 +699,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
           logDebug("already executed, "
 		   "skipping forward: [%s] in 'else'",
 	      block->o_name);
-          if(settings->skipping_o)free(settings->skipping_o);
-	  settings->skipping_o = strdup(block->o_name);
+	  settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
           settings->skipping_start = settings->sequence_number;
           return INTERP_OK;
 	}
@@ -743,7 +711,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
           logDebug("stop skipping forward: [%s] in 'else'",
 	      block->o_name);
           settings->executed_if = 1;
-         if(settings->skipping_o)free(settings->skipping_o);
 	  settings->skipping_o = 0;
 	}
       else
@@ -756,7 +723,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 
     case O_endif:
       // stop skipping if we were
-      if(settings->skipping_o)free(settings->skipping_o);
       settings->skipping_o = 0;
       logDebug("stop skipping forward: [%s] in 'endif'",
 	      block->o_name);
@@ -767,8 +733,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 
     case O_break:
       // start skipping
-      if(settings->skipping_o)free(settings->skipping_o);
-      settings->skipping_o = strdup(block->o_name);
+      settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
       settings->skipping_start = settings->sequence_number;
       //settings->doing_break = 1;
       logDebug("start skipping forward: [%s] in 'break'",
@@ -786,8 +751,7 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	  return INTERP_OK;
 	}
       // start skipping
-      if(settings->skipping_o)free(settings->skipping_o);
-      settings->skipping_o = strdup(block->o_name);
+      settings->skipping_o = strcpy(settings->skipping_o_text, block->o_name);
       settings->skipping_start = settings->sequence_number;
       settings->doing_continue = 1;
       logDebug("start skipping forward: [%s] in 'continue'",
@@ -802,7 +766,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
 	 (0 == strcmp(settings->skipping_o, block->o_name)))
 	{
 	  // we were skipping, so this is the end
-          if(settings->skipping_o)free(settings->skipping_o);
 	  settings->skipping_o = 0;
 
 	  if(settings->doing_continue)
@@ -839,7 +802,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
       }
 
       // if we were skipping, no longer
-      if(settings->skipping_o)free(settings->skipping_o);
       settings->skipping_o = 0;
 
       // in a call -- must do a return
@@ -847,11 +809,6 @@ int Interp::convert_control_functions( /* ARGUMENTS           */
       // restore file position from context
 
       free_named_parameters(settings->call_level, settings);
-      if(settings->sub_context[settings->call_level].subName)
-	{
-	  free(settings->sub_context[settings->call_level].subName);
-	}
-
       settings->call_level--;
 
       for(i=0; i<INTERP_SUB_PARAMS; i++)
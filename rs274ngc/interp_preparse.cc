@@ -0,0 +1,396 @@
+/********************************************************************
+* Description: interp_preparse.cc
+*
+*   Parallel pre-parse of large straight-line programs.
+*
+*   Most CAM output is thousands of lines with no parameters,
+*   expressions or o-words. Such "pure" lines parse the same way no
+*   matter what came before them, so they are read in batches and
+*   parsed into blocks by worker threads. Execution stays sequential:
+*   each pre-parsed block still goes through enhance_block and
+*   check_items against the current modal state. Any other line, or a
+*   pure line the workers could not parse, falls back to the normal
+*   reader so errors are reported the same way.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rs274ngc.h"
+#include "rs274ngc_return.h"
+#include "interp_internal.h"
+#include "rs274ngc_interp.h"
+
+__thread int Interp::_preparse_worker;
+
+struct preparse_job
+{
+   Interp *interp;
+   preparse *pp;
+   int first;
+   int last;
+};
+
+/* Return 1 if the line has no parameters, expressions, o-words, block delete or percent. */
+static int _pure_line(const char *line)
+{
+   int comment = 0;
+
+   for (; *line; line++)
+   {
+      if (comment)
+      {
+         if (*line == ')')
+            comment = 0;
+         continue;
+      }
+      switch (*line)
+      {
+      case '(':
+         comment = 1;
+         break;
+      case ';':
+         return 1;      /* rest of line is a comment */
+      case '#':
+      case '[':
+      case 'o':
+      case 'O':
+      case '/':
+      case '%':
+         return 0;
+      default:
+         break;
+      }
+   }
+   return 1;
+}
+
+static int _preparse_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return (n > 0) ? (int) n : 1;
+#else
+   return 1;
+#endif
+}
+
+/****************************************************************************/
+
+/*! preparse_one
+
+Returned Value: int
+   INTERP_OK if the line was parsed into pl->blk, otherwise an error code.
+
+Side Effects: none outside of pl, so this may run in a worker thread.
+
+Called By: preparse_worker
+
+*/
+
+int Interp::preparse_one(preparse_line * pl)
+{
+   strcpy(pl->block_text, pl->text);
+   CHP(close_and_downcase(pl->block_text));
+   pl->length = strlen(pl->block_text);
+   if (pl->length == 0)
+      return INTERP_ERROR;      /* blank lines go through the normal reader */
+   CHP(init_block(&pl->blk));
+   CHP(read_items(&pl->blk, pl->block_text, _setup.parameters));
+   return INTERP_OK;
+}
+
+void *Interp::preparse_worker(void *arg)
+{
+   struct preparse_job *job = (struct preparse_job *) arg;
+   preparse_line *pl;
+   int i;
+
+   _preparse_worker = 1;
+   for (i = job->first; i < job->last; i++)
+   {
+      pl = &job->pp->line[i];
+      if (pl->pure && job->interp->preparse_one(pl) != INTERP_OK)
+         pl->pure = 0;
+   }
+   _preparse_worker = 0;
+   return NULL;
+}
+
+/****************************************************************************/
+
+/*! preparse_fill
+
+Returned Value: int
+   The number of lines in the new batch, zero at end of file.
+
+Side Effects:
+   The next batch of lines is read from pp->inport and the pure lines
+   are parsed across pp->threads threads (the caller is one of them).
+
+Called By: preparse_read
+
+*/
+
+int Interp::preparse_fill(preparse * pp)
+{
+   struct preparse_job job[PREPARSE_THREADS_MAX];
+   pthread_t tid[PREPARSE_THREADS_MAX];
+   int started[PREPARSE_THREADS_MAX];
+   preparse_line *pl;
+   int i, n, slice, pure = 0;
+
+   pp->cnt = pp->next = 0;
+   while (pp->cnt < pp->batch)
+   {
+      pl = &pp->line[pp->cnt];
+      if (fgets(pl->text, sizeof(pl->text), pp->inport) == NULL)
+         break;
+      pl->end = ftell(pp->inport);
+
+      /* read_items() does not look at lines while skipping o-word blocks. */
+      pl->pure = (pp->threads > 1 && _setup.skipping_o == 0) ? _pure_line(pl->text) : 0;
+      pure += pl->pure;
+      pp->cnt++;
+   }
+
+   if (pp->batch < PREPARSE_BATCH_MAX)
+      pp->batch *= 2;
+
+   if (pure == 0)
+      return pp->cnt;
+
+   /* read_x() depends on G7/G8, remember what the workers saw. */
+   pp->lathe_diameter_mode = _setup.lathe_diameter_mode;
+
+   /* Don't start a thread for less than PREPARSE_BATCH_MIN/2 lines. */
+   n = (pp->cnt + PREPARSE_BATCH_MIN / 2 - 1) / (PREPARSE_BATCH_MIN / 2);
+   if (n > pp->threads)
+      n = pp->threads;
+   slice = (pp->cnt + n - 1) / n;
+   for (i = 0; i < n; i++)
+   {
+      job[i].interp = this;
+      job[i].pp = pp;
+      job[i].first = i * slice;
+      job[i].last = (i + 1) * slice < pp->cnt ? (i + 1) * slice : pp->cnt;
+   }
+
+   /* Run the first slice in this thread. */
+   for (i = 1; i < n; i++)
+   {
+      started[i] = (pthread_create(&tid[i], NULL, preparse_worker, &job[i]) == 0);
+      if (!started[i])
+         preparse_worker(&job[i]);
+   }
+   preparse_worker(&job[0]);
+   for (i = 1; i < n; i++)
+   {
+      if (started[i])
+         pthread_join(tid[i], NULL);
+   }
+
+   return pp->cnt;
+}
+
+/****************************************************************************/
+
+/*! preparse_open
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if the batch buffer cannot be allocated.
+
+Side Effects:
+   Lines will be read from inport by preparse_read. The caller still owns
+   inport and must call preparse_close before closing it.
+
+Called By: external programs
+
+*/
+
+int Interp::preparse_open(FILE * inport)
+{
+   preparse *pp;
+
+   preparse_close();
+
+   if ((pp = (preparse *) calloc(1, sizeof(preparse))) == NULL)
+      ERS("unable to allocate pre-parse buffer");
+   if ((pp->line = (preparse_line *) calloc(PREPARSE_BATCH_MAX, sizeof(preparse_line))) == NULL)
+   {
+      free(pp);
+      ERS("unable to allocate pre-parse buffer");
+   }
+
+   pp->inport = inport;
+   pp->threads = (_preparse_threads > 0) ? _preparse_threads : _preparse_cpus();
+   if (pp->threads > PREPARSE_THREADS_MAX)
+      pp->threads = PREPARSE_THREADS_MAX;
+   pp->batch = PREPARSE_BATCH_MIN;
+   _preparse = pp;
+
+   return INTERP_OK;
+}
+
+/*! preparse_read
+
+Returned Value: int
+   INTERP_OK if there is a line to execute, INTERP_ENDFILE at end of file.
+
+Called By: external programs
+
+*/
+
+int Interp::preparse_read()
+{
+   preparse *pp = _preparse;
+
+   CHKN((pp == NULL), INTERP_FILE_NOT_OPEN);
+
+   if (pp->next >= pp->cnt && preparse_fill(pp) == 0)
+      return INTERP_ENDFILE;
+   pp->next++;
+   return INTERP_OK;
+}
+
+/*! preparse_tell
+
+Returned Value: long
+   The file offset just after the line returned by preparse_read, which
+   is where the following line starts.
+
+Called By: external programs
+
+*/
+
+long Interp::preparse_tell()
+{
+   preparse *pp = _preparse;
+
+   if (pp == NULL || pp->next == 0)
+      return -1;
+   return pp->line[pp->next - 1].end;
+}
+
+/*! preparse_execute
+
+Returned Value: int
+   Same as Interp::execute.
+
+Side Effects:
+   The line returned by preparse_read is executed. Pre-parsed lines skip
+   read_text and read_items, everything else is done as in Interp::read.
+
+Called By: external programs
+
+*/
+
+int Interp::preparse_execute(int line_number)
+{
+   preparse *pp = _preparse;
+   preparse_line *pl;
+   long offset;
+
+   CHKN((pp == NULL || pp->next == 0), INTERP_FILE_NOT_OPEN);
+
+   pl = &pp->line[pp->next - 1];
+   if (!pl->pure)
+      return preparse_last(execute(pl->text, line_number));
+
+   _setup.sequence_number = line_number;
+   CHP(read_synch());
+
+   strcpy(_setup.linetext, pl->text);
+   strcpy(_setup.blocktext, pl->block_text);
+   _setup.line_length = pl->length;
+
+   _setup.parameter_occurrence = 0;
+   _setup.named_parameter_occurrence = 0;
+
+   string_arena_reset(&_setup.line_arena);
+   CHP(init_block(&(_setup.block1)));
+   if (_setup.skipping_o == 0)
+   {
+      offset = _setup.file_pointer ? ftell(_setup.file_pointer) : _setup.block1.offset;
+      _setup.block1 = pl->blk;
+      _setup.block1.offset = offset;
+      if (_setup.block1.x_flag == ON && pp->lathe_diameter_mode != _setup.lathe_diameter_mode)
+      {
+         /* G7/G8 changed after the batch was parsed. */
+         if (_setup.lathe_diameter_mode)
+            _setup.block1.x_number /= 2;
+         else
+            _setup.block1.x_number *= 2;
+      }
+      CHP(enhance_block(&(_setup.block1), &_setup));
+      CHP(check_items(&(_setup.block1), &_setup));
+   }
+
+   return preparse_last(execute());
+}
+
+/*! preparse_last
+
+Returned Value: int
+   status, or an error from hole_order_flush.
+
+Side Effects:
+   After the last line of the file, canned cycle holes still held by
+   hole_order_hold are drilled. A program does not need M2 or % for
+   its last holes to be drilled.
+
+Called By: preparse_execute
+
+*/
+
+int Interp::preparse_last(int status)
+{
+   preparse *pp = _preparse;
+   int c;
+
+   if (status != INTERP_OK || _holes == NULL || _holes->cnt == 0 || pp->next < pp->cnt)
+      return status;
+   if ((c = getc(pp->inport)) != EOF)
+   {
+      ungetc(c, pp->inport);
+      return status;
+   }
+   return hole_order_flush();
+}
+
+/*! preparse_close
+
+Returned Value: int (INTERP_OK)
+
+Side Effects:
+   The unexecuted part of the current batch is given back by seeking
+   inport to the end of the last executed line, so a paused program
+   resumes at the right place.
+
+Called By: external programs
+
+*/
+
+int Interp::preparse_close()
+{
+   preparse *pp = _preparse;
+
+   /* Holes the program did not get to drill. */
+   hole_order_clear();
+
+   if (pp == NULL)
+      return INTERP_OK;
+
+   if (pp->next > 0 && pp->next < pp->cnt)
+      fseek(pp->inport, pp->line[pp->next - 1].end, SEEK_SET);
+
+   free(pp->line);
+   free(pp);
+   _preparse = NULL;
+   return INTERP_OK;
+}
@@ -48,23 +48,20 @@ static double latheorigin_z(setup_pointer settings, double z) {
     return z;
 }
 
-static double endpoint[2];
-static int endpoint_valid = 0;
-
-std::vector<queued_canon>& qc(void) {
-    static std::vector<queued_canon> c;
-    if(0) printf("len %d\n", (int)c.size());
-    return c;
+std::vector<queued_canon>& qc(setup_pointer settings) {
+    if(0) printf("len %d\n", (int)settings->queue.size());
+    return settings->queue;
 }
 
-void qc_reset(void) {
+void qc_reset(setup_pointer settings) {
     if(debug_qc) printf("qc cleared\n");
-    qc().clear();
-    endpoint_valid = 0;
+    qc(settings).clear();
+    string_arena_reset(&settings->queue_comments);
+    settings->endpoint_valid = 0;
 }
 
-void enqueue_SET_FEED_RATE(double feed) {
-    if(qc().empty()) {
+void enqueue_SET_FEED_RATE(setup_pointer settings, double feed) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate set feed rate %f\n", feed);
         SET_FEED_RATE(feed);
         return;
@@ -73,11 +70,11 @@ void enqueue_SET_FEED_RATE(double feed) {
     q.type = QSET_FEED_RATE;
     q.data.set_feed_rate.feed = feed;
     if(debug_qc) printf("enqueue set feed rate %f\n", feed);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_DWELL(double time) {
-    if(qc().empty()) {
+void enqueue_DWELL(setup_pointer settings, double time) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate dwell %f\n", time);
         DWELL(time);
         return;
@@ -86,11 +83,11 @@ void enqueue_DWELL(double time) {
     q.type = QDWELL;
     q.data.dwell.time = time;
     if(debug_qc) printf("enqueue dwell %f\n", time);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_SET_FEED_MODE(int mode) {
-    if(qc().empty()) {
+void enqueue_SET_FEED_MODE(setup_pointer settings, int mode) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate set feed mode %d\n", mode);
         SET_FEED_MODE(mode);
         return;
@@ -99,11 +96,11 @@ void enqueue_SET_FEED_MODE(int mode) {
     q.type = QSET_FEED_MODE;
     q.data.set_feed_mode.mode = mode;
     if(debug_qc) printf("enqueue set feed mode %d\n", mode);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_MIST_ON(void) {
-    if(qc().empty()) {
+void enqueue_MIST_ON(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate mist on\n");
         MIST_ON();
         return;
@@ -111,11 +108,11 @@ void enqueue_MIST_ON(void) {
     queued_canon q;
     q.type = QMIST_ON;
     if(debug_qc) printf("enqueue mist on\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_MIST_OFF(void) {
-    if(qc().empty()) {
+void enqueue_MIST_OFF(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate mist off\n");
         MIST_OFF();
         return;
@@ -123,11 +120,11 @@ void enqueue_MIST_OFF(void) {
     queued_canon q;
     q.type = QMIST_OFF;
     if(debug_qc) printf("enqueue mist off\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_FLOOD_ON(void) {
-    if(qc().empty()) {
+void enqueue_FLOOD_ON(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate flood on\n");
         FLOOD_ON();
         return;
@@ -135,11 +132,11 @@ void enqueue_FLOOD_ON(void) {
     queued_canon q;
     q.type = QFLOOD_ON;
     if(debug_qc) printf("enqueue flood on\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_FLOOD_OFF(void) {
-    if(qc().empty()) {
+void enqueue_FLOOD_OFF(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate flood on\n");
         FLOOD_OFF();
         return;
@@ -147,11 +144,11 @@ void enqueue_FLOOD_OFF(void) {
     queued_canon q;
     q.type = QFLOOD_OFF;
     if(debug_qc) printf("enqueue flood off\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_START_SPINDLE_CLOCKWISE(void) {
-    if(qc().empty()) {
+void enqueue_START_SPINDLE_CLOCKWISE(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate spindle clockwise\n");
         START_SPINDLE_CLOCKWISE();
         return;
@@ -159,11 +156,11 @@ void enqueue_START_SPINDLE_CLOCKWISE(void) {
     queued_canon q;
     q.type = QSTART_SPINDLE_CLOCKWISE;
     if(debug_qc) printf("enqueue spindle clockwise\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_START_SPINDLE_COUNTERCLOCKWISE(void) {
-    if(qc().empty()) {
+void enqueue_START_SPINDLE_COUNTERCLOCKWISE(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate spindle counterclockwise\n");
         START_SPINDLE_COUNTERCLOCKWISE();
         return;
@@ -171,11 +168,11 @@ void enqueue_START_SPINDLE_COUNTERCLOCKWISE(void) {
     queued_canon q;
     q.type = QSTART_SPINDLE_COUNTERCLOCKWISE;
     if(debug_qc) printf("enqueue spindle counterclockwise\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_STOP_SPINDLE_TURNING(void) {
-    if(qc().empty()) {
+void enqueue_STOP_SPINDLE_TURNING(setup_pointer settings) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate spindle stop\n");
         STOP_SPINDLE_TURNING();
         return;
@@ -183,11 +180,11 @@ void enqueue_STOP_SPINDLE_TURNING(void) {
     queued_canon q;
     q.type = QSTOP_SPINDLE_TURNING;
     if(debug_qc) printf("enqueue spindle stop\n");
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_SET_SPINDLE_MODE(double mode) {
-    if(qc().empty()) {
+void enqueue_SET_SPINDLE_MODE(setup_pointer settings, double mode) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate spindle mode %f\n", mode);
         SET_SPINDLE_MODE(mode);
         return;
@@ -196,11 +193,11 @@ void enqueue_SET_SPINDLE_MODE(double mode) {
     q.type = QSET_SPINDLE_MODE;
     q.data.set_spindle_mode.mode = mode;
     if(debug_qc) printf("enqueue spindle mode %f\n", mode);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_SET_SPINDLE_SPEED(double speed) {
-    if(qc().empty()) {
+void enqueue_SET_SPINDLE_SPEED(setup_pointer settings, double speed) {
+    if(qc(settings).empty()) {
     if(debug_qc) printf("immediate set spindle speed %f\n", speed);
         SET_SPINDLE_SPEED(speed);
         return;
@@ -209,20 +206,24 @@ void enqueue_SET_SPINDLE_SPEED(double speed) {
     q.type = QSET_SPINDLE_SPEED;
     q.data.set_spindle_speed.speed = speed;
     if(debug_qc) printf("enqueue set spindle speed %f\n", speed);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_COMMENT(const char *c) {
-    if(qc().empty()) {
+void enqueue_COMMENT(setup_pointer settings, const char *c) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate comment \"%s\"\n", c);
         COMMENT(c);
         return;
     }
     queued_canon q;
     q.type = QCOMMENT;
-    q.data.comment.comment = strdup(c);
+    q.data.comment.comment = string_arena_dup(&settings->queue_comments, c);
+    if(q.data.comment.comment == NULL) {
+        COMMENT(c);     // out of memory, better early than lost
+        return;
+    }
     if(debug_qc) printf("enqueue comment \"%s\"\n", c);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
 int enqueue_STRAIGHT_FEED(setup_pointer settings, int l, 
@@ -259,7 +260,7 @@ int enqueue_STRAIGHT_FEED(setup_pointer settings, int l,
     q.data.straight_feed.u = u;
     q.data.straight_feed.v = v;
     q.data.straight_feed.w = w;
-    qc().push_back(q);
+    qc(settings).push_back(q);
     if(debug_qc) printf("enqueue straight feed lineno %d to %f %f %f direction %f %f %f\n", l, x,y,z, dx, dy, dz);
     return 0;
 }
@@ -299,7 +300,7 @@ int enqueue_STRAIGHT_TRAVERSE(setup_pointer settings, int l,
     q.data.straight_traverse.v = v;
     q.data.straight_traverse.w = w;
     if(debug_qc) printf("enqueue straight traverse lineno %d to %f %f %f direction %f %f %f\n", l, x,y,z, dx, dy, dz);
-    qc().push_back(q);
+    qc(settings).push_back(q);
     return 0;
 }
 
@@ -329,11 +330,11 @@ void enqueue_ARC_FEED(setup_pointer settings, int l,
     q.data.arc_feed.w = w;
 
     if(debug_qc) printf("enqueue arc lineno %d to %f %f center %f %f turn %d sweeping %f\n", l, end1, end2, center1, center2, turn, original_turns);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void enqueue_M_USER_COMMAND (int index, double p_number, double q_number) {
-    if(qc().empty()) {
+void enqueue_M_USER_COMMAND(setup_pointer settings, int index, double p_number, double q_number) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("immediate mcommand\n");
         EXEC_USER_DEFINED_FUNCTION(index, p_number, q_number);
         return;
@@ -345,22 +346,22 @@ void enqueue_M_USER_COMMAND (int index, double p_number, double q_number) {
     q.data.mcommand.q_number = q_number;
     if(debug_qc) printf("enqueue M_USER_COMMAND index=%d p=%f q=%f\n",
                         index,p_number,q_number);
-    qc().push_back(q);
+    qc(settings).push_back(q);
 }
 
-void qc_scale(double scale) {
+void qc_scale(setup_pointer settings, double scale) {
     
-    if(qc().empty()) {
+    if(qc(settings).empty()) {
         if(debug_qc) printf("not scaling because qc is empty\n");
         return;
     }
 
     if(debug_qc) printf("scaling qc by %f\n", scale);
 
-    for(unsigned int i = 0; i<qc().size(); i++) {
-        queued_canon &q = qc()[i];
-        endpoint[0] *= scale;
-        endpoint[1] *= scale;
+    for(unsigned int i = 0; i<qc(settings).size(); i++) {
+        queued_canon &q = qc(settings)[i];
+        settings->endpoint[0] *= scale;
+        settings->endpoint[1] *= scale;
         switch(q.type) {
         case QARC_FEED:
             q.data.arc_feed.end1 *= scale;
@@ -397,12 +398,12 @@ void qc_scale(double scale) {
 void dequeue_canons(setup_pointer settings) {
 
     if(debug_qc) printf("dequeueing: endpoint is now invalid\n");
-    endpoint_valid = 0;
+    settings->endpoint_valid = 0;
 
-    if(qc().empty()) return;
+    if(qc(settings).empty()) return;
 
-    for(unsigned int i = 0; i<qc().size(); i++) {
-        queued_canon &q = qc()[i];
+    for(unsigned int i = 0; i<qc(settings).size(); i++) {
+        queued_canon &q = qc(settings)[i];
 
         switch(q.type) {
         case QARC_FEED:
@@ -486,7 +487,6 @@ void dequeue_canons(setup_pointer settings) {
         case QCOMMENT:
             if(debug_qc) printf("issuing comment\n");
             COMMENT(q.data.comment.comment);
-            free(q.data.comment.comment);
             break;
         case QM_USER_COMMAND:
             if(debug_qc) printf("issuing mcommand\n");
@@ -494,7 +494,8 @@ void dequeue_canons(setup_pointer settings) {
             break;
         }
     }
-    qc().clear();
+    qc(settings).clear();
+    string_arena_reset(&settings->queue_comments);
 }
 
 int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y) {
@@ -504,15 +505,15 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
     double y2;
     double dot;
 
-    if(qc().empty()) return 0;
+    if(qc(settings).empty()) return 0;
     
-    for(unsigned int i = 0; i<qc().size(); i++) {
+    for(unsigned int i = 0; i<qc(settings).size(); i++) {
         // there may be several moves in the queue, and we need to
         // change all of them.  consider moving into a concave corner,
         // then up and back down, then continuing on.  there will be
         // three moves to change.
 
-        queued_canon &q = qc()[i];
+        queued_canon &q = qc(settings)[i];
 
         switch(q.type) {
         case QARC_FEED:
@@ -524,7 +525,7 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
             q.data.arc_feed.end2 = y;
             r2 = hypot(x - q.data.arc_feed.center1,
                        y - q.data.arc_feed.center2);
-            l2 = find_turn(endpoint[0], endpoint[1],
+            l2 = find_turn(settings->endpoint[0], settings->endpoint[1],
                            q.data.arc_feed.center1, q.data.arc_feed.center2,
                            q.data.arc_feed.turn,
                            x, y);
@@ -532,7 +533,7 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
 
             if(fabs(r1-r2) > .01) 
                 ERS(EMC_I18N("BUG: cutter compensation has generated an invalid arc with mismatched radii r1 %f r2 %f\n"), r1, r2);
-            if(l1 && endpoint_valid && fabs(l2) > fabs(l1) + 0.001) {
+            if(l1 && settings->endpoint_valid && fabs(l2) > fabs(l1) + 0.001) {
                 ERS(EMC_I18N("Arc move in concave corner cannot be reached by the tool without gouging"));
             }
             q.data.arc_feed.end1 = x;
@@ -543,23 +544,23 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
             case CANON_PLANE_XY:
                 x1 = q.data.straight_traverse.dx; // direction of original motion
                 y1 = q.data.straight_traverse.dy;                
-                x2 = x - endpoint[0];         // new direction after clipping
-                y2 = y - endpoint[1];
+                x2 = x - settings->endpoint[0];         // new direction after clipping
+                y2 = y - settings->endpoint[1];
                 break;
             case CANON_PLANE_XZ:
                 x1 = q.data.straight_traverse.dz; // direction of original motion
                 y1 = q.data.straight_traverse.dx;                
-                x2 = x - endpoint[0];         // new direction after clipping
-                y2 = y - endpoint[1];
+                x2 = x - settings->endpoint[0];         // new direction after clipping
+                y2 = y - settings->endpoint[1];
                 break;
             default:
                 ERS(EMC_I18N("BUG: Unsupported plane in cutter compensation"));
             }
             
             dot = x1 * x2 + y1 * y2; // not normalized; we only care about the angle
-            if(debug_qc) printf("moving endpoint of traverse old dir %f new dir %f dot %f endpoint_valid %d\n", atan2(y1,x1), atan2(y2,x2), dot, endpoint_valid);
+            if(debug_qc) printf("moving endpoint of traverse old dir %f new dir %f dot %f endpoint_valid %d\n", atan2(y1,x1), atan2(y2,x2), dot, settings->endpoint_valid);
 
-            if(endpoint_valid && dot<0) {
+            if(settings->endpoint_valid && dot<0) {
                 // oops, the move is the wrong way.  this means the
                 // path has crossed because we backed up further
                 // than the line is long.  this will gouge.
@@ -581,14 +582,14 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
             case CANON_PLANE_XY:
                 x1 = q.data.straight_feed.dx; // direction of original motion
                 y1 = q.data.straight_feed.dy;                
-                x2 = x - endpoint[0];         // new direction after clipping
-                y2 = y - endpoint[1];
+                x2 = x - settings->endpoint[0];         // new direction after clipping
+                y2 = y - settings->endpoint[1];
                 break;
             case CANON_PLANE_XZ:
                 x1 = q.data.straight_feed.dz; // direction of original motion
                 y1 = q.data.straight_feed.dx;                
-                x2 = x - endpoint[0];         // new direction after clipping
-                y2 = y - endpoint[1];
+                x2 = x - settings->endpoint[0];         // new direction after clipping
+                y2 = y - settings->endpoint[1];
                 break;
             default:
                 ERS(EMC_I18N("BUG: Unsupported plane [%d] in cutter compensation"),
@@ -596,9 +597,9 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
             }
 
             dot = x1 * x2 + y1 * y2;
-            if(debug_qc) printf("moving endpoint of feed old dir %f new dir %f dot %f endpoint_valid %d\n", atan2(y1,x1), atan2(y2,x2), dot, endpoint_valid);
+            if(debug_qc) printf("moving endpoint of feed old dir %f new dir %f dot %f endpoint_valid %d\n", atan2(y1,x1), atan2(y2,x2), dot, settings->endpoint_valid);
 
-            if(endpoint_valid && dot<0) {
+            if(settings->endpoint_valid && dot<0) {
                 // oops, the move is the wrong way.  this means the
                 // path has crossed because we backed up further
                 // than the line is long.  this will gouge.
@@ -621,12 +622,12 @@ int Interp::move_endpoint_and_flush(setup_pointer settings, double x, double y)
         }
     }
     dequeue_canons(settings);
-    set_endpoint(x, y);
+    set_endpoint(settings, x, y);
     return 0;
 }
 
-void set_endpoint(double x, double y) {
+void set_endpoint(setup_pointer settings, double x, double y) {
     if(debug_qc) printf("setting endpoint %f %f\n", x, y);
-    endpoint[0] = x; endpoint[1] = y; 
-    endpoint_valid = 1;
+    settings->endpoint[0] = x; settings->endpoint[1] = y; 
+    settings->endpoint_valid = 1;
 }
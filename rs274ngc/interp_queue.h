@@ -96,21 +96,21 @@ struct queued_canon
    } data;
 };
 
-std::vector < queued_canon > &qc(void);
+std::vector < queued_canon > &qc(setup_pointer settings);
 
-void enqueue_SET_FEED_RATE(double feed);
-void enqueue_DWELL(double time);
-void enqueue_SET_FEED_MODE(int mode);
-void enqueue_MIST_ON(void);
-void enqueue_MIST_OFF(void);
-void enqueue_FLOOD_ON(void);
-void enqueue_FLOOD_OFF(void);
-void enqueue_START_SPINDLE_CLOCKWISE(void);
-void enqueue_START_SPINDLE_COUNTERCLOCKWISE(void);
-void enqueue_STOP_SPINDLE_TURNING(void);
-void enqueue_SET_SPINDLE_MODE(double mode);
-void enqueue_SET_SPINDLE_SPEED(double speed);
-void enqueue_COMMENT(const char *c);
+void enqueue_SET_FEED_RATE(setup_pointer settings, double feed);
+void enqueue_DWELL(setup_pointer settings, double time);
+void enqueue_SET_FEED_MODE(setup_pointer settings, int mode);
+void enqueue_MIST_ON(setup_pointer settings);
+void enqueue_MIST_OFF(setup_pointer settings);
+void enqueue_FLOOD_ON(setup_pointer settings);
+void enqueue_FLOOD_OFF(setup_pointer settings);
+void enqueue_START_SPINDLE_CLOCKWISE(setup_pointer settings);
+void enqueue_START_SPINDLE_COUNTERCLOCKWISE(setup_pointer settings);
+void enqueue_STOP_SPINDLE_TURNING(setup_pointer settings);
+void enqueue_SET_SPINDLE_MODE(setup_pointer settings, double mode);
+void enqueue_SET_SPINDLE_SPEED(setup_pointer settings, double speed);
+void enqueue_COMMENT(setup_pointer settings, const char *c);
 int enqueue_STRAIGHT_FEED(setup_pointer settings, int l,
                           double dx, double dy, double dz, double x, double y, double z, double a, double b, double c, double u, double v, double w);
 int enqueue_STRAIGHT_TRAVERSE(setup_pointer settings, int l,
@@ -119,10 +119,10 @@ void enqueue_ARC_FEED(setup_pointer settings, int l,
                       double original_arclen,
                       double end1, double end2, double center1, double center2,
                       int turn, double end3, double a, double b, double c, double u, double v, double w);
-void enqueue_M_USER_COMMAND(int index, double p_number, double q_number);
+void enqueue_M_USER_COMMAND(setup_pointer settings, int index, double p_number, double q_number);
 void dequeue_canons(setup_pointer settings);
-void set_endpoint(double x, double y);
-void set_endpoint_zx(double z, double x);
+void set_endpoint(setup_pointer settings, double x, double y);
+void set_endpoint_zx(setup_pointer settings, double z, double x);
 int move_endpoint_and_flush(setup_pointer settings, double x, double y);
-void qc_reset(void);
-void qc_scale(double scale);
+void qc_reset(setup_pointer settings);
+void qc_scale(setup_pointer settings, double scale);
@@ -78,6 +78,7 @@ int Interp::read_a(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->a_flag != OFF), NCE_MULTIPLE_A_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->a_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->a_number = value;
   return INTERP_OK;
 }
@@ -186,6 +187,7 @@ int Interp::read_b(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->b_flag != OFF), NCE_MULTIPLE_B_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->b_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->b_number = value;
   return INTERP_OK;
 }
@@ -241,6 +243,7 @@ int Interp::read_c(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->c_flag != OFF), NCE_MULTIPLE_C_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->c_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->c_number = value;
   return INTERP_OK;
 }
@@ -292,6 +295,7 @@ int Interp::read_comment(char *line,     //!< string: line of RS274 code being p
     block->comment[n] = line[*counter];
   }
   block->comment[n] = 0;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   (*counter)++;
   return INTERP_OK;
 }
@@ -367,6 +371,7 @@ int Interp::read_d(char *line,   //!< string: line of RS274 code being processed
   CHP(read_real_value(line, counter, &value, parameters));
   block->d_number_float = value;
   block->d_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -412,6 +417,7 @@ int Interp::read_e(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->e_flag != OFF), NCE_MULTIPLE_E_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->e_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->e_number = value;
   return INTERP_OK;
 }
@@ -462,6 +468,7 @@ int Interp::read_f(char *line,   //!< string: line of RS274 code being processed
   CHP(read_real_value(line, counter, &value, parameters));
   CHKS((value < 0.0), NCE_NEGATIVE_F_WORD_USED);
   block->f_number = value;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -549,6 +556,7 @@ int Interp::read_g(char *line,   //!< string: line of RS274/NGC code being proce
           NCE_TWO_G_CODES_USED_FROM_SAME_MODAL_GROUP);
     }
     block->g_modes[mode] = value;
+    block->g_dirty |= 1 << mode;
   }
   return INTERP_OK;
 }
@@ -596,6 +604,7 @@ int Interp::read_h(char *line,   //!< string: line of RS274/NGC code being proce
   CHP(read_integer_value(line, counter, &value, parameters));
   CHKS((value < -1), NCE_NEGATIVE_H_WORD_USED);
   block->h_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->h_number = value;
   return INTERP_OK;
 }
@@ -645,6 +654,7 @@ int Interp::read_i(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->i_flag != OFF), NCE_MULTIPLE_I_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->i_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->i_number = value;
   return INTERP_OK;
 }
@@ -842,6 +852,7 @@ int Interp::read_j(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->j_flag != OFF), NCE_MULTIPLE_J_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->j_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->j_number = value;
   return INTERP_OK;
 }
@@ -891,6 +902,7 @@ int Interp::read_k(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->k_flag != OFF), NCE_MULTIPLE_K_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->k_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->k_number = value;
   return INTERP_OK;
 }
@@ -940,6 +952,7 @@ int Interp::read_l(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((value < 0), NCE_NEGATIVE_L_WORD_USED);
   block->l_number = value;
   block->l_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -1040,6 +1053,7 @@ int Interp::read_m(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->m_modes[mode] != -1),
       NCE_TWO_M_CODES_USED_FROM_SAME_MODAL_GROUP);
   block->m_modes[mode] = value;
+  block->m_dirty |= 1 << mode;
   block->m_count++;
   if (value >= 100 && value < 200) {
     block->user_m = 1;
@@ -1515,7 +1529,8 @@ int Interp::read_o(    /* ARGUMENTS                                     */
     case O_endsub:
     case O_call:
     case O_return:
-      block->o_name = strdup(oNameBuf);
+      block->o_name = string_arena_dup(&_setup.line_arena, oNameBuf);
+      CHKS((block->o_name == 0), NCE_OUT_OF_MEMORY);
       logDebug("global case:|%s|", block->o_name);
       break;
 
@@ -1537,7 +1552,8 @@ int Interp::read_o(    /* ARGUMENTS                                     */
 	  logDebug("not defining_sub:|%s|", subName);
 	}
       sprintf(fullNameBuf, "%s#%s", subName, oNameBuf);
-      block->o_name = strdup(fullNameBuf);
+      block->o_name = string_arena_dup(&_setup.line_arena, fullNameBuf);
+      CHKS((block->o_name == 0), NCE_OUT_OF_MEMORY);
       logDebug("local case:|%s|", block->o_name);
     }
 
@@ -1747,6 +1763,7 @@ int Interp::read_p(char *line,   //!< string: line of RS274/NGC code being proce
   // CHKS((value < 0.0), NCE_NEGATIVE_P_WORD_USED);
   block->p_number = value;
   block->p_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -1932,12 +1949,13 @@ int Interp::add_named_param(
       }
   }
 
-  dup = strdup(nameBuf);
+  // locals live until the call returns, globals until the interpreter goes away
+  dup = string_arena_dup(&_setup.sub_context[level].names, nameBuf);
   if(dup == 0)
   {
       ERS(NCE_OUT_OF_MEMORY);
   }
-  logDebug("Interp::add_named_param strdup[0x%x]:|%s|", dup, dup);
+  logDebug("Interp::add_named_param dup[0x%x]:|%s|", dup, dup);
   nameList->named_parameters[nameList->named_parameter_used_size++] = dup;
 
   return INTERP_OK;
@@ -2108,16 +2126,10 @@ int Interp::free_named_parameters( // ARGUMENTS
     int level,      // level to free
     setup_pointer settings)   // pointer to machine settings
 {
-    struct named_parameters_struct *nameList;
-    int i;
- 
-    nameList = &settings->sub_context[level].named_parameters;
-
-    for(i=0; i<nameList->named_parameter_used_size; i++)
-    {
-        free(nameList->named_parameters[i]);
-    }
-    nameList->named_parameter_used_size = 0;
+    // the names are in the frame's arena, which goes with them
+    settings->sub_context[level].named_parameters.named_parameter_used_size = 0;
+    settings->sub_context[level].subName = 0;
+    string_arena_reset(&settings->sub_context[level].names);
 
     return INTERP_OK;
 }
@@ -2217,12 +2229,12 @@ int Interp::read_parameter_setting(
       logDebug("setting up named param[%d]:|%s| value:%lf",
                _setup.named_parameter_occurrence, param, value);
 
-      dup = strdup(param);
+      dup = string_arena_dup(&_setup.line_arena, param);
       if(dup == 0)
       {
           ERS(NCE_OUT_OF_MEMORY);
       }
-      logDebug("Interp::read_parameter_setting strdup[0x%x]:|%s|", dup, dup);
+      logDebug("Interp::read_parameter_setting dup[0x%x]:|%s|", dup, dup);
       _setup.named_parameters[_setup.named_parameter_occurrence] = dup;
 
       _setup.named_parameter_values[_setup.named_parameter_occurrence] = value;
@@ -2389,6 +2401,7 @@ int Interp::read_q(char *line,   //!< string: line of RS274/NGC code being proce
   // CHKS((value <= 0.0), NCE_NEGATIVE_OR_ZERO_Q_VALUE_USED);
   block->q_number = value;
   block->q_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -2439,6 +2452,7 @@ int Interp::read_r(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->r_flag != OFF), NCE_MULTIPLE_R_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->r_flag = ON;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   block->r_number = value;
   return INTERP_OK;
 }
@@ -3043,6 +3057,7 @@ int Interp::read_s(char *line,   //!< string: line of RS274NGC code being proces
   CHP(read_real_value(line, counter, &value, parameters));
   CHKS((value < 0.0), NCE_NEGATIVE_SPINDLE_SPEED_USED);
   block->s_number = value;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -3090,6 +3105,7 @@ int Interp::read_t(char *line,   //!< string: line of RS274/NGC code being proce
   CHP(read_integer_value(line, counter, &value, parameters));
   CHKS((value < 0), NCE_NEGATIVE_TOOL_ID_USED);
   block->t_number = value;
+  block->dirty |= BLOCK_DIRTY_WORDS;
   return INTERP_OK;
 }
 
@@ -3166,7 +3182,6 @@ int Interp::read_text(
     int *length)       //!< a pointer to an integer to be set
 {
   int index;
-  int n;
 
   if (command == NULL) {
     if (fgets(raw_line, LINELEN, inport) == NULL) {
@@ -3212,16 +3227,7 @@ int Interp::read_text(
 
   _setup.parameter_occurrence = 0;      /* initialize parameter buffer */
 
-  // just in case free the strings
-  if(_setup.named_parameter_occurrence != 0)
-  {
-      for (n = 0; n < _setup.named_parameter_occurrence; n++)
-      {
-          // free the string
-          free(_setup.named_parameters[n]);
-      }
-  }
-  _setup.named_parameter_occurrence = 0;      /* initialize parameter buffer */
+  _setup.named_parameter_occurrence = 0;      /* strings go with _setup.line_arena */
 
   if ((line[0] == 0) || ((line[0] == '/') && (GET_BLOCK_DELETE() == ON)))
     *length = 0;
@@ -3291,6 +3297,7 @@ int Interp::read_u(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->u_flag != OFF), EMC_I18N("Multiple U words on one line"));
   CHP(read_real_value(line, counter, &value, parameters));
   block->u_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->u_number = value;
   return INTERP_OK;
 }
@@ -3307,6 +3314,7 @@ int Interp::read_v(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->v_flag != OFF), EMC_I18N("Multiple V words on one line"));
   CHP(read_real_value(line, counter, &value, parameters));
   block->v_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->v_number = value;
   return INTERP_OK;
 }
@@ -3323,6 +3331,7 @@ int Interp::read_w(char *line,   //!< string: line of RS274/NGC code being proce
   CHKS((block->w_flag != OFF), EMC_I18N("Multiple W words on one line"));
   CHP(read_real_value(line, counter, &value, parameters));
   block->w_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->w_number = value;
   return INTERP_OK;
 }
@@ -3373,6 +3382,7 @@ int Interp::read_x(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->x_flag != OFF), NCE_MULTIPLE_X_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->x_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   if(_setup.lathe_diameter_mode)
   {
     block->x_number = value / 2;
@@ -3389,6 +3399,7 @@ int Interp::read_atsign(char *line, int *counter, block_pointer block,
     (*counter)++;
     CHP(read_real_value(line, counter, &block->radius, parameters));
     block->radius_flag = ON;
+    block->dirty |= BLOCK_DIRTY_WORDS;
     return INTERP_OK;
 }
 
@@ -3398,6 +3409,7 @@ int Interp::read_carat(char *line, int *counter, block_pointer block,
     (*counter)++;
     CHP(read_real_value(line, counter, &block->theta, parameters));
     block->theta_flag = ON;
+    block->dirty |= BLOCK_DIRTY_WORDS;
     return INTERP_OK;
 }
     
@@ -3448,6 +3460,7 @@ int Interp::read_y(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->y_flag != OFF), NCE_MULTIPLE_Y_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->y_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->y_number = value;
   return INTERP_OK;
 }
@@ -3497,6 +3510,7 @@ int Interp::read_z(char *line,   //!< string: line of RS274 code being processed
   CHKS((block->z_flag != OFF), NCE_MULTIPLE_Z_WORDS_ON_ONE_LINE);
   CHP(read_real_value(line, counter, &value, parameters));
   block->z_flag = ON;
+  block->dirty |= BLOCK_DIRTY_AXES;
   block->z_number = value;
   return INTERP_OK;
 }
@@ -0,0 +1,388 @@
+/********************************************************************
+* Description: interp_snapshot.cc
+*
+*   Interpreter state snapshots for run-from-line.
+*
+*   While a program is verified or run, the modal interpreter state and
+*   the canon state are saved every SNAPSHOT_LINES lines together with the
+*   file offset of the next line. A later run can then start at line N
+*   by restoring the nearest snapshot before N and seeking, instead of
+*   interpreting the whole program up to N.
+*
+*   Snapshots are only taken at the top level of the program, outside of
+*   subroutines, o-word blocks and cutter compensation. The parameter
+*   array is only copied when it changed since the previous snapshot.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rs274ngc.h"
+#include "rs274ngc_return.h"
+#include "interp_internal.h"
+#include "rs274ngc_interp.h"
+
+#define SNAPSHOT_ALLOC_UNIT 64
+
+#define SNAPSHOT_FIELD(f) \
+   do { if (save) sp->f = _setup.f; else _setup.f = sp->f; } while (0)
+#define SNAPSHOT_ARRAY(f) \
+   do { if (save) memcpy(sp->f, _setup.f, sizeof(sp->f)); else memcpy(_setup.f, sp->f, sizeof(sp->f)); } while (0)
+
+/* Return 1 if filename still has the size and modification time the snapshots were taken with. */
+static int _snapshot_file_same(snapshot_list * sl, const char *filename)
+{
+   struct stat st;
+
+   if (strcmp(sl->filename, filename) != 0 || stat(filename, &st) != 0)
+      return 0;
+   return (st.st_mtime == sl->mtime && st.st_size == sl->size);
+}
+
+/****************************************************************************/
+
+/*! snapshot_modal
+
+Returned Value: none
+
+Side Effects:
+   If save is set the modal part of _setup is copied to sp, otherwise
+   it is copied from sp back to _setup.
+
+Called By: snapshot_save, snapshot_push, snapshot_apply
+
+*/
+
+void Interp::snapshot_modal(snapshot * sp, int save)
+{
+   SNAPSHOT_FIELD(AA_axis_offset);
+   SNAPSHOT_FIELD(AA_current);
+   SNAPSHOT_FIELD(AA_origin_offset);
+   SNAPSHOT_FIELD(BB_axis_offset);
+   SNAPSHOT_FIELD(BB_current);
+   SNAPSHOT_FIELD(BB_origin_offset);
+   SNAPSHOT_FIELD(CC_axis_offset);
+   SNAPSHOT_FIELD(CC_current);
+   SNAPSHOT_FIELD(CC_origin_offset);
+   SNAPSHOT_FIELD(u_axis_offset);
+   SNAPSHOT_FIELD(u_current);
+   SNAPSHOT_FIELD(u_origin_offset);
+   SNAPSHOT_FIELD(v_axis_offset);
+   SNAPSHOT_FIELD(v_current);
+   SNAPSHOT_FIELD(v_origin_offset);
+   SNAPSHOT_FIELD(w_axis_offset);
+   SNAPSHOT_FIELD(w_current);
+   SNAPSHOT_FIELD(w_origin_offset);
+   SNAPSHOT_FIELD(axis_offset_x);
+   SNAPSHOT_FIELD(axis_offset_y);
+   SNAPSHOT_FIELD(axis_offset_z);
+   SNAPSHOT_FIELD(origin_offset_x);
+   SNAPSHOT_FIELD(origin_offset_y);
+   SNAPSHOT_FIELD(origin_offset_z);
+   SNAPSHOT_FIELD(current_x);
+   SNAPSHOT_FIELD(current_y);
+   SNAPSHOT_FIELD(current_z);
+   SNAPSHOT_FIELD(program_x);
+   SNAPSHOT_FIELD(program_y);
+   SNAPSHOT_FIELD(program_z);
+   SNAPSHOT_ARRAY(active_g_codes);
+   SNAPSHOT_ARRAY(active_m_codes);
+   SNAPSHOT_ARRAY(active_settings);
+   SNAPSHOT_FIELD(arc_not_allowed);
+   SNAPSHOT_FIELD(control_mode);
+   SNAPSHOT_FIELD(current_pocket);
+   SNAPSHOT_FIELD(selected_pocket);
+   SNAPSHOT_FIELD(cutter_comp_radius);
+   SNAPSHOT_FIELD(cutter_comp_orientation);
+   SNAPSHOT_FIELD(cutter_comp_side);
+   SNAPSHOT_FIELD(cutter_comp_firstmove);
+   SNAPSHOT_FIELD(cycle_cc);
+   SNAPSHOT_FIELD(cycle_i);
+   SNAPSHOT_FIELD(cycle_j);
+   SNAPSHOT_FIELD(cycle_k);
+   SNAPSHOT_FIELD(cycle_l);
+   SNAPSHOT_FIELD(cycle_p);
+   SNAPSHOT_FIELD(cycle_q);
+   SNAPSHOT_FIELD(cycle_r);
+   SNAPSHOT_FIELD(distance_mode);
+   SNAPSHOT_FIELD(ijk_distance_mode);
+   SNAPSHOT_FIELD(feed_mode);
+   SNAPSHOT_FIELD(feed_override);
+   SNAPSHOT_FIELD(feed_rate);
+   SNAPSHOT_FIELD(flood);
+   SNAPSHOT_FIELD(mist);
+   SNAPSHOT_FIELD(tool_offset_index);
+   SNAPSHOT_FIELD(length_units);
+   SNAPSHOT_FIELD(motion_mode);
+   SNAPSHOT_FIELD(origin_index);
+   SNAPSHOT_FIELD(rotation_xy);
+   SNAPSHOT_FIELD(plane);
+   SNAPSHOT_FIELD(retract_mode);
+   SNAPSHOT_FIELD(speed);
+   SNAPSHOT_FIELD(spindle_mode);
+   SNAPSHOT_FIELD(speed_feed_mode);
+   SNAPSHOT_FIELD(speed_override);
+   SNAPSHOT_FIELD(spindle_turning);
+   SNAPSHOT_FIELD(tool_offset);
+   SNAPSHOT_FIELD(traverse_rate);
+   SNAPSHOT_FIELD(adaptive_feed);
+   SNAPSHOT_FIELD(feed_hold);
+   SNAPSHOT_FIELD(lathe_diameter_mode);
+}
+
+/****************************************************************************/
+
+/*! snapshot_clear
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if the snapshot list cannot be allocated.
+
+Side Effects:
+   All snapshots are freed and the current state is saved as the one
+   for line 1 of filename. With a NULL filename snapshots are just freed.
+
+Called By:
+   external programs
+   Interp::~Interp
+   Interp::snapshot_restore
+
+*/
+
+int Interp::snapshot_clear(const char *filename)
+{
+   snapshot_list *sl = _snapshot;
+   struct stat st;
+   int i;
+
+   if (sl != NULL)
+   {
+      for (i = 0; i < sl->cnt; i++)
+      {
+         if (i == 0 || sl->snap[i].parameters != sl->snap[i - 1].parameters)
+            free(sl->snap[i].parameters);
+      }
+      sl->cnt = 0;
+      sl->filename[0] = 0;
+   }
+
+   if (filename == NULL)
+      return INTERP_OK;
+
+   if (sl == NULL)
+   {
+      if ((sl = (snapshot_list *) calloc(1, sizeof(snapshot_list))) == NULL)
+         ERS("unable to allocate snapshot list");
+      _snapshot = sl;
+   }
+
+   strncpy(sl->filename, filename, sizeof(sl->filename));
+   sl->filename[sizeof(sl->filename) - 1] = 0;
+   if (stat(filename, &st) == 0)
+   {
+      sl->mtime = st.st_mtime;
+      sl->size = st.st_size;
+   }
+   sl->next_line = 1;
+
+   /* The first snapshot is the state the program starts with. */
+   return snapshot_save(0, 1);
+}
+
+/*! snapshot_save
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if memory runs out.
+
+Side Effects:
+   Called after each line with the offset and sequence number of the next
+   line. Every SNAPSHOT_LINES lines the current state is saved, or at the
+   first line after that where the interpreter is at the top level.
+
+Called By: external programs
+
+*/
+
+int Interp::snapshot_save(long offset, int line_number)
+{
+   snapshot_list *sl = _snapshot;
+   snapshot *sp, *prev, *snap;
+
+   if (sl == NULL || _snapshot_lines <= 0 || line_number < sl->next_line)
+      return INTERP_OK;
+
+   /* Only the modal state is saved, wait until nothing else is active. */
+   if (_setup.call_level != 0 || _setup.defining_sub || _setup.skipping_o || _setup.skipping_to_sub || _setup.cutter_comp_side != OFF ||
+       (_holes != NULL && _holes->cnt > 0))
+      return INTERP_OK;
+
+   if (sl->cnt == sl->max)
+   {
+      if ((snap = (snapshot *) realloc(sl->snap, (sl->max + SNAPSHOT_ALLOC_UNIT) * sizeof(snapshot))) == NULL)
+         ERS("unable to allocate snapshot");
+      sl->snap = snap;
+      sl->max += SNAPSHOT_ALLOC_UNIT;
+   }
+
+   sp = &sl->snap[sl->cnt];
+   prev = (sl->cnt > 0) ? &sl->snap[sl->cnt - 1] : NULL;
+   if (prev != NULL && memcmp(prev->parameters, _setup.parameters, sizeof(_setup.parameters)) == 0)
+      sp->parameters = prev->parameters;
+   else
+   {
+      if ((sp->parameters = (double *) malloc(sizeof(_setup.parameters))) == NULL)
+         ERS("unable to allocate snapshot");
+      memcpy(sp->parameters, _setup.parameters, sizeof(_setup.parameters));
+   }
+
+   sp->offset = offset;
+   sp->line_number = line_number;
+   SAVE_CANON_STATE(&sp->canon);
+   write_active(&_setup);       /* bring active_* up to date before they are copied */
+   snapshot_modal(sp, 1);
+
+   sl->cnt++;
+   sl->next_line = line_number + _snapshot_lines;
+
+   return INTERP_OK;
+}
+
+/*! snapshot_restore
+
+Returned Value: int (INTERP_OK)
+
+Side Effects:
+   The nearest snapshot at or before line_number is restored, *offset and
+   *snap_line_number are set to where the caller must continue reading.
+   If there is no usable snapshot nothing is restored and the caller must
+   start at the top of the file (offset 0, line 1).
+
+Called By: external programs
+
+*/
+
+int Interp::snapshot_restore(const char *filename, int line_number, long *offset, int *snap_line_number)
+{
+   snapshot_list *sl = _snapshot;
+   snapshot *sp;
+   int lo, hi, mid;
+
+   *offset = 0;
+   *snap_line_number = 1;
+
+   if (sl == NULL || sl->cnt == 0)
+      return INTERP_OK;
+
+   if (!_snapshot_file_same(sl, filename))
+      return snapshot_clear(filename);  /* program changed since the snapshots were taken */
+
+   /* Find the last snapshot with line_number <= line_number. */
+   lo = 0;
+   hi = sl->cnt;
+   while (lo < hi)
+   {
+      mid = (lo + hi) / 2;
+      if (sl->snap[mid].line_number <= line_number)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   if (lo == 0)
+      return INTERP_OK;
+   sp = &sl->snap[lo - 1];
+   snapshot_apply(sp);
+
+   *offset = sp->offset;
+   *snap_line_number = sp->line_number;
+   return INTERP_OK;
+}
+
+/*! snapshot_apply
+
+Returned Value: none
+
+Side Effects:
+   The interpreter is reset to the top level and the modal state, the
+   parameters and the canon state are copied back from sp.
+
+Called By: snapshot_restore, snapshot_pop
+
+*/
+
+void Interp::snapshot_apply(snapshot * sp)
+{
+   reset();
+   _setup.skipping_to_sub = 0;
+   snapshot_modal(sp, 0);
+   _setup.active_stale = 0;     /* active_* came with the snapshot */
+   memcpy(_setup.parameters, sp->parameters, sizeof(_setup.parameters));
+   RESTORE_CANON_STATE(&sp->canon);
+}
+
+/*! snapshot_push
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if the snapshot cannot be allocated.
+
+Side Effects:
+   The current modal state, parameters and canon state are kept aside
+   until snapshot_pop, so a program can be interpreted without moving the
+   machine and the interpreter put back the way it was. There is one
+   level, a second push replaces the first. Queued cutter compensation
+   moves are not kept.
+
+Called By: external programs
+
+*/
+
+int Interp::snapshot_push()
+{
+   snapshot *sp = _snapshot_pushed;
+
+   if (sp == NULL)
+   {
+      if ((sp = (snapshot *) calloc(1, sizeof(snapshot))) == NULL)
+         ERS("unable to allocate snapshot");
+      if ((sp->parameters = (double *) malloc(sizeof(_setup.parameters))) == NULL)
+      {
+         free(sp);
+         ERS("unable to allocate snapshot");
+      }
+      _snapshot_pushed = sp;
+   }
+
+   memcpy(sp->parameters, _setup.parameters, sizeof(_setup.parameters));
+   SAVE_CANON_STATE(&sp->canon);
+   write_active(&_setup);       /* bring active_* up to date before they are copied */
+   snapshot_modal(sp, 1);
+   return INTERP_OK;
+}
+
+/*! snapshot_pop
+
+Returned Value: int (INTERP_OK)
+
+Side Effects:
+   The state kept by snapshot_push is restored and released. Without a
+   push nothing is changed.
+
+Called By: external programs
+
+*/
+
+int Interp::snapshot_pop()
+{
+   snapshot *sp = _snapshot_pushed;
+
+   if (sp == NULL)
+      return INTERP_OK;
+
+   snapshot_apply(sp);
+   free(sp->parameters);
+   free(sp);
+   _snapshot_pushed = NULL;
+   return INTERP_OK;
+}
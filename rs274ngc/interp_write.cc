@@ -24,12 +24,14 @@
 #include "rs274ngc_interp.h"
 
 /****************************************************************************/
-/*! write_g_codes
+/*! mark_active
 
 Returned Value: int (INTERP_OK)
 
 Side effects:
-   The active_g_codes in the settings are updated.
+   The active_g_codes, active_m_codes and active_settings arrays are
+   marked out of date. The sequence number and the non-modal codes of
+   the block are saved for write_active.
 
 Called by:
    Interp::execute
@@ -37,6 +39,62 @@ Called by:
 
 The block may be NULL.
 
+Only the GUI and the error path read the active arrays, so they are
+not rebuilt after every block. The parts of the report that come from
+the block are kept here, because block1 is overwritten by the next read.
+
+*/
+
+int Interp::mark_active(block_pointer block,     //!< pointer to a block of RS274/NGC instructions
+                        setup_pointer settings)  //!< pointer to machine settings
+{
+  settings->active_stale = 1;
+  settings->active_sequence_number = settings->sequence_number;
+  settings->active_block_g0 = ((block == NULL) ? -1 : block->g_modes[0]);
+  settings->active_block_m4 = ((block == NULL) ? -1 : block->m_modes[4]);
+  settings->active_block_m6 = ((block == NULL) ? -1 : block->m_modes[6]);
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+/*! write_active
+
+Returned Value: int (INTERP_OK)
+
+Side effects:
+   If they are out of date, the active_g_codes, active_m_codes and
+   active_settings arrays are rebuilt from the settings.
+
+Called by:
+   Interp::active_g_codes
+   Interp::active_m_codes
+   Interp::active_settings
+   Interp::snapshot_save
+
+*/
+
+int Interp::write_active(setup_pointer settings)  //!< pointer to machine settings
+{
+  if (settings->active_stale) {
+    write_g_codes(settings);
+    write_m_codes(settings);
+    write_settings(settings);
+    settings->active_stale = 0;
+  }
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+/*! write_g_codes
+
+Returned Value: int (INTERP_OK)
+
+Side effects:
+   The active_g_codes in the settings are updated.
+
+Called by:
+   Interp::write_active
+
 This writes active g_codes into the settings->active_g_codes array by
 examining the interpreter settings. The array of actives is composed
 of ints, so (to handle codes like 59.1) all g_codes are reported as
@@ -45,8 +103,8 @@ ints ten times the actual value. For example, 59.1 is reported as 591.
 The correspondence between modal groups and array indexes is as follows
 (no apparent logic to it).
 
-The group 0 entry is taken from the block (if there is one), since its
-codes are not modal.
+The group 0 entry is taken from the last executed block (see
+mark_active), since its codes are not modal.
 
 group 0  - gez[2]  g4, g10, g28, g30, g53, g92 g92.1, g92.2, g92.3 - misc
 group 1  - gez[1]  g0, g1, g2, g3, g38.2, g80, g81, g82, g83, g84, g85,
@@ -70,15 +128,14 @@ group 16 - gez[15] g7,g8 - lathe diameter mode
 
 */
 
-int Interp::write_g_codes(block_pointer block,   //!< pointer to a block of RS274/NGC instructions
-                         setup_pointer settings)        //!< pointer to machine settings                 
+int Interp::write_g_codes(setup_pointer settings)        //!< pointer to machine settings
 {
   int *gez;
 
   gez = settings->active_g_codes;
-  gez[0] = settings->sequence_number;
+  gez[0] = settings->active_sequence_number;
   gez[1] = settings->motion_mode;
-  gez[2] = ((block == NULL) ? -1 : block->g_modes[0]);
+  gez[2] = settings->active_block_g0;
   switch(settings->plane) {
   case CANON_PLANE_XY:
       gez[3] = G_17;
@@ -135,26 +192,23 @@ Side effects:
    The settings->active_m_codes are updated.
 
 Called by:
-   Interp::execute
-   Interp::init
+   Interp::write_active
 
 This is testing only the feed override to see if overrides is on.
 Might add check of speed override.
 
 */
 
-int Interp::write_m_codes(block_pointer block,   //!< pointer to a block of RS274/NGC instructions
-                         setup_pointer settings)        //!< pointer to machine settings                 
+int Interp::write_m_codes(setup_pointer settings)        //!< pointer to machine settings
 {
   int *emz;
 
   emz = settings->active_m_codes;
-  emz[0] = settings->sequence_number;   /* 0 seq number  */
-  emz[1] = (block == NULL) ? -1 : block->m_modes[4];    /* 1 stopping    */
+  emz[0] = settings->active_sequence_number;   /* 0 seq number  */
+  emz[1] = settings->active_block_m4;    /* 1 stopping    */
   emz[2] = (settings->spindle_turning == CANON_STOPPED) ? 5 :   /* 2 spindle     */
     (settings->spindle_turning == CANON_CLOCKWISE) ? 3 : 4;
-  emz[3] =                      /* 3 tool change */
-    (block == NULL) ? -1 : block->m_modes[6];
+  emz[3] = settings->active_block_m6;  /* 3 tool change */
   emz[4] =                      /* 4 mist        */
     (settings->mist == ON) ? 7 : (settings->flood == ON) ? -1 : 9;
   emz[5] =                      /* 5 flood       */
@@ -186,8 +240,7 @@ Side effects:
   sequence number, feed, and speed settings.
 
 Called by:
-  Interp::execute
-  Interp::init
+  Interp::write_active
 
 */
 
@@ -196,7 +249,7 @@ int Interp::write_settings(setup_pointer settings)       //!< pointer to machine
   double *vals;
 
   vals = settings->active_settings;
-  vals[0] = settings->sequence_number;  /* 0 sequence number */
+  vals[0] = settings->active_sequence_number;  /* 0 sequence number */
   vals[1] = settings->feed_rate;        /* 1 feed rate       */
   vals[2] = settings->speed;    /* 2 spindle speed   */
 
@@ -15,6 +15,7 @@
 * Last change:
 ********************************************************************/
 
+#include <stdlib.h>     /* malloc() */
 #include <string.h>     /* memcpy() */
 #include "emc.h"
 #include "interpl.h"    // these decls
@@ -22,8 +23,10 @@
 
 MSG_INTERP_LIST::MSG_INTERP_LIST()
 {
-//    linked_list_ptr = new LinkedList;
-   linked_list_ptr = new RCS_LINKED_LIST;
+   spare_block = NULL;
+   head_block = tail_block = new_block();
+   head_index = tail_index = 0;
+   size = 0;
 
    next_line_number = 0;
    line_number = 0;
@@ -31,11 +34,29 @@ MSG_INTERP_LIST::MSG_INTERP_LIST()
 
 MSG_INTERP_LIST::~MSG_INTERP_LIST()
 {
-   if (NULL != linked_list_ptr)
+   MSG_INTERP_LIST_BLOCK *b;
+
+   while (NULL != head_block)
    {
-      delete linked_list_ptr;
-      linked_list_ptr = NULL;
+      b = head_block->next;
+      free(head_block);
+      head_block = b;
    }
+   free(spare_block);
+   tail_block = NULL;
+}
+
+// returns an empty block, the spare one if the consumer left one
+MSG_INTERP_LIST_BLOCK *MSG_INTERP_LIST::new_block()
+{
+   MSG_INTERP_LIST_BLOCK *b;
+
+   b = (MSG_INTERP_LIST_BLOCK *) __sync_lock_test_and_set(&spare_block, NULL);
+   if (NULL == b)
+      b = (MSG_INTERP_LIST_BLOCK *) malloc(sizeof(MSG_INTERP_LIST_BLOCK));
+   if (NULL != b)
+      b->next = NULL;
+   return b;
 }
 
 // sets the line number used for subsequent appends
@@ -48,6 +69,9 @@ int MSG_INTERP_LIST::set_line_number(int line)
 
 int MSG_INTERP_LIST::append(emc_command_msg_t * cmd_ptr)
 {
+   MSG_INTERP_LIST_NODE *node_ptr;
+   MSG_INTERP_LIST_BLOCK *b;
+
    /* check for invalid data */
    if (NULL == cmd_ptr)
    {
@@ -61,18 +85,28 @@ int MSG_INTERP_LIST::append(emc_command_msg_t * cmd_ptr)
       return -1;
    }
 
-   if (NULL == linked_list_ptr)
+   if (NULL == tail_block)
    {
       return -1;
    }
-   // fill in the MSG_INTERP_LIST_NODE
-   temp_node.line_number = next_line_number;
-   memcpy(temp_node.command.commandbuf, cmd_ptr, sizeof(emc_command_msg_t));
 
-   // stick it on the list
-   linked_list_ptr->store_at_tail(&temp_node,
-                                  sizeof(emc_command_msg_t) + sizeof(temp_node.line_number) +
-                                  sizeof(temp_node.dummy) + 32 + (32 - sizeof(emc_command_msg_t) % 32), 1);
+   if (tail_index == INTERP_LIST_BLOCK_SIZE)
+   {
+      if (NULL == (b = new_block()))
+      {
+         BUG("MSG_INTERP_LIST::append : unable to allocate block\n");
+         return -1;
+      }
+      tail_block->next = b;
+      tail_block = b;
+      tail_index = 0;
+   }
+
+   // fill in the node, then publish it to the consumer
+   node_ptr = &tail_block->node[tail_index++];
+   node_ptr->line_number = next_line_number;
+   memcpy(&node_ptr->command, cmd_ptr, sizeof(emc_command_msg_t));
+   __sync_fetch_and_add(&size, 1);
 
 #ifdef DEBUG_RTSTEPPEREMC
    switch (cmd_ptr->msg.type)
@@ -81,19 +115,19 @@ int MSG_INTERP_LIST::append(emc_command_msg_t * cmd_ptr)
             {
                 emc_traj_linear_move_msg_t *p = (emc_traj_linear_move_msg_t *)cmd_ptr;
                 DBG("MSG_INTERP_LIST::append() cmd=%s list_size=%d, line=%d x_pos=%0.5f, y_pos=%0.5f, z_pos=%0.5f, vel=%0.5f\n", 
-                    lookup_message(cmd_ptr->msg.type), linked_list_ptr->list_size, temp_node.line_number, p->end.tran.x, p->end.tran.y, p->end.tran.z, p->vel);
+                    lookup_message(cmd_ptr->msg.type), size, node_ptr->line_number, p->end.tran.x, p->end.tran.y, p->end.tran.z, p->vel);
             }
             break;
         case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
             {
                 emc_traj_circular_move_msg_t *p = (emc_traj_circular_move_msg_t *)cmd_ptr;
                 DBG("MSG_INTERP_LIST::append() cmd=%s list_size=%d, line=%d x_pos=%0.5f, y_pos=%0.5f, z_pos=%0.5f, vel=%0.5f\n", 
-                    lookup_message(cmd_ptr->msg.type), linked_list_ptr->list_size, temp_node.line_number, p->end.tran.x, p->end.tran.y, p->end.tran.z, p->vel);
+                    lookup_message(cmd_ptr->msg.type), size, node_ptr->line_number, p->end.tran.x, p->end.tran.y, p->end.tran.z, p->vel);
             }
             break;
         default:
             DBG("MSG_INTERP_LIST::append() cmd=%s list_size=%d, line=%d\n",
-                lookup_message(cmd_ptr->msg.type), linked_list_ptr->list_size, temp_node.line_number);
+                lookup_message(cmd_ptr->msg.type), size, node_ptr->line_number);
             break;
    }
 #endif
@@ -105,25 +139,31 @@ emc_command_msg_t *MSG_INTERP_LIST::get()
 {
    emc_command_msg_t *ret;
    MSG_INTERP_LIST_NODE *node_ptr;
+   MSG_INTERP_LIST_BLOCK *b;
 
-   if (NULL == linked_list_ptr)
+   if (NULL == head_block || __sync_fetch_and_add(&size, 0) == 0)
    {
       line_number = 0;
       return NULL;
    }
 
-   node_ptr = (MSG_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
-
-   if (NULL == node_ptr)
+   if (head_index == INTERP_LIST_BLOCK_SIZE)
    {
-      line_number = 0;
-      return NULL;
+      // block is empty, the producer already linked the next one
+      b = head_block;
+      head_block = b->next;
+      head_index = 0;
+      free(__sync_lock_test_and_set(&spare_block, b));
    }
+
+   node_ptr = &head_block->node[head_index++];
+
    // save line number of this one, for use by get_line_number
    line_number = node_ptr->line_number;
 
-   // get it off the front
-   ret = (emc_command_msg_t *) ((char *) node_ptr->command.commandbuf);
+   // the node stays valid until the next get()
+   ret = &node_ptr->command;
+   __sync_fetch_and_sub(&size, 1);
 
 #ifdef DEBUG_RTSTEPPEREMC
    switch (ret->msg.type)
@@ -154,27 +194,23 @@ emc_command_msg_t *MSG_INTERP_LIST::get()
 
 void MSG_INTERP_LIST::clear()
 {
-   if (NULL != linked_list_ptr)
-   {
-      linked_list_ptr->delete_members();
-   }
+   while (NULL != get())
+      ;
 }
 
 void MSG_INTERP_LIST::print()
 {
-   emc_command_msg_t *cmd;
+   MSG_INTERP_LIST_BLOCK *b = head_block;
+   int i = head_index, n;
 
-   if (NULL == linked_list_ptr)
+   for (n = len(); n > 0 && NULL != b; n--)
    {
-      return;
-   }
-
-   cmd = (emc_command_msg_t *) linked_list_ptr->get_head();
-
-   while (NULL != cmd)
-   {
-      DBG("%d ", cmd->msg.type);
-      cmd = (emc_command_msg_t *) linked_list_ptr->get_next();
+      if (i == INTERP_LIST_BLOCK_SIZE)
+      {
+         b = b->next;
+         i = 0;
+      }
+      DBG("%d ", b->node[i++].command.msg.type);
    }
 
    DBG("\n");
@@ -182,12 +218,7 @@ void MSG_INTERP_LIST::print()
 
 int MSG_INTERP_LIST::len()
 {
-   if (NULL == linked_list_ptr)
-   {
-      return 0;
-   }
-
-   return ((int) linked_list_ptr->list_size);
+   return __sync_fetch_and_add(&size, 0);
 }
 
 int MSG_INTERP_LIST::get_line_number()
@@ -14,37 +14,24 @@
 #ifndef _INTERPL_H
 #define _INTERPL_H
 
-#include "linklist.h"
-
-#define MAX_MSG_COMMAND_SIZE 1000
+#define INTERP_LIST_BLOCK_SIZE 256       /* commands per block */
 
 // these go on the interp list
 struct MSG_INTERP_LIST_NODE
 {
    int line_number;             // line number it was on
-   union _dummy_union
-   {
-      int i;
-      long l;
-      double d;
-      float f;
-      long long ll;
-      long double ld;
-   } dummy;                     // paranoid alignment variable.
+   emc_command_msg_t command;   // the MSG command
+};
 
-   union _command_union
-   {
-      char commandbuf[MAX_MSG_COMMAND_SIZE];    // the MSG command;
-      int i;
-      long l;
-      double d;
-      float f;
-      long long ll;
-      long double ld;
-   } command;
+// the interp list is a chain of these, emptied blocks are reused
+struct MSG_INTERP_LIST_BLOCK
+{
+   MSG_INTERP_LIST_BLOCK *next;
+   MSG_INTERP_LIST_NODE node[INTERP_LIST_BLOCK_SIZE];
 };
 
-// here's the interp list itself
+// here's the interp list itself, a queue with one producer (append) and one
+// consumer (get, clear) that may run in different threads without a lock
 class MSG_INTERP_LIST
 {
  public:
@@ -60,13 +47,16 @@ class MSG_INTERP_LIST
    int len();
 
  private:
-//    class LinkedList * linked_list_ptr;
-     class RCS_LINKED_LIST * linked_list_ptr;
-   MSG_INTERP_LIST_NODE temp_node;      // filled in and put on the list
-   int next_line_number;        // line number used to fill temp_node
+   MSG_INTERP_LIST_BLOCK *new_block();
+
+   MSG_INTERP_LIST_BLOCK *head_block;   // consumer side, next node to get
+   int head_index;
+   MSG_INTERP_LIST_BLOCK *tail_block;   // producer side, next node to fill
+   int tail_index;
+   MSG_INTERP_LIST_BLOCK *spare_block;  // last emptied block, handed back to the producer
+   volatile int size;           // nodes on the list, shared by both sides
+   int next_line_number;        // line number used for the next append
    int line_number;             // line number of node from get()
 };
 
-extern MSG_INTERP_LIST interp_list;     /* MSG Union, for interpreter */
-
 #endif /* _INTERPL_H */
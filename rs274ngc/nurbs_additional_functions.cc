@@ -14,11 +14,6 @@
 #include <algorithm>
 #include "canon.h"
 
-static void unit(PLANE_POINT &p) {
-    double h = hypot(p.X, p.Y);
-    if(h != 0) { p.X/=h; p.Y/=h; }
-}
-
 std::vector<unsigned int> knot_vector_creator(unsigned int n, unsigned int k) {
     
     unsigned int i;
@@ -35,75 +30,53 @@ std::vector<unsigned int> knot_vector_creator(unsigned int n, unsigned int k) {
  
 }
 
-double Nmix(unsigned int i, unsigned int k, double u, 
-                    std::vector<unsigned int> knot_vector) {
-
-    if (k == 1){
-        if ((u >= knot_vector[i]) && (u <= knot_vector[i+1])) {
-            return 1;
-        } else {
-            return 0;}
-    } else if (k > 1) {
-        if ((knot_vector[i+k-1]-knot_vector[i] == 0) && 
-            (knot_vector[i+k]-knot_vector[i+1] != 0)) {
-            return ((knot_vector[i+k] - u)*Nmix(i+1,k-1,u,knot_vector))/
-                    (knot_vector[i+k]-knot_vector[i+1]);
-        } else if ((knot_vector[i+k]-knot_vector[i+1] == 0) && 
-            (knot_vector[i+k-1]-knot_vector[i] != 0)) {
-            return ((u - knot_vector[i])*Nmix(i,k-1,u,knot_vector))/
-                    (knot_vector[i+k-1]-knot_vector[i]);
-        } else if ((knot_vector[i+k-1]-knot_vector[i] == 0) && 
-            (knot_vector[i+k]-knot_vector[i+1] == 0)) {
-            return 0;
-        } else {
-            return ((u - knot_vector[i])*Nmix(i,k-1,u,knot_vector))/
-                    (knot_vector[i+k-1]-knot_vector[i]) + ((knot_vector[i+k] - u)*
-                    Nmix(i+1,k-1,u,knot_vector))/(knot_vector[i+k]-knot_vector[i+1]);
-        }
-    }
-    else return -1;
-}
-
+/* Evaluate the NURBS at u with the de Boor algorithm on homogeneous control
+ * points. work must hold k entries. If tangent is not NULL it gets dC/du. */
+PLANE_POINT nurbs_deboor(double u, unsigned int k,
+                  const std::vector<CONTROL_POINT> &nurbs_control_points,
+                  const std::vector<unsigned int> &knot_vector,
+                  std::vector<CONTROL_POINT> &work, PLANE_POINT *tangent) {
 
+    unsigned int n = nurbs_control_points.size() - 1, p = k - 1;
+    unsigned int s, r, j;
+    CONTROL_POINT d = {0, 0, 0};
+    PLANE_POINT point;
+    double alpha, scale = 0;
 
-double Rden(double u, unsigned int k,
-                  std::vector<CONTROL_POINT> nurbs_control_points,
-                  std::vector<unsigned int> knot_vector) {
+    /* Knot span with knot[s] <= u < knot[s+1], the last span includes its end. */
+    s = std::upper_bound(knot_vector.begin(), knot_vector.begin() + n + 1, u) - knot_vector.begin() - 1;
+    if (s < p) s = p;
+    if (s > n) s = n;
 
-    unsigned int i;
-    double d = 0.0;   
-    for (i=0; i<(nurbs_control_points.size()); i++)
-        d = d + Nmix(i,k,u,knot_vector)*nurbs_control_points[i].W;
-    return d;
-}
+    for (j=0; j<=p; j++) {
+        const CONTROL_POINT &cp = nurbs_control_points[j + s - p];
+        work[j].X = cp.X * cp.W;
+        work[j].Y = cp.Y * cp.W;
+        work[j].W = cp.W;
+    }
 
-PLANE_POINT nurbs_point(double u, unsigned int k, 
-                  std::vector<CONTROL_POINT> nurbs_control_points,
-                  std::vector<unsigned int> knot_vector) {
+    for (r=1; r<=p; r++) {
+        if (r == p && knot_vector[s+1] != knot_vector[s]) {
+            /* The last two points of the triangle give the derivative. */
+            scale = p / (double)(knot_vector[s+1] - knot_vector[s]);
+            d.X = scale * (work[p].X - work[p-1].X);
+            d.Y = scale * (work[p].Y - work[p-1].Y);
+            d.W = scale * (work[p].W - work[p-1].W);
+        }
+        for (j=p; j>=r; j--) {
+            double den = knot_vector[j+1+s-r] - knot_vector[j+s-p];
+            alpha = den != 0 ? (u - knot_vector[j+s-p]) / den : 0;
+            work[j].X = (1 - alpha) * work[j-1].X + alpha * work[j].X;
+            work[j].Y = (1 - alpha) * work[j-1].Y + alpha * work[j].Y;
+            work[j].W = (1 - alpha) * work[j-1].W + alpha * work[j].W;
+        }
+    }
 
-    unsigned int i;
-    PLANE_POINT point;
-    point.X = 0;
-    point.Y = 0;
-    for (i=0; i<(nurbs_control_points.size()); i++) {
-        point.X = point.X + nurbs_control_points[i].X*Nmix(i,k,u,knot_vector)
-	*nurbs_control_points[i].W/Rden(u,k,nurbs_control_points,knot_vector);
-        point.Y = point.Y + nurbs_control_points[i].Y*Nmix(i,k,u,knot_vector)
-	*nurbs_control_points[i].W/Rden(u,k,nurbs_control_points,knot_vector);
+    point.X = work[p].X / work[p].W;
+    point.Y = work[p].Y / work[p].W;
+    if (tangent) {
+        tangent->X = (d.X - d.W * point.X) / work[p].W;
+        tangent->Y = (d.Y - d.W * point.Y) / work[p].W;
     }
     return point;
 }
-
-#define DU (1e-5)
-PLANE_POINT nurbs_tangent(double u, unsigned int k,
-                  std::vector<CONTROL_POINT> nurbs_control_points,
-                  std::vector<unsigned int> knot_vector) {
-    unsigned int n = nurbs_control_points.size() - 1;
-    double umax = n - k + 2;
-    double ulo = std::max(0.0, u-DU), uhi = std::min(umax, u+DU);
-    PLANE_POINT P1 = nurbs_point(ulo, k, nurbs_control_points, knot_vector);
-    PLANE_POINT P3 = nurbs_point(uhi, k, nurbs_control_points, knot_vector);
-    PLANE_POINT r = {(P3.X - P1.X) / (uhi-ulo), (P3.Y - P1.Y) / (uhi-ulo)};
-    unit(r);
-    return r;
-}
@@ -17,6 +17,8 @@
 #define ACTIVE_G_CODES 16
 #define ACTIVE_M_CODES 10
 #define ACTIVE_SETTINGS 3
+#define BLOCK_G_CODES 16
+#define BLOCK_M_CODES 11
 
 /**********************/
 /* INCLUDE DIRECTIVES */
@@ -35,6 +37,11 @@ typedef struct block_struct block;
 #ifndef JAVA_DIAG_APPLET
 typedef block *block_pointer;
 #endif
+typedef struct preparse_struct preparse;
+typedef struct preparse_line_struct preparse_line;
+typedef struct snapshot_struct snapshot;
+typedef struct snapshot_list_struct snapshot_list;
+typedef struct hole_run_struct hole_run;
 
 typedef bool ON_OFF;
 
@@ -65,7 +72,7 @@ typedef int (Interp::*read_function_pointer) (char *, int *, block_pointer, doub
 #ifdef DEBUG_RS274NGC
 #define logDebug DBG
 #else
-#define logDebug(args...)
+#define logDebug(args...) do { if (0) emc_logger_cb(args); } while (0)
 #endif
 
 #endif
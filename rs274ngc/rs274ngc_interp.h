@@ -1,6 +1,7 @@
 #ifndef RS274NGC_INTERP_H
 #define RS274NGC_INTERP_H
 #include "rs274ngc.h"
+#include "interp_internal.h"   // setup, one per instance
 
 class Interp
 {
@@ -40,6 +41,24 @@ class Interp
 // read the mdi or the next line of the open NC code file
    int read(const char *mdi = 0);
 
+// parallel pre-parse of an NC code file opened by the caller (interp_preparse.cc)
+   int preparse_open(FILE * inport);
+   int preparse_read();         // advance to the next line, INTERP_ENDFILE at end of file
+   int preparse_execute(int line_no);   // execute the line returned by preparse_read
+   int preparse_close();        // leave inport positioned after the last executed line
+   long preparse_tell();        // file offset after the line returned by preparse_read
+
+// interpreter state snapshots for run-from-line (interp_snapshot.cc)
+   int snapshot_clear(const char *filename);    // drop old snapshots, new ones belong to filename
+   int snapshot_save(long offset, int line_no); // call after each line with the next line's offset
+   int snapshot_restore(const char *filename, int line_no, long *offset, int *snap_line_no);
+   int snapshot_push();         // keep the current state aside, one level
+   int snapshot_pop();          // go back to the state kept by snapshot_push
+
+// canned cycle hole ordering (interp_holes.cc)
+   int hole_order_flush();      // drill the held holes, call before FINISH after an mdi command
+   double hole_order_saved();   // rapid distance in mm saved so far by reordering holes
+
 // reset yourself
    int reset();
 
@@ -64,6 +83,9 @@ class Interp
 // copy active M codes into array [0]..[9]
    void active_m_codes(int *codes);
 
+// copy the M codes of the last executed block into array [0]..[10], -1 if unused
+   void block_m_codes(int *codes);
+
 // copy active F, S settings into array [0]..[2]
    void active_settings(double *settings);
 
@@ -87,6 +109,9 @@ class Interp
 // return the current sequence number (how many lines read)
    int sequence_number();
 
+// return the carousel slot of the tool in the spindle
+   int current_pocket();
+
 // copy the function name from the stack_index'th position of the
 // function call stack at the time of the most recent error into
 // the function name string, but stop at max_size if the name is longer
@@ -222,6 +247,7 @@ class Interp
    int convert_tool_change(setup_pointer settings);
    int convert_tool_length_offset(int g_code, block_pointer block, setup_pointer settings);
    int convert_tool_select(block_pointer block, setup_pointer settings);
+   int cycle_drill(block_pointer block, CANON_PLANE plane, double end1, double end2, double end3, double clear, double delta, double retract, int chip_break);
    int cycle_feed(block_pointer block, CANON_PLANE plane, double end1, double end2, double end3);
    int cycle_traverse(block_pointer block, CANON_PLANE plane, double end1, double end2, double end3);
    int enhance_block(block_pointer block, setup_pointer settings);
@@ -272,6 +298,7 @@ class Interp
    int read_integer_unsigned(char *line, int *counter, int *integer_ptr);
    int read_integer_value(char *line, int *counter, int *integer_ptr, double *parameters);
    int read_items(block_pointer block, char *line, double *parameters);
+   int read_synch();
    int read_j(char *line, int *counter, block_pointer block, double *parameters);
    int read_k(char *line, int *counter, block_pointer block, double *parameters);
    int read_l(char *line, int *counter, block_pointer block, double *parameters);
@@ -309,8 +336,21 @@ class Interp
    int refresh_actual_position(setup_pointer settings);
    void rotate(double *x, double *y, double t);
    int set_probe_data(setup_pointer settings);
-   int write_g_codes(block_pointer block, setup_pointer settings);
-   int write_m_codes(block_pointer block, setup_pointer settings);
+   int preparse_fill(preparse * pp);
+   int preparse_one(preparse_line * pl);
+   int preparse_last(int status);
+   static void *preparse_worker(void *arg);
+   void snapshot_modal(snapshot * sp, int save);
+   void snapshot_apply(snapshot * sp);
+   int hole_order_hold(int motion, double x, double y, double r, double bottom, double old_z, int *held);
+   int hole_order_grow();
+   int hole_order_continues(block_pointer block);
+   void hole_order_tour(hole_run * hr);
+   void hole_order_clear();
+   int mark_active(block_pointer block, setup_pointer settings);
+   int write_active(setup_pointer settings);
+   int write_g_codes(setup_pointer settings);
+   int write_m_codes(setup_pointer settings);
    int write_settings(setup_pointer settings);
    int unwrap_rotary(double *, double, double, double, char);
    bool isreadonly(int index);
@@ -353,7 +393,24 @@ class Interp
    read_function_pointer _readers[256];
    static const read_function_pointer default_readers[256];
 
-   static setup _setup;
+   setup _setup;
+   char _saved_error[LINELEN + 1];      // text for INTERP_ERROR, see setError
+   char _parameter_file[LINELEN];       // ini: RS274NGC, PARAMETER_FILE in USER_HOME_DIR
+
+   unsigned int _nurbs_order;   // G5.2 control points collected so far
+   std::vector < CONTROL_POINT > _nurbs_control_points;
+
+   preparse *_preparse;
+   int _preparse_threads;       // ini: RS274NGC, PREPARSE_THREADS (0 = one per cpu)
+   static __thread int _preparse_worker;        // set in worker threads, errors are not recorded
+
+   snapshot_list *_snapshot;
+   int _snapshot_lines;         // ini: RS274NGC, SNAPSHOT_LINES (0 = no snapshots)
+   snapshot *_snapshot_pushed;  // state kept by snapshot_push, NULL if none
+
+   hole_run *_holes;
+   int _hole_order_ms;          // ini: RS274NGC, HOLE_ORDER_MS (0 = holes are drilled in program order)
+   double _hole_order_saved;    // mm of rapid travel saved by reordering
 
    enum
    {
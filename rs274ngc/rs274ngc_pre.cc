@@ -96,14 +96,34 @@ extern char *_rs274ngc_errors[];
 
 //#define LOG_FILE &_setup.log_file[0]
 
-static char RS274NGC_PARAMETER_FILE[LINELEN] = RS274NGC_PARAMETER_FILE_NAME_DEFAULT;
-
-Interp::Interp():log_file(0)
+Interp::Interp():log_file(0), _nurbs_order(0), _preparse(0), _preparse_threads(0), _snapshot(0), _snapshot_lines(SNAPSHOT_LINES_DEFAULT),
+   _snapshot_pushed(0), _holes(0), _hole_order_ms(0), _hole_order_saved(0.0)
 {
+   strcpy(_parameter_file, RS274NGC_PARAMETER_FILE_NAME_DEFAULT);
+   _setup.block1.dirty = 0;     /* first init_block() is a full reset */
 }
 
 Interp::~Interp()
 {
+   int i;
+
+   string_arena_free(&_setup.line_arena);
+   string_arena_free(&_setup.queue_comments);
+   for (i = 0; i < INTERP_SUB_ROUTINE_LEVELS; i++)
+      string_arena_free(&_setup.sub_context[i].names);
+   snapshot_clear(NULL);
+   free(_snapshot);
+   if (_snapshot_pushed)
+   {
+      free(_snapshot_pushed->parameters);
+      free(_snapshot_pushed);
+   }
+   if (_holes)
+   {
+      free(_holes->held);
+      free(_holes->tour);
+      free(_holes);
+   }
    if (log_file)
    {
       fclose(log_file);
@@ -226,6 +246,11 @@ int Interp::execute(const char *command)
 
    logDebug("MDImode = 1\n");
    logDebug("Interp::execute(%s)\n", command);
+
+   // canned cycle holes held for reordering are drilled before anything else happens
+   if (_holes != NULL && _holes->cnt > 0 && !hole_order_continues(&(_setup.block1)))
+      CHP(hole_order_flush());
+
    // process control functions -- will skip if skipping
    //  if (_setup.block1.o_number != 0)
    if ((_setup.block1.o_number != 0) || (_setup.block1.o_name != 0))
@@ -279,10 +304,6 @@ int Interp::execute(const char *command)
       logDebug("storing param\n");
       logDebug("storing param:|%s|\n", _setup.named_parameters[n]);
       CHP(store_named_param(_setup.named_parameters[n], _setup.named_parameter_values[n]));
-
-      // free the string
-      logDebug("freeing param[%d]:|%s|:0x%x\n", n, _setup.named_parameters[n], _setup.named_parameters[n]);
-      free(_setup.named_parameters[n]);
    }
 
    _setup.named_parameter_occurrence = 0;
@@ -290,9 +311,7 @@ int Interp::execute(const char *command)
    if (_setup.line_length != 0)
    {    /* line not blank */
       status = execute_block(&(_setup.block1), &_setup);
-      write_g_codes(&(_setup.block1), &_setup);
-      write_m_codes(&(_setup.block1), &_setup);
-      write_settings(&_setup);
+      mark_active(&(_setup.block1), &_setup);    /* active_* are rebuilt when read */
       if ((status != INTERP_OK) && (status != INTERP_EXECUTE_FINISH) && (status != INTERP_EXIT))
          ERP(status);
    }
@@ -328,7 +347,7 @@ written. Otherwise, the default parameter file name is used.
 
 int Interp::exit()
 {
-   save_parameters(RS274NGC_PARAMETER_FILE, _setup.parameters);
+   save_parameters(_parameter_file, _setup.parameters);
    reset();
 
    return INTERP_OK;
@@ -403,7 +422,7 @@ int Interp::init()
 
    _setup.length_units = GET_EXTERNAL_LENGTH_UNIT_TYPE();
    USE_LENGTH_UNITS(_setup.length_units);
-   CHP(restore_parameters(RS274NGC_PARAMETER_FILE));
+   CHP(restore_parameters(_parameter_file));
    pars = _setup.parameters;
    _setup.origin_index = (int) (pars[5220] + 0.0001);
    if (_setup.origin_index < 1 || _setup.origin_index > 9)
@@ -558,9 +577,7 @@ int Interp::init()
    synch();     //synch first, then update the interface
 
 
-   write_g_codes((block_pointer) NULL, &_setup);
-   write_m_codes((block_pointer) NULL, &_setup);
-   write_settings(&_setup);
+   mark_active((block_pointer) NULL, &_setup);
 
    init_tool_parameters();
    // Synch rest of settings to external world
@@ -719,39 +736,21 @@ int Interp::open(const char *filename)  //!< string: the name of the input NC-pr
 
 /***********************************************************************/
 
-/*! Interp::read
+/*! Interp::read_synch
 
 Returned Value: int
-   If any of the following errors occur, this returns the error code shown.
-   Otherwise, this returns:
-       a. INTERP_ENDFILE if the only non-white character on the line is %,
-       b. INTERP_EXECUTE_FINISH if the first character of the
-          close_and_downcased line is a slash, and
-       c. INTERP_OK otherwise.
-   1. The command and_setup.file_pointer are both NULL: INTERP_FILE_NOT_OPEN
-   2. The probe_flag is ON but the HME command queue is not empty:
-      NCE_QUEUE_IS_NOT_EMPTY_AFTER_PROBING
-   3. If read_text (which gets a line of NC code from file) or parse_line
-     (which parses the line) returns an error code, this returns that code.
+   If the command queue is not empty after a probe, tool change or input
+   wait this returns an error code, otherwise INTERP_OK.
 
 Side Effects:
-   _setup.sequence_number is incremented.
-   The _setup.block1 is filled with data.
-
-Called By: external programs
+   Probe, tool change and input results are copied into _setup.
 
-This reads a line of NC-code from the command string or, (if the
-command string is NULL) from the currently open file. The
-_setup.line_length will be set by read_text. This will be zero if the
-line is blank or consists of nothing but a slash. If the length is not
-zero, this parses the line into the _setup.block1.
+Called By: Interp::read, Interp::preparse_execute
 
 */
 
-int Interp::read(const char *command)   //!< may be NULL or a string to read
+int Interp::read_synch()
 {
-   int read_status;
-
    if (_setup.probe_flag == ON)
    {
       CHKS((GET_EXTERNAL_QUEUE_EMPTY() == 0), NCE_QUEUE_IS_NOT_EMPTY_AFTER_PROBING);
@@ -778,6 +777,45 @@ int Interp::read(const char *command)   //!< may be NULL or a string to read
       }
       _setup.input_flag = OFF;
    }
+   return INTERP_OK;
+}
+
+/***********************************************************************/
+
+/*! Interp::read
+
+Returned Value: int
+   If any of the following errors occur, this returns the error code shown.
+   Otherwise, this returns:
+       a. INTERP_ENDFILE if the only non-white character on the line is %,
+       b. INTERP_EXECUTE_FINISH if the first character of the
+          close_and_downcased line is a slash, and
+       c. INTERP_OK otherwise.
+   1. The command and_setup.file_pointer are both NULL: INTERP_FILE_NOT_OPEN
+   2. The probe_flag is ON but the HME command queue is not empty:
+      NCE_QUEUE_IS_NOT_EMPTY_AFTER_PROBING
+   3. If read_text (which gets a line of NC code from file) or parse_line
+     (which parses the line) returns an error code, this returns that code.
+
+Side Effects:
+   _setup.sequence_number is incremented.
+   The _setup.block1 is filled with data.
+
+Called By: external programs
+
+This reads a line of NC-code from the command string or, (if the
+command string is NULL) from the currently open file. The
+_setup.line_length will be set by read_text. This will be zero if the
+line is blank or consists of nothing but a slash. If the length is not
+zero, this parses the line into the _setup.block1.
+
+*/
+
+int Interp::read(const char *command)   //!< may be NULL or a string to read
+{
+   int read_status;
+
+   CHP(read_synch());
    CHKN(((command == NULL) && (_setup.file_pointer == NULL)), INTERP_FILE_NOT_OPEN);
 
    if (_setup.file_pointer)
@@ -788,10 +826,7 @@ int Interp::read(const char *command)   //!< may be NULL or a string to read
    read_status = read_text(command, _setup.file_pointer, _setup.linetext, _setup.blocktext, &_setup.line_length);
 
    if (read_status == INTERP_ERROR && _setup.skipping_to_sub)
-   {
-      free(_setup.skipping_to_sub);
       _setup.skipping_to_sub = 0;
-   }
 
    if (command)
       logDebug("Interp::read:[cmd]:|%s|\n", command);
@@ -802,6 +837,9 @@ int Interp::read(const char *command)   //!< may be NULL or a string to read
    {
       if (_setup.line_length != 0)
       {
+         /* The previous line's o_name and named parameters are done with. A blank
+            line keeps them, block1 is reused as is below. */
+         string_arena_reset(&_setup.line_arena);
          CHP(parse_line(_setup.blocktext, &(_setup.block1), &_setup));
       }
 
@@ -879,7 +917,8 @@ int Interp::reset()
    _setup.skipping_o = 0;
    _setup.oword_labels = 0;
 
-   qc_reset();
+   qc_reset(&_setup);
+   hole_order_clear();
 
    return INTERP_OK;
 }
@@ -1153,7 +1192,7 @@ int Interp::synch()
    _setup.adaptive_feed = GET_EXTERNAL_ADAPTIVE_FEED_ENABLE();
    _setup.feed_hold = GET_EXTERNAL_FEED_HOLD_ENABLE();
 
-   save_parameters(RS274NGC_PARAMETER_FILE, _setup.parameters);
+   save_parameters(_parameter_file, _setup.parameters);
    load_tool_table();   /*  must set  _setup.tool_max first */
 
    return INTERP_OK;
@@ -1179,7 +1218,8 @@ Side Effects: copies active G codes into the codes array
 
 Called By: external programs
 
-See documentation of write_g_codes.
+See documentation of write_g_codes. The codes are as of the last
+executed block.
 
 */
 
@@ -1187,6 +1227,7 @@ void Interp::active_g_codes(int *codes) //!< array of codes to copy into
 {
    int n;
 
+   write_active(&_setup);
    for (n = 0; n < ACTIVE_G_CODES; n++)
    {
       codes[n] = _setup.active_g_codes[n];
@@ -1211,6 +1252,7 @@ void Interp::active_m_codes(int *codes) //!< array of codes to copy into
 {
    int n;
 
+   write_active(&_setup);
    for (n = 0; n < ACTIVE_M_CODES; n++)
    {
       codes[n] = _setup.active_m_codes[n];
@@ -1219,6 +1261,29 @@ void Interp::active_m_codes(int *codes) //!< array of codes to copy into
 
 /***********************************************************************/
 
+/*! Interp::block_m_codes
+
+Returned Value: none
+
+Side Effects: copies the M codes of the last executed block into the
+   codes array, indexed by modal group. Unused groups are -1.
+
+Called By: external programs
+
+*/
+
+void Interp::block_m_codes(int *codes) //!< array of codes to copy into
+{
+   int n;
+
+   for (n = 0; n < BLOCK_M_CODES; n++)
+   {
+      codes[n] = _setup.block1.m_modes[n];
+   }
+}
+
+/***********************************************************************/
+
 /*! Interp::active_settings
 
 Returned Value: none
@@ -1235,20 +1300,20 @@ void Interp::active_settings(double *settings)  //!< array of settings to copy i
 {
    int n;
 
+   write_active(&_setup);
    for (n = 0; n < ACTIVE_SETTINGS; n++)
    {
       settings[n] = _setup.active_settings[n];
    }
 }
 
-static char savedError[LINELEN + 1];
 void Interp::setError(const char *fmt, ...)
 {
    va_list ap;
 
    va_start(ap, fmt);
 
-   vsnprintf(savedError, LINELEN, fmt, ap);
+   vsnprintf(_saved_error, LINELEN, fmt, ap);
 
    va_end(ap);
 }
@@ -1278,7 +1343,7 @@ void Interp::error_text(int error_code, //!< code number of error
 {
    if (error_code == INTERP_ERROR)
    {
-      strncpy(error_text, savedError, max_size);
+      strncpy(error_text, _saved_error, max_size);
       error_text[max_size - 1] = 0;
 
       return;
@@ -1384,6 +1449,24 @@ int Interp::sequence_number()
 
 /***********************************************************************/
 
+/*! Interp::current_pocket
+
+Returned Value: the carousel slot of the tool in the spindle, as last
+passed to CHANGE_TOOL or read with GET_EXTERNAL_TOOL_SLOT.
+
+Side Effects: none
+
+Called By: external programs
+
+*/
+
+int Interp::current_pocket()
+{
+   return _setup.current_pocket;
+}
+
+/***********************************************************************/
+
 /*! Interp::stack_name
 
 Returned Value: none
@@ -1455,9 +1538,15 @@ int Interp::ini_load(const char *filename)
 
    logDebug("Opened inifile:%s:\n", filename);
 
-   snprintf(RS274NGC_PARAMETER_FILE, sizeof(RS274NGC_PARAMETER_FILE), "%s/%s", USER_HOME_DIR, 
+   snprintf(_parameter_file, sizeof(_parameter_file), "%s/%s", USER_HOME_DIR, 
       ini_get(filename, "RS274NGC", "PARAMETER_FILE", inistring, sizeof(inistring), (char *)"stepper.var", 1));
 
+   _preparse_threads = ini_getint(filename, "RS274NGC", "PREPARSE_THREADS", 0, 0);
+   _snapshot_lines = ini_getint(filename, "RS274NGC", "SNAPSHOT_LINES", SNAPSHOT_LINES_DEFAULT, 0);
+   SET_NAIVECAM_CHAIN_MAX(ini_getint(filename, "RS274NGC", "NAIVECAM_CHAIN_MAX", NAIVECAM_CHAIN_MAX_DEFAULT, 0));
+   SET_NAIVECAM_ARC_CHORDS(ini_getint(filename, "RS274NGC", "NAIVECAM_ARC_CHORDS", 0, 0));
+   _hole_order_ms = ini_getint(filename, "RS274NGC", "HOLE_ORDER_MS", 0, 0);
+
    return 0;
 }
 
@@ -63,15 +63,6 @@ static enum EMC_RESULT rtstepper_is_input3_triggered(struct emc_session *ps);
 //#define STEP_BUF_CHUNK 4096
 #define STEP_BUF_CHUNK 16384
 
-static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;  
-static pthread_cond_t _write_done_cond = PTHREAD_COND_INITIALIZER;
-static pthread_cond_t _event_done_cond = PTHREAD_COND_INITIALIZER;
-static pthread_cond_t _dongle_done_cond = PTHREAD_COND_INITIALIZER;
-static pthread_cond_t _dongle_io_done_cond = PTHREAD_COND_INITIALIZER;
-
-static unsigned int step_msg_cnt;
-static unsigned int query_msg_cnt;
-
 struct __attribute__ ((packed)) step_state
 {
    union
@@ -190,7 +181,7 @@ static void event_thread(struct rtstepper_file_descriptor *pfd)
 
    DBG("event_thread() closed...\n");
    pfd->event_abort_done = 1;
-   pthread_cond_signal(&_event_done_cond);
+   pthread_cond_signal(&pfd->event_done_cond);
 }  /* event_thread() */
 
 static void dongle_thread(struct rtstepper_file_descriptor *pfd)
@@ -248,7 +239,7 @@ static void dongle_thread(struct rtstepper_file_descriptor *pfd)
          MSG("INPUT3 estop...\n");
       }
 
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&pfd->mutex);
 
       empty = list_empty(&ps->ctrl_head.list);
       if (!empty)
@@ -257,7 +248,7 @@ static void dongle_thread(struct rtstepper_file_descriptor *pfd)
          list_del(&io->list);
       }
 
-      pthread_mutex_unlock(&_mutex);
+      pthread_mutex_unlock(&pfd->mutex);
 
       if (!empty)
       {
@@ -272,21 +263,21 @@ static void dongle_thread(struct rtstepper_file_descriptor *pfd)
             BUG("invalid usb_ctrl_transfer ret=%d: %s\n", len, libusb_error_name(len));
       }
 
-      pthread_cond_signal(&_dongle_io_done_cond);
+      pthread_cond_signal(&pfd->dongle_io_done_cond);
 
    }  /* while (!dongle_done) */
 
 bugout:
    DBG("dongle_thread() closed...\n");
    pfd->dongle_abort_done = 1;
-   pthread_cond_signal(&_dongle_done_cond);
+   pthread_cond_signal(&pfd->dongle_done_cond);
 }  /* dongle_thread() */
 
 static int claim_interface(struct rtstepper_file_descriptor *pfd)
 {
    int stat=1, r;
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&pfd->mutex);
 
    if (pfd->hd != NULL)
    {
@@ -313,7 +304,7 @@ static int claim_interface(struct rtstepper_file_descriptor *pfd)
    stat=0;
 
 bugout:
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&pfd->mutex);
    return stat;   
 } /* claim_interface() */
 
@@ -322,7 +313,7 @@ static int release_interface(struct rtstepper_file_descriptor *pfd)
    if (pfd->hd == NULL)
       return 0;
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&pfd->mutex);
 
    libusb_release_interface(pfd->hd, DONGLE_INTERFACE);
    libusb_close(pfd->hd);
@@ -332,7 +323,7 @@ static int release_interface(struct rtstepper_file_descriptor *pfd)
 
    DBG("released interface %d\n", DONGLE_INTERFACE);
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&pfd->mutex);
    return 0;
 } /* release_interface() */
 
@@ -342,17 +333,17 @@ static enum EMC_RESULT close_device(struct rtstepper_file_descriptor *pfd)
    {
       /* Wait for dongle_thread to shutdown before calling libusb_close. */
       pfd->dongle_done = 1;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&pfd->mutex);
       while (!pfd->dongle_abort_done)
-         pthread_cond_wait(&_dongle_done_cond, &_mutex);
-      pthread_mutex_unlock(&_mutex);
+         pthread_cond_wait(&pfd->dongle_done_cond, &pfd->mutex);
+      pthread_mutex_unlock(&pfd->mutex);
 
       /* Wait for event_thread to shutdown before calling libusb_close. */
       pfd->event_done = 1;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&pfd->mutex);
       while (!pfd->event_abort_done)
-         pthread_cond_wait(&_event_done_cond, &_mutex);
-      pthread_mutex_unlock(&_mutex);
+         pthread_cond_wait(&pfd->event_done_cond, &pfd->mutex);
+      pthread_mutex_unlock(&pfd->mutex);
 
       release_interface(pfd);
    }
@@ -375,7 +366,7 @@ static enum EMC_RESULT open_device(struct rtstepper_file_descriptor *pfd, const
       {
          pfd->dev = pfd->list_all[i];
          if (claim_interface(pfd))
-            goto bugout;
+            continue;   /* in use by another session, try the next dongle */
 
          pfd->board_rev = rev;
 
@@ -392,7 +383,6 @@ static enum EMC_RESULT open_device(struct rtstepper_file_descriptor *pfd, const
       }
    }
 
-bugout:
    return stat;
 }       /* open_device() */
 
@@ -401,7 +391,7 @@ static void xfr_cancel(struct emc_session *ps)
    struct rtstepper_io_req *io;
    struct list_head *p, *tmp;
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&ps->fd_table.mutex);
 
    /* Walk the queue deleting all io requests. */
    list_for_each_safe(p, tmp, &ps->head.list)
@@ -426,7 +416,7 @@ static void xfr_cancel(struct emc_session *ps)
 
    ps->req_cnt = 0;  /* force zero cnt here */
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&ps->fd_table.mutex);
 } /* xfr_cancel() */
 
 /* Called by xfr_start(). Assums no current IOs are active. */
@@ -435,7 +425,7 @@ static void xfr_sync_cancel(struct emc_session *ps)
    struct rtstepper_io_req *io;
    struct list_head *p, *tmp;
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&ps->fd_table.mutex);
 
    /* Walk the queue deleting all io requests. */
    list_for_each_safe(p, tmp, &ps->head.list)
@@ -449,7 +439,7 @@ static void xfr_sync_cancel(struct emc_session *ps)
       ps->req_cnt--;
    }
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&ps->fd_table.mutex);
 }  /* xfr_sync_cancel() */
 
 #if 0
@@ -557,7 +547,7 @@ static void xfr_cb(struct libusb_transfer *transfer)
       }
    }
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&ps->fd_table.mutex);
 
    libusb_free_transfer(io->req);
    free(io->buf);
@@ -566,7 +556,7 @@ static void xfr_cb(struct libusb_transfer *transfer)
    ps->req_cnt--;
    empty = list_empty(&ps->head.list);
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&ps->fd_table.mutex);
 
    if (!empty)
    {
@@ -575,14 +565,14 @@ static void xfr_cb(struct libusb_transfer *transfer)
       if (xfr_start(io) != EMC_R_OK)
       {
          DBG("IO canceled broadcast write_done_cond...\n");
-         pthread_cond_broadcast(&_write_done_cond);
+         pthread_cond_broadcast(&ps->fd_table.write_done_cond);
       }
    } 
    else
    { 
       /* All usb io is complete. */
       DBG("broadcast write_done_cond...\n");
-      pthread_cond_broadcast(&_write_done_cond);
+      pthread_cond_broadcast(&ps->fd_table.write_done_cond);
    }
 
    return;
@@ -668,7 +658,7 @@ enum EMC_RESULT rtstepper_xfr_start(struct emc_session *ps, struct rtstepper_io_
       }
    }
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&ps->fd_table.mutex);
 
    empty = list_empty(&ps->head.list);
 
@@ -676,7 +666,7 @@ enum EMC_RESULT rtstepper_xfr_start(struct emc_session *ps, struct rtstepper_io_
    list_add_tail(&io->list, &ps->head.list);
    ps->req_cnt++;
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&ps->fd_table.mutex);
 
    if (empty)
    {
@@ -704,12 +694,12 @@ enum EMC_RESULT rtstepper_ctrl_start(struct emc_session *ps, enum STEP_CMD cmd,
    io->cmd = cmd;
    io->param = param;
 
-   pthread_mutex_lock(&_mutex);
+   pthread_mutex_lock(&ps->fd_table.mutex);
 
    /* Add io request to tail of the queue (FIFO) for the dongle_thread. */
    list_add_tail(&io->list, &ps->ctrl_head.list);
 
-   pthread_mutex_unlock(&_mutex);
+   pthread_mutex_unlock(&ps->fd_table.mutex);
    return EMC_R_OK;
 }
 
@@ -731,10 +721,10 @@ enum EMC_RESULT rtstepper_xfr_hysteresis(struct emc_session *ps)
          ts.tv_sec = tv.tv_sec + 2;    /* 2 sec timeout */
          ts.tv_nsec = 0;
          rc=0;
-         pthread_mutex_lock(&_mutex);
+         pthread_mutex_lock(&ps->fd_table.mutex);
          while (ps->req_cnt > RTSTEPPER_REQ_MIN && rc==0)
-            rc = pthread_cond_timedwait(&_write_done_cond, &_mutex, &ts);
-         pthread_mutex_unlock(&_mutex);
+            rc = pthread_cond_timedwait(&ps->fd_table.write_done_cond, &ps->fd_table.mutex, &ts);
+         pthread_mutex_unlock(&ps->fd_table.mutex);
       } while (rc == ETIMEDOUT);
 
       DBG("rstepper_xfr_hysteresis() done...\n");
@@ -758,10 +748,10 @@ enum EMC_RESULT rtstepper_xfr_cancel_wait(struct emc_session *ps)
       ts.tv_sec = tv.tv_sec + 2;    /* 2 sec timeout */
       ts.tv_nsec = 0;
       rc=0;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&ps->fd_table.mutex);
       while (list_empty(&ps->head.list)==0 && (ps->state_bits & EMC_STATE_ESTOP_BIT)==0 && (ps->state_bits & EMC_STATE_CANCEL_BIT)==0 && rc==0)
-        rc = pthread_cond_timedwait(&_write_done_cond, &_mutex, &ts);
-      pthread_mutex_unlock(&_mutex);
+        rc = pthread_cond_timedwait(&ps->fd_table.write_done_cond, &ps->fd_table.mutex, &ts);
+      pthread_mutex_unlock(&ps->fd_table.mutex);
    } while (rc == ETIMEDOUT);
 
    DBG("rstepper_xfr_cancel_wait() done...\n");
@@ -791,10 +781,10 @@ enum EMC_RESULT rtstepper_xfr_wait(struct emc_session *ps)
       ts.tv_sec = tv.tv_sec + 2;    /* 2 sec timeout */
       ts.tv_nsec = 0;
       rc=0;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&ps->fd_table.mutex);
       while (list_empty(&ps->head.list)==0 && rc==0)
-         rc = pthread_cond_timedwait(&_write_done_cond, &_mutex, &ts);
-      pthread_mutex_unlock(&_mutex);
+         rc = pthread_cond_timedwait(&ps->fd_table.write_done_cond, &ps->fd_table.mutex, &ts);
+      pthread_mutex_unlock(&ps->fd_table.mutex);
    } while (rc == ETIMEDOUT);
 
    DBG("rstepper_xfr_wait() done...\n");
@@ -817,10 +807,10 @@ enum EMC_RESULT rtstepper_dongle_empty_wait(struct emc_session *ps)
       ts.tv_sec = tv.tv_sec + 2;    /* 2 sec timeout */
       ts.tv_nsec = 0;
       rc=0;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&ps->fd_table.mutex);
       while ((ps->state_bits & RTSTEPPER_STEP_STATE_EMPTY_BIT)==0 && (ps->state_bits & EMC_STATE_ESTOP_BIT)==0 && (ps->state_bits & EMC_STATE_CANCEL_BIT)==0 && rc==0)
-        rc = pthread_cond_timedwait(&_dongle_io_done_cond, &_mutex, &ts);
-      pthread_mutex_unlock(&_mutex);
+        rc = pthread_cond_timedwait(&ps->fd_table.dongle_io_done_cond, &ps->fd_table.mutex, &ts);
+      pthread_mutex_unlock(&ps->fd_table.mutex);
    } while (rc == ETIMEDOUT);
 
    DBG("rtstepper_dongle_empty_wait() done...\n");
@@ -843,10 +833,10 @@ enum EMC_RESULT rtstepper_dongle_sync_start_wait(struct emc_session *ps)
       ts.tv_sec = tv.tv_sec + 2;    /* 2 sec timeout */
       ts.tv_nsec = 0;
       rc=0;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&ps->fd_table.mutex);
       while ((ps->state_bits & RTSTEPPER_STEP_STATE_SYNC_START_BIT)==0 && (ps->state_bits & EMC_STATE_ESTOP_BIT)==0 && (ps->state_bits & EMC_STATE_CANCEL_BIT)==0 && rc==0)
-        rc = pthread_cond_timedwait(&_dongle_io_done_cond, &_mutex, &ts);
-      pthread_mutex_unlock(&_mutex);
+        rc = pthread_cond_timedwait(&ps->fd_table.dongle_io_done_cond, &ps->fd_table.mutex, &ts);
+      pthread_mutex_unlock(&ps->fd_table.mutex);
    } while (rc == ETIMEDOUT);
 
    DBG("rtstepper_dongle_sync_start_wait() done...\n");
@@ -937,7 +927,7 @@ enum EMC_RESULT rtstepper_encode(struct emc_session *ps, struct rtstepper_io_req
 
       if (step < -1 || step > 1)
       {
-         if (step_msg_cnt++ < 5)
+         if (ps->fd_table.step_msg_cnt++ < 5)
          {
             BUG("invalid step value (run All Zero): id=%d axis=%d cmd_pos=%0.8f master_index=%d input_scale=%0.2f step=%d\n",
                 io->id, i, index[i], ps->axis[i].master_index, ps->axis[i].steps_per_unit, step);
@@ -1020,15 +1010,7 @@ enum EMC_RESULT rtstepper_position_set(struct emc_session *ps, EmcPose pos)
 #endif
 
    /* Convert coordinates into array. */
-   new_pos_cmd[EMC_AXIS_X] = pos.tran.x;
-   new_pos_cmd[EMC_AXIS_Y] = pos.tran.y;
-   new_pos_cmd[EMC_AXIS_Z] = pos.tran.z;
-   new_pos_cmd[EMC_AXIS_A] = pos.a;
-   new_pos_cmd[EMC_AXIS_B] = pos.b;
-   new_pos_cmd[EMC_AXIS_C] = pos.c;
-   new_pos_cmd[EMC_AXIS_U] = pos.u;
-   new_pos_cmd[EMC_AXIS_V] = pos.v;
-   new_pos_cmd[EMC_AXIS_W] = pos.w;
+   emcPoseToArray(&pos, new_pos_cmd);
 
    /* Map new coordinate position to each axis (step/dir pins). One coordinate may map to more than one axis. */
    for (i = 0; i < ps->axes; i++)
@@ -1055,10 +1037,10 @@ enum EMC_RESULT rtstepper_estop(struct emc_session *ps, int thread)
    {
       /* User EStop, wait for dongle_thread to shutdown before sending abort. */
       pfd->dongle_done = 1;
-      pthread_mutex_lock(&_mutex);
+      pthread_mutex_lock(&ps->fd_table.mutex);
       while (!pfd->dongle_abort_done)
-         pthread_cond_wait(&_dongle_done_cond, &_mutex);
-      pthread_mutex_unlock(&_mutex);
+         pthread_cond_wait(&ps->fd_table.dongle_done_cond, &ps->fd_table.mutex);
+      pthread_mutex_unlock(&ps->fd_table.mutex);
    }
 
    rtstepper_abort_set(ps);   /* EReset clears the dongle Abort bit. */
@@ -1269,7 +1251,6 @@ enum EMC_RESULT rtstepper_state_query(struct emc_session *ps)
    struct step_query query_response;
    enum EMC_RESULT stat;
    int len;
-   static int good_query = 0;
 
    /* Clear dongle state bits. */
    ps->state_bits &= ~(RTSTEPPER_STEP_STATE_INPUT0_BIT | RTSTEPPER_STEP_STATE_INPUT1_BIT | RTSTEPPER_STEP_STATE_INPUT2_BIT |
@@ -1296,14 +1277,14 @@ enum EMC_RESULT rtstepper_state_query(struct emc_session *ps)
       }
       else
       {
-         if (query_msg_cnt++ < 5)
-            BUG("invalid usb query_response len=%d good_query_cnt=%d: %s\n", len, good_query, libusb_error_name(len));
+         if (ps->fd_table.query_msg_cnt++ < 5)
+            BUG("invalid usb query_response len=%d good_query_cnt=%d: %s\n", len, ps->fd_table.good_query_cnt, libusb_error_name(len));
          stat = RTSTEPPER_R_IO_ERROR;
       }
       goto bugout;
    }
    else
-      good_query++;
+      ps->fd_table.good_query_cnt++;
 
    ps->state_bits |= query_response.state_bits._word;
 
@@ -1328,7 +1309,6 @@ enum EMC_RESULT rtstepper_state_adc_query(struct emc_session *ps)
    struct step_adc_query query_response;
    enum EMC_RESULT stat;
    int len;
-   static int good_query = 0;
 
    /* Clear dongle state bits. */
    ps->state_bits &= ~(RTSTEPPER_STEP_STATE_INPUT0_BIT | RTSTEPPER_STEP_STATE_INPUT1_BIT | RTSTEPPER_STEP_STATE_INPUT2_BIT |
@@ -1355,14 +1335,14 @@ enum EMC_RESULT rtstepper_state_adc_query(struct emc_session *ps)
       }
       else
       {
-         if (query_msg_cnt++ < 5)
-            BUG("invalid usb query_response len=%d good_query_cnt=%d: %s\n", len, good_query, libusb_error_name(len));
+         if (ps->fd_table.query_msg_cnt++ < 5)
+            BUG("invalid usb query_response len=%d good_query_cnt=%d: %s\n", len, ps->fd_table.good_query_cnt, libusb_error_name(len));
          stat = RTSTEPPER_R_IO_ERROR;
       }
       goto bugout;
    }
    else
-      good_query++;
+      ps->fd_table.good_query_cnt++;
 
    ps->state_bits |= query_response.state_bits._word;
 
@@ -1398,6 +1378,32 @@ enum EMC_RESULT rtstepper_clear_stats(struct emc_session *ps)
    return EMC_R_OK;
 }
 
+/* Set up the session's io lock and conditions. Called once per session, before rtstepper_open(). */
+enum EMC_RESULT rtstepper_init(struct emc_session *ps)
+{
+   struct rtstepper_file_descriptor *pfd = &ps->fd_table;
+
+   pthread_mutex_init(&pfd->mutex, NULL);
+   pthread_cond_init(&pfd->write_done_cond, NULL);
+   pthread_cond_init(&pfd->event_done_cond, NULL);
+   pthread_cond_init(&pfd->dongle_done_cond, NULL);
+   pthread_cond_init(&pfd->dongle_io_done_cond, NULL);
+   return EMC_R_OK;
+}       /* rtstepper_init() */
+
+/* Release what rtstepper_init() set up. Called after the final rtstepper_close(). */
+enum EMC_RESULT rtstepper_exit(struct emc_session *ps)
+{
+   struct rtstepper_file_descriptor *pfd = &ps->fd_table;
+
+   pthread_cond_destroy(&pfd->dongle_io_done_cond);
+   pthread_cond_destroy(&pfd->dongle_done_cond);
+   pthread_cond_destroy(&pfd->event_done_cond);
+   pthread_cond_destroy(&pfd->write_done_cond);
+   pthread_mutex_destroy(&pfd->mutex);
+   return EMC_R_OK;
+}       /* rtstepper_exit() */
+
 enum EMC_RESULT rtstepper_open(struct emc_session *ps)
 {
    struct step_elements elements;
@@ -1412,7 +1418,7 @@ enum EMC_RESULT rtstepper_open(struct emc_session *ps)
    if (ps == NULL)
       return RTSTEPPER_R_IO_ERROR;
 
-   step_msg_cnt = query_msg_cnt = 0;
+   ps->fd_table.step_msg_cnt = ps->fd_table.query_msg_cnt = 0;
 
    ps->old_state_bits = 0;
    for (i=0; i < ps->axes; i++)
@@ -1553,6 +1559,7 @@ enum EMC_RESULT rtstepper_test(const char *snum)
    int i, ret = RTSTEPPER_R_DEVICE_UNAVAILABLE, len, tmo;
 
    fd_table.hd = NULL;
+   pthread_mutex_init(&fd_table.mutex, NULL);
 
    /* Open first usb device or usb device matching specified serial number. */
    if (open_test_device(&fd_table, snum) != 0)
@@ -1650,5 +1657,6 @@ enum EMC_RESULT rtstepper_test(const char *snum)
    }
 
  bugout:
+   pthread_mutex_destroy(&fd_table.mutex);
    return ret;
 }   /* rtstepper_test() */
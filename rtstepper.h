@@ -135,6 +135,14 @@ struct rtstepper_file_descriptor
    int dongle_abort_done;
    pthread_t dongle_tid;    /* thread handle */
    enum RTSTEPPER_BRD board_rev;
+   pthread_mutex_t mutex;   /* io queues and libusb handle, one per session */
+   pthread_cond_t write_done_cond;
+   pthread_cond_t event_done_cond;
+   pthread_cond_t dongle_done_cond;
+   pthread_cond_t dongle_io_done_cond;
+   unsigned int step_msg_cnt;   /* rate limits BUG() messages */
+   unsigned int query_msg_cnt;
+   int good_query_cnt;
 };
 
 struct rtstepper_moving_avg
@@ -174,6 +182,8 @@ extern "C"
 
 /* Function prototypes */
 
+   enum EMC_RESULT rtstepper_init(struct emc_session *ps);
+   enum EMC_RESULT rtstepper_exit(struct emc_session *ps);
    enum EMC_RESULT rtstepper_open(struct emc_session *ps);
    enum EMC_RESULT rtstepper_close(struct emc_session *ps);
    enum EMC_RESULT rtstepper_state_query(struct emc_session *ps);
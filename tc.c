@@ -50,22 +50,23 @@
 
 #include <math.h>
 #include "posemath.h"
+#include "pminline.h"
 #include "emcpos.h"
 #include "tc.h"
 #include "bug.h"
 
-/* the byte of output that gets written, persisting across all TC_STRUCTs,
-   also referenced in tp.c for aborting */
-unsigned char tcDoutByte = 0;
-
 #define TC_VEL_EPSILON 0.0001   /* number below which v is considered 0 */
 #define TC_SCALE_EPSILON 0.0001 /* number below which scale is considered 0 */
+#define TC_ARC_RESEED 256       /* arc steps between exact evaluations */
+#define TC_ARC_STEP_EPSILON 1e-8 /* relative step change that needs a new rotation */
 
+/* tc->geom must already point at its geometry, see tcqEmplace() */
 int tcInit(TC_STRUCT *tc)
 {
   PmPose zero;
 
-  if (0 == tc)
+  if (0 == tc ||
+      0 == tc->geom)
   {
     return -1;
   }
@@ -89,22 +90,25 @@ int tcInit(TC_STRUCT *tc)
 
   tc->tmag=0.0;	
   tc->abc_mag=0.0;
-  tc->tvMax=0.0;
-  tc->taMax=0.0;
-  tc->abc_vMax=0.0;
-  tc->abc_aMax=0.0;
+  tc->uvw_mag=0.0;
+  tc->geom->tvMax=0.0;
+  tc->geom->taMax=0.0;
+  tc->geom->abc_vMax=0.0;
+  tc->geom->abc_aMax=0.0;
   tc->unitCart.x = tc->unitCart.y = tc->unitCart.z = 0.0;
+  tc->geom->leadAxis = 0;
   zero.tran.x = zero.tran.y = zero.tran.z = 0.0;
   zero.rot.s=1.0;
   zero.rot.x = zero.rot.y = zero.rot.z = 0.0;
 
-  pmLineInit(&tc->line, zero, zero);
-  pmLineInit(&tc->line_abc, zero, zero);
+  pmLineInit(&tc->geom->line, zero, zero);
+  pmLineInit(&tc->geom->line_abc, zero, zero);
+  pmLineInit(&tc->geom->line_uvw, zero, zero);
   /* since type is TC_LINEAR, don't need to set circle params */
 
-  tc->douts = 0;
-  tc->doutstarts = 0;
-  tc->doutends = 0;
+  tc->geom->douts = 0;
+  tc->geom->doutstarts = 0;
+  tc->geom->doutends = 0;
 
   return 0;
 }
@@ -122,7 +126,12 @@ int tcSetCycleTime(TC_STRUCT *tc, double secs)
   return 0;
 }
 
-int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc)
+/*
+  Path length is the xyz travel. Without xyz it is the uvw travel, at the
+  same translational limits, and without either it is the abc travel.
+  The other groups follow along in proportion, see tcGetPos().
+*/
+int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc, PmLine line_uvw)
 {
   double tmag,abc_mag;
 
@@ -131,31 +140,39 @@ int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc)
     return -1;
   }
 
-  tc->line = line;
-  tc->line_abc = line_abc;
+  tc->geom->line = line;
+  tc->geom->line_abc = line_abc;
+  tc->geom->line_uvw = line_uvw;
 
 
   /* set targetPos to be scalar difference */
   pmCartCartDisp(line.end.tran, line.start.tran, &tmag);
   pmCartCartDisp(line_abc.end.tran, line_abc.start.tran, &abc_mag);
+  tc->uvw_mag = pmCartCartDispI(&line_uvw.start.tran, &line_uvw.end.tran);
 
   tc->abc_mag = abc_mag;
   tc->tmag = tmag;
   
-  if(tc->abc_aMax <= 0.0 && tc->taMax > 0.0)
+  if(tc->geom->abc_aMax <= 0.0 && tc->geom->taMax > 0.0)
     {
-      tc->abc_aMax = tc->taMax;
+      tc->geom->abc_aMax = tc->geom->taMax;
     }
 
-  if(tc->abc_vMax <= 0.0 && tc->tvMax > 0.0)
+  if(tc->geom->abc_vMax <= 0.0 && tc->geom->tvMax > 0.0)
     {
-      tc->abc_vMax = tc->tvMax;
+      tc->geom->abc_vMax = tc->geom->tvMax;
     }
 
-  if(tc->tmag < 1e-6)
+  if(tc->tmag < 1e-6 && tc->uvw_mag >= 1e-6)
+    {
+      tc->aMax = tc->geom->taMax;
+      tc->vMax = tc->geom->tvMax;
+      tc->targetPos = tc->uvw_mag;
+    }
+  else if(tc->tmag < 1e-6)
     {
-      tc->aMax = tc->abc_aMax;
-      tc->vMax = tc->abc_vMax;
+      tc->aMax = tc->geom->abc_aMax;
+      tc->vMax = tc->geom->abc_vMax;
       tc->targetPos = abc_mag;
     }
   else
@@ -165,27 +182,27 @@ int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc)
       if(tc->abc_mag > 1e-6)
 #endif
 	{
-	  if(tc->abc_aMax * tmag/abc_mag < tc->taMax)
+	  if(tc->geom->abc_aMax * tmag/abc_mag < tc->geom->taMax)
 	    {
-	      tc->aMax = tc->abc_aMax *tmag/abc_mag;
+	      tc->aMax = tc->geom->abc_aMax *tmag/abc_mag;
 	    }
 	  else
 	    {
-	      tc->aMax = tc->taMax;
+	      tc->aMax = tc->geom->taMax;
 	    }      
-	  if(tc->abc_vMax * tmag/abc_mag < tc->tvMax)
+	  if(tc->geom->abc_vMax * tmag/abc_mag < tc->geom->tvMax)
 	    {
-	      tc->vMax = tc->abc_vMax * tmag /abc_mag;
+	      tc->vMax = tc->geom->abc_vMax * tmag /abc_mag;
 	    }
 	  else
 	    {
-	      tc->vMax = tc->tvMax;
+	      tc->vMax = tc->geom->tvMax;
 	    }
 	}
       else
 	{
-	  tc->aMax = tc->taMax;
-	  tc->vMax = tc->tvMax;
+	  tc->aMax = tc->geom->taMax;
+	  tc->vMax = tc->geom->tvMax;
 	}
       tc->targetPos = tmag;
     }
@@ -195,15 +212,16 @@ int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc)
   return 0;
 }
 
-int tcSetCircle(TC_STRUCT *tc, PmCircle circle, PmLine line_abc)
+int tcSetCircle(TC_STRUCT *tc, PmCircle circle, PmLine line_abc, PmLine line_uvw)
 {
   if (0 == tc)
   {
     return -1;
   }
 
-  tc->circle = circle;
-  tc->line_abc = line_abc;
+  tc->geom->circle = circle;
+  tc->geom->line_abc = line_abc;
+  tc->geom->line_uvw = line_uvw;
 
   /* for circular motion, path param is arc length */
   tc->tmag = tc->targetPos = circle.angle * circle.radius;
@@ -211,14 +229,169 @@ int tcSetCircle(TC_STRUCT *tc, PmCircle circle, PmLine line_abc)
   tc->currentPos = 0.0;
   tc->type = TC_CIRCULAR;
 
-  tc->aMax = tc->taMax;
-  tc->vMax = tc->tvMax;
+  tc->geom->arc.pos = 0.0;
+  tc->geom->arc.cos = 1.0;
+  tc->geom->arc.sin = 0.0;
+  tc->geom->arc.step = 0.0;
+  tc->geom->arc.stepCos = 1.0;
+  tc->geom->arc.stepSin = 0.0;
+  tc->geom->arc.count = 0;
+
+  tc->aMax = tc->geom->taMax;
+  tc->vMax = tc->geom->tvMax;
 
   pmCartCartDisp(line_abc.end.tran, line_abc.start.tran, &tc->abc_mag);
+  tc->uvw_mag = pmCartCartDispI(&line_uvw.start.tran, &line_uvw.end.tran);
 
   return 0;
 }
 
+/* Time optimal profile of one dogleg axis, triangular if the axis can't reach vmax. */
+static void tcAxisProfileInit(TC_AXIS_PROFILE *ap, double dist, double vmax, double amax)
+{
+  double d = fabs(dist);
+
+  ap->dist = dist;
+  ap->aMax = amax;
+  if (d < 1e-9 || vmax <= 0.0 || amax <= 0.0)
+    {
+      ap->vPeak = ap->tAccel = ap->tTotal = 0.0;
+      return;
+    }
+  ap->vPeak = sqrt(amax * d);
+  if (ap->vPeak > vmax)
+    {
+      ap->vPeak = vmax;
+    }
+  ap->tAccel = ap->vPeak / amax;
+  ap->tTotal = d / ap->vPeak + ap->tAccel;
+}
+
+/* Displacement of a dogleg axis t seconds into its profile. */
+static double tcAxisProfilePos(const TC_AXIS_PROFILE *ap, double t)
+{
+  double p, r;
+
+  if (t >= ap->tTotal)
+    {
+      return ap->dist;
+    }
+  if (t <= 0.0)
+    {
+      return 0.0;
+    }
+
+  if (t < ap->tAccel)
+    {
+      p = 0.5 * ap->aMax * t * t;
+    }
+  else if (t < ap->tTotal - ap->tAccel)
+    {
+      p = ap->vPeak * (t - 0.5 * ap->tAccel);
+    }
+  else
+    {
+      r = ap->tTotal - t;
+      p = fabs(ap->dist) - 0.5 * ap->aMax * r * r;
+    }
+
+  return (ap->dist < 0.0) ? -p : p;
+}
+
+/* Inverse of tcAxisProfilePos(), time at which the axis has moved s. */
+static double tcAxisProfileTime(const TC_AXIS_PROFILE *ap, double s)
+{
+  double d = fabs(ap->dist);
+  double sa = 0.5 * ap->vPeak * ap->tAccel;
+
+  if (s <= 0.0)
+    {
+      return 0.0;
+    }
+  if (s >= d)
+    {
+      return ap->tTotal;
+    }
+
+  if (s < sa)
+    {
+      return sqrt(2.0 * s / ap->aMax);
+    }
+  if (s < d - sa)
+    {
+      return ap->tAccel + (s - sa) / ap->vPeak;
+    }
+  return ap->tTotal - sqrt(2.0 * (d - s) / ap->aMax);
+}
+
+/*
+  A dogleg move runs every axis on its own time optimal profile instead of
+  along the straight line. Path progress is the travel of the lead axis, the
+  one needing the most time, so tcRunCycle() plans the lead profile and
+  vScale, pause and abort slow the whole move down together. tcGetPos()
+  maps the lead travel back to profile time and evaluates every axis there.
+  vmax and amax are per axis x y z a b c u v w, zero entries fall back to the
+  translational limits.
+*/
+int tcSetDogleg(TC_STRUCT *tc, PmLine line, PmLine line_abc, PmLine line_uvw, const double *vmax, const double *amax)
+{
+  double dist[TC_DOGLEG_AXES];
+  TC_AXIS_PROFILE *lead;
+  int i;
+
+  if (0 == tc)
+  {
+    return -1;
+  }
+
+  tc->geom->line = line;
+  tc->geom->line_abc = line_abc;
+  tc->geom->line_uvw = line_uvw;
+  pmCartCartDisp(line.end.tran, line.start.tran, &tc->tmag);
+  pmCartCartDisp(line_abc.end.tran, line_abc.start.tran, &tc->abc_mag);
+  tc->uvw_mag = pmCartCartDispI(&line_uvw.start.tran, &line_uvw.end.tran);
+
+  dist[0] = line.end.tran.x - line.start.tran.x;
+  dist[1] = line.end.tran.y - line.start.tran.y;
+  dist[2] = line.end.tran.z - line.start.tran.z;
+  dist[3] = line_abc.end.tran.x - line_abc.start.tran.x;
+  dist[4] = line_abc.end.tran.y - line_abc.start.tran.y;
+  dist[5] = line_abc.end.tran.z - line_abc.start.tran.z;
+  dist[6] = line_uvw.end.tran.x - line_uvw.start.tran.x;
+  dist[7] = line_uvw.end.tran.y - line_uvw.start.tran.y;
+  dist[8] = line_uvw.end.tran.z - line_uvw.start.tran.z;
+
+  tc->geom->leadAxis = 0;
+  for (i = 0; i < TC_DOGLEG_AXES; i++)
+    {
+      tcAxisProfileInit(&tc->geom->axis[i], dist[i],
+                        (vmax[i] > 0.0) ? vmax[i] : tc->geom->tvMax,
+                        (amax[i] > 0.0) ? amax[i] : tc->geom->taMax);
+      if (tc->geom->axis[i].tTotal > tc->geom->axis[tc->geom->leadAxis].tTotal)
+        {
+          tc->geom->leadAxis = i;
+        }
+    }
+
+  lead = &tc->geom->axis[tc->geom->leadAxis];
+  if (lead->tTotal > 0.0)
+    {
+      tc->targetPos = fabs(lead->dist);
+      tc->vMax = lead->vPeak;
+      tc->aMax = lead->aMax;
+    }
+  else
+    {
+      tc->targetPos = 0.0;
+      tc->vMax = tc->geom->tvMax;
+      tc->aMax = tc->geom->taMax;
+    }
+
+  tc->currentPos = 0.0;
+  tc->type = TC_DOGLEG;
+  return 0;
+}
+
 int tcSetTVmax(TC_STRUCT *tc, double _vMax)
 {
   if (_vMax < 0.0 ||
@@ -227,7 +400,7 @@ int tcSetTVmax(TC_STRUCT *tc, double _vMax)
     return -1;
   }
 
-  tc->tvMax = _vMax;
+  tc->geom->tvMax = _vMax;
 
   return 0;
 }
@@ -240,7 +413,7 @@ int tcSetRVmax(TC_STRUCT *tc, double _Rvmax)
     return -1;
   }
 
-  tc->abc_vMax = _Rvmax;
+  tc->geom->abc_vMax = _Rvmax;
 
   return 0;
 }
@@ -253,7 +426,7 @@ int tcSetRAmax(TC_STRUCT *tc, double _WDotMax)
     return -1;
   }
 
-  tc->abc_aMax = _WDotMax;
+  tc->geom->abc_aMax = _WDotMax;
 
   return 0;
 }
@@ -279,7 +452,7 @@ int tcSetTAmax(TC_STRUCT *tc, double _aMax)
     return -1;
   }
 
-  tc->taMax = _aMax;
+  tc->geom->taMax = _aMax;
 
   return 0;
 }
@@ -359,7 +532,8 @@ int tcGetTermCond(TC_STRUCT *tc)
   return tc->termCond;
 }
 
-int tcRunCycle(TC_STRUCT *tc)
+/* dout is the byte of output that gets written, it persists across all TC_STRUCTs of the planner. */
+int tcRunCycle(TC_STRUCT *tc, unsigned char *dout)
 {
   double newPos;
   double newVel;
@@ -400,10 +574,10 @@ int tcRunCycle(TC_STRUCT *tc)
 
   if (tc->tcFlag == TC_IS_UNSET) {
     /* it's the start of this segment, so set any start output bits */
-    if (tc->douts) {
-      tcDoutByte |= (tc->douts & tc->doutstarts);
-      tcDoutByte &= (~tc->douts | tc->doutstarts);
-      //extMotDout(tcDoutByte);
+    if (tc->geom->douts) {
+      *dout |= (tc->geom->douts & tc->geom->doutstarts);
+      *dout &= (~tc->geom->douts | tc->geom->doutstarts);
+      //extMotDout(*dout);
     }
   }
 
@@ -413,10 +587,10 @@ int tcRunCycle(TC_STRUCT *tc)
     newPos = tc->targetPos;
     tc->tcFlag = TC_IS_DONE;
     /* set any end output bits */
-    if (tc->douts) {
-      tcDoutByte |= (tc->douts & tc->doutends);
-      tcDoutByte &= (~tc->douts | tc->doutends);
-      //extMotDout(tcDoutByte);
+    if (tc->geom->douts) {
+      *dout |= (tc->geom->douts & tc->geom->doutends);
+      *dout &= (~tc->geom->douts | tc->geom->doutends);
+      //extMotDout(*dout);
     }
   }
   else {
@@ -438,8 +612,8 @@ int tcRunCycle(TC_STRUCT *tc)
     }
 
     if (tc->type == TC_CIRCULAR) {
-      if (newVel > pmSqrt(tc->aMax*tc->circle.radius)) {
-	newVel = pmSqrt(tc->aMax*tc->circle.radius);
+      if (newVel > pmSqrt(tc->aMax*tc->geom->circle.radius)) {
+	newVel = pmSqrt(tc->aMax*tc->geom->circle.radius);
       }
     }
 
@@ -512,11 +686,173 @@ int tcRunCycle(TC_STRUCT *tc)
   return 0;
 }
 
+/*
+   tcRunCycleSkip() advances tc like repeated calls to tcRunCycle() but
+   runs of full acceleration, constant velocity and on-curve deceleration
+   cycles are stepped over in closed form. Returns the number of cycles
+   advanced, 0 if tc can not run. Only positions at the segment ends are valid,
+   and only for a segment run on its own (no blending credit in preVMax
+   or preAMax). Used by the cycle time estimator.
+*/
+long tcRunCycleSkip(TC_STRUCT *tc, unsigned char *dout)
+{
+  double v, a, dt, vc, toGo, curve, vk, gk;
+  long k, lo, hi, mid;
+
+  if (0 == tc || tc->aMax <= 0.0 || tc->vMax <= 0.0 || tc->cycleTime <= 0.0) {
+    return 0;
+  }
+
+  if (tc->preVMax != 0.0 || tc->preAMax != 0.0) {
+    tcRunCycle(tc, dout);
+    return 1;
+  }
+
+  v = tc->currentVel;
+  a = tc->aMax;
+  dt = tc->cycleTime;
+  toGo = tc->targetPos - tc->currentPos;
+
+  /* same velocity clamp as tcRunCycle() */
+  vc = tc->vMax * tc->vScale;
+  if (vc > tc->vLimit) {
+    vc = tc->vLimit;
+  }
+  if (tc->type == TC_CIRCULAR && vc > pmSqrt(a * tc->geom->circle.radius)) {
+    vc = pmSqrt(a * tc->geom->circle.radius);
+  }
+
+  k = 0;
+  if (tc->tcFlag == TC_IS_ACCEL && tc->currentAccel == a) {
+    /* Full acceleration while the velocity stays under the clamp and the
+       stopping distance under toGo. Both get worse with k, so bisect for
+       the last such cycle. */
+    lo = 0;
+    hi = (long) ((vc - v) / (a * dt)) - 1;
+    while (lo < hi) {
+      mid = (lo + hi + 1) / 2;
+      vk = v + (mid - 1) * a * dt;
+      gk = toGo - ((mid - 1) * v * dt + 0.5 * a * dt * dt * (mid - 1) * (mid - 1));
+      if (gk >= 0.5 * vk * vk / a + 2.0 * vk * dt + a * dt * dt) {
+        lo = mid;
+      }
+      else {
+        hi = mid - 1;
+      }
+    }
+    k = lo - 1;                 /* leave the last one to tcRunCycle() */
+    if (k > 0) {
+      tc->currentPos += k * v * dt + 0.5 * a * dt * dt * k * k;
+      tc->currentVel = v + k * a * dt;
+    }
+  }
+  else if (tc->tcFlag == TC_IS_CONST && v > 0.0) {
+    /* Cruise until toGo reaches the stopping distance. */
+    k = (long) ((toGo - 0.5 * v * v / a - v * dt) / (v * dt)) - 1;
+    if (k > 0) {
+      tc->currentPos += k * v * dt;
+    }
+  }
+  else if (tc->tcFlag == TC_IS_DECEL && v > 0.0) {
+    /* Once toGo equals the stopping distance every cycle drops the
+       velocity by a*dt and stays on the curve. */
+    curve = 0.5 * v * v / a;
+    if (fabs(toGo - curve) <= 1e-9 * curve) {
+      k = (long) (v / (a * dt)) - 2;
+      if (k > 0) {
+        vk = v - k * a * dt;
+        tc->currentVel = vk;
+        tc->currentPos = tc->targetPos - 0.5 * vk * vk / a;
+      }
+    }
+  }
+
+  if (k > 0) {
+    return k;
+  }
+
+  return (tcRunCycle(tc, dout) == 0) ? 1 : 0;
+}
+
+/*
+   Move the cached arc rotation up to currentPos. At constant velocity
+   this is one complex multiply by the rotation of the last step. When the
+   step changes the angle is evaluated exactly and the new step rotation
+   is taken from the old and new points, so accel and decel cost one
+   sin/cos per cycle as before. Every TC_ARC_RESEED steps the angle is
+   evaluated exactly again, which keeps rounding from building up.
+*/
+static void tcArcStep(TC_STRUCT *tc)
+{
+  TC_ARC_STEP *as = &tc->geom->arc;
+  double dp = tc->currentPos - as->pos;
+  double angle, c, s;
+
+  if (dp == 0.0)
+    {
+      return;
+    }
+
+  if (dp > 0.0 && as->count < TC_ARC_RESEED && fabs(dp - as->step) <= TC_ARC_STEP_EPSILON * dp)
+    {
+      c = as->cos * as->stepCos - as->sin * as->stepSin;
+      s = as->sin * as->stepCos + as->cos * as->stepSin;
+      as->count++;
+    }
+  else
+    {
+      angle = tc->currentPos / tc->geom->circle.radius;
+      c = cos(angle);
+      s = sin(angle);
+      if (dp > 0.0 && fabs(dp - as->step) > TC_ARC_STEP_EPSILON * dp)
+        {
+          /* new step, rotation from the old point to the new one */
+          as->step = dp;
+          as->stepCos = c * as->cos + s * as->sin;
+          as->stepSin = s * as->cos - c * as->sin;
+        }
+      as->count = 0;
+    }
+
+  as->pos = tc->currentPos;
+  as->cos = c;
+  as->sin = s;
+}
+
+/* Radius vector at currentPos, rTan and rPerp both have magnitude radius. */
+static void tcArcRadial(TC_STRUCT *tc, PmCartesian *radial)
+{
+  tcArcStep(tc);
+  pmCartScalMultI(&tc->geom->circle.rTan, tc->geom->arc.cos, radial);
+  pmCartScalMultAddI(&tc->geom->circle.rPerp, tc->geom->arc.sin, radial);
+}
+
+/* pmCirclePoint() at currentPos using the cached rotation. */
+static void tcArcPoint(TC_STRUCT *tc, PmCartesian *pos)
+{
+  PmCartesian radial;
+  double scale;
+
+  tcArcRadial(tc, &radial);
+
+  scale = 0.0;
+  if (tc->geom->circle.angle != 0.0)
+    {
+      scale = tc->currentPos / tc->geom->circle.radius / tc->geom->circle.angle;
+    }
+
+  /* spiral along the radius, helix along the normal */
+  pmCartCartAddI(&tc->geom->circle.center, &radial, pos);
+  pmCartScalMultAddI(&radial, scale * tc->geom->circle.spiral / tc->geom->circle.radius, pos);
+  pmCartScalMultAddI(&tc->geom->circle.rHelix, scale, pos);
+}
+
 EmcPose tcGetPos(TC_STRUCT *tc)
 {
   EmcPose v;
   PmPose v1;
-  PmPose v2;
+  PmCartesian abc, uvw;
+  double t;
 
   if (0 == tc)
     {
@@ -524,43 +860,83 @@ EmcPose tcGetPos(TC_STRUCT *tc)
       return v;
     }
 
+  if (tc->type == TC_DOGLEG)
+    {
+      t = tcAxisProfileTime(&tc->geom->axis[tc->geom->leadAxis], tc->currentPos);
+      v.tran.x = tc->geom->line.start.tran.x + tcAxisProfilePos(&tc->geom->axis[0], t);
+      v.tran.y = tc->geom->line.start.tran.y + tcAxisProfilePos(&tc->geom->axis[1], t);
+      v.tran.z = tc->geom->line.start.tran.z + tcAxisProfilePos(&tc->geom->axis[2], t);
+      v.a = tc->geom->line_abc.start.tran.x + tcAxisProfilePos(&tc->geom->axis[3], t);
+      v.b = tc->geom->line_abc.start.tran.y + tcAxisProfilePos(&tc->geom->axis[4], t);
+      v.c = tc->geom->line_abc.start.tran.z + tcAxisProfilePos(&tc->geom->axis[5], t);
+      v.u = tc->geom->line_uvw.start.tran.x + tcAxisProfilePos(&tc->geom->axis[6], t);
+      v.v = tc->geom->line_uvw.start.tran.y + tcAxisProfilePos(&tc->geom->axis[7], t);
+      v.w = tc->geom->line_uvw.start.tran.z + tcAxisProfilePos(&tc->geom->axis[8], t);
+      return v;
+    }
+
   /* note: was if tc->targetPos <= 0.0 return basePos */
   if (tc->type == TC_LINEAR)
     {
-      pmLinePoint(&tc->line, tc->currentPos, &v1);
+      pmLinePointI(&tc->geom->line, tc->currentPos, &v.tran);
     }
   else if (tc->type == TC_CIRCULAR)
     {
-      pmCirclePoint(&tc->circle, tc->currentPos / tc->circle.radius, &v1);
+      if (tc->currentPos >= tc->targetPos)
+        {
+          /* exact at the end, so the next segment starts where this one stops */
+          pmCirclePoint(&tc->geom->circle, tc->currentPos / tc->geom->circle.radius, &v1);
+          v.tran = v1.tran;
+        }
+      else
+        {
+          tcArcPoint(tc, &v.tran);
+        }
     }
   else
     {
-      v1.tran.x = v1.tran.y = v1.tran.z = 0.0;
-      v1.rot.s = 1.0;
-      v1.rot.x = v1.rot.y = v1.rot.z = 0.0;
+      v.tran.x = v.tran.y = v.tran.z = 0.0;
     }
-  v.tran = v1.tran;
   if(tc->abc_mag > 1e-6) 
     {
       if(tc->tmag > 1e-6 )
 	{
-	  pmLinePoint(&tc->line_abc,(tc->currentPos *tc->abc_mag /tc->tmag),&v2);
-	  v.a = v2.tran.x; 
-	  v.b = v2.tran.y; 
-	  v.c = v2.tran.z; 
+	  pmLinePointI(&tc->geom->line_abc,(tc->currentPos *tc->abc_mag /tc->tmag),&abc);
+	}
+      else if(tc->uvw_mag > 1e-6)
+	{
+	  pmLinePointI(&tc->geom->line_abc,(tc->currentPos *tc->abc_mag /tc->uvw_mag),&abc);
 	}
       else
 	{
-	  pmLinePoint(&tc->line_abc,tc->currentPos,&v2);
-	  v.a = v2.tran.x; 
-	  v.b = v2.tran.y; 
-	  v.c = v2.tran.z; 
+	  pmLinePointI(&tc->geom->line_abc,tc->currentPos,&abc);
 	}
+      v.a = abc.x; 
+      v.b = abc.y; 
+      v.c = abc.z; 
     }
   else
     {
       v.a = v.b = v.c = 0.0;
     }
+  if(tc->uvw_mag > 1e-6)
+    {
+      if(tc->tmag > 1e-6)
+	{
+	  pmLinePointI(&tc->geom->line_uvw,(tc->currentPos *tc->uvw_mag /tc->tmag),&uvw);
+	}
+      else
+	{
+	  pmLinePointI(&tc->geom->line_uvw,tc->currentPos,&uvw);
+	}
+      v.u = uvw.x;
+      v.v = uvw.y;
+      v.w = uvw.z;
+    }
+  else
+    {
+      v.u = v.v = v.w = 0.0;
+    }
 	  
   return v;
 }
@@ -574,12 +950,13 @@ EmcPose tcGetGoalPos(TC_STRUCT *tc)
   {
     ev.tran.x = ev.tran.y = ev.tran.z = 0.0;
     ev.a = ev.b = ev.c = 0.0;
+    ev.u = ev.v = ev.w = 0.0;
     return ev;
   }
 
-  if (tc->type == TC_LINEAR)
+  if (tc->type == TC_LINEAR || tc->type == TC_DOGLEG)
     {
-      v = tc->line.end;
+      v = tc->geom->line.end;
     }
   else if (tc->type == TC_CIRCULAR)
     {
@@ -589,7 +966,7 @@ EmcPose tcGetGoalPos(TC_STRUCT *tc)
          this function is called often, we should save end point in the
          PM_CIRCLE struct. This will increase all TC_STRUCTS but make
          tcGetGoalPos() run faster. */
-      pmCirclePoint(&tc->circle, tc->circle.angle, &v);
+      pmCirclePoint(&tc->geom->circle, tc->geom->circle.angle, &v);
     }
   else
     {
@@ -599,9 +976,12 @@ EmcPose tcGetGoalPos(TC_STRUCT *tc)
     }
   
   ev.tran  = v.tran;
-  ev.a = tc->line_abc.end.tran.x;
-  ev.b = tc->line_abc.end.tran.y;
-  ev.c = tc->line_abc.end.tran.z;
+  ev.a = tc->geom->line_abc.end.tran.x;
+  ev.b = tc->geom->line_abc.end.tran.y;
+  ev.c = tc->geom->line_abc.end.tran.z;
+  ev.u = tc->geom->line_uvw.end.tran.x;
+  ev.v = tc->geom->line_uvw.end.tran.y;
+  ev.w = tc->geom->line_uvw.end.tran.z;
   return ev;
 }
 
@@ -716,8 +1096,10 @@ void tcPrint(TC_STRUCT *tc)
 
 /* TC_QUEUE_STRUCT definitions */
 
-int tcqCreate(TC_QUEUE_STRUCT *tcq, int _size, TC_STRUCT *tcSpace)
+int tcqCreate(TC_QUEUE_STRUCT *tcq, int _size, TC_STRUCT *tcSpace, TC_GEOM *geomSpace)
 {
+  int i;
+
   if (_size <= 0 ||
       0 == tcq)
   {
@@ -726,15 +1108,23 @@ int tcqCreate(TC_QUEUE_STRUCT *tcq, int _size, TC_STRUCT *tcSpace)
   else
   {
     tcq->queue = tcSpace;
+    tcq->geom = geomSpace;
     tcq->size = _size;
     tcq->_len = 0;
     tcq->start = tcq->end = 0;
     tcq->allFull = 0;
 
-    if (0 == tcq->queue)
+    if (0 == tcq->queue ||
+        0 == tcq->geom)
       {
         return -1;
       }
+
+    /* every slot keeps its geometry, so tcs are never copied whole */
+    for (i = 0; i < _size; i++)
+      {
+        tcq->queue[i].geom = &tcq->geom[i];
+      }
     return 0;
   }
 }
@@ -746,6 +1136,7 @@ int tcqDelete(TC_QUEUE_STRUCT *tcq)
   {
     /*    free(tcq->queue); */
     tcq->queue = 0;
+    tcq->geom = 0;
   }
 
   return 0;
@@ -764,8 +1155,28 @@ int tcqInit(TC_QUEUE_STRUCT *tcq)
   return 0;
 }
 
-/* put sometc on the end of the queue */
-int tcqPut(TC_QUEUE_STRUCT *tcq, TC_STRUCT tc)
+/* get the free slot at the end of the queue, the caller fills it in
+   place with tcInit() and tcSet*() then puts it on with tcqCommit() */
+TC_STRUCT * tcqEmplace(TC_QUEUE_STRUCT *tcq)
+{
+  /* check for initialized */
+  if (0 == tcq ||
+      0 == tcq->queue)
+  {
+    return (TC_STRUCT *) 0;
+  }
+
+  /* check for allFull, so we don't overflow the queue */
+  if (tcq->allFull)
+  {
+    return (TC_STRUCT *) 0;
+  }
+
+  return &(tcq->queue[tcq->end]);
+}
+
+/* put the slot from tcqEmplace() on the end of the queue */
+int tcqCommit(TC_QUEUE_STRUCT *tcq)
 {
   /* check for initialized */
   if (0 == tcq ||
@@ -781,7 +1192,6 @@ int tcqPut(TC_QUEUE_STRUCT *tcq, TC_STRUCT tc)
   }
 
   /* add it */
-  tcq->queue[tcq->end] = tc;
   tcq->_len++;
 
   /* update end ptr, modulo size of queue */
@@ -796,53 +1206,6 @@ int tcqPut(TC_QUEUE_STRUCT *tcq, TC_STRUCT tc)
   return 0;
 }
 
-/* get the first item from the beginning of the queue */
-TC_STRUCT tcqGet(TC_QUEUE_STRUCT *tcq, int *status)
-{
-  TC_STRUCT tc;
-
-  if ((0 == tcq) ||
-      (0 == tcq->queue) ||              /* not initialized */
-      ((tcq->start == tcq->end) && ! tcq->allFull)) /* empty queue */
-  {
-    if (0 != status)
-    {
-      *status = -1;             /* set status flag, if passed */
-    }
-    tc.cycleTime=0;
-    tc.targetPos=0;             /* positive motion progession */
-    tc.vMax=0;                  /* max velocity */
-    tc.vScale=0;                /* scale factor for vMax */
-    tc.aMax=0;                  /* max accel */
-    tc.preVMax=0;               /* vel from previous blend */
-    tc.preAMax=0;               /* decel (negative) from previous blend */
-    tc.vLimit=0;                /* abs vel limit, including scale */
-    tc.toGo=0;
-    tc.currentPos=0;
-    tc.currentVel=0;
-    tc.currentAccel=0;
-    tc.tcFlag=0;                        /* TC_IS_DONE,ACCEL,CONST,DECEL*/
-    tc.type=0;                  /* TC_LINEAR, TC_CIRCULAR */
-    tc.id=0;                    /* id for motion segment */
-    tc.termCond=0;                      /* TC_END_STOP,BLEND */
-    return tc;
-  }
-
-  /* get current int and set status for returning */
-  if (0 != status)
-  {
-    *status = 0;
-  }
-  tc = tcq->queue[tcq->start];
-
-  /* update start ptr and reset allFull flag and len */
-  tcq->start = (tcq->start + 1) % tcq->size;
-  tcq->allFull = 0;
-  tcq->_len--;
-
-  return tc;
-}
-
 /* remove n items from the queue */
 int tcqRemove(TC_QUEUE_STRUCT *tcq, int n)
 {
@@ -954,6 +1317,7 @@ double tcRunPreCycle(const TC_STRUCT *tc)
 {
   TC_STRUCT preTc;
   double ratio;                 /* ratio of (new pos) / (target pos) */
+  unsigned char dout = 0;       /* outputs of the copy are thrown away */
 
   if (0 == tc)
     {
@@ -968,7 +1332,7 @@ double tcRunPreCycle(const TC_STRUCT *tc)
   else
   {
     preTc = *tc;
-    tcRunCycle(&preTc);
+    tcRunCycle(&preTc, &dout);
     ratio = preTc.currentPos / preTc.targetPos;
   }
 
@@ -1045,25 +1409,19 @@ int tcForceCycle(TC_STRUCT *tc, double ratio)
 
 PmCartesian tcGetUnitCart(TC_STRUCT *tc)
 {
-  PmPose currentPose;
   PmCartesian radialCart;
   static const PmCartesian fake= {1.0,0.0,0.0};
 
-  if(tc->type == TC_LINEAR)
+  if(tc->type == TC_LINEAR || tc->type == TC_DOGLEG)
     {
-      pmCartCartSub(tc->line.end.tran,tc->line.start.tran,&tc->unitCart);
-#ifdef USE_PM_CART_NORM
-      pmCartNorm(tc->unitCart,&tc->unitCart);
-#else    
-      pmCartUnit(tc->unitCart,&tc->unitCart);
-#endif
+      /* pmLineInit() already normalized end - start */
+      tc->unitCart = tc->geom->line.uVec;
       return(tc->unitCart);
     }
   else if(tc->type == TC_CIRCULAR)
     {
-      pmCirclePoint(&tc->circle,tc->currentPos,&currentPose);
-      pmCartCartSub(currentPose.tran, tc->circle.center, &radialCart);
-      pmCartCartCross(tc->circle.normal, radialCart,&tc->unitCart);
+      tcArcRadial(tc, &radialCart);
+      pmCartCartCrossI(&tc->geom->circle.normal, &radialCart, &tc->unitCart);
 #ifdef USE_PM_CART_NORM
       pmCartNorm(tc->unitCart,&tc->unitCart);
 #else    
@@ -1081,9 +1439,9 @@ int tcSetDout(TC_STRUCT *tc, unsigned char douts, unsigned char starts, unsigned
     return -1;
   }
 
-  tc->douts = douts;
-  tc->doutstarts = starts;
-  tc->doutends = ends;
+  tc->geom->douts = douts;
+  tc->geom->doutstarts = starts;
+  tc->geom->doutends = ends;
 
   return 0;
 }
@@ -49,8 +49,56 @@
 
 #define TC_LINEAR 1
 #define TC_CIRCULAR 2
+#define TC_DOGLEG 3
 
-/* structure for individual trajectory elements */
+#define TC_DOGLEG_AXES 9        /* x y z a b c u v w */
+
+/* per axis profile of a dogleg (non-coordinated) move */
+
+typedef struct
+{
+  double dist;                  /* signed distance */
+  double vPeak;                 /* peak velocity, below vMax for short moves */
+  double aMax;                  /* max accel */
+  double tAccel;                /* time to reach vPeak */
+  double tTotal;                /* time to complete the move */
+} TC_AXIS_PROFILE;
+
+/* cached rotation of a circular move, stepped once per cycle */
+
+typedef struct
+{
+  double pos;                   /* path position of cos, sin below */
+  double cos;                   /* cos, sin of pos / radius */
+  double sin;
+  double step;                  /* path step of the rotation below */
+  double stepCos;               /* cos, sin of step / radius */
+  double stepSin;
+  int count;                    /* steps since the last exact evaluation */
+} TC_ARC_STEP;
+
+/* setup only geometry of a trajectory element, one per queue slot */
+
+typedef struct
+{
+  PmLine line;
+  PmLine line_abc;
+  PmLine line_uvw;
+  PmCircle circle;
+  TC_ARC_STEP arc;              /* TC_CIRCULAR only */
+  TC_AXIS_PROFILE axis[TC_DOGLEG_AXES]; /* TC_DOGLEG only */
+  int leadAxis;                 /* TC_DOGLEG axis with the longest move time */
+  double tvMax;			/* maximum translational velocity */
+  double taMax;			/* maximum translational accelleration */
+  double abc_vMax;		/* maximum rotational velocity */
+  double abc_aMax;		/* maximum rotational accelleration */
+  unsigned char douts;		/* mask for douts to set */
+  unsigned char doutstarts;	/* mask for dout start vals */
+  unsigned char doutends;	/* mask for dout end vals */
+} TC_GEOM;
+
+/* structure for individual trajectory elements, the state tcRunCycle() and
+   the blend loop in tpRunCycle() touch every cycle */
 
 typedef struct
 {
@@ -67,26 +115,16 @@ typedef struct
   double currentVel;
   double currentAccel;
   int tcFlag;                   /* TC_IS_DONE,ACCEL,CONST,DECEL*/
-  int type;                     /* TC_LINEAR, TC_CIRCULAR */
+  int type;                     /* TC_LINEAR, TC_CIRCULAR, TC_DOGLEG */
   int id;                       /* id for motion segment */
   int termCond;                 /* TC_END_STOP,BLEND */
-  PmLine line;
-  PmLine line_abc;
-  PmCircle circle;
   double tmag;			/* magnitude of translation */
   double abc_mag;		/* magnitude of rotation  */
-  double tvMax;			/* maximum translational velocity */
-  double taMax;			/* maximum translational accelleration */
-  double abc_vMax;		/* maximum rotational velocity */
-  double abc_aMax;		/* maximum rotational accelleration */
+  double uvw_mag;               /* magnitude of u v w translation */
   PmCartesian unitCart;
-  unsigned char douts;		/* mask for douts to set */
-  unsigned char doutstarts;	/* mask for dout start vals */
-  unsigned char doutends;	/* mask for dout end vals */
+  TC_GEOM *geom;                /* geometry, fixed per queue slot by tcqCreate() */
 } TC_STRUCT;
 
-extern unsigned char tcDoutByte;
-
 #ifdef __cplusplus
 extern "C"
 {
@@ -96,8 +134,9 @@ extern "C"
 
 int tcInit(TC_STRUCT *tc);
 int tcSetCycleTime(TC_STRUCT *tc, double secs);
-int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc);
-int tcSetCircle(TC_STRUCT *tc, PmCircle circle, PmLine line_abc);
+int tcSetLine(TC_STRUCT *tc, PmLine line, PmLine line_abc, PmLine line_uvw);
+int tcSetCircle(TC_STRUCT *tc, PmCircle circle, PmLine line_abc, PmLine line_uvw);
+int tcSetDogleg(TC_STRUCT *tc, PmLine line, PmLine line_abc, PmLine line_uvw, const double *vmax, const double *amax);
 int tcSetTVmax(TC_STRUCT *tc, double vmax);
 int tcSetRVmax(TC_STRUCT *tc, double vmax);
 int tcSetVscale(TC_STRUCT *tc, double vscale);
@@ -109,7 +148,8 @@ int tcSetId(TC_STRUCT *tc, int id);
 int tcGetId(TC_STRUCT *tc);
 int tcSetTermCond(TC_STRUCT *tc, int cond);
 int tcGetTermCond(TC_STRUCT *tc);
-int tcRunCycle(TC_STRUCT *tc);
+int tcRunCycle(TC_STRUCT *tc, unsigned char *dout);
+long tcRunCycleSkip(TC_STRUCT *tc, unsigned char *dout);
 EmcPose tcGetPos(TC_STRUCT *tc);
 EmcPose tcGetGoalPos(TC_STRUCT *tc);
 double tcGetVel(TC_STRUCT *tc);
@@ -131,6 +171,7 @@ int tcSetDout(TC_STRUCT *tc, unsigned char douts, unsigned char starts, unsigned
 typedef struct
 {
   TC_STRUCT *queue;             /* ptr to the tcs */
+  TC_GEOM *geom;                /* ptr to the tc geometry, parallel to queue */
   int size;                     /* size of queue */
   int _len;                     /* number of tcs now in queue */
   int start, end;               /* indices to next to get, next to put */
@@ -139,8 +180,8 @@ typedef struct
 
 /* TC_QUEUE_STRUCT functions */
 
-/* create queue of _size */
-int tcqCreate(TC_QUEUE_STRUCT *tcq, int _size, TC_STRUCT *tcSpace);
+/* create queue of _size, geomSpace has one TC_GEOM per tc */
+int tcqCreate(TC_QUEUE_STRUCT *tcq, int _size, TC_STRUCT *tcSpace, TC_GEOM *geomSpace);
 
 /* free up queue */
 int tcqDelete(TC_QUEUE_STRUCT *tcq);
@@ -148,11 +189,11 @@ int tcqDelete(TC_QUEUE_STRUCT *tcq);
 /* reset queue to empty */
 int tcqInit(TC_QUEUE_STRUCT *tcq);
 
-/* put tc on end */
-int tcqPut(TC_QUEUE_STRUCT *tcq, TC_STRUCT tc);
+/* free slot at the end to fill in place, 0 if full */
+TC_STRUCT * tcqEmplace(TC_QUEUE_STRUCT *tcq);
 
-/* get tcq from front */
-TC_STRUCT tcqGet(TC_QUEUE_STRUCT *tcq, int *status);
+/* put the slot from tcqEmplace() on end */
+int tcqCommit(TC_QUEUE_STRUCT *tcq);
 
 /* remove n tcs from front */
 int tcqRemove(TC_QUEUE_STRUCT *tcq, int n);
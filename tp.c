@@ -43,11 +43,12 @@
 */
 
 #include "posemath.h"
+#include "pminline.h"
 #include "tc.h"
 #include "tp.h"
 #include "bug.h"
 
-int tpCreate(TP_STRUCT *tp, int _queueSize, TC_STRUCT *tcSpace)
+int tpCreate(TP_STRUCT *tp, int _queueSize, TC_STRUCT *tcSpace, TC_GEOM *geomSpace)
 {
   if (0 == tp) {
     return -1;
@@ -61,7 +62,7 @@ int tpCreate(TP_STRUCT *tp, int _queueSize, TC_STRUCT *tcSpace)
   }
 
   /* create the queue */
-  if (-1 == tcqCreate(&tp->queue, tp->queueSize, tcSpace)) {
+  if (-1 == tcqCreate(&tp->queue, tp->queueSize, tcSpace, geomSpace)) {
     return -1;
   }
 
@@ -92,12 +93,7 @@ int tpDelete(TP_STRUCT *tp)
 int tpClear(TP_STRUCT *tp)
 {
   tcqInit(&tp->queue);
-  tp->goalPos.tran.x = tp->currentPos.tran.x;
-  tp->goalPos.tran.y = tp->currentPos.tran.y;
-  tp->goalPos.tran.z = tp->currentPos.tran.z;
-  tp->goalPos.a = tp->currentPos.a;
-  tp->goalPos.b = tp->currentPos.b;
-  tp->goalPos.c = tp->currentPos.c;
+  tp->goalPos = tp->currentPos;
   tp->nextId = 0;
   tp->execId = 0;
   tp->termCond = TC_TERM_COND_BLEND;
@@ -120,13 +116,9 @@ int tpInit(TP_STRUCT *tp)
   tp->vMax = 0.0;
   tp->wMax = 0.0;
   tp->wDotMax = 0.0;
+  tp->doutByte = 0;
 
-  tp->currentPos.tran.x = 0.0;
-  tp->currentPos.tran.y = 0.0;
-  tp->currentPos.tran.z = 0.0;
-  tp->currentPos.a = 0.0;
-  tp->currentPos.b = 0.0;
-  tp->currentPos.c = 0.0;
+  ZERO_EMC_POSE(tp->currentPos);
 
   return tpClear(tp);
 }
@@ -329,61 +321,62 @@ int tpSetPos(TP_STRUCT *tp, EmcPose pos)
   return 0;
 }
 
-int tpAddLine(TP_STRUCT *tp, EmcPose end)
+/* Line between two points of one axis group, xyz, abc or uvw. */
+static void tpGroupLine(PmLine *line, PmCartesian start, PmCartesian end)
 {
-  TC_STRUCT tc;
-  PmLine line, line_abc;
-  PmPose tran_pose, goal_tran_pose;
-  PmPose abc_pose, goal_abc_pose;
+  PmPose start_pose, end_pose;
 
-  if (0 == tp) {
-    return -1;
-  }
+  start_pose.tran = start;
+  start_pose.rot.s = 1.0;
+  start_pose.rot.x = start_pose.rot.y = start_pose.rot.z = 0.0;
+  end_pose.tran = end;
+  end_pose.rot.s = 1.0;
+  end_pose.rot.x = end_pose.rot.y = end_pose.rot.z = 0.0;
 
-  if (tp->aborting) {
-    return -1;
-  }
+  pmLineInit(line, start_pose, end_pose);
+}
+
+/* Lines from the current goal to end for the abc and uvw groups. */
+static void tpGroupLines(TP_STRUCT *tp, EmcPose end, PmLine *line_abc, PmLine *line_uvw)
+{
+  PmCartesian start, stop;
+
+  start.x = tp->goalPos.a;
+  start.y = tp->goalPos.b;
+  start.z = tp->goalPos.c;
+  stop.x = end.a;
+  stop.y = end.b;
+  stop.z = end.c;
+  tpGroupLine(line_abc, start, stop);
+
+  start.x = tp->goalPos.u;
+  start.y = tp->goalPos.v;
+  start.z = tp->goalPos.w;
+  stop.x = end.u;
+  stop.y = end.v;
+  stop.z = end.w;
+  tpGroupLine(line_uvw, start, stop);
+}
 
-  tran_pose.tran = end.tran;
-  tran_pose.rot.s = 1.0;
-  tran_pose.rot.x = tran_pose.rot.y = tran_pose.rot.z = 0.0;  
-  goal_tran_pose.tran = tp->goalPos.tran;
-  goal_tran_pose.rot.s = 1.0;
-  goal_tran_pose.rot.x = goal_tran_pose.rot.y = goal_tran_pose.rot.z = 0.0;
-
-  abc_pose.tran.x = end.a;
-  abc_pose.tran.y = end.b;
-  abc_pose.tran.z = end.c;
-  abc_pose.rot.s = 1.0;
-  abc_pose.rot.x = abc_pose.rot.y = abc_pose.rot.z = 0.0;  
-  goal_abc_pose.tran.x = tp->goalPos.a;
-  goal_abc_pose.tran.y = tp->goalPos.b;
-  goal_abc_pose.tran.z = tp->goalPos.c;
-  goal_abc_pose.rot.s = 1.0;
-  goal_abc_pose.rot.x = goal_abc_pose.rot.y = goal_abc_pose.rot.z = 0.0;
-
-  tcInit(&tc);
-
-  pmLineInit(&line, goal_tran_pose, tran_pose);
-  pmLineInit(&line_abc, goal_abc_pose, abc_pose);
-  tcSetCycleTime(&tc, tp->cycleTime);
-  tcSetTVmax(&tc, tp->vMax);
-  tcSetTAmax(&tc, tp->aMax);
-  tcSetRVmax(&tc, tp->wMax);
-  tcSetRAmax(&tc, tp->wDotMax);
-  tcSetVscale(&tc, tp->vScale);
-  tcSetVlimit(&tc, tp->vLimit);
-  tcSetLine(&tc, line, line_abc);
-  tcSetId(&tc, tp->nextId);
-  tcSetTermCond(&tc, tp->termCond);
+/* Lines from the current goal to end, translation, rotation and uvw parts. */
+static void tpLineInit(TP_STRUCT *tp, EmcPose end, PmLine *line, PmLine *line_abc, PmLine *line_uvw)
+{
+  tpGroupLine(line, tp->goalPos.tran, end.tran);
+  tpGroupLines(tp, end, line_abc, line_uvw);
+}
+
+/* Put a tc filled in place by tpAddLine(), tpAddDogleg() or tpAddCircle() on the queue. */
+static int tpQueueMove(TP_STRUCT *tp, TC_STRUCT *tc, EmcPose end)
+{
+  tcSetId(tc, tp->nextId);
   if (tp->douts) {
-    tcSetDout(&tc, tp->douts, tp->doutstart, tp->doutend);
+    tcSetDout(tc, tp->douts, tp->doutstart, tp->doutend);
     tp->douts = 0;
     tp->doutstart = 0;
     tp->doutend = 0;
   }
 
-  if (-1 == tcqPut(&tp->queue, tc)) {
+  if (-1 == tcqCommit(&tp->queue)) {
     return -1;
   }
 
@@ -395,14 +388,80 @@ int tpAddLine(TP_STRUCT *tp, EmcPose end)
   return 0;
 }
 
+int tpAddLine(TP_STRUCT *tp, EmcPose end)
+{
+  TC_STRUCT *tc;
+  PmLine line, line_abc, line_uvw;
+
+  if (0 == tp) {
+    return -1;
+  }
+
+  if (tp->aborting) {
+    return -1;
+  }
+
+  if (0 == (tc = tcqEmplace(&tp->queue))) {
+    return -1;
+  }
+  tcInit(tc);
+
+  tpLineInit(tp, end, &line, &line_abc, &line_uvw);
+  tcSetCycleTime(tc, tp->cycleTime);
+  tcSetTVmax(tc, tp->vMax);
+  tcSetTAmax(tc, tp->aMax);
+  tcSetRVmax(tc, tp->wMax);
+  tcSetRAmax(tc, tp->wDotMax);
+  tcSetVscale(tc, tp->vScale);
+  tcSetVlimit(tc, tp->vLimit);
+  tcSetLine(tc, line, line_abc, line_uvw);
+  tcSetTermCond(tc, tp->termCond);
+
+  return tpQueueMove(tp, tc, end);
+}
+
+/*
+  tpAddDogleg() adds a non-coordinated move, each of x y z a b c u v w runs on
+  its own vmax[]/amax[] profile (see tcSetDogleg()). The path leaves the
+  straight line so the move always stops at its end instead of blending.
+*/
+int tpAddDogleg(TP_STRUCT *tp, EmcPose end, const double *vmax, const double *amax)
+{
+  TC_STRUCT *tc;
+  PmLine line, line_abc, line_uvw;
+
+  if (0 == tp) {
+    return -1;
+  }
+
+  if (tp->aborting) {
+    return -1;
+  }
+
+  if (0 == (tc = tcqEmplace(&tp->queue))) {
+    return -1;
+  }
+  tcInit(tc);
+
+  tpLineInit(tp, end, &line, &line_abc, &line_uvw);
+  tcSetCycleTime(tc, tp->cycleTime);
+  tcSetTVmax(tc, tp->vMax);
+  tcSetTAmax(tc, tp->aMax);
+  tcSetVscale(tc, tp->vScale);
+  tcSetVlimit(tc, tp->vLimit);
+  tcSetDogleg(tc, line, line_abc, line_uvw, vmax, amax);
+  tcSetTermCond(tc, TC_TERM_COND_STOP);
+
+  return tpQueueMove(tp, tc, end);
+}
+
 int tpAddCircle(TP_STRUCT *tp, EmcPose end,
                 PmCartesian center, PmCartesian normal, int turn)
 {
-  TC_STRUCT tc;
+  TC_STRUCT *tc;
   PmCircle circle;
-  PmLine line_abc;
+  PmLine line_abc, line_uvw;
   PmPose endPose, circleGoalPose;
-  PmPose abc_pose,goal_abc_pose;
   endPose.tran = end.tran;
   endPose.rot.s = 1.0;
   endPose.rot.x = endPose.rot.y = endPose.rot.z = 0.0;
@@ -418,49 +477,24 @@ int tpAddCircle(TP_STRUCT *tp, EmcPose end,
     return -1;
   }
 
-  tcInit(&tc);
-  pmCircleInit(&circle, circleGoalPose, endPose, center, normal, turn);
-  tcSetCycleTime(&tc, tp->cycleTime);
-  tcSetTVmax(&tc, tp->vMax);
-  tcSetTAmax(&tc, tp->aMax);
-  tcSetRVmax(&tc, tp->wMax);
-  tcSetRAmax(&tc, tp->wDotMax);
-  tcSetVscale(&tc, tp->vScale);
-  tcSetVlimit(&tc, tp->vLimit);
-
-  abc_pose.tran.x = end.a;
-  abc_pose.tran.y = end.b;
-  abc_pose.tran.z = end.c;
-  abc_pose.rot.s = 1.0;
-  abc_pose.rot.x = abc_pose.rot.y = abc_pose.rot.z = 0.0;  
-  goal_abc_pose.tran.x = tp->goalPos.a;
-  goal_abc_pose.tran.y = tp->goalPos.b;
-  goal_abc_pose.tran.z = tp->goalPos.c;
-  goal_abc_pose.rot.s = 1.0;
-  goal_abc_pose.rot.x = goal_abc_pose.rot.y = goal_abc_pose.rot.z = 0.0;
-  pmLineInit(&line_abc, goal_abc_pose, abc_pose);
-
-  tcSetCircle(&tc, circle, line_abc);
-  tcSetId(&tc, tp->nextId);
-  tcSetTermCond(&tc, tp->termCond);
-
-  if (tp->douts) {
-    tcSetDout(&tc, tp->douts, tp->doutstart, tp->doutend);
-    tp->douts = 0;
-    tp->doutstart = 0;
-    tp->doutend = 0;
-  }
-
-  if (-1 == tcqPut(&tp->queue, tc)) {
+  if (0 == (tc = tcqEmplace(&tp->queue))) {
     return -1;
   }
-
-  tp->goalPos = end;
-  tp->done = 0;
-  tp->depth = tcqLen(&tp->queue);
-  tp->nextId++;
-
-  return 0;
+  tcInit(tc);
+  pmCircleInit(&circle, circleGoalPose, endPose, center, normal, turn);
+  tcSetCycleTime(tc, tp->cycleTime);
+  tcSetTVmax(tc, tp->vMax);
+  tcSetTAmax(tc, tp->aMax);
+  tcSetRVmax(tc, tp->wMax);
+  tcSetRAmax(tc, tp->wDotMax);
+  tcSetVscale(tc, tp->vScale);
+  tcSetVlimit(tc, tp->vLimit);
+
+  tpGroupLines(tp, end, &line_abc, &line_uvw);
+  tcSetCircle(tc, circle, line_abc, line_uvw);
+  tcSetTermCond(tc, tp->termCond);
+
+  return tpQueueMove(tp, tc, end);
 }
 
 int tpRunCycle(TP_STRUCT *tp)
@@ -468,7 +502,6 @@ int tpRunCycle(TP_STRUCT *tp)
   EmcPose sumPos;
   PmCartesian unitCart;
   double thisAccel =0.0, thisVel=0.0;
-  PmCartesian thisAccelCart, thisVelCart;
   PmCartesian accelCart, velCart;
   double currentAccelMag =0.0, currentVelMag =0.0;
   double dot =0.0;
@@ -486,19 +519,13 @@ int tpRunCycle(TP_STRUCT *tp)
     return -1;
   }
 
-  sumPos.tran.x = sumPos.tran.y = sumPos.tran.z = 0.0;
+  ZERO_EMC_POSE(sumPos);
   unitCart.x = unitCart.y = unitCart.z = 0.0;
   accelCart.x = accelCart.y = accelCart.z = 0.0;
   velCart.x = velCart.y = velCart.z = 0.0;
-  sumPos.a = sumPos.b = sumPos.c = 0.0;
 
   /* correct accumulation of errors between currentPos and before */
-  after.tran.x = before.tran.x = tp->currentPos.tran.x;
-  after.tran.y = before.tran.y = tp->currentPos.tran.y;
-  after.tran.z = before.tran.z = tp->currentPos.tran.z;
-  after.a = before.a = tp->currentPos.a;
-  after.b = before.b = tp->currentPos.b;
-  after.c = before.c = tp->currentPos.c;
+  after = before = tp->currentPos;
 
   /* run all TCs at and before this one */
   tp->activeDepth = 0;
@@ -540,9 +567,9 @@ int tpRunCycle(TP_STRUCT *tp)
 	 tcRunCycle will subtract preVMax from vMax and clamp the velocity to 
 	 this value.
       */
-      pmCartMag(velCart,&currentVelMag);
+      currentVelMag = pmCartMagI(&velCart);
       if (currentVelMag >= TP_VEL_EPSILON) {
-	pmCartCartDot(velCart, unitCart, &dot);
+	dot = pmCartCartDotI(&velCart, &unitCart);
 	preVMax = thisTc->vMax + dot - pmSqrt(pmSq(dot) -pmSq(currentVelMag) + pmSq(thisTc->vMax));
       }
       else {
@@ -555,9 +582,9 @@ int tpRunCycle(TP_STRUCT *tp)
 	 tcRunCycle will subtract preVMax from vMax and clamp the acceleration to 
 	 this value.
       */
-      pmCartMag(accelCart,&currentAccelMag);
+      currentAccelMag = pmCartMagI(&accelCart);
       if (currentAccelMag >= TP_ACCEL_EPSILON) {
-	pmCartCartDot(accelCart, unitCart, &dot);
+	dot = pmCartCartDotI(&accelCart, &unitCart);
 	preAMax = thisTc->aMax + dot - pmSqrt(pmSq(dot) - pmSq(currentAccelMag) + pmSq(thisTc->aMax));
       }
       else {
@@ -567,17 +594,14 @@ int tpRunCycle(TP_STRUCT *tp)
 
     before = tcGetPos(thisTc);
     tcSetPremax(thisTc, preVMax, preAMax);
-    tcRunCycle(thisTc);
+    tcRunCycle(thisTc, &tp->doutByte);
     after = tcGetPos(thisTc);
     if (tp->activeDepth <= toRemove) {
       tp->execId = tcGetId(thisTc);
     }
 
-    pmCartCartSub(after.tran, before.tran, &after.tran);
-    pmCartCartAdd(sumPos.tran, after.tran, &sumPos.tran);
-    sumPos.a += after.a - before.a;
-    sumPos.b += after.b - before.b;
-    sumPos.c += after.c - before.c;
+    emcPoseSubI(&after, &before, &after);
+    emcPoseAddI(&sumPos, &after, &sumPos);
 
     if (tcIsDone(thisTc)) {
       /* this one is done-- blend in the next one */
@@ -597,10 +621,8 @@ int tpRunCycle(TP_STRUCT *tp)
       thisAccel = tcGetAccel(thisTc);
       thisVel = tcGetVel(thisTc);
       unitCart = tcGetUnitCart(thisTc);
-      pmCartScalMult(unitCart, thisAccel, &thisAccelCart);
-      pmCartCartAdd(thisAccelCart, accelCart, &accelCart);
-      pmCartScalMult(unitCart, thisVel, &thisVelCart);
-      pmCartCartAdd(thisVelCart, velCart, &velCart);
+      pmCartScalMultAddI(&unitCart, thisAccel, &accelCart);
+      pmCartScalMultAddI(&unitCart, thisVel, &velCart);
       continue;
     }
     else {
@@ -623,10 +645,7 @@ int tpRunCycle(TP_STRUCT *tp)
   }
 
   /* increment current position with sum of increments */
-  pmCartCartAdd(tp->currentPos.tran, sumPos.tran, &tp->currentPos.tran);
-  tp->currentPos.a += sumPos.a;
-  tp->currentPos.b += sumPos.b;
-  tp->currentPos.c += sumPos.c;
+  emcPoseAddI(&tp->currentPos, &sumPos, &tp->currentPos);
   
   /* check for abort done */
   if (tp->aborting &&
@@ -635,9 +654,9 @@ int tpRunCycle(TP_STRUCT *tp)
     /* all paused and we're aborting-- clear out the TP queue */
     /* first set the motion outputs to the end values for the current move */
     if (tp->douts) {
-      tcDoutByte |= (thisTc->douts & thisTc->doutends);
-      tcDoutByte &= (~thisTc->douts | thisTc->doutends);
-      //extMotDout(tcDoutByte);
+      tp->doutByte |= (thisTc->geom->douts & thisTc->geom->doutends);
+      tp->doutByte &= (~thisTc->geom->douts | thisTc->geom->doutends);
+      //extMotDout(tp->doutByte);
     }
     tcqInit(&tp->queue);
     tp->goalPos = tp->currentPos;
@@ -652,6 +671,39 @@ int tpRunCycle(TP_STRUCT *tp)
   return 0;
 }
 
+/*
+  tpRunEstimate() runs the queued segments to the end one at a time, the
+  way the dispatcher drains the queue after each move, and returns the
+  number of tpRunCycle() cycles that takes. No positions are produced.
+  Used by the cycle time estimator.
+*/
+long tpRunEstimate(TP_STRUCT *tp)
+{
+  TC_STRUCT *tc;
+  long n, cycles = 0;
+
+  if (0 == tp) {
+    return 0;
+  }
+
+  while (tcqLen(&tp->queue) > 0) {
+    tc = tcqItem(&tp->queue, 0, 0);
+    tcSetPremax(tc, 0.0, 0.0);
+    while (!tcIsDone(tc) && (n = tcRunCycleSkip(tc, &tp->doutByte)) > 0) {
+      cycles += n;
+    }
+    tcqRemove(&tp->queue, 1);
+  }
+
+  tp->currentPos = tp->goalPos;
+  tp->done = 1;
+  tp->depth = 0;
+  tp->activeDepth = 0;
+  tp->execId = 0;
+
+  return cycles;
+}
+
 int tpPause(TP_STRUCT *tp)
 {
   if (0 == tp)
@@ -723,8 +775,7 @@ EmcPose tpGetPos(TP_STRUCT *tp)
 
   if (0 == tp)
     {
-      retval.tran.x = retval.tran.y = retval.tran.z = 0.0;
-      retval.a = retval.b = retval.c = 0.0;
+      ZERO_EMC_POSE(retval);
       return retval;
     }
 
@@ -61,6 +61,7 @@ typedef struct
   unsigned char douts;		/* mask for douts to set */
   unsigned char doutstart;	/* mask for dout start vals */
   unsigned char doutend;	/* mask for dout end vals */
+  unsigned char doutByte;	/* output byte written by the segments, persists across them */
 } TP_STRUCT;
 
 #ifdef __cplusplus
@@ -68,7 +69,7 @@ extern "C"
 {
 #endif
 
-int tpCreate(TP_STRUCT *tp, int _queueSize, TC_STRUCT *tcSpace);
+int tpCreate(TP_STRUCT *tp, int _queueSize, TC_STRUCT *tcSpace, TC_GEOM *geomSpace);
 int tpDelete(TP_STRUCT *tp);
 int tpClear(TP_STRUCT *tp);
 int tpInit(TP_STRUCT *tp);
@@ -87,9 +88,11 @@ int tpSetTermCond(TP_STRUCT *tp, int cond);
 int tpGetTermCond(TP_STRUCT *tp);
 int tpSetPos(TP_STRUCT *tp, EmcPose pos);
 int tpAddLine(TP_STRUCT *tp, EmcPose end);
+int tpAddDogleg(TP_STRUCT *tp, EmcPose end, const double *vmax, const double *amax);
 int tpAddCircle(TP_STRUCT *tp, EmcPose end,
                        PmCartesian center, PmCartesian normal, int turn);
 int tpRunCycle(TP_STRUCT *tp);
+long tpRunEstimate(TP_STRUCT *tp);
 int tpPause(TP_STRUCT *tp);
 int tpResume(TP_STRUCT *tp);
 int tpAbort(TP_STRUCT *tp);
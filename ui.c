@@ -30,6 +30,8 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
 #include <math.h>
 #include <string.h>
 #include <errno.h>
@@ -78,7 +80,33 @@ static plugin_cb_t _plugin_cb = NULL;
 
 static pthread_mutex_t ui_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-struct emc_session session;
+int emc_log_level = EMC_LOG_MAX;     /* everything the build compiles in, DBG in debug builds */
+
+/* While a session is open, log messages are formatted into a lock free ring
+ * and handed to the logger callback by _log_thread(), so BUG/MSG/DBG never
+ * wait on ui_mutex or python. Producers claim a slot by its sequence number
+ * (bounded MPMC queue), a full ring drops the message. With no session open
+ * messages go straight to the callback as before. */
+#define LOG_RING_SIZE 256       /* power of two */
+#define LOG_MSG_MAX 512
+
+struct log_slot
+{
+   volatile unsigned int seq;   /* == claim position: free, + 1: message ready */
+   char msg[LOG_MSG_MAX];
+};
+
+static struct log_slot _log_ring[LOG_RING_SIZE];
+static volatile unsigned int _log_head;      /* next slot to claim */
+static volatile unsigned int _log_tail;      /* next slot to drain, _log_thread() only */
+static volatile unsigned int _log_dropped;
+static volatile int _log_running;
+static volatile int _log_users;              /* producers between the _log_running test and publish */
+static volatile int _log_exit;
+static int _log_sessions;
+static sem_t _log_sem;
+static pthread_t _log_tid;
+static pthread_mutex_t _log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* Axis:                                    1    2    3    4     5     6     7     8      9  */
 static const int _map_axes_mask[] = { 0x0, 0x1, 0x3, 0x7, 0xf, 0x1f, 0x3f, 0x7f, 0xff, 0x1ff };
@@ -286,26 +314,144 @@ void esleep(double seconds)
    return;
 }       /* esleep() */
 
+static void _log_emit(const char *msg)
+{
+   pthread_mutex_lock(&ui_mutex);
+   if (_logger_cb)
+      (_logger_cb) (msg);  /* make direct call to python logger */
+   else
+      fputs(msg, stdout);
+   pthread_mutex_unlock(&ui_mutex);
+}
+
+/* Claim a ring slot and format into it, returns 0 if the ring is full. */
+static int _log_push(const char *fmt, va_list args)
+{
+   struct log_slot *slot;
+   unsigned int pos;
+   int dif;
+
+   pos = _log_head;
+   for (;;)
+   {
+      slot = &_log_ring[pos & (LOG_RING_SIZE - 1)];
+      dif = (int)(slot->seq - pos);
+      if (dif == 0)
+      {
+         if (__sync_bool_compare_and_swap(&_log_head, pos, pos + 1))
+            break;
+         pos = _log_head;
+      }
+      else if (dif < 0)
+         return 0;      /* full */
+      else
+         pos = _log_head;
+   }
+
+   vsnprintf(slot->msg, sizeof(slot->msg), fmt, args);
+   slot->msg[sizeof(slot->msg) - 1] = 0;    /* force zero termination */
+   __sync_synchronize();
+   slot->seq = pos + 1;
+   sem_post(&_log_sem);
+   return 1;
+}
+
+static void *_log_thread(void *arg)
+{
+   struct log_slot *slot;
+   unsigned int dropped;
+   char tmp[64];
+
+   for (;;)
+   {
+      sem_wait(&_log_sem);
+      if (_log_tail != _log_head)
+      {
+         slot = &_log_ring[_log_tail & (LOG_RING_SIZE - 1)];
+         while (slot->seq != _log_tail + 1)
+            sched_yield();      /* claimed, still being formatted */
+         __sync_synchronize();
+         _log_emit(slot->msg);
+         __sync_synchronize();
+         slot->seq = _log_tail + LOG_RING_SIZE;
+         _log_tail++;
+      }
+
+      if (_log_dropped && (dropped = __sync_lock_test_and_set(&_log_dropped, 0)))
+      {
+         snprintf(tmp, sizeof(tmp), "%u log messages dropped\n", dropped);
+         _log_emit(tmp);
+      }
+
+      if (_log_exit && _log_tail == _log_head)
+         break;
+   }
+   return NULL;
+}
+
+/* Called by emc_ui_open(), starts the ring with the first session. */
+static void _log_start(void)
+{
+   unsigned int i;
+
+   pthread_mutex_lock(&_log_mutex);
+   if (_log_sessions++ == 0)
+   {
+      for (i = 0; i < LOG_RING_SIZE; i++)
+         _log_ring[i].seq = i;
+      _log_head = _log_tail = 0;
+      _log_exit = 0;
+      sem_init(&_log_sem, 0, 0);
+      if (pthread_create(&_log_tid, NULL, _log_thread, NULL) == 0)
+         _log_running = 1;
+      else
+         sem_destroy(&_log_sem);
+   }
+   pthread_mutex_unlock(&_log_mutex);
+}
+
+/* Called by emc_ui_close(), drains and stops the ring with the last session. */
+static void _log_stop(void)
+{
+   pthread_mutex_lock(&_log_mutex);
+   if (--_log_sessions == 0 && _log_running)
+   {
+      _log_running = 0;
+      __sync_synchronize();
+      while (_log_users)
+         sched_yield();         /* let producers that saw _log_running publish */
+      _log_exit = 1;
+      __sync_synchronize();
+      sem_post(&_log_sem);
+      pthread_join(_log_tid, NULL);
+      sem_destroy(&_log_sem);
+   }
+   pthread_mutex_unlock(&_log_mutex);
+}
+
 enum EMC_RESULT emc_logger_cb(const char *fmt, ...)
 {
    va_list args;
-   char tmp[512];
-
-   pthread_mutex_lock(&ui_mutex);
+   char tmp[LOG_MSG_MAX];
 
    va_start(args, fmt);
 
+   __sync_fetch_and_add(&_log_users, 1);
+   if (_log_running)
+   {
+      if (!_log_push(fmt, args))
+         __sync_fetch_and_add(&_log_dropped, 1);
+      __sync_fetch_and_sub(&_log_users, 1);
+      va_end(args);
+      return EMC_R_OK;
+   }
+   __sync_fetch_and_sub(&_log_users, 1);
+
    vsnprintf(tmp, sizeof(tmp), fmt, args);
    tmp[sizeof(tmp) - 1] = 0;    /* force zero termination */
-
-   if (_logger_cb)
-      (_logger_cb) (tmp);  /* make direct call to python logger */
-   else
-      fputs(tmp, stdout);
+   _log_emit(tmp);
 
    va_end(args);
-
-   pthread_mutex_unlock(&ui_mutex);
    return EMC_R_OK;
 } /* emc_logger_cb() */
 
@@ -421,6 +567,13 @@ DLL_EXPORT enum EMC_RESULT emc_ui_logger_register_cb(logger_cb_t fp)
    return EMC_R_OK;
 }
 
+/* Messages above level (EMC_LOG_xxx) are skipped without formatting. */
+DLL_EXPORT enum EMC_RESULT emc_ui_logger_level_set(int level)
+{
+   emc_log_level = level;
+   return EMC_R_OK;
+}
+
 DLL_EXPORT enum EMC_RESULT emc_ui_gui_event_register_cb(post_event_cb_t fp)
 {
    _post_event_cb = fp;
@@ -507,6 +660,12 @@ DLL_EXPORT enum EMC_RESULT emc_ui_auto_cmd(void *hd, const char *gcode_file)
    return dsp_auto(ps, gcode_file);
 }       /* emc_ui_auto_cmd() */
 
+DLL_EXPORT enum EMC_RESULT emc_ui_auto_from_line_cmd(void *hd, const char *gcode_file, int line_number)
+{
+   struct emc_session *ps = (struct emc_session *)hd;
+   return dsp_auto_from_line(ps, gcode_file, line_number);
+}       /* emc_ui_auto_from_line_cmd() */
+
 DLL_EXPORT enum EMC_RESULT emc_ui_auto_cancel_set(void *hd)
 {
    struct emc_session *ps = (struct emc_session *)hd;
@@ -527,6 +686,18 @@ DLL_EXPORT enum EMC_RESULT emc_ui_verify_cmd(void *hd, const char *gcode_file)
    return dsp_verify(ps, gcode_file);
 }       /* emc_ui_verify_cmd() */
 
+DLL_EXPORT enum EMC_RESULT emc_ui_verify_summary_cmd(void *hd, const char *gcode_file, struct emc_verify_summary *sum, struct emc_verify_point *path, int path_max)
+{
+   struct emc_session *ps = (struct emc_session *)hd;
+   return dsp_verify_summary(ps, gcode_file, sum, path, path_max);
+}       /* emc_ui_verify_summary_cmd() */
+
+DLL_EXPORT enum EMC_RESULT emc_ui_estimate_cmd(void *hd, const char *gcode_file, struct emc_estimate *est, double *range_time, int range_lines, int range_cnt)
+{
+   struct emc_session *ps = (struct emc_session *)hd;
+   return dsp_estimate(ps, gcode_file, est, range_time, range_lines, range_cnt);
+}       /* emc_ui_estimate_cmd() */
+
 DLL_EXPORT enum EMC_RESULT emc_ui_verify_cancel_set(void *hd)
 {
    struct emc_session *ps = (struct emc_session *)hd;
@@ -659,6 +830,18 @@ DLL_EXPORT enum EMC_RESULT emc_ui_input_adc_get(void *hd, int input_num, int *va
    return EMC_R_OK;
 }
 
+/* Get a value from the session's .ini file out of the parsed ini store. */
+DLL_EXPORT enum EMC_RESULT emc_ui_ini_get(void *hd, const char *section, const char *key, char *value, int value_size)
+{
+   struct emc_session *ps = (struct emc_session *)hd;
+
+   if (value_size <= 0)
+      return EMC_R_ERROR;
+   if (ini_get(ps->ini_file, section, key, value, value_size, NULL, 0) == NULL)
+      return EMC_R_ERROR;
+   return EMC_R_OK;
+}
+
 DLL_EXPORT enum EMC_RESULT emc_ui_test(const char *snum)
 {
    return rtstepper_test(snum);
@@ -666,12 +849,21 @@ DLL_EXPORT enum EMC_RESULT emc_ui_test(const char *snum)
 
 DLL_EXPORT void *emc_ui_open(const char *home, const char *ini_file)
 {
-   struct emc_session *ret = NULL, *ps = &session;
+   struct emc_session *ret = NULL, *ps;
    char inistring[LINELEN];
    int i, rstat;
 
    DBG("[%d] emc_ui_open() ini=%s\n", getpid(), ini_file);
 
+   /* Each open gets its own session, zeroed as the old global one was. */
+   if ((ps = (struct emc_session *)calloc(1, sizeof(struct emc_session))) == NULL)
+   {
+      BUG("unable to malloc emc_session\n");
+      goto bugout;
+   }
+
+   _log_start();
+
    strncpy(USER_HOME_DIR, home, sizeof(USER_HOME_DIR));
    USER_HOME_DIR[sizeof(USER_HOME_DIR)-1] = 0;  /* force zero termination */
 
@@ -700,15 +892,22 @@ DLL_EXPORT void *emc_ui_open(const char *home, const char *ini_file)
    ps->maxVelocity = ini_getfloat(ini_file, "TRAJ", "MAX_VELOCITY", 1e99, 1);
    // by default, use AXIS limit
    ps->maxAcceleration = ini_getfloat(ini_file, "TRAJ", "MAX_ACCELERATION", 1e99, 1);
+   ps->rapid_mode = ini_getint(ini_file, "TRAJ", "RAPID_MODE", EMC_RAPID_COORDINATED, 0);
 
    _load_tool_table(ini_get(ini_file, "EMC", "TOOL_TABLE", inistring, sizeof(inistring), "stepper.tbl", 1), ps->toolTable);
 
    /* Set defaults for all nine axis. */
+   ps->backlash_mask = 0;
    for (i=0; i < EMC_MAX_AXIS; i++)
+   {
       _load_axis(ps, i, (i < ps->axes) ? 1 : 0);
+      if (i < ps->axes && ps->axis[i].backlash != 0.0)
+         ps->backlash_mask |= 1 << i;
+   }
 
    INIT_LIST_HEAD(&ps->head.list);
    INIT_LIST_HEAD(&ps->ctrl_head.list);
+   rtstepper_init(ps);
 
    emc_position_post_cb(0, ps->position);
 
@@ -720,8 +919,19 @@ DLL_EXPORT void *emc_ui_open(const char *home, const char *ini_file)
    if (dsp_open(ps) != EMC_R_OK || rstat != EMC_R_OK)
       emc_estop_post_cb(ps);
 
+   if (ps->dsp == NULL)
+   {
+      /* No interpreter, the session is unusable. */
+      rtstepper_close(ps);
+      rtstepper_exit(ps);
+      free(ps);
+      _log_stop();
+      goto bugout;
+   }
+
    ret = ps;
 
+bugout:
    return ret;  /* return an opaque handle */
 }       /* emc_ui_open() */
 
@@ -729,8 +939,13 @@ DLL_EXPORT enum EMC_RESULT emc_ui_close(void *hd)
 {
    struct emc_session *ps = (struct emc_session *)hd;
    DBG("[%d] emc_ui_close()\n", getpid());
+   if (ps == NULL)
+      return EMC_R_ERROR;
    dsp_close(ps);
    rtstepper_close(ps);
+   rtstepper_exit(ps);
+   free(ps);
+   _log_stop();
    return EMC_R_OK;
 }       /* emc_ui_close() */
 